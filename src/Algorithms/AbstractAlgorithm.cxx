@@ -20,11 +20,19 @@
 
 #include "AbstractAlgorithm.h"
 
+#include "CaretProfiler.h"
+
 using namespace std;
 using namespace caret;
 
-AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject)
+AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject, const char* algorithmName)
 {
+    m_profiled = CaretProfiler::isEnabled();
+    if (m_profiled)
+    {//the derived constructor does the processing, so the lifetime of this base covers it (including when it throws)
+        AString myName(algorithmName);
+        CaretProfiler::beginScope(myName.isEmpty() ? AString("algorithm") : myName, "algorithm");
+    }
     m_progObj = myProgressObject;
     m_finish = true;
     if (m_progObj == NULL)
@@ -56,6 +64,10 @@ float AbstractAlgorithm::getAlgorithmWeight()
 
 AbstractAlgorithm::~AbstractAlgorithm()
 {
+    if (m_profiled)
+    {
+        CaretProfiler::endScope();
+    }
     if ((m_progObj != NULL) && m_finish)
     {
         m_progObj->forceFinish();
@@ -24,6 +24,7 @@
 //make it easy to use these in an algorithm class, don't just forward declare them
 #include "ProgressObject.h"
 #include "CaretAssert.h"
+#include "CaretFunctionName.h"
 #include "OperationParameters.h"
 #include "AbstractOperation.h"
 
@@ -34,13 +35,15 @@ namespace caret {
     {
         ProgressObject* m_progObj;//so that the destructor can make sure the bar finishes
         bool m_finish;
+        bool m_profiled;
         AbstractAlgorithm();//prevent default construction
     protected:
         ///override this with the weights of the algorithms this algorithm will call
         static float getSubAlgorithmWeight();//protected so that people don't try to use them to set algorithm weights in progress objects
         ///override this with the amount of work the algorithm does internally, outside of calls to other algorithms
         static float getAlgorithmInternalWeight();
-        AbstractAlgorithm(ProgressObject* myProgressObject);
+        ///the name is only used for -profile output, the default picks up the name of the derived constructor
+        AbstractAlgorithm(ProgressObject* myProgressObject, const char* algorithmName = __CARET_CALLING_FUNCTION_NAME__);
         virtual ~AbstractAlgorithm();
     public:
         ///use this to set the weight parameter of a ProgressObject
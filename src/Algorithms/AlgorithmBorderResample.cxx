@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "Border.h"
+#include "CaretOMP.h"
 #include "BorderFile.h"
 #include "GiftiLabelTable.h"
 #include "GiftiMetaData.h"
@@ -30,6 +31,8 @@
 #include "SurfaceProjectionBarycentric.h"
 #include "SignedDistanceHelper.h"
 
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -89,34 +92,68 @@ AlgorithmBorderResample::AlgorithmBorderResample(ProgressObject* myProgObj, cons
         borderOut->addBorderMetadataKey(borderIn->getBorderMetadataKey(m));//rely on the keys being in order added
     }
     int numBorders = borderIn->getNumberOfBorders();
-    CaretPointer<SignedDistanceHelper> myHelp = newAdjust.getSignedDistanceHelper();
+    vector<int> resampleBorders;
     for (int i = 0; i < numBorders; ++i)
     {
-        const Border* inputBorder = borderIn->getBorder(i);
-        if (inputBorder->getStructure() != curSphere->getStructure()) continue;
-        CaretPointer<Border> outputBorder(new Border());//in case something throws
-        outputBorder->setName(inputBorder->getName());
-        outputBorder->setClassName(inputBorder->getClassName());
-        outputBorder->setClosed(inputBorder->isClosed());
-        int numPoints = inputBorder->getNumberOfPoints();
-        for (int j = 0; j < numPoints; ++j)
+        if (borderIn->getBorder(i)->getStructure() == curSphere->getStructure()) resampleBorders.push_back(i);
+    }
+    int numResample = (int)resampleBorders.size();
+    vector<CaretPointer<Border> > outputBorders(numResample);
+    vector<AString> errorMessages(numResample);//can't throw out of a parallel region
+#pragma omp CARET_PAR if (numResample > 1)
+    {
+        CaretPointer<SignedDistanceHelper> myHelp = newAdjust.getSignedDistanceHelper();//one per thread, they share the surface's triangle search structure
+        vector<float> coords;
+        vector<BarycentricInfo> baryInfos;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int b = 0; b < numResample; ++b)
         {
-            CaretPointer<SurfaceProjectedItem> outPoint(new SurfaceProjectedItem());//ditto
-            float coord[3];
-            const SurfaceProjectedItem* myItem = inputBorder->getPoint(j);
-            if (!myItem->getBarycentricProjection()->isValid()) throw AlgorithmException("input file has a border point without barycentric projection");//because we never want to use van essen projection or straight coords
-            bool valid = myItem->getBarycentricProjection()->unprojectToSurface(curAdjust, coord, 0.0f, true);//should really be "from" surface - "true" makes it not use the signed distance above surface, if present
-            if (!valid) throw AlgorithmException("input file has a border point that is invalid for the current sphere");
-            BarycentricInfo myBaryInfo;
-            myHelp->barycentricWeights(coord, myBaryInfo);
-            outPoint->setStructure(inputBorder->getStructure());
-            outPoint->getBarycentricProjection()->setTriangleNodes(myBaryInfo.nodes);
-            outPoint->getBarycentricProjection()->setTriangleAreas(myBaryInfo.baryWeights);
-            outPoint->getBarycentricProjection()->setProjectionSurfaceNumberOfNodes(newSphere->getNumberOfNodes());
-            outPoint->getBarycentricProjection()->setValid(true);
-            outputBorder->addPoint(outPoint.releasePointer());//NOTE: addPoint currently takes ownership of a RAW POINTER - shared_ptr won't release the pointer, so this function would need to be deprecated
+            const Border* inputBorder = borderIn->getBorder(resampleBorders[b]);
+            int numPoints = inputBorder->getNumberOfPoints();
+            coords.resize(numPoints * 3);
+            baryInfos.resize(numPoints);
+            bool pointsValid = true;
+            for (int j = 0; j < numPoints; ++j)
+            {
+                const SurfaceProjectedItem* myItem = inputBorder->getPoint(j);
+                if (!myItem->getBarycentricProjection()->isValid())
+                {
+                    errorMessages[b] = "input file has a border point without barycentric projection";//because we never want to use van essen projection or straight coords
+                    pointsValid = false;
+                    break;
+                }
+                bool valid = myItem->getBarycentricProjection()->unprojectToSurface(curAdjust, coords.data() + j * 3, 0.0f, true);//should really be "from" surface - "true" makes it not use the signed distance above surface, if present
+                if (!valid)
+                {
+                    errorMessages[b] = "input file has a border point that is invalid for the current sphere";
+                    pointsValid = false;
+                    break;
+                }
+            }
+            if (!pointsValid) continue;
+            if (numPoints > 0) myHelp->barycentricWeights(coords.data(), numPoints, baryInfos.data());//consecutive border points are close together, so each search starts from the previous triangle
+            outputBorders[b].grabNew(new Border());
+            Border* outputBorder = outputBorders[b];
+            outputBorder->setName(inputBorder->getName());
+            outputBorder->setClassName(inputBorder->getClassName());
+            outputBorder->setClosed(inputBorder->isClosed());
+            for (int j = 0; j < numPoints; ++j)
+            {
+                CaretPointer<SurfaceProjectedItem> outPoint(new SurfaceProjectedItem());//in case something throws
+                outPoint->setStructure(inputBorder->getStructure());
+                outPoint->getBarycentricProjection()->setTriangleNodes(baryInfos[j].nodes);
+                outPoint->getBarycentricProjection()->setTriangleAreas(baryInfos[j].baryWeights);
+                outPoint->getBarycentricProjection()->setProjectionSurfaceNumberOfNodes(newSphere->getNumberOfNodes());
+                outPoint->getBarycentricProjection()->setValid(true);
+                outputBorder->addPoint(outPoint.releasePointer());//NOTE: addPoint currently takes ownership of a RAW POINTER - shared_ptr won't release the pointer, so this function would need to be deprecated
+            }
         }
-        borderOut->addBorder(outputBorder.releasePointer());//NOTE: again, ownership of RAW POINTER
+    }
+    for (int b = 0; b < numResample; ++b)
+    {//report errors and add borders in file order
+        if (errorMessages[b] != "") throw AlgorithmException(errorMessages[b]);
+        const Border* inputBorder = borderIn->getBorder(resampleBorders[b]);
+        borderOut->addBorder(outputBorders[b].releasePointer());//NOTE: again, ownership of RAW POINTER
         for (int m = 0; m < numBorderMDKeys; ++m)//HACK: will do this repeatedly for multi-part borders, but oh well
         {
             AString value = borderIn->getBorderMetadataValue(inputBorder->getName(), inputBorder->getClassName(), m);
@@ -22,8 +22,10 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiRowBlockReader.h"
 #include "MathFunctions.h"
 
 #include <cmath>
@@ -116,50 +118,52 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
         }
     }
     ciftiOut->setCiftiXML(baseXML);
-    vector<double> accum(rowSize);
-    vector<float> myrow(rowSize);
-    for (int i = 0; i < numRows; ++i)
+    CiftiRowBlockReader myReader(ciftiList);//reads blocks of rows from all files concurrently, so many inputs don't turn into a seek per row per file
+    vector<vector<float> > outRows(myReader.getRowsPerBlock(), vector<float>(rowSize));
+    while (myReader.readNextBlock())
     {
-        vector<double> weightaccum(rowSize, 0.0);
-        for (int j = 0; j < rowSize; ++j)
+        int blockRows = (int)myReader.getBlockRowCount();
+#pragma omp CARET_PAR
         {
-            accum[j] = 0.0;
-        }
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrow.data(), i);
-            if (weightsPtr == NULL)
+            vector<double> accum(rowSize), weightaccum(rowSize);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < blockRows; ++i)
             {
                 for (int k = 0; k < rowSize; ++k)
                 {
-                    if (MathFunctions::isNumeric(myrow[k]))
+                    accum[k] = 0.0;
+                    weightaccum[k] = 0.0;
+                }
+                for (int j = 0; j < numFiles; ++j)
+                {
+                    const float* myrow = myReader.getRow(j, i);
+                    double weight = 1.0;
+                    if (weightsPtr != NULL) weight = (*weightsPtr)[j];
+                    for (int k = 0; k < rowSize; ++k)
                     {
-                        weightaccum[k] += 1.0;
-                        accum[k] += myrow[k];
+                        float value = myrow[k];
+                        bool numeric = (value - value == 0.0f);//same as MathFunctions::isNumeric, but inline and branch free so the loop can vectorize
+                        weightaccum[k] += numeric ? weight : 0.0;
+                        accum[k] += numeric ? value * weight : 0.0;
                     }
                 }
-            } else {
-                float weight = (*weightsPtr)[j];
+                float* outrow = outRows[i].data();
                 for (int k = 0; k < rowSize; ++k)
                 {
-                    if (MathFunctions::isNumeric(myrow[k]))
+                    if (weightaccum[k] != 0.0)
                     {
-                        weightaccum[k] += weight;
-                        accum[k] += myrow[k] * weight;
+                        outrow[k] = accum[k] / weightaccum[k];
+                    } else {
+                        outrow[k] = 0.0f;
                     }
                 }
             }
         }
-        for (int k = 0; k < rowSize; ++k)
+        for (int i = 0; i < blockRows; ++i)
         {
-            if (weightaccum[k] != 0.0)
-            {
-                myrow[k] = accum[k] / weightaccum[k];
-            } else {
-                myrow[k] = 0.0f;
-            }
+            ciftiOut->setRow(outRows[i].data(), myReader.getBlockStart() + i);
         }
-        ciftiOut->setRow(myrow.data(), i);
+        myProgress.reportProgress(((float)(myReader.getBlockStart() + blockRows)) / numRows);
     }
 }
 
@@ -190,75 +194,95 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     }
     bool haveWarned = false;
     ciftiOut->setCiftiXML(baseXML);
-    vector<vector<float> > myrows(numFiles, vector<float>(rowSize));
-    for (int i = 0; i < numRows; ++i)
+    CiftiRowBlockReader myReader(ciftiList);
+    vector<vector<float> > outRows(myReader.getRowsPerBlock(), vector<float>(rowSize));
+    while (myReader.readNextBlock())
     {
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrows[j].data(), i);
-        }
-        vector<float> outrow(rowSize);
-        for (int k = 0; k < rowSize; ++k)
+        int blockRows = (int)myReader.getBlockRowCount();
+#pragma omp CARET_PAR
         {
-            double accum = 0.0;
-            double weightaccum = 0.0;
-            int nonnumeric = 0;
-            for (int j = 0; j < numFiles; ++j)
+            vector<const float*> myrows(numFiles);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < blockRows; ++i)
             {
-                if (MathFunctions::isNumeric(myrows[j][k]))
-                {
-                    accum += myrows[j][k];
-                } else {
-                    ++nonnumeric;
-                }
-            }
-            if (nonnumeric >= numFiles - 1)
-            {
-                if (!haveWarned)
+                for (int j = 0; j < numFiles; ++j)
                 {
-                    CaretLogWarning("found element where less than 2 files have numeric values");
-                    haveWarned = true;
+                    myrows[j] = myReader.getRow(j, i);
                 }
-                outrow[k] = 0.0f;
-            } else {
-                float mean = accum / (numFiles - nonnumeric);
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
+                float* outrow = outRows[i].data();
+                for (int k = 0; k < rowSize; ++k)
                 {
-                    if (MathFunctions::isNumeric(myrows[j][k]))
+                    double accum = 0.0;
+                    double weightaccum = 0.0;
+                    int nonnumeric = 0;
+                    for (int j = 0; j < numFiles; ++j)
                     {
-                        float temp = myrows[j][k] - mean;
-                        accum += temp * temp;
+                        if (MathFunctions::isNumeric(myrows[j][k]))
+                        {
+                            accum += myrows[j][k];
+                        } else {
+                            ++nonnumeric;
+                        }
                     }
-                }
-                float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
-                float cutoffLow = mean - sigmaBelow * stdev;
-                float cutoffHigh = mean + sigmaAbove * stdev;
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
-                {
-                    if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)//implicitly excludes NaN and inf
+                    if (nonnumeric >= numFiles - 1)
                     {
-                        if (weightsPtr != NULL)
+                        if (!haveWarned)
+                        {
+#pragma omp critical
+                            {
+                                if (!haveWarned)
+                                {
+                                    CaretLogWarning("found element where less than 2 files have numeric values");
+                                    haveWarned = true;
+                                }
+                            }
+                        }
+                        outrow[k] = 0.0f;
+                    } else {
+                        float mean = accum / (numFiles - nonnumeric);
+                        accum = 0.0;
+                        for (int j = 0; j < numFiles; ++j)
                         {
-                            float weight = (*weightsPtr)[j];
-                            accum += myrows[j][k] * weight;
-                            weightaccum += weight;
+                            if (MathFunctions::isNumeric(myrows[j][k]))
+                            {
+                                float temp = myrows[j][k] - mean;
+                                accum += temp * temp;
+                            }
+                        }
+                        float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
+                        float cutoffLow = mean - sigmaBelow * stdev;
+                        float cutoffHigh = mean + sigmaAbove * stdev;
+                        accum = 0.0;
+                        for (int j = 0; j < numFiles; ++j)
+                        {
+                            if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)//implicitly excludes NaN and inf
+                            {
+                                if (weightsPtr != NULL)
+                                {
+                                    float weight = (*weightsPtr)[j];
+                                    accum += myrows[j][k] * weight;
+                                    weightaccum += weight;
+                                } else {
+                                    accum += myrows[j][k];
+                                    weightaccum += 1.0;
+                                }
+                            }
+                        }
+                        if (weightaccum != 0.0)
+                        {
+                            outrow[k] = accum / weightaccum;
                         } else {
-                            accum += myrows[j][k];
-                            weightaccum += 1.0;
+                            outrow[k] = 0.0f;
                         }
                     }
                 }
-                if (weightaccum != 0.0)
-                {
-                    outrow[k] = accum / weightaccum;
-                } else {
-                    outrow[k] = 0.0f;
-                }
             }
         }
-        ciftiOut->setRow(outrow.data(), i);
+        for (int i = 0; i < blockRows; ++i)
+        {
+            ciftiOut->setRow(outRows[i].data(), myReader.getBlockStart() + i);
+        }
+        myProgress.reportProgress(((float)(myReader.getBlockStart() + blockRows)) / numRows);
     }
 }
 
@@ -20,7 +20,7 @@
 
 #include "AlgorithmCiftiCorrelationGradient.h"
 #include "AlgorithmException.h"
-#include "AlgorithmMetricGradient.h"
+#include "CaretAssert.h"
 #include "MetricSmoothingObject.h"
 #include "AlgorithmVolumeGradient.h"
 #include "CaretLogger.h"
@@ -29,6 +29,7 @@
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 #include "Vector3D.h"
 #include "VolumeFile.h"
 #include "dot_wrapper.h"
@@ -37,6 +38,275 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //the regression gradient from AlgorithmMetricGradient is linear in the data for a fixed surface and ROI: the gradient vector at a vertex
+    //is a weighted sum of (neighbor value - center value), so we compute the per-neighbor weight vectors once per surface instead of redoing
+    //the normals, areas, and regressions for every column, and apply them to each column of correlation values
+    class SurfaceGradientOperator
+    {
+        vector<int32_t> m_topoStarts, m_topoNeighbors;//surface neighbors of every vertex
+        vector<int64_t> m_starts;//precomputed weights for the construction ROI, only in-ROI neighbors are kept
+        vector<int32_t> m_neighbors;
+        vector<float> m_coefs;//3 per neighbor
+        vector<bool> m_roi;
+        vector<float> m_areaStorage, m_sqrtCorrAreas, m_sqrtVertAreas;
+        const float* m_coords, *m_normals, *m_vertAreas;
+        bool m_haveCorrAreas;
+        void neighborOffset(const int32_t& node, const int32_t& neighbor, const Vector3D& normal, const Vector3D& xhat, const Vector3D& yhat,
+                            float& xmag, float& ymag, float& unrollMag, float& mag2d) const;
+        float applyCoefs(const float* values, const int32_t& node, const int32_t* neighbors, const float* coefs, const int32_t& count) const;
+    public:
+        SurfaceGradientOperator(SurfaceFile* mySurf, const MetricFile* corrAreaMetric, const vector<bool>& roiLookup);
+        int32_t getMaxNeighbors() const;
+        //returns number of neighbors written, which are the in-ROI surface neighbors, or zero if the vertex is outside the ROI
+        int32_t computeCoefs(const int32_t& node, const vector<bool>& roiLookup, int32_t* neighborsOut, float* coefsOut) const;
+        //gradient magnitude using the construction ROI
+        float getGradient(const float* values, const int32_t& node) const;
+        //gradient magnitude for an ROI that is a subset of the construction ROI, only vertices next to the removed vertices are recomputed
+        float getGradient(const float* values, const int32_t& node, const vector<bool>& subsetLookup, vector<int32_t>& neighScratch, vector<float>& coefScratch) const;
+    };
+    
+    SurfaceGradientOperator::SurfaceGradientOperator(SurfaceFile* mySurf, const MetricFile* corrAreaMetric, const vector<bool>& roiLookup)
+    {
+        int32_t numNodes = mySurf->getNumberOfNodes();
+        CaretAssert((int32_t)roiLookup.size() == numNodes);
+        m_roi = roiLookup;
+        mySurf->computeNormals();//same as AlgorithmMetricGradient without average normals
+        m_normals = mySurf->getNormalData();
+        m_coords = mySurf->getCoordinateData();
+        m_haveCorrAreas = (corrAreaMetric != NULL);
+        if (m_haveCorrAreas)
+        {//same logic as AlgorithmMetricGradient
+            m_sqrtCorrAreas.resize(numNodes);
+            mySurf->computeNodeAreas(m_sqrtVertAreas);
+            const float* corrAreaData = corrAreaMetric->getValuePointerForColumn(0);
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                m_sqrtCorrAreas[i] = sqrt(corrAreaData[i]);
+                m_sqrtVertAreas[i] = sqrt(m_sqrtVertAreas[i]);
+            }
+            m_vertAreas = corrAreaData;
+        } else {
+            mySurf->computeNodeAreas(m_areaStorage);
+            m_vertAreas = m_areaStorage.data();
+        }
+        CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+        m_topoStarts.resize(numNodes + 1);
+        m_starts.resize(numNodes + 1);
+        int64_t roiNeighTotal = 0;
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            int32_t numNeigh;
+            const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+            m_topoStarts[i] = (int32_t)m_topoNeighbors.size();
+            m_starts[i] = roiNeighTotal;
+            for (int32_t j = 0; j < numNeigh; ++j)
+            {
+                m_topoNeighbors.push_back(myNeighbors[j]);
+                if (m_roi[i] && m_roi[myNeighbors[j]]) ++roiNeighTotal;
+            }
+        }
+        m_topoStarts[numNodes] = (int32_t)m_topoNeighbors.size();
+        m_starts[numNodes] = roiNeighTotal;
+        m_neighbors.resize(roiNeighTotal);
+        m_coefs.resize(roiNeighTotal * 3);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            if (m_starts[i + 1] != m_starts[i])
+            {
+                int32_t count = computeCoefs(i, m_roi, m_neighbors.data() + m_starts[i], m_coefs.data() + m_starts[i] * 3);
+                CaretAssert(count == m_starts[i + 1] - m_starts[i]);
+                (void)count;
+            }
+        }
+    }
+    
+    int32_t SurfaceGradientOperator::getMaxNeighbors() const
+    {
+        int32_t ret = 0;
+        int32_t numNodes = (int32_t)m_roi.size();
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            ret = max(ret, m_topoStarts[i + 1] - m_topoStarts[i]);
+        }
+        return ret;
+    }
+    
+    void SurfaceGradientOperator::neighborOffset(const int32_t& node, const int32_t& neighbor, const Vector3D& normal, const Vector3D& xhat, const Vector3D& yhat,
+                                                 float& xmag, float& ymag, float& unrollMag, float& mag2d) const
+    {
+        Vector3D somevec = Vector3D(m_coords + neighbor * 3) - Vector3D(m_coords + node * 3);
+        float origMag = somevec.length();
+        unrollMag = origMag;
+        float opposite = somevec.dot(normal);
+        if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
+        {
+            unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
+        }
+        if (m_haveCorrAreas)
+        {
+            unrollMag *= (m_sqrtCorrAreas[node] + m_sqrtCorrAreas[neighbor]) / (m_sqrtVertAreas[node] + m_sqrtVertAreas[neighbor]);
+        }
+        xmag = xhat.dot(somevec);
+        ymag = yhat.dot(somevec);
+        mag2d = sqrt(xmag * xmag + ymag * ymag);
+    }
+    
+    int32_t SurfaceGradientOperator::computeCoefs(const int32_t& node, const vector<bool>& roiLookup, int32_t* neighborsOut, float* coefsOut) const
+    {
+        if (!roiLookup[node]) return 0;
+        int32_t numNeigh = m_topoStarts[node + 1] - m_topoStarts[node];
+        const int32_t* myNeighbors = m_topoNeighbors.data() + m_topoStarts[node];
+        int32_t neighCount = 0;
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            if (roiLookup[myNeighbors[j]])
+            {
+                neighborsOut[neighCount] = myNeighbors[j];
+                ++neighCount;
+            }
+        }
+        if (neighCount == 0) return 0;
+        Vector3D myNormal = Vector3D(m_normals + node * 3).normal();
+        Vector3D somevec, xhat, yhat;
+        somevec[2] = 0.0;
+        if (abs(myNormal[0]) > abs(myNormal[1]))
+        {//generate a vector not parallel to normal
+            somevec[0] = 0.0;
+            somevec[1] = 1.0;
+        } else {
+            somevec[0] = 1.0;
+            somevec[1] = 0.0;
+        }
+        xhat = myNormal.cross(somevec).normal();
+        yhat = myNormal.cross(xhat).normal();
+        float xmag, ymag, unrollMag, mag2d;
+        bool good = false;
+        if (numNeigh >= 2 && neighCount >= 2)
+        {//area weighted least squares fit of value difference = gx * x + gy * y + c, so the fit is (A'WA)^-1 A'W applied to the differences
+            double ata[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+            for (int32_t j = 0; j < neighCount; ++j)
+            {
+                int32_t whichNode = neighborsOut[j];
+                neighborOffset(node, whichNode, myNormal, xhat, yhat, xmag, ymag, unrollMag, mag2d);
+                xmag *= unrollMag / mag2d;
+                ymag *= unrollMag / mag2d;
+                double area = m_vertAreas[whichNode];
+                ata[0][0] += xmag * xmag * area;
+                ata[0][1] += xmag * ymag * area;
+                ata[0][2] += xmag * area;
+                ata[1][1] += ymag * ymag * area;
+                ata[1][2] += ymag * area;
+                ata[2][2] += area;
+            }
+            ata[1][0] = ata[0][1];
+            ata[2][0] = ata[0][2];
+            ata[2][1] = ata[1][2];
+            ata[2][2] += m_vertAreas[node];//include center
+            double cof[2][3];//only the first two rows of the inverse are needed, they give the x and y gradient
+            cof[0][0] = ata[1][1] * ata[2][2] - ata[1][2] * ata[2][1];
+            cof[0][1] = ata[0][2] * ata[2][1] - ata[0][1] * ata[2][2];
+            cof[0][2] = ata[0][1] * ata[1][2] - ata[0][2] * ata[1][1];
+            cof[1][0] = ata[1][2] * ata[2][0] - ata[1][0] * ata[2][2];
+            cof[1][1] = ata[0][0] * ata[2][2] - ata[0][2] * ata[2][0];
+            cof[1][2] = ata[0][2] * ata[1][0] - ata[0][0] * ata[1][2];
+            double det = ata[0][0] * cof[0][0] + ata[0][1] * cof[1][0] + ata[0][2] * (ata[1][0] * ata[2][1] - ata[1][1] * ata[2][0]);
+            if (det != 0.0)
+            {
+                good = true;
+                for (int32_t j = 0; j < neighCount; ++j)
+                {
+                    int32_t whichNode = neighborsOut[j];
+                    neighborOffset(node, whichNode, myNormal, xhat, yhat, xmag, ymag, unrollMag, mag2d);
+                    xmag *= unrollMag / mag2d;
+                    ymag *= unrollMag / mag2d;
+                    double area = m_vertAreas[whichNode] / det;
+                    double xweight = (cof[0][0] * xmag + cof[0][1] * ymag + cof[0][2]) * area;
+                    double yweight = (cof[1][0] * xmag + cof[1][1] * ymag + cof[1][2]) * area;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        float coef = (float)(xhat[k] * xweight + yhat[k] * yweight);
+                        if (coef != coef || abs(coef) > 1e30f) good = false;
+                        coefsOut[j * 3 + k] = coef;
+                    }
+                }
+            }
+        }
+        if (!good)
+        {//fallback: area weighted average of the point estimates of the gradient along each edge
+            float totalWeight = 0.0f;
+            for (int32_t j = 0; j < neighCount; ++j)
+            {
+                totalWeight += m_vertAreas[neighborsOut[j]];
+            }
+            good = true;
+            for (int32_t j = 0; j < neighCount; ++j)
+            {
+                int32_t whichNode = neighborsOut[j];
+                neighborOffset(node, whichNode, myNormal, xhat, yhat, xmag, ymag, unrollMag, mag2d);
+                float scale = m_vertAreas[whichNode] / (unrollMag * mag2d * totalWeight);
+                for (int k = 0; k < 3; ++k)
+                {
+                    float coef = (xhat[k] * xmag + yhat[k] * ymag) * scale;
+                    if (coef != coef || abs(coef) > 1e30f) good = false;
+                    coefsOut[j * 3 + k] = coef;
+                }
+            }
+            if (!good)
+            {//AlgorithmMetricGradient outputs zero when both methods fail
+                for (int32_t j = 0; j < neighCount * 3; ++j)
+                {
+                    coefsOut[j] = 0.0f;
+                }
+            }
+        }
+        return neighCount;
+    }
+    
+    float SurfaceGradientOperator::applyCoefs(const float* values, const int32_t& node, const int32_t* neighbors, const float* coefs, const int32_t& count) const
+    {
+        float center = values[node];
+        float grad[3] = { 0.0f, 0.0f, 0.0f };
+        for (int32_t j = 0; j < count; ++j)
+        {
+            float diff = values[neighbors[j]] - center;
+            grad[0] += coefs[j * 3] * diff;
+            grad[1] += coefs[j * 3 + 1] * diff;
+            grad[2] += coefs[j * 3 + 2] * diff;
+        }
+        float ret = sqrt(grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]);
+        if (ret != ret) return 0.0f;//AlgorithmMetricGradient outputs zero for NaN
+        return ret;
+    }
+    
+    float SurfaceGradientOperator::getGradient(const float* values, const int32_t& node) const
+    {
+        int64_t start = m_starts[node];
+        return applyCoefs(values, node, m_neighbors.data() + start, m_coefs.data() + start * 3, (int32_t)(m_starts[node + 1] - start));
+    }
+    
+    float SurfaceGradientOperator::getGradient(const float* values, const int32_t& node, const vector<bool>& subsetLookup,
+                                               vector<int32_t>& neighScratch, vector<float>& coefScratch) const
+    {
+        if (!subsetLookup[node]) return 0.0f;
+        int64_t start = m_starts[node], end = m_starts[node + 1];
+        bool changed = false;
+        for (int64_t j = start; j < end; ++j)
+        {
+            if (!subsetLookup[m_neighbors[j]])
+            {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed) return applyCoefs(values, node, m_neighbors.data() + start, m_coefs.data() + start * 3, (int32_t)(end - start));
+        int32_t count = computeCoefs(node, subsetLookup, neighScratch.data(), coefScratch.data());
+        return applyCoefs(values, node, neighScratch.data(), coefScratch.data(), count);
+    }
+}
+
 AString AlgorithmCiftiCorrelationGradient::getCommandSwitch()
 {
     return "-cifti-correlation-gradient";
@@ -308,13 +578,16 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         areaData = myAreas->getValuePointerForColumn(0);
     }
+    int numSurfNodes = mySurf->getNumberOfNodes();
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numSurfNodes, 1);
     myRoi.initializeColumn(0);
+    vector<bool> roiLookup(numSurfNodes, false);
     vector<int> rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         myRoi.setValue(myMap[i].m_surfaceNode, 0, 1.0f);
+        roiLookup[myMap[i].m_surfaceNode] = true;
         if (cacheFullInput)
         {
             rowsToCache.push_back(myMap[i].m_ciftiIndex);
@@ -329,6 +602,8 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    SurfaceGradientOperator myGradient(mySurf, myAreas, roiLookup);//likewise for the gradient regressions
+    vector<float> computeBlock((int64_t)numSurfNodes * numCacheRows, 0.0f);//one correlation map per cached row, laid out like metric columns
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -343,8 +618,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             cacheRows(rowsToCache);
         }
         int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
+        float* blockData = computeBlock.data();
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int i = 0; i < mapSize; ++i)
         {
@@ -357,6 +631,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 ++curRow;
                 movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
             }
+            const int64_t movingNode = myMap[myrow].m_surfaceNode;
             for (int j = startpos; j < endpos; ++j)
             {
                 if (myrow >= startpos && myrow < endpos)
@@ -366,37 +641,42 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                         float cacheRrs;
                         const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
                         float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                        computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
+                        blockData[(int64_t)(j - startpos) * numSurfNodes + movingNode] = result;
+                        blockData[(int64_t)(myrow - startpos) * numSurfNodes + myMap[j].m_surfaceNode] = result;
                     }
                 } else {
                     float cacheRrs;
                     const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
                     float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                    computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
+                    blockData[(int64_t)(j - startpos) * numSurfNodes + movingNode] = result;
                 }
             }
         }
         int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            const float* myCol;
-            if (surfKern > 0.0f)
+#pragma omp CARET_PAR
+        {//smooth, take the gradient, and sum each correlation map in one pass per column, on separate columns in each thread
+            vector<double> threadAccum(mapSize, 0.0);
+            vector<float> smoothed;
+            if (surfKern > 0.0f) smoothed.resize(numSurfNodes);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numMetricCols; ++j)
             {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &myRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &myRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
+                const float* myCol = blockData + (int64_t)j * numSurfNodes;
+                if (surfKern > 0.0f)
+                {
+                    mySmooth->smoothValues(myCol, smoothed.data());
+                    myCol = smoothed.data();
+                }
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    threadAccum[i] += myGradient.getGradient(myCol, myMap[i].m_surfaceNode);
+                }
             }
-            for (int i = 0; i < mapSize; ++i)
+#pragma omp critical
             {
-                const float* roiColumn = myRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
+                    accum[i] += threadAccum[i];
                 }
             }
         }
@@ -438,16 +718,18 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
         areaData = myAreas->getValuePointerForColumn(0);
     }
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, areaData));//can't really have SurfaceFile cache ones with corrected areas
+    int numSurfNodes = mySurf->getNumberOfNodes();
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numSurfNodes, 1);
     myRoi.initializeColumn(0);
     vector<vector<bool> > roiLookup(numCacheRows);//this gets bit compressed
-    vector<bool> origRoi(mySurf->getNumberOfNodes());
+    vector<bool> origRoi(numSurfNodes, false);
     vector<vector<int32_t> > excludeNodes(numCacheRows);
     vector<int> rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         myRoi.setValue(myMap[i].m_surfaceNode, 0, 1.0f);
+        origRoi[myMap[i].m_surfaceNode] = true;
         if (cacheFullInput)
         {
             rowsToCache.push_back(myMap[i].m_ciftiIndex);
@@ -462,6 +744,9 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    SurfaceGradientOperator myGradient(mySurf, myAreas, origRoi);//the exclusion only changes the regressions next to the excluded area, those get recomputed per column
+    const int maxNeighbors = myGradient.getMaxNeighbors();
+    vector<float> computeBlock((int64_t)numSurfNodes * numCacheRows, 0.0f);//one correlation map per cached row, laid out like metric columns
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -475,7 +760,6 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
-        int numSurfNodes = mySurf->getNumberOfNodes();
 #pragma omp CARET_PAR
         {
             vector<float> distances;
@@ -486,11 +770,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 vector<int32_t>& excludeRef = excludeNodes[i - startpos];
                 myGeoHelp->getNodesToGeoDist(myMap[i].m_surfaceNode, surfExclude, excludeRef, distances);
                 vector<bool>& lookupRef = roiLookup[i - startpos];
-                lookupRef.resize(numSurfNodes);
-                for (int j = 0; j < numSurfNodes; ++j)
-                {
-                    lookupRef[j] = (myRoi.getValue(j, 0) > 0.0f);
-                }
+                lookupRef = origRoi;
                 int numExclude = excludeRef.size();
                 for (int j = 0; j < numExclude; ++j)
                 {
@@ -499,8 +779,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
         }
         int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
+        float* blockData = computeBlock.data();
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int i = 0; i < mapSize; ++i)
         {
@@ -513,9 +792,10 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 ++curRow;
                 movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
             }
+            const int64_t movingNode = myMap[myrow].m_surfaceNode;
             for (int j = startpos; j < endpos; ++j)
             {
-                if (roiLookup[j - startpos][myMap[myrow].m_surfaceNode])
+                if (roiLookup[j - startpos][movingNode])
                 {
                     if (myrow >= startpos && myrow < endpos)
                     {
@@ -524,50 +804,54 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                             float cacheRrs;
                             const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
                             float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                            computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                            computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
+                            blockData[(int64_t)(j - startpos) * numSurfNodes + movingNode] = result;
+                            blockData[(int64_t)(myrow - startpos) * numSurfNodes + myMap[j].m_surfaceNode] = result;
                         }
                     } else {
                         float cacheRrs;
                         const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
                         float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
+                        blockData[(int64_t)(j - startpos) * numSurfNodes + movingNode] = result;
                     }
                 }
             }
         }
         int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        MetricFile excludeRoi = myRoi;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            int numExclude = (int)excludeNodes[j].size();
-            const float* myCol;
-            for (int k = 0; k < numExclude; ++k)
-            {
-                excludeRoi.setValue(excludeNodes[j][k], 0, 0.0f);//exclude the nodes near the seed node
-            }
-            if (surfKern > 0.0f)
-            {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric, &excludeRoi);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &excludeRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &excludeRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
-            }
-            for (int i = 0; i < mapSize; ++i)
+#pragma omp CARET_PAR
+        {//smooth, take the gradient, and sum each correlation map in one pass per column, on separate columns in each thread
+            vector<double> threadAccum(mapSize, 0.0);
+            vector<int32_t> threadCount(mapSize, 0);
+            vector<float> smoothed;
+            if (surfKern > 0.0f) smoothed.resize(numSurfNodes);
+            vector<int32_t> neighScratch(maxNeighbors);
+            vector<float> coefScratch(maxNeighbors * 3);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numMetricCols; ++j)
             {
-                const float* roiColumn = excludeRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                const vector<bool>& excludeLookup = roiLookup[j];//the roi without the nodes near the seed node
+                const float* myCol = blockData + (int64_t)j * numSurfNodes;
+                if (surfKern > 0.0f)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
-                    accumCount[i] += 1;//less dubious looking than ++accumCount[i]
+                    mySmooth->smoothValues(myCol, smoothed.data(), &excludeLookup);
+                    myCol = smoothed.data();
+                }
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    int32_t node = myMap[i].m_surfaceNode;
+                    if (excludeLookup[node])
+                    {
+                        threadAccum[i] += myGradient.getGradient(myCol, node, excludeLookup, neighScratch, coefScratch);
+                        threadCount[i] += 1;
+                    }
                 }
             }
-            for (int k = 0; k < numExclude; ++k)
+#pragma omp critical
             {
-                excludeRoi.setValue(excludeNodes[j][k], 0, myRoi.getValue(excludeNodes[j][k], 0));//and set them back to original roi afterwards, instead of a full reinitialize
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    accum[i] += threadAccum[i];
+                    accumCount[i] += threadCount[i];
+                }
             }
         }
     }
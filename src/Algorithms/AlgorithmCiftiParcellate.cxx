@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
@@ -29,6 +30,7 @@
 #include "ReductionOperation.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 
@@ -205,6 +207,119 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
     AlgorithmCiftiParcellate(myProgObj, myCiftiIn, myCiftiLabel, direction, myCiftiOut, method, excludeLow, excludeHigh, onlyNumeric);
 }
 
+namespace
+{
+    //parcellates along rows a block of rows at a time: rows are read in order, then each row is gathered and reduced in parallel
+    //members of each parcel are in compressed rows, in increasing index order, so the values reach the reduction in the same order as before
+    //parcelWeights may be NULL for unweighted reduction, otherwise it must be in the same order as the members
+    void parcellateAlongRows(const CiftiFile* myCiftiIn, CiftiFile* myCiftiOut, const vector<int>& indexToParcel, const vector<vector<float> >* parcelWeights,
+                             const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric, const bool& isLabel, const int& labelDir)
+    {
+        const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
+        const CiftiXML& myOutXML = myCiftiOut->getCiftiXML();
+        vector<int64_t> dims = myInputXML.getDimensions();
+        const int numParcels = (int)myOutXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        const int64_t numCols = dims[0];
+        vector<int64_t> parcelStarts(numParcels + 1, 0), parcelMembers;
+        for (int64_t j = 0; j < numCols; ++j)
+        {
+            CaretAssert(indexToParcel[j] > -2 && indexToParcel[j] < numParcels);
+            if (indexToParcel[j] != -1) ++parcelStarts[indexToParcel[j] + 1];
+        }
+        for (int j = 0; j < numParcels; ++j)
+        {
+            parcelStarts[j + 1] += parcelStarts[j];
+        }
+        parcelMembers.resize(parcelStarts[numParcels]);
+        vector<int64_t> fillPos(parcelStarts.begin(), parcelStarts.end() - 1);
+        for (int64_t j = 0; j < numCols; ++j)
+        {
+            if (indexToParcel[j] != -1) parcelMembers[fillPos[indexToParcel[j]]++] = j;
+        }
+        vector<float> flatWeights;
+        if (parcelWeights != NULL)
+        {
+            flatWeights.reserve(parcelMembers.size());
+            for (int j = 0; j < numParcels; ++j)
+            {
+                CaretAssert((int64_t)(*parcelWeights)[j].size() == parcelStarts[j + 1] - parcelStarts[j]);
+                flatWeights.insert(flatWeights.end(), (*parcelWeights)[j].begin(), (*parcelWeights)[j].end());
+            }
+        }
+        const int64_t blockRows = max((int64_t)1, min((int64_t)1024, (((int64_t)64) << 20) / max((int64_t)1, (numCols + numParcels) * (int64_t)sizeof(float))));
+        vector<float> inBlock(blockRows * numCols), outBlock(blockRows * numParcels), unassignedKeys(blockRows, 0.0f);
+        vector<vector<int64_t> > blockIndices(blockRows);
+        MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end()));
+        while (!iter.atEnd())
+        {
+            int64_t rowsInBlock = 0;
+            for (; rowsInBlock < blockRows && !iter.atEnd(); ++rowsInBlock, ++iter)
+            {
+                blockIndices[rowsInBlock] = *iter;
+                myCiftiIn->getRow(inBlock.data() + rowsInBlock * numCols, *iter);
+                if (isLabel)
+                {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                    unassignedKeys[rowsInBlock] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                }
+            }
+#pragma omp CARET_PAR
+            {
+                vector<float> parcelData(parcelMembers.size());//all parcels of one row, float so we can use ReductionOperation
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t row = 0; row < rowsInBlock; ++row)
+                {
+                    const float* inRow = inBlock.data() + row * numCols;
+                    float* outRow = outBlock.data() + row * numParcels;
+                    for (int64_t k = 0; k < (int64_t)parcelMembers.size(); ++k)
+                    {
+                        if (isLabel)
+                        {
+                            parcelData[k] = floor(inRow[parcelMembers[k]] + 0.5f);//round to nearest integer to be safe
+                        } else {
+                            parcelData[k] = inRow[parcelMembers[k]];
+                        }
+                    }
+                    for (int j = 0; j < numParcels; ++j)
+                    {
+                        const int64_t start = parcelStarts[j], count = parcelStarts[j + 1] - parcelStarts[j];
+                        const float* data = parcelData.data() + start;
+                        if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
+                        {
+                            if (parcelWeights != NULL)
+                            {
+                                const float* weights = flatWeights.data() + start;
+                                if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                                {
+                                    outRow[j] = ReductionOperation::reduceWeightedExcludeDev(data, weights, count, method, excludeLow, excludeHigh);
+                                } else if (onlyNumeric) {
+                                    outRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(data, weights, count, method);
+                                } else {
+                                    outRow[j] = ReductionOperation::reduceWeighted(data, weights, count, method);
+                                }
+                            } else {
+                                if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                                {
+                                    outRow[j] = ReductionOperation::reduceExcludeDev(data, count, method, excludeLow, excludeHigh);
+                                } else if (onlyNumeric) {
+                                    outRow[j] = ReductionOperation::reduceOnlyNumeric(data, count, method);
+                                } else {
+                                    outRow[j] = ReductionOperation::reduce(data, count, method);
+                                }
+                            }
+                        } else {
+                            outRow[j] = (isLabel ? unassignedKeys[row] : 0.0f);
+                        }
+                    }
+                }
+            }
+            for (int64_t row = 0; row < rowsInBlock; ++row)
+            {
+                myCiftiOut->setRow(outBlock.data() + row * numParcels, blockIndices[row]);
+            }
+        }
+    }
+}
+
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                                    const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric) : AbstractAlgorithm(myProgObj)
 {
@@ -272,59 +387,7 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     }
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchOutRow(numParcels);
-        vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-        for (int j = 0; j < numParcels; ++j)
-        {
-            parcelData[j].reserve(parcelCounts[j]);
-        }
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
-        {
-            for (int j = 0; j < numParcels; ++j)
-            {
-                parcelData[j].clear();//doesn't change allocation
-            }
-            myCiftiIn->getRow(scratchRow.data(), *iter);
-            for (int64_t j = 0; j < numCols; ++j)
-            {
-                int parcel = indexToParcel[j];
-                if (parcel != -1)
-                {
-                    if (isLabel)
-                    {
-                        parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                    } else {
-                        parcelData[parcel].push_back(scratchRow[j]);
-                    }
-                }
-            }
-            for (int j = 0; j < numParcels; ++j)
-            {
-                CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
-                if (parcelCounts[j] > 0 && (method != ReductionEnum::SAMPSTDEV || parcelCounts[j] > 1))
-                {
-                    if (excludeLow > 0.0f && excludeHigh > 0.0f)
-                    {
-                        scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelData[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                    } else {
-                        if (onlyNumeric)
-                        {
-                            scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelData[j].data(), parcelData[j].size(), method);
-                        } else {
-                            scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), method);
-                        }
-                    }
-                } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                    if (isLabel)
-                    {
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                    } else {
-                        scratchOutRow[j] = 0.0f;
-                    }
-                }
-            }
-            myCiftiOut->setRow(scratchOutRow.data(), *iter);
-        }
+        parcellateAlongRows(myCiftiIn, myCiftiOut, indexToParcel, NULL, method, excludeLow, excludeHigh, onlyNumeric, isLabel, labelDir);
     } else {
         vector<float> scratchOutRow(numCols);
         vector<int64_t> otherDims = dims;
@@ -450,59 +513,7 @@ namespace
         vector<float> scratchRow(numCols);
         if (direction == CiftiXML::ALONG_ROW)
         {
-            vector<float> scratchOutRow(numParcels);
-            vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-            for (int j = 0; j < numParcels; ++j)
-            {
-                parcelData[j].reserve(parcelWeights[j].size());
-            }
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
-            {
-                for (int j = 0; j < numParcels; ++j)
-                {
-                    parcelData[j].clear();//doesn't change allocation
-                }
-                myCiftiIn->getRow(scratchRow.data(), *iter);
-                for (int64_t j = 0; j < numCols; ++j)
-                {
-                    int parcel = indexToParcel[j];
-                    if (parcel != -1)
-                    {
-                        if (isLabel)
-                        {
-                            parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                        } else {
-                            parcelData[parcel].push_back(scratchRow[j]);
-                        }
-                    }
-                }
-                for (int j = 0; j < numParcels; ++j)
-                {
-                    CaretAssert(parcelWeights[j].size() == parcelData[j].size());
-                    if (parcelData[j].size() > 0 && (method != ReductionEnum::SAMPSTDEV || parcelData[j].size() > 1))
-                    {
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
-                        {
-                            scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
-                            {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
-                            } else {
-                                scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
-                            }
-                        }
-                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                        if (isLabel)
-                        {
-                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                        } else {
-                            scratchOutRow[j] = 0.0f;
-                        }
-                    }
-                }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
-            }
+            parcellateAlongRows(myCiftiIn, myCiftiOut, indexToParcel, &parcelWeights, method, excludeLow, excludeHigh, onlyNumeric, isLabel, labelDir);
         } else {
             vector<float> scratchOutRow(numCols);
             vector<int64_t> otherDims = dims;
@@ -20,8 +20,13 @@
 
 #include "AlgorithmCiftiTranspose.h"
 #include "AlgorithmException.h"
+#include "CaretBinaryFile.h"
+#include "CaretLogger.h"
+#include "CaretTemporaryFile.h"
 #include "CiftiFile.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -47,7 +52,10 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.\n\n" +
+        "If -mem-limit would require reading the input more than twice, the input is instead transposed in blocks into a temporary file " +
+        "as large as the input, which is then read back to write the output, so that the input is only read once.  " +
+        "The temporary file is created in the system temporary directory, which can be changed with the TMPDIR environment variable."
     );
     return ret;
 }
@@ -91,6 +99,12 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
         if (numCacheRows < 1) numCacheRows = 1;
         if (numCacheRows > colSize) numCacheRows = colSize;
     }
+    int numPasses = (colSize + numCacheRows - 1) / numCacheRows;
+    if (numPasses > 2)
+    {//more passes over the input than it costs to write and read a spill file
+        transposeWithSpillFile(ciftiIn, ciftiOut, (int64_t)(memLimitGB * 1024 * 1024 * 1024));
+        return;
+    }
     vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
     vector<float> scratchInRow(colSize);
     for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
@@ -112,6 +126,57 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     }
 }
 
+void AlgorithmCiftiTranspose::transposeWithSpillFile(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& memLimitBytes)
+{//two passes: transpose blocks of input rows into a temporary file, then gather bands of output rows from each block
+    const CiftiXML& outXML = ciftiOut->getCiftiXML();
+    const int64_t rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);//input has rowSize rows of length colSize
+    int64_t blockRows = memLimitBytes / (colSize * sizeof(float));
+    if (blockRows < 1) blockRows = 1;
+    if (blockRows > rowSize) blockRows = rowSize;
+    int64_t bandRows = memLimitBytes / (rowSize * sizeof(float));
+    if (bandRows < 1) bandRows = 1;
+    if (bandRows > colSize) bandRows = colSize;
+    CaretTemporaryFile spillTemp;
+    spillTemp.createEmptyFile();
+    CaretLogInfo("transposing through temporary file " + spillTemp.getFileName());
+    CaretBinaryFile spillFile(spillTemp.getFileName(), CaretBinaryFile::READ_WRITE_TRUNCATE);
+    {
+        //block starting at input row b0 takes up colSize * (b1 - b0) floats starting at float offset b0 * colSize, ordered by output row, so each output row's piece of the block is contiguous
+        vector<float> blockTransposed(blockRows * colSize), scratchInRow(colSize);
+        for (int64_t b0 = 0; b0 < rowSize; b0 += blockRows)
+        {
+            const int64_t b1 = min(b0 + blockRows, rowSize), blockLength = b1 - b0;
+            for (int64_t j = b0; j < b1; ++j)
+            {
+                ciftiIn->getRow(scratchInRow.data(), j);
+                for (int64_t k = 0; k < colSize; ++k)
+                {
+                    blockTransposed[k * blockLength + j - b0] = scratchInRow[k];
+                }
+            }
+            spillFile.write(blockTransposed.data(), blockLength * colSize * sizeof(float));//sequential, blocks are written in order
+        }
+    }
+    vector<vector<float> > bandOutRows(bandRows, vector<float>(rowSize));
+    for (int64_t k0 = 0; k0 < colSize; k0 += bandRows)
+    {
+        const int64_t k1 = min(k0 + bandRows, colSize);
+        for (int64_t b0 = 0; b0 < rowSize; b0 += blockRows)
+        {
+            const int64_t b1 = min(b0 + blockRows, rowSize), blockLength = b1 - b0;
+            spillFile.seek((b0 * colSize + k0 * blockLength) * sizeof(float));//the band is one contiguous range within each block
+            for (int64_t k = k0; k < k1; ++k)
+            {
+                spillFile.read(bandOutRows[k - k0].data() + b0, blockLength * sizeof(float));
+            }
+        }
+        for (int64_t k = k0; k < k1; ++k)
+        {
+            ciftiOut->setRow(bandOutRows[k - k0].data(), k);
+        }
+    }
+}
+
 float AlgorithmCiftiTranspose::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
@@ -28,6 +28,7 @@ namespace caret {
     class AlgorithmCiftiTranspose : public AbstractAlgorithm
     {
         AlgorithmCiftiTranspose();
+        void transposeWithSpillFile(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& memLimitBytes);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
@@ -252,36 +252,56 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
             }
         }
     }
-    vector<int64_t> exactVoxelList;
+    vector<int64_t> exactVoxelList, rowStarts;//rowStarts indexes voxels (not ints) in exactVoxelList where a new run of marked voxels along i begins
     int64_t ijk[3];
     for (ijk[2] = 0; ijk[2] < myDims[2]; ++ijk[2])
     {
         for (ijk[1] = 0; ijk[1] < myDims[1]; ++ijk[1])
         {
+            bool inRun = false;
             for (ijk[0] = 0; ijk[0] < myDims[0]; ++ijk[0])
             {
                 if (volMarked[myVolOut->getIndex(ijk)] == 1)
                 {
+                    if (!inRun)
+                    {
+                        rowStarts.push_back(exactVoxelList.size() / 3);
+                        inRun = true;
+                    }
                     exactVoxelList.push_back(ijk[0]);
                     exactVoxelList.push_back(ijk[1]);
                     exactVoxelList.push_back(ijk[2]);
+                } else {
+                    inRun = false;
                 }
             }
         }
     }
+    rowStarts.push_back(exactVoxelList.size() / 3);//end of the last run
     myProgress.reportProgress(markweight);
     myProgress.setTask("computing exact distances");
 #pragma omp CARET_PAR
     {
         CaretPointer<SignedDistanceHelper> myDist = mySurf->getSignedDistanceHelper();
-        int numExact = (int)exactVoxelList.size();
-        Vector3D thisCoord;
+        int64_t numRuns = (int64_t)rowStarts.size() - 1;
+        vector<float> runCoords, runDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numExact; i += 3)
-        {
-            myVolOut->indexToSpace(exactVoxelList.data() + i, thisCoord);
-            myVolOut->setValue(myDist->dist(thisCoord, myWinding), exactVoxelList.data() + i);
-            volMarked[myVolOut->getIndex(exactVoxelList.data() + i)] |= 22;//set marked to have valid value (positive and negative), and frozen
+        for (int64_t run = 0; run < numRuns; ++run)
+        {//do each run of adjacent voxels as a batch, so each search starts with the previous voxel's closest triangle
+            int64_t runStart = rowStarts[run], runLength = rowStarts[run + 1] - runStart;
+            runCoords.resize(runLength * 3);
+            runDists.resize(runLength);
+            for (int64_t i = 0; i < runLength; ++i)
+            {
+                myVolOut->indexToSpace(exactVoxelList.data() + (runStart + i) * 3, runCoords.data() + i * 3);
+            }
+            myDist->dist(runCoords.data(), runLength, runDists.data(), myWinding);
+            for (int64_t i = 0; i < runLength; ++i)
+            {
+                const int64_t* thisVoxel = exactVoxelList.data() + (runStart + i) * 3;
+                myVolOut->setValue(runDists[i], thisVoxel);
+                volMarked[myVolOut->getIndex(thisVoxel)] |= 22;//set marked to have valid value (positive and negative), and frozen
+            }
         }
     }
     myProgress.reportProgress(markweight + exactweight);
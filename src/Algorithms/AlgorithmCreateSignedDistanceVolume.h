@@ -24,7 +24,6 @@
 #include "AbstractAlgorithm.h"
 #include "Vector3D.h"
 #include "CaretMutex.h"
-#include "OctTree.h"
 #include "SignedDistanceHelper.h"
 
 #include <vector>
@@ -28,9 +28,28 @@
 #include "SurfaceFile.h"
 #include "SurfaceProjector.h"
 
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    void projectBatch(SurfaceProjector* myProj, const vector<Focus*>& batch, const vector<int>& batchIndices, const FociFile* fociIn)
+    {
+        if (batch.empty()) return;
+        vector<AString> errorMessages;
+        myProj->projectFoci(batch, errorMessages);
+        for (int i = 0; i < (int)batch.size(); ++i)
+        {//report the first failure of this structure in file order
+            if (!errorMessages[i].isEmpty())
+            {
+                throw AlgorithmException("failed to project focus '" + fociIn->getFocus(batchIndices[i])->getName() + "': " + errorMessages[i]);
+            }
+        }
+    }
+}
+
 AString AlgorithmFociResample::getCommandSwitch()
 {
     return "-foci-resample";
@@ -121,7 +140,11 @@ AlgorithmFociResample::AlgorithmFociResample(ProgressObject* myProgObj, const Fo
     *(fociOut->getClassColorTable()) = *(fociIn->getClassColorTable());
     *(fociOut->getNameColorTable()) = *(fociIn->getNameColorTable());
     *(fociOut->getFileMetaData()) = *(fociIn->getFileMetaData());
-    for (int i = 0; i < fociIn->getNumberOfFoci(); ++i)
+    int numFoci = fociIn->getNumberOfFoci();
+    vector<CaretPointer<Focus> > newFoci(numFoci);
+    vector<Focus*> leftFoci, rightFoci, cerebFoci;//project each structure as a batch, so the foci can be projected in parallel
+    vector<int> leftIndices, rightIndices, cerebIndices;
+    for (int i = 0; i < numFoci; ++i)
     {
         const Focus* thisFocus = fociIn->getFocus(i);
         if (thisFocus->getNumberOfProjections() < 1)
@@ -130,36 +153,51 @@ AlgorithmFociResample::AlgorithmFociResample(ProgressObject* myProgObj, const Fo
         }
         SurfaceProjector* myProj = NULL;
         const SurfaceFile* unprojFrom = NULL;
+        vector<Focus*>* projBatch = NULL;
+        vector<int>* batchIndices = NULL;
         switch (thisFocus->getProjection(0)->getStructure())
         {
             case StructureEnum::CORTEX_LEFT:
                 myProj = leftProj;
                 unprojFrom = leftCurSurf;
+                projBatch = &leftFoci;
+                batchIndices = &leftIndices;
                 break;
             case StructureEnum::CORTEX_RIGHT:
                 myProj = rightProj;
                 unprojFrom = rightCurSurf;
+                projBatch = &rightFoci;
+                batchIndices = &rightIndices;
                 break;
             case StructureEnum::CEREBELLUM:
                 myProj = cerebProj;
                 unprojFrom = cerebCurSurf;
+                projBatch = &cerebFoci;
+                batchIndices = &cerebIndices;
                 break;
             default:
                 throw AlgorithmException("focus '" + thisFocus->getName() + "' has unsupported structure " + StructureEnum::toName(thisFocus->getProjection(0)->getStructure()));
         }
         if (unprojFrom == NULL || myProj == NULL) throw AlgorithmException("focus '" + thisFocus->getName() + "' has structure " +
             StructureEnum::toName(thisFocus->getProjection(0)->getStructure()) + ", but surfaces for that structure were not specified");
-        CaretPointer<Focus> newFocus(new Focus(*thisFocus));//start with a copy
+        newFoci[i].grabNew(new Focus(*thisFocus));//start with a copy
         float xyz[3];
         bool result = thisFocus->getProjection(0)->getProjectedPosition(*unprojFrom, xyz, discardNormDist);
         if (!result) throw AlgorithmException("failed to unproject focus '" + thisFocus->getName() + "'");
-        newFocus->getProjection(0)->setStereotaxicXYZ(xyz);
-        myProj->projectFocus(i, newFocus);
+        newFoci[i]->getProjection(0)->setStereotaxicXYZ(xyz);
+        projBatch->push_back(newFoci[i]);
+        batchIndices->push_back(i);
+    }
+    projectBatch(leftProj, leftFoci, leftIndices, fociIn);
+    projectBatch(rightProj, rightFoci, rightIndices, fociIn);
+    projectBatch(cerebProj, cerebFoci, cerebIndices, fociIn);
+    for (int i = 0; i < numFoci; ++i)
+    {
         if (restoryXyz)
         {
-            newFocus->getProjection(0)->setStereotaxicXYZ(thisFocus->getProjection(0)->getStereotaxicXYZ());
+            newFoci[i]->getProjection(0)->setStereotaxicXYZ(fociIn->getFocus(i)->getProjection(0)->getStereotaxicXYZ());
         }
-        fociOut->addFocus(newFocus.releasePointer());
+        fociOut->addFocus(newFoci[i].releasePointer());
     }
 }
 
@@ -21,12 +21,16 @@
 #include "AlgorithmMetricFindClusters.h"
 #include "AlgorithmException.h"
 
+#include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -152,12 +156,14 @@ namespace
         double area;
     };
     
-    void processColumn(const float* data, const float* roiData, const float* nodeAreas, TopologyHelper* myTopoHelp, GeodesicHelper* myGeoHelp,
-                       const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
-                       float* outData, int& markVal)
+    //marks each vertex of a surviving cluster with its cluster number within this column, starting at 1, returns the number of clusters
+    //does not throw or log, so that columns can be processed in parallel
+    int processColumn(const float* data, const float* roiData, const float* nodeAreas, const ConnectedComponentHelper& myCompHelp, GeodesicHelper* myGeoHelp,
+                      const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
+                      int* clusterOut, bool& nonPositiveOut)
     {
-        int numNodes = myTopoHelp->getNumberOfNodes();
-        vector<int> marked(numNodes, 0);
+        int numNodes = (int)myCompHelp.getNumberOfElements();
+        vector<char> marked(numNodes, 0);
         if (lessThan)
         {
             for (int i = 0; i < numNodes; ++i)
@@ -176,46 +182,41 @@ namespace
                 }
             }
         }
+        vector<int64_t> labels;
+        int64_t numComponents = myCompHelp.labelComponents(marked, labels);
+        vector<double> componentAreas(numComponents, 0.0);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (labels[i] >= 0) componentAreas[labels[i]] += nodeAreas[i];
+        }
         vector<Cluster> clusters;
+        vector<int> componentToCluster(numComponents, -1);
         float biggestSize = 0.0f;
         int biggestCluster = -1;
-        for (int i = 0; i < numNodes; ++i)
+        for (int64_t i = 0; i < numComponents; ++i)
         {
-            if (marked[i])
+            if (componentAreas[i] > minArea)
             {
-                Cluster newCluster;
-                newCluster.members.push_back(i);
-                marked[i] = 0;//unmark it when added to list to prevent multiples
-                for (int index = 0; index < (int)newCluster.members.size(); ++index)//NOTE: vector grows inside loop
+                if (componentAreas[i] > biggestSize)
                 {
-                    int node = newCluster.members[index];//keep list around so we can put it into the output immediately if it is large enough
-                    newCluster.area += nodeAreas[node];
-                    const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
-                    int numNeigh = (int)neighbors.size();
-                    for (int n = 0; n < numNeigh; ++n)
-                    {
-                        const int32_t& neighbor = neighbors[n];
-                        if (marked[neighbor])
-                        {
-                            newCluster.members.push_back(neighbor);
-                            marked[neighbor] = 0;
-                        }
-                    }
-                }
-                if (newCluster.area > minArea)
-                {
-                    if (newCluster.area > biggestSize)
-                    {
-                        biggestSize = newCluster.area;
-                        biggestCluster = (int)clusters.size();
-                    }
-                    clusters.push_back(newCluster);
+                    biggestSize = componentAreas[i];
+                    biggestCluster = (int)clusters.size();
                 }
+                componentToCluster[i] = (int)clusters.size();
+                clusters.push_back(Cluster());
+                clusters.back().area = componentAreas[i];
+            }
+        }
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (labels[i] >= 0 && componentToCluster[labels[i]] != -1)
+            {
+                clusters[componentToCluster[labels[i]]].members.push_back(i);
             }
         }
         vector<int32_t> pathScratch;
         vector<float> distScratch;
-        if (!clusters.empty() && biggestCluster == -1) CaretLogWarning("clusters found, but none have positive area, check your vertex areas for negatives");
+        nonPositiveOut = (!clusters.empty() && biggestCluster == -1);
         if (biggestCluster != -1 && (distanceCutoff > 0.0f || areaRatio > 0.0f))
         {
             for (size_t i = 0; i < clusters.size(); ++i)
@@ -249,6 +250,21 @@ namespace
             }
         }
         for (size_t i = 0; i < clusters.size(); ++i)
+        {
+            int numMembers = (int)clusters[i].members.size();
+            for (int index = 0; index < numMembers; ++index)
+            {
+                clusterOut[clusters[i].members[index]] = (int)i + 1;
+            }
+        }
+        return (int)clusters.size();
+    }
+    
+    //converts the per-column cluster numbers into marking values, which continue across columns and skip 0
+    void markClusters(const int* clusterIn, const int& numNodes, const int& numClusters, float* outData, int& markVal)
+    {
+        vector<float> markValues(numClusters);
+        for (int i = 0; i < numClusters; ++i)
         {
             if (markVal == 0)
             {
@@ -257,12 +273,17 @@ namespace
             }
             float tempVal = markVal;
             if ((int)tempVal != markVal) throw AlgorithmException("too many clusters, unable to mark them uniquely");
-            int numMembers = (int)clusters[i].members.size();
-            for (int index = 0; index < numMembers; ++index)
+            markValues[i] = tempVal;
+            ++markVal;
+        }
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (clusterIn[i] > 0)
             {
-                outData[clusters[i].members[index]] = tempVal;
+                outData[i] = markValues[clusterIn[i] - 1];
+            } else {
+                outData[i] = 0.0f;
             }
-            ++markVal;
         }
     }
 }
@@ -303,40 +324,70 @@ AlgorithmMetricFindClusters::AlgorithmMetricFindClusters(ProgressObject* myProgO
         nodeAreas = myAreas->getValuePointerForColumn(0);
     }
     CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
-    CaretPointer<GeodesicHelper> myGeoHelp;
+    ConnectedComponentHelper myCompHelp(myTopoHelp);
     CaretPointer<GeodesicHelperBase> myGeoBase;
-    if (distanceCutoff > 0.0f)//geodesic is only needed for distance cutoff
+    if (distanceCutoff > 0.0f && myAreas != NULL)//geodesic is only needed for distance cutoff
     {
-        if (myAreas == NULL)
-        {
-            myGeoHelp = mySurf->getGeodesicHelper();
-        } else {
-            myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
-            myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
-        }
+        myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
     }
-    vector<int> toSearch;
-    int markVal = startVal;//give each cluster a different value, including across maps
+    vector<int> inputColumns;
     if (columnNum == -1)
     {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
-        myMetricOut->setStructure(mySurf->getStructure());
         for (int c = 0; c < numCols; ++c)
         {
-            myMetricOut->setColumnName(c, myMetric->getColumnName(c));
-            vector<float> outData(numNodes, 0.0f);
-            const float* data = myMetric->getValuePointerForColumn(c);
-            processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
-            myMetricOut->setValuesForColumn(c, outData.data());
+            inputColumns.push_back(c);
         }
     } else {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        myMetricOut->setStructure(mySurf->getStructure());
-        myMetricOut->setColumnName(0, myMetric->getColumnName(columnNum));
-        vector<float> outData(numNodes, 0.0f);
-        const float* data = myMetric->getValuePointerForColumn(columnNum);
-        processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
-        myMetricOut->setValuesForColumn(0, outData.data());
+        inputColumns.push_back(columnNum);
+    }
+    int numOutCols = (int)inputColumns.size();
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutCols);
+    myMetricOut->setStructure(mySurf->getStructure());
+    int batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();
+#endif
+    batchSize = min(batchSize, numOutCols);
+    vector<vector<int> > batchClusters(batchSize, vector<int>(numNodes));
+    vector<int> batchNumClusters(batchSize, 0);
+    vector<char> batchNonPositive(batchSize, 0);
+    vector<float> outData(numNodes);
+    int markVal = startVal;//give each cluster a different value, including across maps
+    for (int batchStart = 0; batchStart < numOutCols; batchStart += batchSize)
+    {//find clusters for several columns in parallel, then number them in column order
+        int batchEnd = min(batchStart + batchSize, numOutCols);
+#pragma omp CARET_PAR if (batchEnd - batchStart > 1)
+        {
+            CaretPointer<GeodesicHelper> myGeoHelp;
+            if (distanceCutoff > 0.0f)
+            {
+                if (myGeoBase != NULL)
+                {
+                    myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
+                } else {
+                    myGeoHelp = mySurf->getGeodesicHelper();
+                }
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int c = batchStart; c < batchEnd; ++c)
+            {
+                int batchIndex = c - batchStart;
+                vector<int>& clusterScratch = batchClusters[batchIndex];
+                clusterScratch.assign(numNodes, 0);
+                bool nonPositive = false;
+                batchNumClusters[batchIndex] = processColumn(myMetric->getValuePointerForColumn(inputColumns[c]), roiData, nodeAreas, myCompHelp, myGeoHelp,
+                                                             threshVal, minArea, lessThan, areaRatio, distanceCutoff, clusterScratch.data(), nonPositive);
+                batchNonPositive[batchIndex] = (nonPositive ? 1 : 0);
+            }
+        }
+        for (int c = batchStart; c < batchEnd; ++c)
+        {
+            int batchIndex = c - batchStart;
+            if (batchNonPositive[batchIndex]) CaretLogWarning("clusters found, but none have positive area, check your vertex areas for negatives");
+            markClusters(batchClusters[batchIndex].data(), numNodes, batchNumClusters[batchIndex], outData.data(), markVal);
+            myMetricOut->setColumnName(c, myMetric->getColumnName(inputColumns[c]));
+            myMetricOut->setValuesForColumn(c, outData.data());
+        }
     }
     if (endVal != NULL) *endVal = markVal;
 }
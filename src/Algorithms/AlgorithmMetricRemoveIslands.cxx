@@ -21,11 +21,13 @@
 #include "AlgorithmMetricRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
-#include <utility>
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -92,68 +94,62 @@ AlgorithmMetricRemoveIslands::AlgorithmMetricRemoveIslands(ProgressObject* myPro
     int numCols = myMetric->getNumberOfColumns();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     myMetricOut->setStructure(myMetric->getStructure());
-    for (int col = 0; col < numCols; ++col)
+    CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
+    ConnectedComponentHelper myCompHelp(myHelp);
+    int batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();
+#endif
+    batchSize = min(batchSize, numCols);
+    vector<vector<float> > batchOut(batchSize);
+    for (int batchStart = 0; batchStart < numCols; batchStart += batchSize)
     {
-        vector<pair<float, vector<int> > > areas;
-        vector<int> used(numNodes, 0);
-        CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
-        const float* roiData = myMetric->getValuePointerForColumn(col);
-        myMetricOut->setColumnName(col, myMetric->getColumnName(col));
-        for (int i = 0; i < numNodes; ++i)
+        int batchEnd = min(batchStart + batchSize, numCols);
+#pragma omp CARET_PARFOR schedule(dynamic) if (batchEnd - batchStart > 1)
+        for (int col = batchStart; col < batchEnd; ++col)
         {
-            if (used[i] == 0 && roiData[i] > 0.0f)
+            const float* roiData = myMetric->getValuePointerForColumn(col);
+            vector<char> marked(numNodes);
+            for (int i = 0; i < numNodes; ++i)
             {
-                areas.push_back(make_pair(0.0f, vector<int>()));
-                vector<int>& thisAreaMembers = areas.back().second;
-                float& thisSurfArea = areas.back().first;
-                thisAreaMembers.push_back(i);
-                thisSurfArea += areaData[i];
-                used[i] = 1;
-                vector<int> mystack;
-                mystack.push_back(i);
-                while (!mystack.empty())
+                marked[i] = (roiData[i] > 0.0f ? 1 : 0);
+            }
+            vector<int64_t> labels;
+            int numAreas = (int)myCompHelp.labelComponents(marked, labels);
+            vector<float> areas(numAreas, 0.0f);
+            for (int i = 0; i < numNodes; ++i)
+            {
+                if (labels[i] >= 0) areas[labels[i]] += areaData[i];
+            }
+            vector<float>& outscratch = batchOut[col - batchStart];
+            outscratch.assign(numNodes, 0.0f);
+            if (numAreas > 0)
+            {
+                int bestIndex = 0;
+                float bestArea = areas[0];
+                for (int i = 1; i < numAreas; ++i)
                 {
-                    int curnode = mystack.back();
-                    mystack.pop_back();
-                    const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(curnode);
-                    int numNeigh = (int)neighbors.size();
-                    for (int j = 0; j < numNeigh; ++j)
+                    float thisArea = (int)areas[i];
+                    if (thisArea > bestArea)
                     {
-                        int thisneigh = neighbors[j];
-                        if (used[thisneigh] == 0 && roiData[thisneigh] > 0.0f)
-                        {
-                            used[thisneigh] = 1;
-                            thisAreaMembers.push_back(thisneigh);
-                            thisSurfArea += areaData[thisneigh];
-                            mystack.push_back(thisneigh);
-                        }
+                        bestIndex = i;
+                        bestArea = thisArea;
                     }
                 }
-            }
-        }
-        vector<float> outscratch(numNodes, 0.0f);
-        int numAreas = (int)areas.size();
-        if (numAreas > 0)
-        {
-            int bestIndex = 0;
-            float bestArea = areas[0].first;
-            for (int i = 1; i < numAreas; ++i)
-            {
-                float thisArea = (int)areas[i].first;
-                if (thisArea > bestArea)
+                for (int i = 0; i < numNodes; ++i)
                 {
-                    bestIndex = i;
-                    bestArea = thisArea;
+                    if (labels[i] == bestIndex)
+                    {
+                        outscratch[i] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                    }
                 }
             }
-            const vector<int>& thisArea = areas[bestIndex].second;
-            int numAreaNodes = (int)thisArea.size();
-            for (int i = 0; i < numAreaNodes; ++i)
-            {
-                outscratch[thisArea[i]] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
-            }
         }
-        myMetricOut->setValuesForColumn(col, outscratch.data());
+        for (int col = batchStart; col < batchEnd; ++col)
+        {
+            myMetricOut->setColumnName(col, myMetric->getColumnName(col));
+            myMetricOut->setValuesForColumn(col, batchOut[col - batchStart].data());
+        }
     }
 }
 
@@ -161,16 +161,24 @@ AlgorithmMetricToVolumeMapping::AlgorithmMetricToVolumeMapping(ProgressObject* m
     const int64_t frameSize = dims[0] * dims[1] * dims[2];
     vector<int32_t> voxelToVertex(frameSize);
     CaretPointer<const CaretPointLocator> myLocator = mySurf->getPointLocator();
-#pragma omp CARET_PARFOR schedule(dynamic)
+    const int64_t sliceSize = dims[0] * dims[1];
+    vector<float> sliceCoords(sliceSize * 3);
+    vector<int64_t> sliceVertices(sliceSize);
     for (int64_t k = 0; k < dims[2]; ++k)
-    {
+    {//one batched query per slice, the locator does the parallelization
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                myVolSpace.indexToSpace(i, j, k, sliceCoords.data() + (i + j * dims[0]) * 3);
+            }
+        }
+        myLocator->closestPoints(sliceCoords.data(), sliceSize, sliceVertices.data(), nearDist);
         for (int64_t j = 0; j < dims[1]; ++j)
         {
             for (int64_t i = 0; i < dims[0]; ++i)
             {
-                float voxelCoord[3];
-                myVolSpace.indexToSpace(i, j, k, voxelCoord);
-                voxelToVertex[myVolSpace.getIndex(i, j, k)] = myLocator->closestPointLimited(voxelCoord, nearDist);
+                voxelToVertex[myVolSpace.getIndex(i, j, k)] = (int32_t)sliceVertices[i + j * dims[0]];
             }
         }
     }
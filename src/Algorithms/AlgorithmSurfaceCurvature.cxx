@@ -23,8 +23,7 @@
 
 #include "MetricFile.h"
 #include "SurfaceFile.h"
-#include "TopologyHelper.h"
-#include "Vector3D.h"
+#include "SurfaceGeometryHelper.h"
 
 #include <cmath>
 
@@ -94,73 +93,17 @@ AlgorithmSurfaceCurvature::AlgorithmSurfaceCurvature(ProgressObject* myProgObj,
         gaussOut->setStructure(mySurf->getStructure());
         gaussOut->setColumnName(0, "gaussian curvature");
     }
-    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
-    const float* normalData = mySurf->getNormalData();
-    for (int i = 0; i < numNodes; ++i)
+    if (numNodes <= 0) return;
+    SurfaceGeometryHelper myGeoHelp(mySurf);
+    vector<float> meanData(numNodes), gaussData(numNodes);
+    myGeoHelp.computeCurvature(mySurf->getCoordinateData(), mySurf->getNormalData(), meanData.data(), gaussData.data());
+    if (meanOut != NULL)
+    {
+        meanOut->setValuesForColumn(0, meanData.data());
+    }
+    if (gaussOut != NULL)
     {
-        const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
-        int numNeigh = (int)neighbors.size();
-        float k1 = 0.0f, k2 = 0.0f;
-        if (numNeigh > 0)
-        {
-            Vector3D center = mySurf->getCoordinate(i);
-            Vector3D normal = normalData + i * 3;
-            Vector3D basisStart;//default constructor is 0 vector
-            if (abs(normal[0]) > abs(normal[1]))
-            {//a vector not parallel to the normal
-                basisStart[1] = 1.0f;
-            } else {
-                basisStart[0] = 1.0f;
-            }
-            Vector3D ihat = normal.cross(basisStart).normal();
-            Vector3D jhat = normal.cross(ihat);
-            float sig_x = 0.0f, sig_xy = 0.0f, sig_y = 0.0f;
-            float norm_x = 0.0f, norm_xy = 0.0f, norm_y = 0.0f;
-            for (int j = 0; j < numNeigh; ++j)
-            {//center node contributes 0 to each sum, so skip it
-                Vector3D neighNormal = normalData + neighbors[j] * 3;
-                Vector3D neighDiff = Vector3D(mySurf->getCoordinate(neighbors[j])) - center;
-                float normProj[2] = { neighNormal.dot(ihat), neighNormal.dot(jhat) };
-                float diffProj[2] = { neighDiff.dot(ihat), neighDiff.dot(jhat) };
-                sig_x += diffProj[0] * diffProj[0];
-                sig_xy += diffProj[0] * diffProj[1];
-                sig_y += diffProj[1] * diffProj[1];
-                norm_x += normProj[0] * diffProj[0];
-                norm_xy += normProj[0] * diffProj[1] + normProj[1] * diffProj[0];
-                norm_y += normProj[1] * diffProj[1];
-            }
-            float sig_xy2 = sig_xy * sig_xy;
-            float denom = (sig_x + sig_y) * (-sig_xy2 + sig_x * sig_y);
-            if (denom != 0.0f)
-            {
-                float a = (norm_x * (-sig_xy2 + sig_x * sig_y + sig_y * sig_y) -
-                           norm_xy * sig_xy * sig_y +
-                           norm_y * sig_xy2) / denom;
-                float b = (-norm_x * sig_xy * sig_y +
-                           norm_xy * sig_x * sig_y -
-                           norm_y * sig_x * sig_xy) / denom;
-                float c = (norm_x * sig_xy2 -
-                           norm_xy * sig_x * sig_xy +
-                           norm_y * (sig_x * sig_x - sig_xy2 + sig_x * sig_y)) / denom;
-                float trC = a + c;
-                float detC = a * c - b * b;
-                float temp = trC * trC - 4 * detC;
-                if (temp >= 0.0f)
-                {
-                    float delta = sqrt(temp);
-                    k1 = (trC + delta) / 2;
-                    k2 = (trC - delta) / 2;
-                }
-            }
-        }
-        if (meanOut != NULL)
-        {
-            meanOut->setValue(i, 0, (k1 + k2) / 2);
-        }
-        if (gaussOut != NULL)
-        {
-            gaussOut->setValue(i, 0, k1 * k2);
-        }
+        gaussOut->setValuesForColumn(0, gaussData.data());
     }
 }
 
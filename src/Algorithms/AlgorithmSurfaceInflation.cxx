@@ -27,7 +27,9 @@
 #include "BoundingBox.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "SurfaceFile.h"
+#include "SurfaceGeometryHelper.h"
 
 using namespace caret;
 
@@ -165,6 +167,14 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
     
     const int32_t numberOfNodes = outputSurfaceFile->getNumberOfNodes();
     
+    /*
+     * The topology doesn't change, so build the smoothing neighbors once,
+     * and work on a coordinate array instead of the surface
+     */
+    SurfaceGeometryHelper myGeoHelp(outputSurfaceFile, true);
+    const float* coordData = outputSurfaceFile->getCoordinateData();
+    std::vector<float> coords(coordData, coordData + numberOfNodes * 3);
+    
     for (int iCycle = 0; iCycle < cycles; iCycle++) {
         /*
          * Smooth
@@ -174,19 +184,18 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
         {
             subProgress = subAlgProgress[iCycle];
         }
-        AlgorithmSurfaceSmoothing(subProgress,
-                                  outputSurfaceFile,
-                                  outputSurfaceFile,
-                                  strength,
-                                  iterations);
+        AlgorithmSurfaceSmoothing::smoothCoordinates(subProgress,
+                                                     myGeoHelp,
+                                                     coords,
+                                                     strength,
+                                                     iterations);
         
         /*
          * Inflate
          */
-        float xyz[3];
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
         for (int32_t iNode = 0; iNode < numberOfNodes; iNode++) {
-            outputSurfaceFile->getCoordinate(iNode,
-                                             xyz);
+            float* xyz = &coords[iNode * 3];
             
             const float x = xyz[0] / anatomicalRangeX;
             const float y = xyz[1] / anatomicalRangeY;
@@ -198,15 +207,15 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
             xyz[0] *= scale;
             xyz[1] *= scale;
             xyz[2] *= scale;
-            
-            outputSurfaceFile->setCoordinate(iNode,
-                                             xyz);
         }
         
         myProgress.reportProgress(static_cast<float>(iCycle +1)
                                   / static_cast<float>(cycles));
     }
     
+    if (numberOfNodes > 0) {
+        outputSurfaceFile->setCoordinates(&coords[0]);
+    }
     outputSurfaceFile->computeNormals();
 }
 
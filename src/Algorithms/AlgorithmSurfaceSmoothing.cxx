@@ -24,9 +24,8 @@
 
 #include "AlgorithmSurfaceSmoothing.h"
 #include "AlgorithmException.h"
-#include "MathFunctions.h"
 #include "SurfaceFile.h"
-#include "TopologyHelper.h"
+#include "SurfaceGeometryHelper.h"
 
 using namespace caret;
 
@@ -108,6 +107,23 @@ AlgorithmSurfaceSmoothing::useParameters(OperationParameters* myParams,
     
 }
 
+namespace
+{
+    void checkSmoothingParameters(const float strength, const int32_t iterations)
+    {
+        if ((strength < 0.0)
+            || (strength > 1.0)) {
+            throw AlgorithmException("Invalid smoothing strength outside [0.0, 1.0]: "
+                                     + QString::number(strength, 'f', 5));
+        }
+        
+        if (iterations <= 0) {
+            throw AlgorithmException("Invalid iterations value [1, infinity]: "
+                                     + QString::number(iterations));
+        }
+    }
+}
+
 /**
  * Constructor
  *
@@ -123,158 +139,68 @@ AlgorithmSurfaceSmoothing::AlgorithmSurfaceSmoothing(ProgressObject* myProgObj,
                                                      const int32_t iterations)
    : AbstractAlgorithm(myProgObj)
 {
-    if ((strength < 0.0)
-        || (strength > 1.0)) {
-        throw AlgorithmException("Invalid smoothing strength outside [0.0, 1.0]: "
-                                 + QString::number(strength, 'f', 5));
-    }
-    
-    if (iterations <= 0) {
-        throw AlgorithmException("Invalid iterations value [1, infinity]: "
-                                 + QString::number(iterations));
-    }
-    
-    /*
-     * Sets the algorithm up to use the progress object, and will 
-     * finish the progress object automatically when the algorithm terminates
-     */
-    LevelProgress myProgress(myProgObj);
+    checkSmoothingParameters(strength, iterations);
     
     *outputSurfaceFile = *inputSurfaceFile;
     
-    CaretPointer<TopologyHelper> myTopoHelp = outputSurfaceFile->getTopologyHelper(true);
-    
     const int32_t numNodes = outputSurfaceFile->getNumberOfNodes();
     if (numNodes <= 0) {
         return;
     }
     
     /*
-     * Storage for coordinates, input and output of each iteration
+     * Smoothing needs the neighbors in order around each node
      */
-    std::vector<float> coordsIn(numNodes * 3);
-    std::vector<float> coordsOut(numNodes * 3);
+    SurfaceGeometryHelper myGeoHelp(outputSurfaceFile, true);
+    
+    const float* coordData = outputSurfaceFile->getCoordinateData();
+    std::vector<float> coords(coordData, coordData + numNodes * 3);
     
+    smoothCoordinates(myProgObj, myGeoHelp, coords, strength, iterations);
+
     /*
-     * Copy coordinates from surface
+     * Copy coordinates into surface
      */
-    for (int32_t i = 0; i < numNodes; i++) {
-        const float* xyz = outputSurfaceFile->getCoordinate(i);
-        
-        const int32_t i3 = i * 3;
-        coordsIn[i3]   = xyz[0];
-        coordsIn[i3+1] = xyz[1];
-        coordsIn[i3+2] = xyz[2];
-        coordsOut[i3]   = xyz[0];
-        coordsOut[i3+1] = xyz[1];
-        coordsOut[i3+2] = xyz[2];
-    }
+    outputSurfaceFile->setCoordinates(&coords[0]);
+}
+
+/**
+ * Smooth coordinates in place, without a surface file.  Used when the same
+ * topology is smoothed repeatedly, so the neighbors are only found once.
+ *
+ * @param myProgObj
+ *     Progress object, may be NULL
+ * @param myGeoHelp
+ *     Geometry helper for the topology, must have sorted neighbors
+ * @param coordsInOut
+ *     Interleaved XYZ coordinates
+ */
+void AlgorithmSurfaceSmoothing::smoothCoordinates(ProgressObject* myProgObj,
+                                                  const SurfaceGeometryHelper& myGeoHelp,
+                                                  std::vector<float>& coordsInOut,
+                                                  const float strength,
+                                                  const int32_t iterations)
+{
+    checkSmoothingParameters(strength, iterations);
+    CaretAssert(static_cast<int64_t>(coordsInOut.size()) == static_cast<int64_t>(myGeoHelp.getNumberOfNodes()) * 3);
     
-    std::vector<float> triangleAreas(100);
-    std::vector<float> triangleCenters(100*3);
+    /*
+     * Sets the algorithm up to use the progress object, and will 
+     * finish the progress object automatically when the algorithm terminates
+     */
+    LevelProgress myProgress(myProgObj);
     
-    const float inverseStrength = 1.0 - strength;
+    /*
+     * Each iteration reads one buffer and writes the other, then they are swapped
+     */
+    std::vector<float> scratch(coordsInOut.size());
     
     /*
      * Perform the requested number of iterations
      */
     for (int32_t iter = 1; iter <= iterations; iter++) {
-        /*
-         * Copy coordinates from previous iteration
-         */
-        if (iter > 1) {
-            coordsIn = coordsOut;
-        }
-        
-        /*
-         * Process each node
-         */
-        for (int32_t iNode = 0; iNode < numNodes; iNode++) {
-            /*
-             * Get node's neighbors
-             */
-            int32_t numNeighbors = 0;
-            const int32_t* neighbors = myTopoHelp->getNodeNeighbors(iNode, numNeighbors);
-            
-            if (numNeighbors < 2) {
-                coordsOut[iNode*3]   = coordsIn[iNode*3];
-                coordsOut[iNode*3+1] = coordsIn[iNode*3+1];
-                coordsOut[iNode*3+2] = coordsIn[iNode*3+2];
-            }
-            else {
-                /*
-                 * Ensure adequate space for triangle areas and center coordinate
-                 */
-                if (numNeighbors > static_cast<int32_t>(triangleAreas.size())) {
-                    triangleAreas.resize(numNeighbors);
-                    triangleCenters.resize(numNeighbors * 3);
-                }
-                double totalArea = 0.0;
-                
-                /*
-                 * Average node with its neighbors
-                 */
-                for (int jn = 0; jn < numNeighbors; jn++) {
-                    /*
-                     * Get two consecutive neighbors
-                     */
-                    const int32_t n1 = neighbors[jn];
-                    int nextNeighborIndex = jn + 1;
-                    if (nextNeighborIndex >= numNeighbors) {
-                        nextNeighborIndex = 0;
-                    }
-                    const int32_t n2 = neighbors[nextNeighborIndex];
-                    
-                    /*
-                     * Coordinates of nodes and neighbors
-                     */
-                    const float* c1 = &coordsIn[iNode*3];
-                    const float* c2 = &coordsIn[n1*3];
-                    const float* c3 = &coordsIn[n2*3];
-                    const float area = MathFunctions::triangleArea(c1,
-                                                                   c2,
-                                                                   c3);
-                    
-                    /*
-                     * Area of triangle formed by node and neighbors
-                     */
-                    triangleAreas[jn] = area;
-                    totalArea += area;
-                    
-                    /*
-                     * Average of nodes that form triangle
-                     */
-                    for (int32_t k = 0; k < 3; k++) {
-                        triangleCenters[jn*3+k] = (c1[k] + c2[k] + c3[k]) / 3.0;
-                    }
-                }
-                    
-                /*
-                 * Influence of neighbors
-                 */
-                float neighborAverageX = 0.0;
-                float neighborAverageY = 0.0;
-                float neighborAverageZ = 0.0;
-                for (int j = 0; j < numNeighbors; j++) {
-                    if (triangleAreas[j] > 0.0) {
-                        const float weight = triangleAreas[j] / totalArea;
-                        neighborAverageX += (weight * triangleCenters[j*3]);
-                        neighborAverageY += (weight * triangleCenters[j*3+1]);
-                        neighborAverageZ += (weight * triangleCenters[j*3+2]);
-                    }
-                }
-                
-                /*
-                 * Update coordinates
-                 */
-                coordsOut[iNode*3]   = ((coordsIn[iNode*3] * inverseStrength)
-                                        + (neighborAverageX * strength));
-                coordsOut[iNode*3+1] = ((coordsIn[iNode*3+1] * inverseStrength)
-                                        + (neighborAverageY * strength));
-                coordsOut[iNode*3+2] = ((coordsIn[iNode*3+2] * inverseStrength)
-                                        + (neighborAverageZ * strength));
-            }
-        }
+        myGeoHelp.smoothCoordinates(coordsInOut.data(), strength, scratch.data());
+        coordsInOut.swap(scratch);
         
         /*
          * Update progress
@@ -282,14 +208,8 @@ AlgorithmSurfaceSmoothing::AlgorithmSurfaceSmoothing(ProgressObject* myProgObj,
         const float percentDone = (static_cast<float>(iter)
                                     / static_cast<float>(iterations));
         myProgress.reportProgress(percentDone);//give continuous updates, if it slows things down we can reduce the resolution in the progress framework
-        
     }
 
-    /*
-     * Copy coordinates into surface
-     */
-    outputSurfaceFile->setCoordinates(&coordsOut[0]);
-
     myProgress.reportProgress(1.0f);
 }
 
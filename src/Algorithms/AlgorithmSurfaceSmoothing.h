@@ -24,8 +24,12 @@
 
 #include "AbstractAlgorithm.h"
 
+#include <vector>
+
 namespace caret {
 
+    class SurfaceGeometryHelper;
+
     class AlgorithmSurfaceSmoothing : public AbstractAlgorithm {
 
     private:
@@ -43,6 +47,13 @@ namespace caret {
                                   const float strength,
                                   const int32_t iterations);
 
+        //smooths coordinates in place, the helper must have sorted neighbors, lets repeated smoothing of the same topology reuse the helper
+        static void smoothCoordinates(ProgressObject* myProgObj,
+                                      const SurfaceGeometryHelper& myGeoHelp,
+                                      std::vector<float>& coordsInOut,
+                                      const float strength,
+                                      const int32_t iterations);
+
         static OperationParameters* getParameters();
 
         static void useParameters(OperationParameters* myParams, 
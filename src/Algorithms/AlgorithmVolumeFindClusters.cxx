@@ -23,11 +23,13 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CaretPointLocator.h"
+#include "ConnectedComponentHelper.h"
 #include "VolumeFile.h"
-#include "VoxelIJK.h"
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -135,23 +137,13 @@ void AlgorithmVolumeFindClusters::useParameters(OperationParameters* myParams, P
 
 namespace
 {
-    void processSubvol(const float* inFrame, VolumeFile* volOut, const int64_t& outSubvol, const int64_t& outComponent, const float& threshValue, const float& minVolume,
-                       const bool& lessThan, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff, int& markVal)
+    //marks each voxel of a surviving cluster with its cluster number within this frame, starting at 1, returns the number of clusters
+    //does not throw or log, so that frames can be processed in parallel
+    int processSubvol(const float* inFrame, const VolumeSpace& mySpace, const ConnectedComponentHelper& myCompHelp, const int64_t& minVoxels,
+                      const bool& lessThan, const float& threshValue, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff, int* clusterOut)
     {
-        vector<int64_t> dims = volOut->getDimensions();
+        const int64_t* dims = mySpace.getDims();
         int64_t frameSize = dims[0] * dims[1] * dims[2];
-        const VolumeSpace& mySpace = volOut->getVolumeSpace();
-        Vector3D ivec, jvec, kvec, origin;
-        mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
-        float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
-        int64_t minVoxels = (int64_t)ceil(minVolume / voxelVolume);
-        vector<VoxelIJK> neighbors;
-        neighbors.push_back(VoxelIJK(1, 0, 0));
-        neighbors.push_back(VoxelIJK(-1, 0, 0));
-        neighbors.push_back(VoxelIJK(0, 1, 0));
-        neighbors.push_back(VoxelIJK(0, -1, 0));
-        neighbors.push_back(VoxelIJK(0, 0, 1));
-        neighbors.push_back(VoxelIJK(0, 0, -1));
         vector<char> marked(frameSize, 0);
         if (lessThan)
         {
@@ -171,56 +163,42 @@ namespace
                 }
             }
         }
-        vector<vector<VoxelIJK> > clusters;
+        vector<int64_t> labels;
+        int64_t numComponents = myCompHelp.labelComponents(marked, labels);
+        vector<int64_t> componentSizes(numComponents, 0);
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (labels[i] >= 0) ++componentSizes[labels[i]];
+        }
+        vector<vector<int64_t> > clusters;//linear voxel indices
+        vector<int64_t> componentToCluster(numComponents, -1);
         size_t biggestCount = 0;
         int64_t biggestCluster = -1;
-        for (int64_t k = 0; k < dims[2]; ++k)
+        for (int64_t i = 0; i < numComponents; ++i)
         {
-            for (int64_t j = 0; j < dims[1]; ++j)
+            if (componentSizes[i] >= minVoxels)
             {
-                for (int64_t i = 0; i < dims[0]; ++i)
+                if ((size_t)componentSizes[i] > biggestCount)
                 {
-                    int64_t myIndex = mySpace.getIndex(i, j, k);
-                    if (marked[myIndex])
-                    {
-                        vector<VoxelIJK> voxelList;
-                        voxelList.push_back(VoxelIJK(i, j, k));
-                        marked[myIndex] = 0;//don't let voxels get duplicated in the list
-                        for (int64_t index = 0; index < (int64_t)voxelList.size(); ++index)//NOTE: vector grows inside loop
-                        {
-                            const VoxelIJK& thisVoxel = voxelList[index];
-                            for (int n = 0; n < (int)neighbors.size(); ++n)
-                            {
-                                VoxelIJK neighVox(thisVoxel.m_ijk[0] + neighbors[n].m_ijk[0],
-                                                    thisVoxel.m_ijk[1] + neighbors[n].m_ijk[1],
-                                                    thisVoxel.m_ijk[2] + neighbors[n].m_ijk[2]);
-                                if (mySpace.indexValid(neighVox.m_ijk))
-                                {
-                                    int64_t neighIndex = mySpace.getIndex(neighVox.m_ijk);
-                                    if (marked[neighIndex])
-                                    {
-                                        voxelList.push_back(neighVox);
-                                        marked[neighIndex] = 0;
-                                    }
-                                }
-                            }
-                        }
-                        if ((int64_t)voxelList.size() >= minVoxels)
-                        {
-                            if (voxelList.size() > biggestCount)
-                            {
-                                biggestCount = voxelList.size();
-                                biggestCluster = (int64_t)clusters.size();
-                            }
-                            clusters.push_back(voxelList);
-                        }
-                    }
+                    biggestCount = (size_t)componentSizes[i];
+                    biggestCluster = (int64_t)clusters.size();
                 }
+                componentToCluster[i] = (int64_t)clusters.size();
+                clusters.push_back(vector<int64_t>());
+                clusters.back().reserve(componentSizes[i]);
+            }
+        }
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (labels[i] >= 0 && componentToCluster[labels[i]] != -1)
+            {
+                clusters[componentToCluster[labels[i]]].push_back(i);
             }
         }
         if (!clusters.empty()) CaretAssert(biggestCluster != -1);
         if (biggestCluster != -1 && (distanceCutoff > 0.0f || sizeRatio > 0.0f))
         {
+            const int64_t sliceSize = dims[0] * dims[1];
             CaretPointer<CaretPointLocator> myLocator;
             if (distanceCutoff > 0.0f)
             {
@@ -228,13 +206,14 @@ namespace
                 biggestCoords.reserve(biggestCount * 3);
                 for (size_t i = 0; i < clusters[biggestCluster].size(); ++i)
                 {
+                    int64_t index = clusters[biggestCluster][i];
                     float thisCoord[3];
-                    mySpace.indexToSpace(clusters[biggestCluster][i].m_ijk, thisCoord);
+                    mySpace.indexToSpace(index % dims[0], (index / dims[0]) % dims[1], index / sliceSize, thisCoord);
                     biggestCoords.push_back(thisCoord[0]);
                     biggestCoords.push_back(thisCoord[1]);
                     biggestCoords.push_back(thisCoord[2]);
                 }
-                myLocator.grabNew(new CaretPointLocator(biggestCoords.data(), biggestCoords.size()));
+                myLocator.grabNew(new CaretPointLocator(biggestCoords.data(), biggestCoords.size() / 3));
             }
             for (size_t i = 0; i < clusters.size(); ++i)
             {
@@ -250,8 +229,9 @@ namespace
                         erase = true;//erase unless we find a point close enough to the biggest cluster
                         for (size_t j = 0; j < clusters[i].size(); ++j)
                         {
+                            int64_t index = clusters[i][j];
                             float thisCoord[3];
-                            mySpace.indexToSpace(clusters[i][j].m_ijk, thisCoord);
+                            mySpace.indexToSpace(index % dims[0], (index / dims[0]) % dims[1], index / sliceSize, thisCoord);
                             int32_t ret = myLocator->closestPointLimited(thisCoord, distanceCutoff);
                             if (ret == -1)
                             {
@@ -270,6 +250,20 @@ namespace
             }
         }
         for (size_t i = 0; i < clusters.size(); ++i)
+        {
+            for (size_t index = 0; index < clusters[i].size(); ++index)
+            {
+                clusterOut[clusters[i][index]] = (int)i + 1;
+            }
+        }
+        return (int)clusters.size();
+    }
+    
+    //converts the per-frame cluster numbers into marking values, which continue across frames and skip 0
+    void markClusters(const int* clusterIn, const int64_t& frameSize, const int& numClusters, float* outFrame, int& markVal)
+    {
+        vector<float> markValues(numClusters);
+        for (int i = 0; i < numClusters; ++i)
         {
             if (markVal == 0)
             {
@@ -278,11 +272,17 @@ namespace
             }
             float tempVal = markVal;
             if ((int)tempVal != markVal) throw AlgorithmException("too many clusters, unable to mark them uniquely");
-            for (size_t index = 0; index < clusters[i].size(); ++index)
+            markValues[i] = tempVal;
+            ++markVal;
+        }
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (clusterIn[i] > 0)
             {
-                volOut->setValue(tempVal, clusters[i][index].m_ijk, outSubvol, outComponent);
+                outFrame[i] = markValues[clusterIn[i] - 1];
+            } else {
+                outFrame[i] = 0.0f;
             }
-            ++markVal;
         }
     }
 }
@@ -304,28 +304,63 @@ AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgO
         roiFrame = myRoi->getFrame();
     }
     vector<int64_t> dims = volIn->getDimensions();
-    int markVal = startVal;
+    int64_t frameSize = dims[0] * dims[1] * dims[2];
+    Vector3D ivec, jvec, kvec, origin;
+    mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
+    float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
+    int64_t minVoxels = (int64_t)ceil(minVolume / voxelVolume);
+    ConnectedComponentHelper myCompHelp(mySpace.getDims());
+    vector<int64_t> inSubvols, outSubvols, components;//frames in marking order
     if (subvolNum == -1)
     {
         volOut->reinitialize(volIn->getOriginalDimensions(), volIn->getSform(), dims[4]);
-        volOut->setValueAllVoxels(0.0f);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
             for (int64_t s = 0; s < dims[3]; ++s)
             {
-                const float* inFrame = volIn->getFrame(s, c);
-                processSubvol(inFrame, volOut, s, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+                inSubvols.push_back(s);
+                outSubvols.push_back(s);
+                components.push_back(c);
             }
         }
     } else {
         vector<int64_t> outDims = volIn->getOriginalDimensions();
         outDims.resize(3);
         volOut->reinitialize(outDims, volIn->getSform(), dims[4]);
-        volOut->setValueAllVoxels(0.0f);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
-            const float* inFrame = volIn->getFrame(subvolNum, c);
-            processSubvol(inFrame, volOut, 0, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+            inSubvols.push_back(subvolNum);
+            outSubvols.push_back(0);
+            components.push_back(c);
+        }
+    }
+    int numFrames = (int)components.size();
+    int batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();
+#endif
+    batchSize = min(batchSize, numFrames);
+    vector<vector<int> > batchClusters(batchSize);
+    vector<int> batchNumClusters(batchSize, 0);
+    vector<float> outFrame(frameSize);
+    int markVal = startVal;
+    for (int batchStart = 0; batchStart < numFrames; batchStart += batchSize)
+    {//find clusters for several frames in parallel, then number them in frame order
+        int batchEnd = min(batchStart + batchSize, numFrames);
+#pragma omp CARET_PARFOR schedule(dynamic) if (batchEnd - batchStart > 1)
+        for (int f = batchStart; f < batchEnd; ++f)
+        {
+            int batchIndex = f - batchStart;
+            vector<int>& clusterScratch = batchClusters[batchIndex];
+            clusterScratch.assign(frameSize, 0);
+            batchNumClusters[batchIndex] = processSubvol(volIn->getFrame(inSubvols[f], components[f]), mySpace, myCompHelp, minVoxels,
+                                                         lessThan, threshValue, roiFrame, sizeRatio, distanceCutoff, clusterScratch.data());
+        }
+        for (int f = batchStart; f < batchEnd; ++f)
+        {
+            int batchIndex = f - batchStart;
+            markClusters(batchClusters[batchIndex].data(), frameSize, batchNumClusters[batchIndex], outFrame.data(), markVal);
+            volOut->setFrame(outFrame.data(), outSubvols[f], components[f]);
         }
     }
     if (endVal != NULL) *endVal = markVal;
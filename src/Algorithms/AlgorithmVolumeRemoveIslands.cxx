@@ -21,8 +21,11 @@
 #include "AlgorithmVolumeRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -61,93 +64,66 @@ void AlgorithmVolumeRemoveIslands::useParameters(OperationParameters* myParams,
 AlgorithmVolumeRemoveIslands::AlgorithmVolumeRemoveIslands(ProgressObject* myProgObj, const VolumeFile* myVolIn, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    const int STENCIL_SIZE = 18;//the easy way, and prepare for different stencils if we ever need them
-    const int stencil[STENCIL_SIZE] = { 0, 0, -1,
-                                  0, -1, 0,
-                                  -1, 0, 0,
-                                  1, 0, 0,
-                                  0, 1, 0,
-                                  0, 0, 1 };
     vector<int64_t> dims;
     myVolIn->getDimensions(dims);
     myVolOut->reinitialize(myVolIn->getOriginalDimensions(), myVolIn->getSform(), myVolIn->getNumberOfComponents(), myVolIn->getType());
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    ConnectedComponentHelper myCompHelp(myVolIn->getVolumeSpace().getDims());//face neighbors only
+    int numFrames = (int)(dims[3] * dims[4]);
+    int batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();
+#endif
+    batchSize = min(batchSize, numFrames);
+    vector<vector<float> > batchOut(batchSize);
     for (int s = 0; s < dims[3]; ++s)
     {
         myVolOut->setMapName(s, myVolIn->getMapName(s));
-        for (int c = 0; c < dims[4]; ++c)
+    }
+    for (int batchStart = 0; batchStart < numFrames; batchStart += batchSize)
+    {
+        int batchEnd = min(batchStart + batchSize, numFrames);
+#pragma omp CARET_PARFOR schedule(dynamic) if (batchEnd - batchStart > 1)
+        for (int f = batchStart; f < batchEnd; ++f)
         {
-            int64_t ijk[3];
-            vector<vector<int64_t> > parts;
-            vector<int> used(dims[0] * dims[1] * dims[2], 0);
-            const float* frame = myVolIn->getFrame(s, c);
-            for (ijk[2] = 0; ijk[2] < dims[2]; ++ijk[2])
+            const float* frame = myVolIn->getFrame(f / dims[4], f % dims[4]);
+            vector<char> marked(frameSize);
+            for (int64_t i = 0; i < frameSize; ++i)
             {
-                for (ijk[1] = 0; ijk[1] < dims[1]; ++ijk[1])
-                {
-                    for (ijk[0] = 0; ijk[0] < dims[0]; ++ijk[0])
-                    {
-                        int64_t index = myVolIn->getIndex(ijk);
-                        if (used[index] == 0 && frame[index] > 0.0f)
-                        {
-                            parts.push_back(vector<int64_t>());
-                            vector<int64_t>& thispart = parts.back();
-                            thispart.push_back(ijk[0]);
-                            thispart.push_back(ijk[1]);
-                            thispart.push_back(ijk[2]);
-                            used[index] = 1;
-                            vector<int64_t> mystack;
-                            mystack.push_back(ijk[0]);
-                            mystack.push_back(ijk[1]);
-                            mystack.push_back(ijk[2]);
-                            while (!mystack.empty())
-                            {
-                                int64_t curSize = (int64_t)mystack.size();
-                                int64_t curvox[3] = { mystack[curSize - 3], mystack[curSize - 2], mystack[curSize - 1] };
-                                mystack.resize(curSize - 3);//basically pop_back
-                                for (int i = 0; i < STENCIL_SIZE; i += 3)
-                                {
-                                    int64_t neighbor[3] = { curvox[0] + stencil[i], curvox[1] + stencil[i + 1], curvox[2] + stencil[i + 2] };
-                                    if (myVolIn->indexValid(neighbor))
-                                    {
-                                        int64_t neighindex = myVolIn->getIndex(neighbor);
-                                        if (used[neighindex] == 0 && frame[neighindex] > 0.0f)
-                                        {
-                                            thispart.push_back(neighbor[0]);
-                                            thispart.push_back(neighbor[1]);
-                                            thispart.push_back(neighbor[2]);
-                                            used[neighindex] = 1;
-                                            mystack.push_back(neighbor[0]);
-                                            mystack.push_back(neighbor[1]);
-                                            mystack.push_back(neighbor[2]);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                marked[i] = (frame[i] > 0.0f ? 1 : 0);
             }
-            int64_t bestCount = -1, bestPart = -1, numParts = (int64_t)parts.size();
+            vector<int64_t> labels;
+            int64_t numParts = myCompHelp.labelComponents(marked, labels);
+            vector<int64_t> partSizes(numParts, 0);
+            for (int64_t i = 0; i < frameSize; ++i)
+            {
+                if (labels[i] >= 0) ++partSizes[labels[i]];
+            }
+            int64_t bestCount = -1, bestPart = -1;
             for (int64_t i = 0; i < numParts; ++i)
             {
-                int64_t thisCount = (int64_t)parts[i].size();
-                if (thisCount > bestCount)
+                if (partSizes[i] > bestCount)
                 {
-                    bestCount = thisCount;
+                    bestCount = partSizes[i];
                     bestPart = i;
                 }
             }
-            vector<float> outFrame(dims[0] * dims[1] * dims[2], 0.0f);
+            vector<float>& outFrame = batchOut[f - batchStart];
+            outFrame.assign(frameSize, 0.0f);
             if (bestPart != -1)
             {
-                vector<int64_t>& myPart = parts[bestPart];
-                for (int64_t i = 0; i < bestCount; i += 3)
+                for (int64_t i = 0; i < frameSize; ++i)
                 {
-                    int64_t myIndex = myVolIn->getIndex(myPart.data() + i);
-                    outFrame[myIndex] = 1.0f;//make it a simple 0/1 volume, even if it wasn't before
+                    if (labels[i] == bestPart)
+                    {
+                        outFrame[i] = 1.0f;//make it a simple 0/1 volume, even if it wasn't before
+                    }
                 }
             }
-            myVolOut->setFrame(outFrame.data(), s, c);
+        }
+        for (int f = batchStart; f < batchEnd; ++f)
+        {
+            myVolOut->setFrame(batchOut[f - batchStart].data(), f / dims[4], f % dims[4]);
         }
     }
 }
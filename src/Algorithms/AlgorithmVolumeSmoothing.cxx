@@ -25,7 +25,12 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CaretAssert.h"
+#include "MathFunctions.h"
+
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -33,6 +38,281 @@ using namespace std;
 //makes the program issue warning only once per launch, prevents repeated calls by other algorithms from spamming
 bool AlgorithmVolumeSmoothing::haveWarned = false;
 
+namespace
+{
+    const double FFT_COST_FACTOR = 4.0;//rough cost of the double precision FFT per element per doubling of size, relative to one kernel tap of direct convolution, measured
+
+    //out[i] = sum over d of weights[d + range] * in[i + d], anything outside the line counts as zero
+    //loops over the kernel outermost so the inner loop is contiguous, and adds in the same order as summing each voxel separately
+    void convolveLine(const float* in, float* out, const int64_t& length, const float* weights, const int& range)
+    {
+        for (int64_t i = 0; i < length; ++i)
+        {
+            out[i] = 0.0f;
+        }
+        for (int d = -range; d <= range; ++d)
+        {
+            const float weight = weights[d + range];
+            const int64_t start = max((int64_t)0, (int64_t)-d), end = min(length, length - d);
+            for (int64_t i = start; i < end; ++i)
+            {
+                out[i] += weight * in[i + d];
+            }
+        }
+    }
+
+    //one row of i for a pass along j or k, in and out point to the start of the row, axisStride is the distance between neighboring rows along the smoothed axis
+    void convolveOuterRow(const float* in, float* out, const int64_t& rowLength, const int64_t& coord, const int64_t& axisLength, const int64_t& axisStride,
+                          const float* weights, const int& range)
+    {
+        for (int64_t i = 0; i < rowLength; ++i)
+        {
+            out[i] = 0.0f;
+        }
+        const int64_t cmin = max((int64_t)0, coord - range), cmax = min(axisLength, coord + range + 1);//one-after array size convention
+        for (int64_t c = cmin; c < cmax; ++c)
+        {
+            const float weight = weights[c - coord + range];
+            const float* inRow = in + (c - coord) * axisStride;
+            for (int64_t i = 0; i < rowLength; ++i)
+            {
+                out[i] += weight * inRow[i];
+            }
+        }
+    }
+
+    //total kernel weight that lands inside the volume at each position along an axis, when all voxels are used the normalization is the product of these
+    vector<float> getEdgeWeightSums(const int64_t& axisLength, const float* weights, const int& range)
+    {
+        vector<float> ret(axisLength);
+        for (int64_t c = 0; c < axisLength; ++c)
+        {
+            const int64_t cmin = max((int64_t)0, c - range), cmax = min(axisLength, c + range + 1);
+            float weightsum = 0.0f;
+            for (int64_t ckern = cmin; ckern < cmax; ++ckern)
+            {
+                weightsum += weights[ckern - c + range];
+            }
+            ret[c] = weightsum;
+        }
+        return ret;
+    }
+
+    //convolution along lines with the truncated kernel via zero padded FFT, only used when the kernel is wide compared to the volume
+    class LineFFTConvolver
+    {
+        int64_t m_length, m_size;
+        int m_range;
+        const float* m_weights;
+        double m_kernelSum;
+        vector<complex<double> > m_twiddles;
+        vector<double> m_kernelSpectrum;//kernel is real and symmetric, so its spectrum is real
+        vector<int64_t> m_bitReverse;
+
+        static int64_t getSize(const int64_t& length, const int& range)
+        {//taps at or beyond the line length can never land in the volume, and padding by the range keeps the circular convolution from wrapping into the line
+            int64_t ret = 1;
+            while (ret < length + min((int64_t)range, length - 1)) ret *= 2;
+            return ret;
+        }
+
+        void transform(complex<double>* data, const bool& inverse) const
+        {//iterative radix-2 decimation in time
+            for (int64_t i = 0; i < m_size; ++i)
+            {
+                if (i < m_bitReverse[i]) swap(data[i], data[m_bitReverse[i]]);
+            }
+            for (int64_t half = 1; half < m_size; half *= 2)
+            {
+                const int64_t step = m_size / (half * 2);
+                for (int64_t start = 0; start < m_size; start += half * 2)
+                {
+                    for (int64_t k = 0; k < half; ++k)
+                    {
+                        complex<double> twiddle = m_twiddles[k * step];
+                        if (inverse) twiddle = conj(twiddle);
+                        const complex<double> temp = data[start + k + half] * twiddle;
+                        data[start + k + half] = data[start + k] - temp;
+                        data[start + k] += temp;
+                    }
+                }
+            }
+        }
+    public:
+        static bool isFaster(const int64_t& length, const int& range)
+        {
+            const int64_t taps = 2 * min((int64_t)range, length - 1) + 1;
+            const int64_t size = getSize(length, range);
+            return length * taps > FFT_COST_FACTOR * size * log((double)size) / log(2.0);
+        }
+
+        LineFFTConvolver(const int64_t& length, const float* weights, const int& range)
+        {
+            m_length = length;
+            m_range = range;
+            m_weights = weights;
+            m_size = getSize(length, range);
+            int log2size = 0;
+            while (((int64_t)1 << log2size) < m_size) ++log2size;
+            m_bitReverse.resize(m_size);
+            for (int64_t i = 0; i < m_size; ++i)
+            {
+                int64_t reversed = 0;
+                for (int bit = 0; bit < log2size; ++bit)
+                {
+                    if ((i >> bit) & 1) reversed |= ((int64_t)1) << (log2size - 1 - bit);
+                }
+                m_bitReverse[i] = reversed;
+            }
+            m_twiddles.resize(m_size / 2);
+            for (int64_t k = 0; k < m_size / 2; ++k)
+            {
+                const double angle = -2.0 * 3.14159265358979323846 * k / m_size;
+                m_twiddles[k] = complex<double>(cos(angle), sin(angle));
+            }
+            vector<complex<double> > kernel(m_size, complex<double>(0.0, 0.0));
+            const int useRange = (int)min((int64_t)range, length - 1);
+            m_kernelSum = 0.0;
+            for (int d = -useRange; d <= useRange; ++d)
+            {//circular convolution wants the kernel centered on 0, with negative offsets wrapped to the end
+                kernel[(d + m_size) % m_size] = weights[d + range];
+                m_kernelSum += weights[d + range];
+            }
+            transform(&kernel[0], false);
+            m_kernelSpectrum.resize(m_size);
+            for (int64_t i = 0; i < m_size; ++i)
+            {
+                m_kernelSpectrum[i] = kernel[i].real() / m_size;//fold the inverse transform scaling in here
+            }
+        }
+
+        int64_t getScratchSize() const { return m_size; }
+
+        //convolve two contiguous lines at once by putting them in the real and imaginary parts, inB and outB can be NULL
+        void convolve(const float* inA, const float* inB, float* outA, float* outB, complex<double>* scratch) const
+        {
+            float maxA = 0.0f, maxB = 0.0f;
+            bool finite = true;
+            for (int64_t i = 0; i < m_length; ++i)
+            {
+                const float valB = (inB == NULL ? 0.0f : inB[i]);
+                if (!MathFunctions::isNumeric(inA[i]) || !MathFunctions::isNumeric(valB)) finite = false;
+                maxA = max(maxA, abs(inA[i]));
+                maxB = max(maxB, abs(valB));
+                scratch[i] = complex<double>(inA[i], valB);
+            }
+            if (!finite)
+            {//the FFT would spread a NaN or inf over the entire line, rather than just within the kernel
+                convolveLine(inA, outA, m_length, m_weights, m_range);
+                if (inB != NULL) convolveLine(inB, outB, m_length, m_weights, m_range);
+                return;
+            }
+            for (int64_t i = m_length; i < m_size; ++i)
+            {
+                scratch[i] = complex<double>(0.0, 0.0);
+            }
+            transform(scratch, false);
+            for (int64_t i = 0; i < m_size; ++i)
+            {
+                scratch[i] *= m_kernelSpectrum[i];
+            }
+            transform(scratch, true);
+            const double toleranceA = 1e-12 * m_kernelSum * maxA, toleranceB = 1e-12 * m_kernelSum * maxB;//snap rounding noise to zero, so empty windows still give exactly 0 weight
+            for (int64_t i = 0; i < m_length; ++i)
+            {
+                outA[i] = (abs(scratch[i].real()) > toleranceA ? (float)scratch[i].real() : 0.0f);
+                if (outB != NULL) outB[i] = (abs(scratch[i].imag()) > toleranceB ? (float)scratch[i].imag() : 0.0f);
+            }
+        }
+    };
+
+    int64_t getLineStart(const int64_t& line, const int64_t dims[3], const int& axis)
+    {
+        switch (axis)
+        {
+            case 0:
+                return line * dims[0];
+            case 1:
+                return (line % dims[0]) + (line / dims[0]) * dims[0] * dims[1];
+            default:
+                return line;
+        }
+    }
+
+    //smooth a frame along one axis with the FFT, if inB is given its lines are transformed along with the matching lines of inA, otherwise pairs of lines from inA share a transform
+    void convolveAxisFFT(const float* inA, const float* inB, float* outA, float* outB, const int64_t dims[3], const int& axis, const LineFFTConvolver& convolver)
+    {
+        const int64_t length = dims[axis], numLines = dims[0] * dims[1] * dims[2] / length;
+        int64_t stride = 1;
+        for (int i = 0; i < axis; ++i)
+        {
+            stride *= dims[i];
+        }
+        const bool paired = (inB != NULL);
+        const int64_t numJobs = (paired ? numLines : (numLines + 1) / 2);
+#pragma omp CARET_PAR
+        {
+            vector<float> lineA(length), lineB(length), resultA(length), resultB(length);
+            vector<complex<double> > scratch(convolver.getScratchSize());
+#pragma omp CARET_FOR schedule(dynamic, 16)
+            for (int64_t job = 0; job < numJobs; ++job)
+            {
+                int64_t startA, startB = -1;
+                const float* sourceB = inA;
+                float* destB = outA;
+                if (paired)
+                {
+                    startA = getLineStart(job, dims, axis);
+                    startB = startA;
+                    sourceB = inB;
+                    destB = outB;
+                } else {
+                    startA = getLineStart(job * 2, dims, axis);
+                    if (job * 2 + 1 < numLines) startB = getLineStart(job * 2 + 1, dims, axis);
+                }
+                for (int64_t i = 0; i < length; ++i)
+                {
+                    lineA[i] = inA[startA + i * stride];
+                }
+                if (startB != -1)
+                {
+                    for (int64_t i = 0; i < length; ++i)
+                    {
+                        lineB[i] = sourceB[startB + i * stride];
+                    }
+                    convolver.convolve(&lineA[0], &lineB[0], &resultA[0], &resultB[0], &scratch[0]);
+                    for (int64_t i = 0; i < length; ++i)
+                    {
+                        destB[startB + i * stride] = resultB[i];
+                    }
+                } else {
+                    convolver.convolve(&lineA[0], NULL, &resultA[0], NULL, &scratch[0]);
+                }
+                for (int64_t i = 0; i < length; ++i)
+                {
+                    outA[startA + i * stride] = resultA[i];
+                }
+            }
+        }
+    }
+
+    //merge per-slice voxel lists in slice order, so the ROI lists don't need a critical section while building them
+    void mergeLists(vector<vector<int> >& parts, vector<int>& listOut)
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            total += parts[i].size();
+        }
+        listOut.reserve(total);
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            listOut.insert(listOut.end(), parts[i].begin(), parts[i].end());
+            vector<int>().swap(parts[i]);
+        }
+    }
+}
+
 AString AlgorithmVolumeSmoothing::getCommandSwitch()
 {
     return "-volume-smoothing";
@@ -66,7 +346,8 @@ OperationParameters* AlgorithmVolumeSmoothing::getParameters()
         "be significantly slower, because the operation cannot be separated into 1-dimensional smoothings without distorting the kernel shape.\n\n" +
         "The -fix-zeros option causes the smoothing to not use an input value if it is zero, but still write a smoothed value to the voxel.  " +
         "This is useful for zeros that indicate lack of information, preventing them from pulling down the intensity of nearby voxels, while " +
-        "giving the zero an extrapolated value."
+        "giving the zero an extrapolated value.\n\n" +
+        "When the kernel is very wide compared to the volume dimensions, smoothing along an axis is done with an FFT instead, which gives the same result to within rounding error."
     );
     return ret;
 }
@@ -126,7 +407,12 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     const float ORTH_TOLERANCE = 0.001f;//tolerate this much deviation from orthogonal (dot product divided by product of lengths) to use orthogonal assumptions to smooth
     if (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE)
     {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
-        CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights(myDims[0] * myDims[1] * myDims[2]), scratchWeights2(myDims[0] * myDims[1] * myDims[2]), scratchFrame3;
+        CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights, scratchWeights2, scratchFrame3;
+        if (roiVol != NULL || fixZeros)//without these, the normalization is a product of per-axis sums, so no weight frames are needed
+        {
+            scratchWeights = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
+            scratchWeights2 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
+        }
         if (roiVol != NULL)
         {
             scratchFrame3 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
@@ -170,7 +456,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                     const float* inFrame = inVol->getFrame(s, c);
                     if (roiVol == NULL)
                     {
-                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
+                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                     } else {
                         smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                     }
@@ -191,7 +477,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                 const float* inFrame = inVol->getFrame(subvol, c);
                 if (roiVol == NULL)
                 {
-                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
+                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 } else {
                     smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 }
@@ -273,87 +559,96 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     }
 }
 
-void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
+void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
 {//this function should ONLY get invoked when the volume is orthogonal (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
+    //each pass works on whole rows of i, so the inner loops are contiguous and vectorize, without -fix-zeros the normalization is separable and the weight frames are skipped
+    const int64_t dims[3] = { myDims[0], myDims[1], myDims[2] };
+    const int64_t rowLength = dims[0], numRows = dims[1] * dims[2], sliceSize = dims[0] * dims[1], frameSize = sliceSize * dims[2];
+    const float* axisWeights[3] = { iweights, jweights, kweights };
+    const int axisRanges[3] = { irange, jrange, krange };
+    CaretPointer<LineFFTConvolver> fftConvolvers[3];//for very wide kernels relative to the volume, FFT convolution along that axis is cheaper
+    for (int axis = 0; axis < 3; ++axis)
     {
-        for (int j = 0; j < myDims[1]; ++j)
+        if (LineFFTConvolver::isFaster(dims[axis], axisRanges[axis]))
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            fftConvolvers[axis].grabNew(new LineFFTConvolver(dims[axis], axisWeights[axis], axisRanges[axis]));
+        }
+    }
+    vector<float> edgeSums[3];
+    if (!fixZeros)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            edgeSums[axis] = getEdgeWeightSums(dims[axis], axisWeights[axis], axisRanges[axis]);
+        }
+    } else {
+#pragma omp CARET_PARFOR
+        for (int64_t index = 0; index < frameSize; ++index)
+        {
+            scratchWeights2[index] = (inFrame[index] != 0.0f ? 1.0f : 0.0f);//zeros still add nothing to the sum, so only the weights need the mask
+        }
+    }
+    if (fftConvolvers[0] != NULL)//smooth along i axis
+    {
+        convolveAxisFFT(inFrame, (fixZeros ? scratchWeights2.getArray() : NULL), scratchFrame, scratchWeights, dims, 0, *(fftConvolvers[0]));
+    } else {
+#pragma omp CARET_PARFOR
+        for (int64_t row = 0; row < numRows; ++row)
+        {
+            const int64_t rowStart = row * rowLength;
+            convolveLine(inFrame + rowStart, scratchFrame + rowStart, rowLength, iweights, irange);//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
+            if (fixZeros)
             {
-                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                if (imin < 0) imin = 0;
-                if (imax > myDims[0]) imax = myDims[0];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(0, j, k, 0);//extra 0 on a default parameter is to prevent int->pointer vs int->int64 conversion ambiguity
-                int64_t curInd = baseInd + i;
-                for (int ikern = imin; ikern < imax; ++ikern)
-                {
-                    int64_t thisIndex = baseInd + ikern;
-                    if ((!fixZeros || inFrame[thisIndex] != 0.0f))
-                    {
-                        float weight = iweights[ikern - i + irange];
-                        weightsum += weight;
-                        sum += weight * inFrame[thisIndex];
-                    }
-                }
-                scratchWeights[curInd] = weightsum;
-                scratchFrame[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
+                convolveLine(scratchWeights2 + rowStart, scratchWeights + rowStart, rowLength, iweights, irange);
             }
         }
     }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//now j
+    if (fftConvolvers[1] != NULL)//now j
     {
-        for (int i = 0; i < myDims[0]; ++i)
+        convolveAxisFFT(scratchFrame, (fixZeros ? scratchWeights.getArray() : NULL), scratchFrame2, scratchWeights2, dims, 1, *(fftConvolvers[1]));
+    } else {
+#pragma omp CARET_PARFOR
+        for (int64_t row = 0; row < numRows; ++row)
         {
-            for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
+            const int64_t rowStart = row * rowLength, j = row % dims[1];
+            convolveOuterRow(scratchFrame + rowStart, scratchFrame2 + rowStart, rowLength, j, dims[1], rowLength, jweights, jrange);
+            if (fixZeros)
             {
-                int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-                if (jmin < 0) jmin = 0;
-                if (jmax > myDims[1]) jmax = myDims[1];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(i, 0, k);
-                int64_t curInd = baseInd + j * myDims[0];
-                for (int jkern = jmin; jkern < jmax; ++jkern)
-                {
-                    int64_t thisIndex = baseInd + jkern * myDims[0];
-                    float weight = jweights[jkern - j + jrange];
-                    weightsum += weight * scratchWeights[thisIndex];
-                    sum += weight * scratchFrame[thisIndex];
-                }
-                scratchWeights2[curInd] = weightsum;
-                scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
+                convolveOuterRow(scratchWeights + rowStart, scratchWeights2 + rowStart, rowLength, j, dims[1], rowLength, jweights, jrange);//we now have the weighted sum of the weight sums
             }
         }
     }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int j = 0; j < myDims[1]; ++j)//and finally k
+    const bool fftLast = (fftConvolvers[2] != NULL);
+    if (fftLast)//and finally k
+    {
+        convolveAxisFFT(scratchFrame2, (fixZeros ? scratchWeights2.getArray() : NULL), scratchFrame, scratchWeights, dims, 2, *(fftConvolvers[2]));
+    }
+#pragma omp CARET_PARFOR
+    for (int64_t row = 0; row < numRows; ++row)
     {
-        for (int i = 0; i < myDims[0]; ++i)
+        const int64_t rowStart = row * rowLength, j = row % dims[1], k = row / dims[1];
+        float* outRow = scratchFrame + rowStart;
+        if (!fftLast)
+        {//normalize each row while it is still in cache
+            convolveOuterRow(scratchFrame2 + rowStart, outRow, rowLength, k, dims[2], sliceSize, kweights, krange);
+            if (fixZeros)
+            {
+                convolveOuterRow(scratchWeights2 + rowStart, scratchWeights + rowStart, rowLength, k, dims[2], sliceSize, kweights, krange);
+            }
+        }
+        if (fixZeros)
         {
-            for (int k = 0; k < myDims[2]; ++k)//ditto
+            const float* weightRow = scratchWeights + rowStart;
+            for (int64_t i = 0; i < rowLength; ++i)
             {
-                int64_t baseInd = inVol->getIndex(i, j, 0);
-                int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                if (kmin < 0) kmin = 0;
-                if (kmax > myDims[2]) kmax = myDims[2];
-                float sum = 0.0f, weightsum = 0.0f;
-                for (int kkern = kmin; kkern < kmax; ++kkern)
-                {
-                    int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];
-                    float weight = kweights[kkern - k + krange];
-                    weightsum += weight * scratchWeights2[thisIndex];
-                    sum += weight * scratchFrame2[thisIndex];
-                }
-                if (weightsum != 0.0f)
-                {
-                    scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                } else {
-                    scratchFrame[curInd] = 0.0f;
-                }
+                outRow[i] = (weightRow[i] != 0.0f ? outRow[i] / weightRow[i] : 0.0f);//NOW we can divide
+            }
+        } else {
+            const float jkWeight = edgeSums[1][j] * edgeSums[2][k];
+            const float* iEdge = &(edgeSums[0][0]);
+            for (int64_t i = 0; i < rowLength; ++i)
+            {
+                outRow[i] /= iEdge[i] * jkWeight;//the center voxel is always used, so never zero
             }
         }
     }
@@ -368,9 +663,11 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
     {//this is our first time into this function, we must populate the lists
         const float* roiFrame = roiVol->getFrame();
         CaretArray<int> markROI(myDims[0] * myDims[1] * myDims[2], 0);//need a temporary array to sort out ROI zeros from -fix-zeros zeros
+        vector<vector<int> > sliceLists(myDims[2]);//each iteration of the parallel loop gets its own list, merged afterwards in order
 #pragma omp CARET_PARFOR
         for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
         {
+            vector<int>& myList = sliceLists[k];
             for (int j = 0; j < myDims[1]; ++j)
             {
                 for (int i = 0; i < myDims[0]; ++i)//don't test whether intermediate voxel is insode ROI, or we lose some data
@@ -391,12 +688,9 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                             {
                                 used = true;
                                 markROI[curInd] = 1;
-#pragma omp critical
-                                {
-                                    lists[0].push_back(i);
-                                    lists[0].push_back(j);
-                                    lists[0].push_back(k);
-                                }
+                                myList.push_back(i);
+                                myList.push_back(j);
+                                myList.push_back(k);
                             }
                             if (!fixZeros || inFrame[thisIndex] != 0.0f)
                             {
@@ -411,9 +705,11 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                 }
             }
         }
+        mergeLists(sliceLists, lists[0]);
 #pragma omp CARET_PARFOR
         for (int k = 0; k < myDims[2]; ++k)//now j
         {
+            vector<int>& myList = sliceLists[k];
             for (int i = 0; i < myDims[0]; ++i)
             {
                 for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
@@ -434,12 +730,9 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                             {
                                 used = true;
                                 markROI[curInd] |= 2;//bitwise so i can track all 3 lists separately in one array
-#pragma omp critical
-                                {
-                                    lists[1].push_back(i);
-                                    lists[1].push_back(j);
-                                    lists[1].push_back(k);
-                                }
+                                myList.push_back(i);
+                                myList.push_back(j);
+                                myList.push_back(k);
                             }
                             float weight = jweights[jkern - j + jrange];
                             weightsum += weight * scratchWeights[thisIndex];
@@ -451,9 +744,12 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                 }
             }
         }
+        mergeLists(sliceLists, lists[1]);
+        vector<vector<int> > rowLists(myDims[1]);
 #pragma omp CARET_PARFOR
         for (int j = 0; j < myDims[1]; ++j)//and finally k
         {
+            vector<int>& myList = rowLists[j];
             for (int i = 0; i < myDims[0]; ++i)
             {
                 for (int k = 0; k < myDims[2]; ++k)//ditto
@@ -462,12 +758,9 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                     int64_t curInd = baseInd + k * myDims[0] * myDims[1];
                     if (roiFrame[curInd] > 0.0f)
                     {
-#pragma omp critical
-                        {
-                            lists[2].push_back(i);//third list is a little different, since we don't output stuff outside the ROI, we can drop the voxels that "grew" from the ROI
-                            lists[2].push_back(j);//we do need to calculate those grown voxels, though, since we use some of them within the k-kernel
-                            lists[2].push_back(k);
-                        }
+                        myList.push_back(i);//third list is a little different, since we don't output stuff outside the ROI, we can drop the voxels that "grew" from the ROI
+                        myList.push_back(j);//we do need to calculate those grown voxels, though, since we use some of them within the k-kernel
+                        myList.push_back(k);
                         int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
                         if (kmin < 0) kmin = 0;
                         if (kmax > myDims[2]) kmax = myDims[2];
@@ -491,6 +784,7 @@ void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64
                 }
             }
         }
+        mergeLists(rowLists, lists[2]);
         if (lists[0].size() == 0)
         {
             lists[0].push_back(-1);//to keep it from scanning the ROI again when the ROI has no voxels, slightly hacky
@@ -21,10 +21,14 @@
 #include "AlgorithmVolumeToSurfaceMapping.h"
 #include "AlgorithmException.h"
 
+#include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "DataFileException.h"
+#include "FileInformation.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
 #include "MetricFile.h"
+#include "SparseVoxelWeights.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "Vector3D.h"
@@ -36,6 +40,88 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    uint64_t hashSurface(const SurfaceFile* mySurf, const uint64_t& previousHash)
+    {
+        uint64_t ret = SparseVoxelWeights::hashData(mySurf->getCoordinateData(), mySurf->getNumberOfNodes() * 3 * sizeof(float), previousHash);
+        int32_t numTris = mySurf->getNumberOfTriangles();
+        for (int32_t i = 0; i < numTris; ++i)
+        {
+            ret = SparseVoxelWeights::hashData(mySurf->getTriangle(i), 3 * sizeof(int32_t), ret);
+        }
+        return ret;
+    }
+    
+    uint64_t hashRoiFrame(const VolumeFile* roiVol, const uint64_t& previousHash)
+    {
+        if (roiVol == NULL)
+        {
+            const int32_t noRoi = -1;
+            return SparseVoxelWeights::hashData(&noRoi, sizeof(int32_t), previousHash);
+        }
+        const int64_t* dims = roiVol->getVolumeSpace().getDims();
+        return SparseVoxelWeights::hashData(roiVol->getFrame(), dims[0] * dims[1] * dims[2] * sizeof(float), previousHash);
+    }
+    
+    bool readCachedWeights(SparseVoxelWeights& weightsOut, const AString& cacheName, const VolumeSpace& volSpace, const int64_t& numNodes, const uint64_t& inputKey)
+    {
+        if (cacheName.isEmpty() || !FileInformation(cacheName).exists()) return false;
+        try
+        {
+            weightsOut.readFile(cacheName);
+        } catch (DataFileException& e) {
+            CaretLogWarning("ignoring unreadable weights cache file: " + e.whatString());
+            return false;
+        }
+        if (!weightsOut.matches(volSpace, numNodes, inputKey))
+        {
+            CaretLogInfo("weights cache file '" + cacheName + "' was made from different inputs, recomputing");
+            return false;
+        }
+        return true;
+    }
+    
+    void applyWeights(const SparseVoxelWeights& myWeights, const VolumeFile* myVolume, MetricFile* myMetricOut, const int64_t& mySubVol, const AString& methodName)
+    {
+        vector<int64_t> myVolDims;
+        myVolume->getDimensions(myVolDims);
+        vector<const float*> frames;
+        for (int64_t i = 0; i < myVolDims[3]; ++i)
+        {
+            if (mySubVol != -1 && i != mySubVol) continue;
+            for (int64_t j = 0; j < myVolDims[4]; ++j)
+            {
+                AString metricLabel = myVolume->getMapName(i);
+                if (myVolDims[4] != 1)
+                {
+                    metricLabel += " component " + AString::number(j);
+                }
+                metricLabel += methodName;
+                myMetricOut->setColumnName((int64_t)frames.size(), metricLabel);
+                frames.push_back(myVolume->getFrame(i, j));
+            }
+        }
+        const int64_t CHUNK_SIZE = 16;//frames per pass over the weights, also limits the scratch memory
+        int64_t numNodes = myWeights.getNumberOfNodes(), numFrames = (int64_t)frames.size();
+        vector<vector<float> > scratch(min(CHUNK_SIZE, numFrames), vector<float>(numNodes));
+        vector<float*> scratchPointers(scratch.size());
+        for (size_t i = 0; i < scratch.size(); ++i)
+        {
+            scratchPointers[i] = scratch[i].data();
+        }
+        for (int64_t chunkStart = 0; chunkStart < numFrames; chunkStart += CHUNK_SIZE)
+        {
+            int64_t chunkSize = min(CHUNK_SIZE, numFrames - chunkStart);
+            myWeights.applyToFrames(frames.data() + chunkStart, chunkSize, scratchPointers.data());
+            for (int64_t i = 0; i < chunkSize; ++i)
+            {
+                myMetricOut->setValuesForColumn(chunkStart + i, scratchPointers[i]);
+            }
+        }
+    }
+}
+
 AString AlgorithmVolumeToSurfaceMapping::getCommandSwitch()
 {
     return "-volume-to-surface-mapping";
@@ -73,11 +159,15 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
     OptionalParameter* ribbonWeightsText = ribbonOpt->createOptionalParameter(6, "-output-weights-text", "write the voxel weights for all vertices to a text file");
     ribbonWeightsText->addStringParameter(1, "text-out", "output - the output text filename");//fake the output formatting
+    OptionalParameter* ribbonCache = ribbonOpt->createOptionalParameter(7, "-weights-cache", "reuse voxel weights from a previous run with the same inputs");
+    ribbonCache->addStringParameter(1, "cache-file", "the weights file to read, or to create if missing or out of date");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
     myelinStyleOpt->addMetricParameter(2, "thickness", "a metric file of cortical thickness");
     myelinStyleOpt->addDoubleParameter(3, "sigma", "gaussian kernel in mm for weighting voxels within range");
+    OptionalParameter* myelinCache = myelinStyleOpt->createOptionalParameter(4, "-weights-cache", "reuse voxel weights from a previous run with the same inputs");
+    myelinCache->addStringParameter(1, "cache-file", "the weights file to read, or to create if missing or out of date");
     
     OptionalParameter* subvolumeSelect = ret->createOptionalParameter(7, "-subvol-select", "select a single subvolume to map");
     subvolumeSelect->addStringParameter(1, "subvol", "the subvolume number or name");
@@ -93,7 +183,11 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "voxels, consider increasing this if you get zeros in your output.\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels closer than the thickness at the vertex " +
         "that are within the ribbon ROI, and less than half the thickness value away from the vertex along the direction of the surface normal, and apply a gaussian kernel " +
-        "with the specified sigma to them to get the weights to use."
+        "with the specified sigma to them to get the weights to use.\n\n" +
+        "Computing the ribbon and myelin style weights is usually slower than applying them.  " +
+        "The -weights-cache options store the weights in a sparse binary file, along with a fingerprint of the surfaces, ROI, and other settings that were used.  " +
+        "If the file exists and was made with the same inputs and volume space, the weights are read from it instead of being computed, " +
+        "otherwise they are computed and the file is (over)written, so one cache file per subject can be used when mapping several runs."
     );
     return ret;
 }
@@ -204,7 +298,13 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 weightsOutVertex = (int)ribbonWeights->getInteger(1);
                 weightsOut = ribbonWeights->getOutputVolume(2);
             }
-            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, mySubVol, weightsOutVertex, weightsOut);
+            AString weightsCacheName;
+            OptionalParameter* ribbonCache = ribbonOpt->getOptionalParameter(7);
+            if (ribbonCache->m_present)
+            {
+                weightsCacheName = ribbonCache->getString(1);
+            }
+            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, mySubVol, weightsOutVertex, weightsOut, weightsCacheName);
             OptionalParameter* ribbonWeightsText = ribbonOpt->getOptionalParameter(6);
             if (ribbonWeightsText->m_present)
             {//do this after the algorithm, to let it do the error condition checking
@@ -235,7 +335,13 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
             VolumeFile* roi = myelinStyleOpt->getVolume(1);
             MetricFile* thickness = myelinStyleOpt->getMetric(2);
             float sigma = (float)myelinStyleOpt->getDouble(3);
-            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, roi, thickness, sigma, mySubVol);
+            AString weightsCacheName;
+            OptionalParameter* myelinCache = myelinStyleOpt->getOptionalParameter(4);
+            if (myelinCache->m_present)
+            {
+                weightsCacheName = myelinCache->getString(1);
+            }
+            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, roi, thickness, sigma, mySubVol, weightsCacheName);
             break;
         }
         default:
@@ -340,7 +446,8 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 //ribbon mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol,
-                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut,
+                                                                 const AString& weightsCacheName) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -374,96 +481,40 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
         weightDims.resize(3);
         weightsOut->reinitialize(weightDims, myVolume->getSform());
     }
-    vector<vector<VoxelWeight> > myWeights;
-    const float* roiFrame = NULL;
-    if (roiVol != NULL) roiFrame = roiVol->getFrame();
-    RibbonMappingHelper::computeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions);
+    const int32_t methodTag = RIBBON_CONSTRAINED;
+    uint64_t inputKey = SparseVoxelWeights::hashData(&methodTag, sizeof(int32_t));
+    inputKey = SparseVoxelWeights::hashData(&subdivisions, sizeof(int32_t), inputKey);
+    inputKey = hashSurface(innerSurf, inputKey);
+    inputKey = hashSurface(outerSurf, inputKey);
+    inputKey = hashRoiFrame(roiVol, inputKey);
+    SparseVoxelWeights myWeights;
+    if (!readCachedWeights(myWeights, weightsCacheName, myVolume->getVolumeSpace(), numNodes, inputKey))
+    {
+        vector<vector<VoxelWeight> > weightLists;
+        const float* roiFrame = NULL;
+        if (roiVol != NULL) roiFrame = roiVol->getFrame();
+        RibbonMappingHelper::computeWeightsRibbon(weightLists, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions);
+        myWeights.setWeights(weightLists, myVolume->getVolumeSpace(), inputKey, true);
+        if (!weightsCacheName.isEmpty()) myWeights.writeFile(weightsCacheName);
+    }
     if (weightsOut != NULL)
     {
         weightsOut->setValueAllVoxels(0.0f);
-        const vector<VoxelWeight>& vertexWeights = myWeights[weightsOutVertex];
+        vector<VoxelWeight> vertexWeights;
+        myWeights.getNodeWeights(weightsOutVertex, vertexWeights);
         int numWeights = (int)vertexWeights.size();
         for (int i = 0; i < numWeights; ++i)
         {
             weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
-    {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
-        {
-            AString metricLabel = myVolume->getMapName(mySubVol);
-            if (myVolDims[4] != 1)
-            {
-                metricLabel += " component " + AString::number(j);
-            }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
-        }
-    }
+    applyWeights(myWeights, myVolume, myMetricOut, mySubVol, " ribbon constrained");
 }
 
 //myelin style mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
-                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol): AbstractAlgorithm(myProgObj)
+                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol,
+                                                                 const AString& weightsCacheName): AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -486,62 +537,25 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     int64_t numNodes = mySurface->getNumberOfNodes();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
     myMetricOut->setStructure(mySurface->getStructure());
-    vector<vector<VoxelWeight> > myWeights;
-    precomputeWeightsMyelin(myWeights, mySurface, roiVol, thickness, sigma);
-    vector<float> myScratch(numNodes);
-    if (mySubVol == -1)
+    if (thickness->getNumberOfNodes() != numNodes)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    double accum = 0.0;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);//weights have already been normalized in precompute, for this method
-                    }
-                    myScratch[node] = accum;
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
-        {
-            AString metricLabel = myVolume->getMapName(mySubVol);
-            if (myVolDims[4] != 1)
-            {
-                metricLabel += " component " + AString::number(j);
-            }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                double accum = 0.0;
-                int numVoxels = (int)myWeights[node].size();
-                for (int voxel = 0; voxel < numVoxels; ++voxel)
-                {
-                    accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);//weights have already been normalized in precompute, for this method
-                }
-                myScratch[node] = accum;
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-        }
+        throw AlgorithmException("thickness metric does not match the number of surface vertices");
+    }
+    const int32_t methodTag = MYELIN_STYLE;
+    uint64_t inputKey = SparseVoxelWeights::hashData(&methodTag, sizeof(int32_t));
+    inputKey = SparseVoxelWeights::hashData(&sigma, sizeof(float), inputKey);
+    inputKey = hashSurface(mySurface, inputKey);
+    inputKey = hashRoiFrame(roiVol, inputKey);
+    inputKey = SparseVoxelWeights::hashData(thickness->getValuePointerForColumn(0), numNodes * sizeof(float), inputKey);
+    SparseVoxelWeights myWeights;
+    if (!readCachedWeights(myWeights, weightsCacheName, myVolume->getVolumeSpace(), numNodes, inputKey))
+    {
+        vector<vector<VoxelWeight> > weightLists;
+        precomputeWeightsMyelin(weightLists, mySurface, roiVol, thickness, sigma);
+        myWeights.setWeights(weightLists, myVolume->getVolumeSpace(), inputKey, false);//already normalized
+        if (!weightsCacheName.isEmpty()) myWeights.writeFile(weightsCacheName);
     }
+    applyWeights(myWeights, myVolume, myMetricOut, mySubVol, " ribbon constrained");
 }
 
 void AlgorithmVolumeToSurfaceMapping::precomputeWeightsMyelin(vector<vector<VoxelWeight> >& myWeights, const SurfaceFile* mySurface, const VolumeFile* roiVol,
@@ -19,7 +19,9 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #define __BRAIN_OPEN_G_L_CHART_DRAWING_FIXED_PIPELINE_DECLARE__
 #include "BrainOpenGLChartDrawingFixedPipeline.h"
@@ -29,6 +31,7 @@
 #include "AnnotationPointSizeText.h"
 #include "CaretOpenGLInclude.h"
 #include "BrainOpenGLFixedPipeline.h"
+#include "BrainOpenGLTextureManager.h"
 #include "BrainOpenGLTextRenderInterface.h"
 #include "CaretAssert.h"
 #include "ChartAxis.h"
@@ -49,6 +52,7 @@
 #include "CiftiScalarDataSeriesFile.h"
 #include "Brain.h"
 #include "ConnectivityDataLoaded.h"
+#include "DrawnWithOpenGLTextureInfo.h"
 #include "EventCaretMappableDataFileMapsViewedInOverlays.h"
 #include "EventManager.h"
 #include "IdentificationWithColor.h"
@@ -61,6 +65,205 @@
 
 using namespace caret;
 
+namespace {
+    /**
+     * @return Largest power of two that is less than or equal to value
+     * (zero if value is less than one).
+     */
+    int32_t floorToPowerOfTwo(const int32_t value)
+    {
+        if (value < 1) {
+            return 0;
+        }
+        int32_t result = 1;
+        while ((result * 2) <= value) {
+            result *= 2;
+        }
+        return result;
+    }
+    
+    /**
+     * @return Smallest power of two that is greater than or equal to value.
+     */
+    int32_t ceilingToPowerOfTwo(const int32_t value)
+    {
+        int32_t result = 1;
+        while (result < value) {
+            result *= 2;
+        }
+        return result;
+    }
+    
+    /**
+     * @return A hash of the matrix coloring used to determine
+     * when the matrix textures need to be recreated.
+     */
+    uint64_t computeMatrixColoringKey(const int32_t numberOfRows,
+                                      const int32_t numberOfColumns,
+                                      const std::vector<float>& matrixRGBA)
+    {
+        /*
+         * FNV-1a on the bits of the floats
+         */
+        const uint64_t fnvPrime = 1099511628211ULL;
+        uint64_t hash = 14695981039346656037ULL;
+        hash = (hash ^ static_cast<uint64_t>(numberOfRows)) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(numberOfColumns)) * fnvPrime;
+        const int64_t numberOfValues = matrixRGBA.size();
+        for (int64_t i = 0; i < numberOfValues; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, &matrixRGBA[i], sizeof(bits));
+            hash = (hash ^ bits) * fnvPrime;
+        }
+        return hash;
+    }
+    
+    /**
+     * Create the full resolution level of a texture for a tile of the matrix.
+     * Texture row zero is at the bottom so it contains the last matrix row
+     * in the tile.  Texels outside of the tile are transparent.
+     *
+     * @param matrixRGBA
+     *     RGBA coloring of the matrix cells.
+     * @param numberOfColumns
+     *     Number of columns in the matrix.
+     * @param firstRow
+     *     First matrix row in the tile.
+     * @param tileNumberOfRows
+     *     Number of matrix rows in the tile.
+     * @param firstColumn
+     *     First matrix column in the tile.
+     * @param tileNumberOfColumns
+     *     Number of matrix columns in the tile.
+     * @param textureWidth
+     *     Width of the texture.
+     * @param textureHeight
+     *     Height of the texture.
+     * @param textureBytesOut
+     *     Output containing RGBA bytes of the texture.
+     */
+    void createMatrixTextureLevelZero(const std::vector<float>& matrixRGBA,
+                                      const int32_t numberOfColumns,
+                                      const int32_t firstRow,
+                                      const int32_t tileNumberOfRows,
+                                      const int32_t firstColumn,
+                                      const int32_t tileNumberOfColumns,
+                                      const int32_t textureWidth,
+                                      const int32_t textureHeight,
+                                      std::vector<uint8_t>& textureBytesOut)
+    {
+        textureBytesOut.assign(static_cast<int64_t>(textureWidth) * textureHeight * 4, 0);
+        for (int32_t y = 0; y < tileNumberOfRows; y++) {
+            const int32_t matrixRow = firstRow + tileNumberOfRows - 1 - y;
+            const float* rgba = &matrixRGBA[(static_cast<int64_t>(matrixRow) * numberOfColumns + firstColumn) * 4];
+            uint8_t* texel = &textureBytesOut[static_cast<int64_t>(y) * textureWidth * 4];
+            const int32_t numberOfComponents = tileNumberOfColumns * 4;
+            for (int32_t i = 0; i < numberOfComponents; i++) {
+                const float value = rgba[i] * 255.0f + 0.5f;
+                texel[i] = ((value <= 0.0f)
+                            ? 0
+                            : ((value >= 255.0f)
+                               ? 255
+                               : static_cast<uint8_t>(value)));
+            }
+        }
+    }
+    
+    /**
+     * Create the next coarser level of a matrix texture.  Each texel
+     * in the coarser level is a copy of the most extreme texel (furthest
+     * from the mean color) in its 2x2 block, ignoring transparent texels
+     * unless all are transparent.  So, unlike averaging, a small region
+     * of minimum or maximum values is not blended away at coarser levels.
+     *
+     * @param levelBytes
+     *     RGBA bytes of the level.
+     * @param levelWidth
+     *     Width of the level.
+     * @param levelHeight
+     *     Height of the level.
+     * @param validWidth
+     *     Width of the region of the level containing matrix cells.
+     * @param validHeight
+     *     Height of the region of the level containing matrix cells.
+     * @param reducedBytesOut
+     *     Output containing RGBA bytes of the coarser level.
+     */
+    void reduceMatrixTextureLevel(const std::vector<uint8_t>& levelBytes,
+                                  const int32_t levelWidth,
+                                  const int32_t levelHeight,
+                                  const int32_t validWidth,
+                                  const int32_t validHeight,
+                                  std::vector<uint8_t>& reducedBytesOut)
+    {
+        const int32_t reducedWidth  = std::max(levelWidth  / 2, 1);
+        const int32_t reducedHeight = std::max(levelHeight / 2, 1);
+        const int32_t stepX = ((levelWidth  > 1) ? 2 : 1);
+        const int32_t stepY = ((levelHeight > 1) ? 2 : 1);
+        reducedBytesOut.assign(static_cast<int64_t>(reducedWidth) * reducedHeight * 4, 0);
+        
+        for (int32_t y = 0; y < reducedHeight; y++) {
+            const int32_t blockY = y * stepY;
+            if (blockY >= validHeight) {
+                break;
+            }
+            const int32_t blockYEnd = std::min(blockY + stepY, validHeight);
+            for (int32_t x = 0; x < reducedWidth; x++) {
+                const int32_t blockX = x * stepX;
+                if (blockX >= validWidth) {
+                    break;
+                }
+                const int32_t blockXEnd = std::min(blockX + stepX, validWidth);
+                
+                const uint8_t* texels[4] = { NULL, NULL, NULL, NULL };
+                int32_t numberOfTexels = 0;
+                float meanRGB[3] = { 0.0, 0.0, 0.0 };
+                int32_t numberOfOpaqueTexels = 0;
+                for (int32_t j = blockY; j < blockYEnd; j++) {
+                    for (int32_t i = blockX; i < blockXEnd; i++) {
+                        const uint8_t* texel = &levelBytes[(static_cast<int64_t>(j) * levelWidth + i) * 4];
+                        texels[numberOfTexels] = texel;
+                        numberOfTexels++;
+                        if (texel[3] > 0) {
+                            meanRGB[0] += texel[0];
+                            meanRGB[1] += texel[1];
+                            meanRGB[2] += texel[2];
+                            numberOfOpaqueTexels++;
+                        }
+                    }
+                }
+                
+                const uint8_t* selectedTexel = texels[0];
+                if (numberOfOpaqueTexels > 0) {
+                    meanRGB[0] /= numberOfOpaqueTexels;
+                    meanRGB[1] /= numberOfOpaqueTexels;
+                    meanRGB[2] /= numberOfOpaqueTexels;
+                    float maximumDistance = -1.0;
+                    for (int32_t k = 0; k < numberOfTexels; k++) {
+                        const uint8_t* texel = texels[k];
+                        if (texel[3] > 0) {
+                            const float dr = texel[0] - meanRGB[0];
+                            const float dg = texel[1] - meanRGB[1];
+                            const float db = texel[2] - meanRGB[2];
+                            const float distance = dr*dr + dg*dg + db*db;
+                            if (distance > maximumDistance) {
+                                maximumDistance = distance;
+                                selectedTexel = texel;
+                            }
+                        }
+                    }
+                }
+                
+                uint8_t* reducedTexel = &reducedBytesOut[(static_cast<int64_t>(y) * reducedWidth + x) * 4];
+                reducedTexel[0] = selectedTexel[0];
+                reducedTexel[1] = selectedTexel[1];
+                reducedTexel[2] = selectedTexel[2];
+                reducedTexel[3] = selectedTexel[3];
+            }
+        }
+    }
+}
+
 
     
 /**
@@ -78,6 +281,8 @@ BrainOpenGLChartDrawingFixedPipeline::BrainOpenGLChartDrawingFixedPipeline()
     m_brain = NULL;
     m_fixedPipelineDrawing = NULL;
     m_identificationModeFlag = false;
+    m_matrixIdentificationRowIndex    = -1;
+    m_matrixIdentificationColumnIndex = -1;
 }
 
 /**
@@ -1085,114 +1290,15 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
                          0.0);
         }
         
-        int32_t rgbaOffset = 0;
-        std::vector<float> quadVerticesXYZ;
-        quadVerticesXYZ.reserve(numberOfRows * numberOfColumns * 3);
-        std::vector<float> quadVerticesFloatRGBA;
-        quadVerticesFloatRGBA.reserve(numberOfRows * numberOfColumns * 4);
-        std::vector<uint8_t> quadVerticesByteRGBA;
-        quadVerticesByteRGBA.reserve(numberOfRows * numberOfColumns * 4);
-        
-        float cellY = (numberOfRows - 1) * cellHeight;
-        for (int32_t rowIndex = 0; rowIndex < numberOfRows; rowIndex++) {
-            float cellX = 0;
-            for (int32_t columnIndex = 0; columnIndex < numberOfColumns; columnIndex++) {
-                CaretAssertVectorIndex(matrixRGBA, rgbaOffset+3);
-                const float* rgba = &matrixRGBA[rgbaOffset];
-                rgbaOffset += 4;
-                
-                uint8_t idRGBA[4];
-                if (m_identificationModeFlag) {
-                    addToChartMatrixIdentification(rowIndex,
-                                                   columnIndex,
-                                                   idRGBA);
-                }
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX);
-                quadVerticesXYZ.push_back(cellY);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX + cellWidth);
-                quadVerticesXYZ.push_back(cellY);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX + cellWidth);
-                quadVerticesXYZ.push_back(cellY + cellHeight);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX);
-                quadVerticesXYZ.push_back(cellY + cellHeight);
-                quadVerticesXYZ.push_back(0.0);
-                
-                
-                cellX += cellWidth;
-            }
-            
-            cellY -= cellHeight;
-        }
-        
-        /*
-         * Draw the matrix elements.
-         */
         if (m_identificationModeFlag) {
-            CaretAssert((quadVerticesXYZ.size() / 3) == (quadVerticesByteRGBA.size() / 4));
-            const int32_t numberQuadVertices = static_cast<int32_t>(quadVerticesXYZ.size() / 3);
-            glBegin(GL_QUADS);
-            for (int32_t i = 0; i < numberQuadVertices; i++) {
-                CaretAssertVectorIndex(quadVerticesByteRGBA, i*4 + 3);
-                glColor4ubv(&quadVerticesByteRGBA[i*4]);
-                CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                glVertex3fv(&quadVerticesXYZ[i*3]);
-            }
-            glEnd();
+            /*
+             * Identification is arithmetic on the cell layout so
+             * nothing is drawn with identification colors.
+             */
+            identifyChartGraphicsMatrixCell(numberOfRows,
+                                            numberOfColumns,
+                                            cellWidth,
+                                            cellHeight);
         }
         else {
             /*
@@ -1202,47 +1308,48 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             
-            CaretAssert((quadVerticesXYZ.size() / 3) == (quadVerticesFloatRGBA.size() / 4));
-            const int32_t numberQuadVertices = static_cast<int32_t>(quadVerticesXYZ.size() / 3);
-            glBegin(GL_QUADS);
-            for (int32_t i = 0; i < numberQuadVertices; i++) {
-                CaretAssertVectorIndex(quadVerticesFloatRGBA, i*4 + 3);
-                glColor4fv(&quadVerticesFloatRGBA[i*4]);
-                CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                glVertex3fv(&quadVerticesXYZ[i*3]);
-            }
-            glEnd();
+            drawChartGraphicsMatrixTextures(chartMatrixInterface,
+                                            numberOfRows,
+                                            numberOfColumns,
+                                            matrixRGBA,
+                                            cellWidth,
+                                            cellHeight);
             
             glDisable(GL_BLEND);
 
             
             /*
-             * Drawn an outline around the matrix elements.
+             * Drawn an outline around the matrix elements.  Lines are
+             * drawn along the rows and columns of the matrix, instead of
+             * around each cell.  Lines that would be less than two pixels
+             * apart would cover the matrix so they are omitted.
              */
             if (displayGridLinesFlag) {
                 uint8_t gridLineColorBytes[3];
                 prefs->getBackgroundAndForegroundColors()->getColorChartMatrixGridLines(gridLineColorBytes);
-                float gridLineColorFloats[4];
-                CaretPreferences::byteRgbToFloatRgb(gridLineColorBytes,
-                                                    gridLineColorFloats);
-                gridLineColorFloats[3] = 1.0;
-                std::vector<float> outlineRGBA;
-                outlineRGBA.reserve(numberQuadVertices * 4);
-                for (int32_t i = 0; i < numberQuadVertices; i++) {
-                    outlineRGBA.push_back(gridLineColorFloats[0]);
-                    outlineRGBA.push_back(gridLineColorFloats[1]);
-                    outlineRGBA.push_back(gridLineColorFloats[2]);
-                    outlineRGBA.push_back(gridLineColorFloats[3]);
-                }
                 
-                glPolygonMode(GL_FRONT, GL_LINE);
+                const float minimumLineSpacing = 2.0;
+                const bool drawRowLinesFlag    = ((cellHeight * zooming) >= minimumLineSpacing);
+                const bool drawColumnLinesFlag = ((cellWidth  * zooming) >= minimumLineSpacing);
+                const float matrixWidth  = numberOfColumns * cellWidth;
+                const float matrixHeight = numberOfRows    * cellHeight;
+                
                 glLineWidth(1.0);
-                glBegin(GL_QUADS);
-                for (int32_t i = 0; i < numberQuadVertices; i++) {
-                    CaretAssertVectorIndex(outlineRGBA, i*4 + 3);
-                    glColor4fv(&outlineRGBA[i*4]);
-                    CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                    glVertex3fv(&quadVerticesXYZ[i*3]);
+                glColor3ubv(gridLineColorBytes);
+                glBegin(GL_LINES);
+                if (drawRowLinesFlag) {
+                    for (int32_t rowIndex = 0; rowIndex <= numberOfRows; rowIndex++) {
+                        const float y = rowIndex * cellHeight;
+                        glVertex3f(0.0, y, 0.0);
+                        glVertex3f(matrixWidth, y, 0.0);
+                    }
+                }
+                if (drawColumnLinesFlag) {
+                    for (int32_t columnIndex = 0; columnIndex <= numberOfColumns; columnIndex++) {
+                        const float x = columnIndex * cellWidth;
+                        glVertex3f(x, 0.0, 0.0);
+                        glVertex3f(x, matrixHeight, 0.0);
+                    }
                 }
                 glEnd();
             }
@@ -1393,10 +1500,255 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
                 }
                 glLineWidth(1.0);
             }
+        }
+    }
+}
+
+/**
+ * Draw the matrix coloring as textures.  The matrix is split into
+ * tiles no larger than the maximum texture size and each tile is
+ * drawn as one textured quad so that drawing is proportional to the
+ * number of pixels, not the number of matrix cells.  The textures are
+ * created only when the matrix coloring changes.
+ *
+ * @param chartMatrixInterface
+ *     Chart that is drawn.
+ * @param numberOfRows
+ *     Number of rows in the matrix.
+ * @param numberOfColumns
+ *     Number of columns in the matrix.
+ * @param matrixRGBA
+ *     RGBA coloring of the matrix cells.
+ * @param cellWidth
+ *     Width of a matrix cell.
+ * @param cellHeight
+ *     Height of a matrix cell.
+ */
+void
+BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrixTextures(ChartableMatrixInterface* chartMatrixInterface,
+                                                                      const int32_t numberOfRows,
+                                                                      const int32_t numberOfColumns,
+                                                                      const std::vector<float>& matrixRGBA,
+                                                                      const float cellWidth,
+                                                                      const float cellHeight)
+{
+    CaretAssert(static_cast<int64_t>(matrixRGBA.size())
+                == (static_cast<int64_t>(numberOfRows) * numberOfColumns * 4));
+    
+    m_fixedPipelineDrawing->checkForOpenGLError(NULL, "At beginning of drawChartGraphicsMatrixTextures()");
+    
+    GLint maximumTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+    const int32_t tileSize = floorToPowerOfTwo(std::min(static_cast<int32_t>(maximumTextureSize),
+                                                        MATRIX_TEXTURE_MAXIMUM_SIZE));
+    if (tileSize < 1) {
+        return;
+    }
+    const int32_t numberOfTileRows    = (numberOfRows    + tileSize - 1) / tileSize;
+    const int32_t numberOfTileColumns = (numberOfColumns + tileSize - 1) / tileSize;
+    
+    std::vector<DrawnWithOpenGLTextureInfo*> textureInfo;
+    chartMatrixInterface->getMatrixChartTextureInfo(computeMatrixColoringKey(numberOfRows,
+                                                                             numberOfColumns,
+                                                                             matrixRGBA),
+                                                    numberOfTileRows * numberOfTileColumns,
+                                                    textureInfo);
+    
+    BrainOpenGLTextureManager* textureManager = m_fixedPipelineDrawing->getTextureManager();
+    CaretAssert(textureManager);
+    
+    /*
+     * Saves glPixelStore parameters
+     */
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    
+    std::vector<uint8_t> levelBytes;
+    std::vector<uint8_t> reducedLevelBytes;
+    
+    for (int32_t tileRow = 0; tileRow < numberOfTileRows; tileRow++) {
+        const int32_t firstRow = tileRow * tileSize;
+        const int32_t tileNumberOfRows = std::min(tileSize, numberOfRows - firstRow);
+        const int32_t textureHeight = ceilingToPowerOfTwo(tileNumberOfRows);
+        
+        for (int32_t tileColumn = 0; tileColumn < numberOfTileColumns; tileColumn++) {
+            const int32_t firstColumn = tileColumn * tileSize;
+            const int32_t tileNumberOfColumns = std::min(tileSize, numberOfColumns - firstColumn);
+            const int32_t textureWidth = ceilingToPowerOfTwo(tileNumberOfColumns);
+            
+            const int32_t tileIndex = (tileRow * numberOfTileColumns) + tileColumn;
+            CaretAssertVectorIndex(textureInfo, tileIndex);
+            GLuint textureName = 0;
+            bool newTextureNameFlag = false;
+            textureManager->getTextureName(textureInfo[tileIndex],
+                                           textureName,
+                                           newTextureNameFlag);
+            glBindTexture(GL_TEXTURE_2D, textureName);
+            
+            if (newTextureNameFlag) {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+                
+                /*
+                 * Texture is padded to a power of two so that it works
+                 * with all versions of OpenGL.  Each coarser level keeps
+                 * the most extreme cell of each 2x2 block so that small
+                 * regions of minimum or maximum values remain visible
+                 * when the matrix is smaller than the number of pixels.
+                 */
+                createMatrixTextureLevelZero(matrixRGBA,
+                                             numberOfColumns,
+                                             firstRow,
+                                             tileNumberOfRows,
+                                             firstColumn,
+                                             tileNumberOfColumns,
+                                             textureWidth,
+                                             textureHeight,
+                                             levelBytes);
+                int32_t levelWidth  = textureWidth;
+                int32_t levelHeight = textureHeight;
+                int32_t validWidth  = tileNumberOfColumns;
+                int32_t validHeight = tileNumberOfRows;
+                int32_t level = 0;
+                while (true) {
+                    glTexImage2D(GL_TEXTURE_2D,     // MUST BE GL_TEXTURE_2D
+                                 level,             // level of detail 0=base, n is nth mipmap reduction
+                                 GL_RGBA,           // number of components
+                                 levelWidth,        // width of image
+                                 levelHeight,       // height of image
+                                 0,                 // border
+                                 GL_RGBA,           // format of the pixel data
+                                 GL_UNSIGNED_BYTE,  // data type of pixel data
+                                 &levelBytes[0]);   // pointer to image data
+                    if ((levelWidth == 1)
+                        && (levelHeight == 1)) {
+                        break;
+                    }
+                    reduceMatrixTextureLevel(levelBytes,
+                                             levelWidth,
+                                             levelHeight,
+                                             validWidth,
+                                             validHeight,
+                                             reducedLevelBytes);
+                    levelBytes.swap(reducedLevelBytes);
+                    levelWidth  = std::max(levelWidth / 2, 1);
+                    levelHeight = std::max(levelHeight / 2, 1);
+                    validWidth  = (validWidth  + 1) / 2;
+                    validHeight = (validHeight + 1) / 2;
+                    level++;
+                }
+            }
+            
+            /*
+             * Row zero of the matrix is at the top.
+             */
+            const float xMin = firstColumn * cellWidth;
+            const float xMax = (firstColumn + tileNumberOfColumns) * cellWidth;
+            const float yMin = (numberOfRows - (firstRow + tileNumberOfRows)) * cellHeight;
+            const float yMax = (numberOfRows - firstRow) * cellHeight;
+            const float sMax = static_cast<float>(tileNumberOfColumns) / textureWidth;
+            const float tMax = static_cast<float>(tileNumberOfRows)    / textureHeight;
             
-            glPolygonMode(GL_FRONT, GL_FILL);
+            glBegin(GL_QUADS);
+            glTexCoord2f(0.0, 0.0);
+            glVertex3f(xMin, yMin, 0.0);
+            glTexCoord2f(sMax, 0.0);
+            glVertex3f(xMax, yMin, 0.0);
+            glTexCoord2f(sMax, tMax);
+            glVertex3f(xMax, yMax, 0.0);
+            glTexCoord2f(0.0, tMax);
+            glVertex3f(xMin, yMax, 0.0);
+            glEnd();
         }
     }
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glDisable(GL_TEXTURE_2D);
+    
+    glPopClientAttrib();
+    
+    m_fixedPipelineDrawing->checkForOpenGLError(NULL, "At end of drawChartGraphicsMatrixTextures()");
+}
+
+/**
+ * Identify the matrix cell under the mouse.  Since the matrix cells
+ * are a regular grid, the mouse location is converted to the
+ * coordinates used for drawing the matrix and the cell is found
+ * with arithmetic.  Must be called after the matrix transformations
+ * have been set.
+ *
+ * @param numberOfRows
+ *     Number of rows in the matrix.
+ * @param numberOfColumns
+ *     Number of columns in the matrix.
+ * @param cellWidth
+ *     Width of a matrix cell.
+ * @param cellHeight
+ *     Height of a matrix cell.
+ */
+void
+BrainOpenGLChartDrawingFixedPipeline::identifyChartGraphicsMatrixCell(const int32_t numberOfRows,
+                                                                      const int32_t numberOfColumns,
+                                                                      const float cellWidth,
+                                                                      const float cellHeight)
+{
+    m_matrixIdentificationRowIndex    = -1;
+    m_matrixIdentificationColumnIndex = -1;
+    
+    if ((cellWidth <= 0.0)
+        || (cellHeight <= 0.0)) {
+        return;
+    }
+    
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT,
+                  viewport);
+    const int32_t mouseX = m_fixedPipelineDrawing->mouseX;
+    const int32_t mouseY = m_fixedPipelineDrawing->mouseY;
+    if ((mouseX < viewport[0])
+        || (mouseX >= (viewport[0] + viewport[2]))
+        || (mouseY < viewport[1])
+        || (mouseY >= (viewport[1] + viewport[3]))) {
+        return;
+    }
+    
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX,
+                 projectionMatrix);
+    GLdouble modelMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX,
+                 modelMatrix);
+    
+    /*
+     * Use center of the pixel
+     */
+    GLdouble chartXYZ[3];
+    if ( ! gluUnProject(mouseX + 0.5, mouseY + 0.5, 0.5,
+                        modelMatrix, projectionMatrix, viewport,
+                        &chartXYZ[0], &chartXYZ[1], &chartXYZ[2])) {
+        return;
+    }
+    
+    const double columnFloat = std::floor(chartXYZ[0] / cellWidth);
+    const double rowFromBottomFloat = std::floor(chartXYZ[1] / cellHeight);
+    if ((columnFloat < 0.0)
+        || (columnFloat >= numberOfColumns)
+        || (rowFromBottomFloat < 0.0)
+        || (rowFromBottomFloat >= numberOfRows)) {
+        return;
+    }
+    
+    /*
+     * Row zero of the matrix is at the top.
+     */
+    m_matrixIdentificationColumnIndex = static_cast<int32_t>(columnFloat);
+    m_matrixIdentificationRowIndex    = numberOfRows - 1 - static_cast<int32_t>(rowFromBottomFloat);
 }
 
 /**
@@ -1471,36 +1823,6 @@ BrainOpenGLChartDrawingFixedPipeline::addToChartLineIdentification(const int32_t
     m_identificationIndices.push_back(chartLineIndex);
 }
 
-/**
- * Add an item for matrix identification.
- *
- * @param matrixRowIndex
- *     Index of the row
- * @param matrixColumnIndex
- *     Index of the column
- * @param rgbaForColorIdentificationOut
- *    Encoded identification in RGBA color OUTPUT
- */
-void
-BrainOpenGLChartDrawingFixedPipeline::addToChartMatrixIdentification(const int32_t matrixRowIndex,
-                                                                     const int32_t matrixColumnIndex,
-                                                                     uint8_t rgbaForColorIdentificationOut[4])
-{
-    const int32_t idIndex = m_identificationIndices.size() / IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT;
-    
-    m_fixedPipelineDrawing->colorIdentification->addItem(rgbaForColorIdentificationOut,
-                                                         m_chartableMatrixSelectionTypeForIdentification,
-                                                         idIndex);
-    rgbaForColorIdentificationOut[3] = 255;
-    
-    /*
-     * If these items change, need to update reset and
-     * processing of identification.
-     */
-    m_identificationIndices.push_back(matrixRowIndex);
-    m_identificationIndices.push_back(matrixColumnIndex);
-}
-
 /**
  * Reset identification.
  */
@@ -1508,6 +1830,8 @@ void
 BrainOpenGLChartDrawingFixedPipeline::resetIdentification()
 {
     m_identificationIndices.clear();
+    m_matrixIdentificationRowIndex    = -1;
+    m_matrixIdentificationColumnIndex = -1;
     
     if (m_identificationModeFlag) {
         const int32_t estimatedNumberOfItems = 1000;
@@ -1621,21 +1945,19 @@ BrainOpenGLChartDrawingFixedPipeline::processIdentification()
         }
     }
     else if (m_chartableMatrixInterfaceBeingDrawnForIdentification != NULL) {
-        m_fixedPipelineDrawing->getIndexFromColorSelection(m_chartableMatrixSelectionTypeForIdentification,
-                                                           m_fixedPipelineDrawing->mouseX,
-                                                           m_fixedPipelineDrawing->mouseY,
-                                                           identifiedItemIndex,
-                                                           depth);
-        if (identifiedItemIndex >= 0) {
-            const int32_t idIndex = identifiedItemIndex * IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT;
-            const int32_t rowIndex = m_identificationIndices[idIndex];
-            const int32_t columnIndex = m_identificationIndices[idIndex + 1];
-            
+        if ((m_matrixIdentificationRowIndex >= 0)
+            && (m_matrixIdentificationColumnIndex >= 0)) {
+            /*
+             * Matrix is drawn at Z=0 in an orthographic projection
+             * that ranges from -1 to 1 so it is in the middle
+             * of the depth range.
+             */
+            depth = 0.5;
             SelectionItemChartMatrix* chartMatrixID = m_brain->getSelectionManager()->getChartMatrixIdentification();
             if (chartMatrixID->isOtherScreenDepthCloserToViewer(depth)) {
                 chartMatrixID->setChartMatrix(m_chartableMatrixInterfaceBeingDrawnForIdentification,
-                                              rowIndex,
-                                              columnIndex);
+                                              m_matrixIdentificationRowIndex,
+                                              m_matrixIdentificationColumnIndex);
             }
         }
     }
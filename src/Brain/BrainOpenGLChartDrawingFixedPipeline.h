@@ -90,6 +90,18 @@ namespace caret {
                                      ChartableMatrixInterface* chartMatrixInterface,
                                      const int32_t scalarDataSeriesMapIndex);
 
+        void drawChartGraphicsMatrixTextures(ChartableMatrixInterface* chartMatrixInterface,
+                                             const int32_t numberOfRows,
+                                             const int32_t numberOfColumns,
+                                             const std::vector<float>& matrixRGBA,
+                                             const float cellWidth,
+                                             const float cellHeight);
+        
+        void identifyChartGraphicsMatrixCell(const int32_t numberOfRows,
+                                             const int32_t numberOfColumns,
+                                             const float cellWidth,
+                                             const float cellHeight);
+        
         void drawChartGraphicsBoxAndSetViewport(const float vpX,
                                const float vpY,
                                const float vpWidth,
@@ -132,10 +144,6 @@ namespace caret {
                                           const int32_t lineIndex,
                                           uint8_t rgbaForColorIdentification[4]);
         
-        void addToChartMatrixIdentification(const int32_t matrixRowIndex,
-                                          const int32_t matrixColumnIndex,
-                                          uint8_t rgbaForColorIdentification[4]);
-        
         void resetIdentification();
         
         void processIdentification();
@@ -167,15 +175,19 @@ namespace caret {
         
         bool m_identificationModeFlag;
         
+        int32_t m_matrixIdentificationRowIndex;
+        
+        int32_t m_matrixIdentificationColumnIndex;
+        
         // ADD_NEW_MEMBERS_HERE
 
         static const int32_t IDENTIFICATION_INDICES_PER_CHART_LINE;
-        static const int32_t IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT;
+        static const int32_t MATRIX_TEXTURE_MAXIMUM_SIZE;
     };
     
 #ifdef __BRAIN_OPEN_G_L_CHART_DRAWING_FIXED_PIPELINE_DECLARE__
     const int32_t BrainOpenGLChartDrawingFixedPipeline::IDENTIFICATION_INDICES_PER_CHART_LINE = 2;
-    const int32_t BrainOpenGLChartDrawingFixedPipeline::IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT = 2;
+    const int32_t BrainOpenGLChartDrawingFixedPipeline::MATRIX_TEXTURE_MAXIMUM_SIZE = 4096;
 #endif // __BRAIN_OPEN_G_L_CHART_DRAWING_FIXED_PIPELINE_DECLARE__
 
 } // namespace
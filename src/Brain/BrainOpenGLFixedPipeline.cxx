@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <cstring>
 
 #include <QStringList>
 #include <QImage>
@@ -4027,24 +4028,101 @@ BrainOpenGLFixedPipeline::addFiberOrientationForDrawing(const FiberOrientationDi
 }
 
 /*
- * For comparison when sorting that results in furthest fibers drawn first.
+ * Sort fiber orientations so that the furthest fibers are drawn first
+ * using a stable radix sort on the drawing depth.
+ *
+ * @param fiberOrientations
+ *    Fiber orientations with depths that are sorted.
+ */
+static void
+radixSortFibersByDepth(std::vector<FiberOrientation*>& fiberOrientations)
+{
+    const int64_t numFibers = static_cast<int64_t>(fiberOrientations.size());
+    
+    /*
+     * Map the float depths to unsigned integers that sort in
+     * order of decreasing depth.
+     */
+    std::vector<uint32_t> keys(numFibers);
+    for (int64_t i = 0; i < numFibers; i++) {
+        uint32_t bits;
+        memcpy(&bits, &fiberOrientations[i]->m_drawingDepth, sizeof(bits));
+        keys[i] = ((bits & 0x80000000) ? bits : (~bits & 0x7fffffff));
+    }
+    
+    std::vector<uint32_t> keysTemp(numFibers);
+    std::vector<FiberOrientation*> fibersTemp(numFibers);
+    for (int32_t shift = 0; shift < 32; shift += 8) {
+        int64_t counts[256];
+        std::fill(counts, counts + 256, 0);
+        for (int64_t i = 0; i < numFibers; i++) {
+            counts[(keys[i] >> shift) & 0xff]++;
+        }
+        if (counts[(keys[0] >> shift) & 0xff] == numFibers) {
+            continue; // all keys have the same byte
+        }
+        int64_t offset = 0;
+        for (int32_t j = 0; j < 256; j++) {
+            const int64_t count = counts[j];
+            counts[j] = offset;
+            offset += count;
+        }
+        for (int64_t i = 0; i < numFibers; i++) {
+            const int64_t indx = counts[(keys[i] >> shift) & 0xff]++;
+            keysTemp[indx]   = keys[i];
+            fibersTemp[indx] = fiberOrientations[i];
+        }
+        keys.swap(keysTemp);
+        fiberOrientations.swap(fibersTemp);
+    }
+}
+
+/*
+ * Update a previous sorting of fibers for new depths with an insertion
+ * sort, which is fast when the view has changed only slightly.
+ *
+ * @param fiberOrientations
+ *    Fiber orientations in their previous sorted order.
+ * @param maximumMoves
+ *    Give up when more than this number of moves is needed.
+ * @return
+ *    True if the fibers were sorted, false if the sort gave up.
  */
 static bool
-fiberDepthCompare(FiberOrientation* &f1,
-                              FiberOrientation* &f2)
+insertionSortFibersByDepth(std::vector<FiberOrientation*>& fiberOrientations,
+                           const int64_t maximumMoves)
 {
-    return (f1->m_drawingDepth > f2->m_drawingDepth);
+    int64_t movesRemaining = maximumMoves;
+    const int64_t numFibers = static_cast<int64_t>(fiberOrientations.size());
+    for (int64_t i = 1; i < numFibers; i++) {
+        FiberOrientation* fiberOrientation = fiberOrientations[i];
+        const float depth = fiberOrientation->m_drawingDepth;
+        int64_t j = i;
+        while ((j > 0)
+               && (fiberOrientations[j - 1]->m_drawingDepth < depth)) {
+            fiberOrientations[j] = fiberOrientations[j - 1];
+            j--;
+            movesRemaining--;
+        }
+        fiberOrientations[j] = fiberOrientation;
+        if (movesRemaining < 0) {
+            return false;
+        }
+    }
+    
+    return true;
 }
 
 /**
  * Sort the fiber orientations by depth.
+ *
+ * When the same fiber orientations were sorted for the previous
+ * frame, that ordering is updated incrementally; otherwise a
+ * radix sort is used.
  */
 void
 BrainOpenGLFixedPipeline::sortFiberOrientationsByDepth()
 {
-    ElapsedTimer timer;
-    timer.start();
-    
     /*
      * Create transforms model coordinate to a screen coordinate.
      */
@@ -4069,10 +4147,9 @@ BrainOpenGLFixedPipeline::sortFiberOrientationsByDepth()
     const float m2 = modelToScreenMatrix.getMatrixElement(2, 2);
     const float m3 = modelToScreenMatrix.getMatrixElement(2, 3);
     
-    for (std::list<FiberOrientation*>::const_iterator iter = m_fiberOrientationsForDrawing.begin();
-         iter != m_fiberOrientationsForDrawing.end();
-         iter++) {
-        const FiberOrientation* fiberOrientation = *iter;
+    const int64_t numFiberOrientations = static_cast<int64_t>(m_fiberOrientationsForDrawing.size());
+    for (int64_t i = 0; i < numFiberOrientations; i++) {
+        const FiberOrientation* fiberOrientation = m_fiberOrientationsForDrawing[i];
         
         const float rawDepth =(m0 * fiberOrientation->m_xyz[0]
                             + m1 * fiberOrientation->m_xyz[1]
@@ -4084,7 +4161,82 @@ BrainOpenGLFixedPipeline::sortFiberOrientationsByDepth()
         
     }
     
-    m_fiberOrientationsForDrawing.sort(fiberDepthCompare);
+    /*
+     * Same fibers as the previous sort, start from the previous order
+     * and fall back to a full sort if the view changed too much.
+     */
+    if (m_fiberOrientationsForDrawing == m_fiberOrientationsSortInputPrevious) {
+        std::vector<FiberOrientation*> sortedFibers(m_fiberOrientationsSortedPrevious);
+        if (insertionSortFibersByDepth(sortedFibers,
+                                       numFiberOrientations * 4)) {
+            m_fiberOrientationsSortedPrevious = sortedFibers;
+            m_fiberOrientationsForDrawing.swap(sortedFibers);
+            return;
+        }
+    }
+    
+    m_fiberOrientationsSortInputPrevious = m_fiberOrientationsForDrawing;
+    if (numFiberOrientations > 0) {
+        radixSortFibersByDepth(m_fiberOrientationsForDrawing);
+    }
+    m_fiberOrientationsSortedPrevious = m_fiberOrientationsForDrawing;
+}
+
+/*
+ * Create the OpenGL matrix for drawing a fiber cone, equivalent to
+ * a translation, rotations about the Z, Y, and Z axes, and a scaling.
+ *
+ * @param xyz
+ *    Translation.
+ * @param angleZ1
+ *    First rotation about Z axis, in degrees.
+ * @param angleY
+ *    Rotation about Y axis, in degrees.
+ * @param angleZ2
+ *    Second rotation about Z axis, in degrees.
+ * @param scaleX
+ *    X-scaling.
+ * @param scaleY
+ *    Y-scaling.
+ * @param scaleZ
+ *    Z-scaling.
+ * @param matrixOut
+ *    Output column-major matrix for glMultMatrixf().
+ */
+static void
+createFiberConeMatrix(const float xyz[3],
+                      const float angleZ1,
+                      const float angleY,
+                      const float angleZ2,
+                      const float scaleX,
+                      const float scaleY,
+                      const float scaleZ,
+                      GLfloat matrixOut[16])
+{
+    const double degreesToRadians = M_PI / 180.0;
+    const double ca = std::cos(angleZ1 * degreesToRadians);
+    const double sa = std::sin(angleZ1 * degreesToRadians);
+    const double cb = std::cos(angleY * degreesToRadians);
+    const double sb = std::sin(angleY * degreesToRadians);
+    const double cc = std::cos(angleZ2 * degreesToRadians);
+    const double sc = std::sin(angleZ2 * degreesToRadians);
+    
+    matrixOut[0]  = ( ca * cb * cc - sa * sc) * scaleX;
+    matrixOut[1]  = ( sa * cb * cc + ca * sc) * scaleX;
+    matrixOut[2]  = (-sb * cc) * scaleX;
+    matrixOut[3]  = 0.0;
+    matrixOut[4]  = (-ca * cb * sc - sa * cc) * scaleY;
+    matrixOut[5]  = (-sa * cb * sc + ca * cc) * scaleY;
+    matrixOut[6]  = ( sb * sc) * scaleY;
+    matrixOut[7]  = 0.0;
+    matrixOut[8]  = (ca * sb) * scaleZ;
+    matrixOut[9]  = (sa * sb) * scaleZ;
+    matrixOut[10] = cb * scaleZ;
+    matrixOut[11] = 0.0;
+    matrixOut[12] = xyz[0];
+    matrixOut[13] = xyz[1];
+    matrixOut[14] = xyz[2];
+    matrixOut[15] = 1.0;
 }
 
 /**
@@ -4101,10 +4253,16 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
         sortFiberOrientationsByDepth();
     }
     
-    for (std::list<FiberOrientation*>::const_iterator iter = m_fiberOrientationsForDrawing.begin();
-         iter != m_fiberOrientationsForDrawing.end();
-         iter++) {
-        const FiberOrientation* fiberOrientation = *iter;
+    /*
+     * Lines are collected and drawn with a single call after
+     * all fibers are processed.  Order of lines is preserved.
+     */
+    std::vector<float> lineXYZ;
+    std::vector<float> lineRGBA;
+    
+    const int64_t numFiberOrientations = static_cast<int64_t>(m_fiberOrientationsForDrawing.size());
+    for (int64_t iFiberOrientation = 0; iFiberOrientation < numFiberOrientations; iFiberOrientation++) {
+        const FiberOrientation* fiberOrientation = m_fiberOrientationsForDrawing[iFiberOrientation];
 
         /*
          * Draw each of the fibers
@@ -4218,30 +4376,18 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                                 const int32_t indx = j % 3;
                                 switch (indx) {
                                     case 0: // use RED
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_RED[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_RED[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_RED[2],
-                                                  alpha);
                                         fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_RED[0];
                                         fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_RED[1];
                                         fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_RED[2];
                                         fiberRGBA[3] = alpha;
                                         break;
                                     case 1: // use BLUE
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_BLUE[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_BLUE[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_BLUE[2],
-                                                  alpha);
                                         fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_BLUE[0];
                                         fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_BLUE[1];
                                         fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_BLUE[2];
                                         fiberRGBA[3] = alpha;
                                         break;
                                     case 2: // use GREEN
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_GREEN[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_GREEN[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_GREEN[2],
-                                                  alpha);
                                         fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_GREEN[0];
                                         fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_GREEN[1];
                                         fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_GREEN[2];
@@ -4255,10 +4401,6 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                                 CaretAssert((fiber->m_directionUnitVectorRGB[1] >= 0.0) && (fiber->m_directionUnitVectorRGB[1] <= 1.0));
                                 CaretAssert((fiber->m_directionUnitVectorRGB[2] >= 0.0) && (fiber->m_directionUnitVectorRGB[2] <= 1.0));
                                 CaretAssert((alpha >= 0.0) && (alpha <= 1.0));
-                                glColor4f(fiber->m_directionUnitVectorRGB[0],
-                                          fiber->m_directionUnitVectorRGB[1],
-                                          fiber->m_directionUnitVectorRGB[2],
-                                          alpha);
                                 fiberRGBA[0] = fiber->m_directionUnitVectorRGB[0];
                                 fiberRGBA[1] = fiber->m_directionUnitVectorRGB[1];
                                 fiberRGBA[2] = fiber->m_directionUnitVectorRGB[2];
@@ -4270,10 +4412,6 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                     {
                         const CaretColorEnum::Enum caretColor = fodi->colorSource->getCaretColor();
                         const float* rgb = CaretColorEnum::toRGB(caretColor);
-                        glColor4f(rgb[0],
-                                  rgb[1],
-                                  rgb[2],
-                                  alpha);
                         fiberRGBA[0] = rgb[0];
                         fiberRGBA[1] = rgb[1];
                         fiberRGBA[2] = rgb[2];
@@ -4301,31 +4439,41 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                                                           * fodi->fanMultiplier),
                                                          vectorLength);
                         
+                        /*
+                         * Transform for each cone is computed here so that
+                         * there is only one matrix operation per cone.
+                         */
+                        GLfloat coneMatrix[16];
+                        
                         /*
                          * First cone
                          */
+                        createFiberConeMatrix(startXYZ,
+                                              -fiber->m_phi * radiansToDegrees,
+                                              -fiber->m_theta * radiansToDegrees,
+                                              -fiber->m_psi * radiansToDegrees,
+                                              majorAxis * 2.0,
+                                              minorAxis * 2.0,
+                                              vectorLength,
+                                              coneMatrix);
                         glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(-fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(-fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
+                        glMultMatrixf(coneMatrix);
                         m_shapeCone->draw(fiberRGBA);
                         glPopMatrix();
                         
                         /*
                          * Second cone but pointing in opposite direction
                          */
+                        createFiberConeMatrix(startXYZ,
+                                              -fiber->m_phi * radiansToDegrees,
+                                              180.0 - fiber->m_theta * radiansToDegrees,
+                                              fiber->m_psi * radiansToDegrees,
+                                              majorAxis * 2.0,
+                                              minorAxis * 2.0,
+                                              vectorLength,
+                                              coneMatrix);
                         glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(180.0 -fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
+                        glMultMatrixf(coneMatrix);
                         m_shapeCone->draw(fiberRGBA);
                         glPopMatrix();
                         
@@ -4333,12 +4481,10 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                         break;
                     case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
                     {
-                        const float radius = 2.0;
-                        setLineWidth(radius);
-                        glBegin(GL_LINES);
-                        glVertex3fv(startXYZ);
-                        glVertex3fv(endXYZ);
-                        glEnd();
+                        lineXYZ.insert(lineXYZ.end(), startXYZ, startXYZ + 3);
+                        lineXYZ.insert(lineXYZ.end(), endXYZ, endXYZ + 3);
+                        lineRGBA.insert(lineRGBA.end(), fiberRGBA, fiberRGBA + 4);
+                        lineRGBA.insert(lineRGBA.end(), fiberRGBA, fiberRGBA + 4);
                     }
                         break;
                 }
@@ -4346,6 +4492,29 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
         }
     }
     
+    /*
+     * Draw all of the lines
+     */
+    if ( ! lineXYZ.empty()) {
+        const float radius = 2.0;
+        setLineWidth(radius);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(3,
+                        GL_FLOAT,
+                        0,
+                        reinterpret_cast<const GLvoid*>(&lineXYZ[0]));
+        glColorPointer(4,
+                       GL_FLOAT,
+                       0,
+                       reinterpret_cast<const GLvoid*>(&lineRGBA[0]));
+        glDrawArrays(GL_LINES,
+                     0,
+                     static_cast<GLsizei>(lineXYZ.size() / 3));
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+    
     /*
      * Now clear the list of fiber orientations for drawing.
      */
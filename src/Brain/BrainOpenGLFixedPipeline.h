@@ -601,7 +601,13 @@ namespace caret {
         /** Cylinder symbol */
         BrainOpenGLShapeCylinder* m_shapeCylinder;
         
-        std::list<FiberOrientation*> m_fiberOrientationsForDrawing;
+        std::vector<FiberOrientation*> m_fiberOrientationsForDrawing;
+        
+        /** Fiber orientations in the order they were added for the previous depth sort */
+        std::vector<FiberOrientation*> m_fiberOrientationsSortInputPrevious;
+        
+        /** Result of the previous depth sort, reused when the same fibers are drawn again */
+        std::vector<FiberOrientation*> m_fiberOrientationsSortedPrevious;
         
         double inverseRotationMatrix[16];
         bool inverseRotationMatrixValid;
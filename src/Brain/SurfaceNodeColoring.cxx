@@ -23,6 +23,8 @@
 #include "SurfaceNodeColoring.h"
 #undef __SURFACE_NODE_COLORING_DECLARE__
 
+#include <algorithm>
+
 #include "Brain.h"
 #include "BrainordinateRegionOfInterest.h"
 #include "BrainStructure.h"
@@ -44,6 +46,7 @@
 #include "DisplayPropertiesLabels.h"
 #include "EventManager.h"
 #include "EventModelSurfaceGet.h"
+#include "EventSurfaceColoringInvalidate.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GroupAndNameHierarchyGroup.h"
@@ -75,7 +78,14 @@ using namespace caret;
 SurfaceNodeColoring::SurfaceNodeColoring()
 : CaretObject()
 {
-    
+    m_invalidationGeneration = 0;
+    m_lastColoringGeneration = 0;
+    m_coloringSerialNumberCounter = 0;
+    
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_BRAIN_RESET);
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_DATA_FILE_DELETE);
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_DATA_FILE_RELOAD);
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
 }
 
 /**
@@ -83,7 +93,205 @@ SurfaceNodeColoring::SurfaceNodeColoring()
  */
 SurfaceNodeColoring::~SurfaceNodeColoring()
 {
+    EventManager::get()->removeAllEventsFromListener(this);
+}
+
+/**
+ * Receive an event.
+ *
+ * @param event
+ *    The event.
+ */
+void
+SurfaceNodeColoring::receiveEvent(Event* event)
+{
+    if (event->getEventType() == EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE) {
+        EventSurfaceColoringInvalidate* invalidateEvent =
+        dynamic_cast<EventSurfaceColoringInvalidate*>(event);
+        CaretAssert(invalidateEvent);
+        
+        invalidateEvent->setEventProcessed();
+        
+        invalidateCachedColoring();
+    }
+    else if ((event->getEventType() == EventTypeEnum::EVENT_BRAIN_RESET)
+             || (event->getEventType() == EventTypeEnum::EVENT_DATA_FILE_DELETE)
+             || (event->getEventType() == EventTypeEnum::EVENT_DATA_FILE_RELOAD)) {
+        /*
+         * Files are deleted or their data replaced without
+         * marking them modified so discard all coloring.
+         * Events are processed by other listeners.
+         */
+        clearCachedColoring();
+    }
+}
+
+/**
+ * Clear the cached overlay layers and blended layers.
+ */
+void
+SurfaceNodeColoring::clearCachedColoring()
+{
+    m_coloredLayers.clear();
+    m_blendedLayers.clear();
+}
+
+/**
+ * Invalidate the cached overlay layers.  Layers and blended layers
+ * that were not displayed since the previous invalidation are
+ * removed.  Other layers are kept and, when next displayed, a layer
+ * is colored again unless its file's palette and data are unchanged.
+ */
+void
+SurfaceNodeColoring::invalidateCachedColoring()
+{
+    std::map<LayerKey, ColoredLayer>::iterator layerIter = m_coloredLayers.begin();
+    while (layerIter != m_coloredLayers.end()) {
+        if (layerIter->second.m_lastUsedGeneration < m_lastColoringGeneration) {
+            m_coloredLayers.erase(layerIter++);
+        }
+        else {
+            ++layerIter;
+        }
+    }
+    
+    std::map<BlendKey, BlendedLayers>::iterator blendIter = m_blendedLayers.begin();
+    while (blendIter != m_blendedLayers.end()) {
+        if (blendIter->second.m_lastUsedGeneration < m_lastColoringGeneration) {
+            m_blendedLayers.erase(blendIter++);
+        }
+        else {
+            ++blendIter;
+        }
+    }
+    
+    m_invalidationGeneration++;
+}
+
+/**
+ * Constructor.
+ *
+ * @param brainStructure
+ *    Brain structure containing the surface.
+ * @param numberOfNodes
+ *    Number of nodes in the surface.
+ * @param mapFile
+ *    File selected in the overlay, identified by its instance identifier.
+ * @param mapIndex
+ *    Map selected in the overlay.
+ * @param browserTabIndex
+ *    Index of tab, -1 if coloring does not depend upon the tab.
+ * @param surface
+ *    The surface, NULL if coloring does not depend upon the surface.
+ */
+SurfaceNodeColoring::LayerKey::LayerKey(const BrainStructure* brainStructure,
+                                        const int32_t numberOfNodes,
+                                        const CaretMappableDataFile* mapFile,
+                                        const int32_t mapIndex,
+                                        const int32_t browserTabIndex,
+                                        const Surface* surface)
+: m_brainStructure(brainStructure),
+m_numberOfNodes(numberOfNodes),
+m_mapFileInstanceIdentifier(mapFile->getDataFileInstanceIdentifier()),
+m_mapIndex(mapIndex),
+m_browserTabIndex(browserTabIndex),
+m_surface(surface)
+{
+}
+
+/**
+ * Less than operator for use as a map key.
+ *
+ * @param rhs
+ *    Key on right side of operator.
+ */
+bool
+SurfaceNodeColoring::LayerKey::operator<(const LayerKey& rhs) const
+{
+    if (m_brainStructure != rhs.m_brainStructure) return (m_brainStructure < rhs.m_brainStructure);
+    if (m_numberOfNodes != rhs.m_numberOfNodes) return (m_numberOfNodes < rhs.m_numberOfNodes);
+    if (m_mapFileInstanceIdentifier != rhs.m_mapFileInstanceIdentifier) return (m_mapFileInstanceIdentifier < rhs.m_mapFileInstanceIdentifier);
+    if (m_mapIndex != rhs.m_mapIndex) return (m_mapIndex < rhs.m_mapIndex);
+    if (m_browserTabIndex != rhs.m_browserTabIndex) return (m_browserTabIndex < rhs.m_browserTabIndex);
+    return (m_surface < rhs.m_surface);
+}
+
+/**
+ * Constructor.
+ */
+SurfaceNodeColoring::LayerColoringState::LayerColoringState()
+: m_retainableFlag(false),
+m_paletteNormalizationMode(PaletteNormalizationModeEnum::NORMALIZATION_SELECTED_MAP_DATA)
+{
+}
+
+/**
+ * Set the state from a file's map.  Label coloring depends upon display
+ * properties and connectivity coloring upon loaded data so they are
+ * never retained.  Other coloring is retained until its file's data
+ * is modified.
+ *
+ * @param mapFile
+ *    File selected in the overlay.
+ * @param mapIndex
+ *    Map selected in the overlay.
+ */
+void
+SurfaceNodeColoring::LayerColoringState::setFromMapFile(const CaretMappableDataFile* mapFile,
+                                                        const int32_t mapIndex)
+{
+    m_retainableFlag = false;
+    m_paletteColorMapping.grabNew(NULL);
+    
+    switch (mapFile->getDataFileType()) {
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+        case DataFileTypeEnum::METRIC:
+        case DataFileTypeEnum::RGBA:
+            m_retainableFlag = ( ! mapFile->isModifiedExcludingPaletteColorMapping());
+            break;
+        default:
+            break;
+    }
+    
+    if (m_retainableFlag
+        && mapFile->isMappedWithPalette()) {
+        m_paletteNormalizationMode = mapFile->getPaletteNormalizationMode();
+        const PaletteColorMapping* paletteColorMapping = mapFile->getMapPaletteColorMapping(mapIndex);
+        if (paletteColorMapping != NULL) {
+            m_paletteColorMapping.grabNew(new PaletteColorMapping(*paletteColorMapping));
+        }
+    }
+}
+
+/**
+ * Equality operator.
+ *
+ * @param rhs
+ *    State on right side of operator.
+ * @return
+ *    True if both states are retainable and have the same palette mapping.
+ */
+bool
+SurfaceNodeColoring::LayerColoringState::operator==(const LayerColoringState& rhs) const
+{
+    if (( ! m_retainableFlag)
+        || ( ! rhs.m_retainableFlag)) {
+        return false;
+    }
+    if (m_paletteNormalizationMode != rhs.m_paletteNormalizationMode) {
+        return false;
+    }
     
+    const PaletteColorMapping* pcm    = m_paletteColorMapping;
+    const PaletteColorMapping* rhsPcm = rhs.m_paletteColorMapping;
+    if ((pcm == NULL)
+        || (rhsPcm == NULL)) {
+        return (pcm == rhsPcm);
+    }
+    return (*pcm == *rhsPcm);
 }
 
 /**
@@ -200,7 +408,8 @@ SurfaceNodeColoring::colorSurfaceNodes(Model* model,
     
     const int numNodes = surface->getNumberOfNodes();
     const int numColorComponents = numNodes * 4;
-    float *rgbaColor = new float[numColorComponents];
+    std::vector<float> rgbaColorVector(numColorComponents);
+    float* rgbaColor = &rgbaColorVector[0];
     
     /*
      * Color the surface nodes
@@ -227,8 +436,6 @@ SurfaceNodeColoring::colorSurfaceNodes(Model* model,
         rgba = surface->getWholeBrainNodeColoringRgbaForBrowserTab(browserTabIndex);
     }
 
-    if(rgbaColor) delete [] rgbaColor;
-    
     return rgba;
 }
 
@@ -286,6 +493,11 @@ SurfaceNodeColoring::showBrainordinateHighlightRegionOfInterest(const Brain* bra
 /**
  * Assign color components to surface nodes. 
  *
+ * Each overlay layer is colored once and kept after coloring is
+ * invalidated unless its file's palette or data changes.  Blended
+ * layers are saved so that tabs with the same overlays, or overlays
+ * that differ only in the top layer, reuse the blending.
+ *
  * @param surface
  *    Surface that has its nodes colored.
  * @param overlaySet
@@ -303,25 +515,18 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
     const int32_t numNodes = surface->getNumberOfNodes();
     const int32_t numberOfDisplayedOverlays = overlaySet->getNumberOfDisplayedOverlays();
     
-    /*
-     * Default color.
-     */
-    for (int32_t i = 0; i < numNodes; i++) {
-        const int32_t i4 = i * 4;
-        rgbaNodeColors[i4] = 0.70;
-        rgbaNodeColors[i4+1] = 0.70;
-        rgbaNodeColors[i4+2] = 0.70;
-        rgbaNodeColors[i4+3] = 1.0;
-    }
-    
     const BrainStructure* brainStructure = surface->getBrainStructure();
     CaretAssert(brainStructure);
     const Brain* brain = brainStructure->getBrain();
     CaretAssert(brain);
     
-    bool firstOverlayFlag = true;
-    float* overlayRGBV = new float[numNodes * 4];
+    m_lastColoringGeneration = m_invalidationGeneration;
     
+    /*
+     * Layers from bottom to top
+     */
+    BlendKey blendKey;
+    std::vector<const ColoredLayer*> layers;
     for (int32_t iOver = (numberOfDisplayedOverlays - 1); iOver >= 0; iOver--) {
         Overlay* overlay = overlaySet->getOverlay(iOver);
         if (overlay->isEnabled()) {            
@@ -332,213 +537,111 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
             overlay->getSelectionData(mapFiles,
                                       selectedMapFile,
                                       selectedMapIndex);
-            
-            DataFileTypeEnum::Enum mapDataFileType = DataFileTypeEnum::UNKNOWN;
-            if (selectedMapFile != NULL) {
-                mapDataFileType = selectedMapFile->getDataFileType();
+            if (selectedMapFile == NULL) {
+                continue;
             }
             
-            bool isColoringValid = false;
-            switch (mapDataFileType) {
-                case DataFileTypeEnum::ANNOTATION:
-                    break;
-                case DataFileTypeEnum::BORDER:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                                    cmf,
-                                                                                    selectedMapIndex,
-                                                                                    numNodes,
-                                                                                    overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                                    cmf,
-                                                                                    selectedMapIndex,
-                                                                                    numNodes,
-                                                                                    overlayRGBV);
-                }
-                    break;
+            bool tabDependentFlag = false;
+            switch (selectedMapFile->getDataFileType()) {
                 case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
-                    isColoringValid = this->assignCiftiDenseLabelColoring(displayPropertiesLabels,
-                                                                     browserTabIndex,
-                                                                     brainStructure,
-                                                                          surface,
-                                                                      dynamic_cast<CiftiBrainordinateLabelFile*>(selectedMapFile),
-                                                                     selectedMapIndex,
-                                                                      numNodes,
-                                                                      overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
-                    isColoringValid = this->assignCiftiScalarColoring(brainStructure,
-                                                                 dynamic_cast<CiftiBrainordinateScalarFile*>(selectedMapFile),
-                                                                      selectedMapIndex,
-                                                                 numNodes,
-                                                                 overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
-                    isColoringValid = this->assignCiftiDataSeriesColoring(brainStructure,
-                                                                      dynamic_cast<CiftiBrainordinateDataSeriesFile*>(selectedMapFile),
-                                                                          selectedMapIndex,
-                                                                      numNodes,
-                                                                      overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                }
-                    break;
                 case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
-                {
-                    CiftiParcelLabelFile* cplf = dynamic_cast<CiftiParcelLabelFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiParcelLabelColoring(displayPropertiesLabels,
-                                                   browserTabIndex,
-                                                   brainStructure,
-                                                                     surface,
-                                                   cplf,
-                                                   selectedMapIndex,
-                                                   numNodes,
-                                                   overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
-                    isColoringValid = this->assignCiftiParcelScalarColoring(brainStructure,
-                                                                            dynamic_cast<CiftiParcelScalarFile*>(selectedMapFile),
-                                                                            selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
-                    isColoringValid = this->assignCiftiParcelSeriesColoring(brainStructure,
-                                                                            dynamic_cast<CiftiParcelSeriesFile*>(selectedMapFile),
-                                                                            selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
-                    break;
-                case DataFileTypeEnum::FOCI:
-                    break;
-                case DataFileTypeEnum::IMAGE:
-                    break;
                 case DataFileTypeEnum::LABEL:
-                    isColoringValid = this->assignLabelColoring(displayPropertiesLabels,
-                                                                browserTabIndex,
-                                                                brainStructure,
-                                                                surface,
-                                                                dynamic_cast<LabelFile*>(selectedMapFile),
-                                                                selectedMapIndex,
-                                                                numNodes, 
-                                                                overlayRGBV);
-                    break;
-                case DataFileTypeEnum::METRIC:
-                    isColoringValid = this->assignMetricColoring(brainStructure, 
-                                                                 dynamic_cast<MetricFile*>(selectedMapFile),
-                                                                 selectedMapIndex,
-                                                                 numNodes, 
-                                                                 overlayRGBV);
-                    break;
-                case DataFileTypeEnum::PALETTE:
+                    tabDependentFlag = true;
                     break;
-                case DataFileTypeEnum::RGBA:
-                    isColoringValid = this->assignRgbaColoring(brainStructure, 
-                                                               dynamic_cast<RgbaFile*>(selectedMapFile),
-                                                               selectedMapIndex,
-                                                               numNodes, 
-                                                               overlayRGBV);
-                    break;
-                case DataFileTypeEnum::SCENE:
-                    break;
-                case DataFileTypeEnum::SPECIFICATION:
-                    break;
-                case DataFileTypeEnum::SURFACE:
-                    break;
-                case DataFileTypeEnum::VOLUME:
-                    break;
-                case DataFileTypeEnum::UNKNOWN:
+                default:
                     break;
             }
             
-            if (isColoringValid) {
-                const float opacity = overlay->getOpacity();
-                const float oneMinusOpacity = 1.0 - opacity;
-                
-                for (int32_t i = 0; i < numNodes; i++) {
-                    const int32_t i4 = i * 4;
-                    const float valid = overlayRGBV[i4 + 3];
-                    if (valid > 0.0 ) {
-                        if (opacity < 1.0) {
-                            if (firstOverlayFlag) {
-                                /*
-                                 * When first overlay, there is nothing to 
-                                 * blend with
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity);
-                            }
-                            else {
-                                /*
-                                 * Blend with underlaying colors
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity)
-                                + (rgbaNodeColors[i4] * oneMinusOpacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity)
-                                + (rgbaNodeColors[i4+1] * oneMinusOpacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity)
-                                + (rgbaNodeColors[i4+2] * oneMinusOpacity);
-                            }
-                        }
-                        else {
-                            /*
-                             * No opacity so simple replace coloring
-                             */
-                            rgbaNodeColors[i4] = overlayRGBV[i4];
-                            rgbaNodeColors[i4+1] = overlayRGBV[i4+1];
-                            rgbaNodeColors[i4+2] = overlayRGBV[i4+2];
-                        }
-                    }
-                }
-                
-                firstOverlayFlag = false;
-            }
+            const LayerKey layerKey(brainStructure,
+                                    numNodes,
+                                    selectedMapFile,
+                                    selectedMapIndex,
+                                    (tabDependentFlag ? browserTabIndex : -1),
+                                    (tabDependentFlag ? surface : NULL));
+            const ColoredLayer& layer = getColoredLayer(displayPropertiesLabels,
+                                                        browserTabIndex,
+                                                        brainStructure,
+                                                        surface,
+                                                        layerKey,
+                                                        selectedMapFile);
+            blendKey.push_back(std::make_pair(layer.m_coloringSerialNumber,
+                                              overlay->getOpacity()));
+            layers.push_back(&layer);
+        }
+    }
+    
+    /*
+     * Start from the saved blending of all layers or all
+     * but the top layer when available.
+     */
+    const int32_t numberOfLayers = static_cast<int32_t>(blendKey.size());
+    int32_t firstLayerToBlend = 0;
+    BlendedLayers blended;
+    std::map<BlendKey, BlendedLayers>::iterator blendIter = m_blendedLayers.find(blendKey);
+    if (blendIter != m_blendedLayers.end()) {
+        firstLayerToBlend = numberOfLayers;
+        blendIter->second.m_lastUsedGeneration = m_invalidationGeneration;
+        blended = blendIter->second;
+    }
+    else if (numberOfLayers > 1) {
+        const BlendKey belowTopKey(blendKey.begin(),
+                                   blendKey.end() - 1);
+        blendIter = m_blendedLayers.find(belowTopKey);
+        if (blendIter != m_blendedLayers.end()) {
+            firstLayerToBlend = numberOfLayers - 1;
+            blendIter->second.m_lastUsedGeneration = m_invalidationGeneration;
+            blended = blendIter->second;
         }
     }
     
+    if (firstLayerToBlend == 0) {
+        /*
+         * Default color.
+         */
+        blended.m_anyLayerBlended = false;
+        blended.m_lastUsedGeneration = m_invalidationGeneration;
+        blended.m_rgba.resize(numNodes * 4);
+        for (int32_t i = 0; i < numNodes; i++) {
+            const int32_t i4 = i * 4;
+            blended.m_rgba[i4] = 0.70;
+            blended.m_rgba[i4+1] = 0.70;
+            blended.m_rgba[i4+2] = 0.70;
+            blended.m_rgba[i4+3] = 1.0;
+        }
+    }
+    
+    for (int32_t iLayer = firstLayerToBlend; iLayer < numberOfLayers; iLayer++) {
+        if ((iLayer == (numberOfLayers - 1))
+            && (firstLayerToBlend < iLayer)) {
+            /*
+             * Save blending below the top layer since the top
+             * layer is the one most often changed.
+             */
+            const BlendKey belowTopKey(blendKey.begin(),
+                                       blendKey.end() - 1);
+            m_blendedLayers[belowTopKey] = blended;
+        }
+        
+        const ColoredLayer& layer = *layers[iLayer];
+        if (layer.m_valid) {
+            blendLayer(&layer.m_rgba[0],
+                       blendKey[iLayer].second,
+                       ( ! blended.m_anyLayerBlended),
+                       numNodes,
+                       &blended.m_rgba[0]);
+            blended.m_anyLayerBlended = true;
+        }
+    }
+    
+    if (firstLayerToBlend < numberOfLayers) {
+        m_blendedLayers[blendKey] = blended;
+    }
+    
+    CaretAssert(static_cast<int32_t>(blended.m_rgba.size()) == (numNodes * 4));
+    std::copy(blended.m_rgba.begin(),
+              blended.m_rgba.end(),
+              rgbaNodeColors);
+    
     /*
      * Opacity from first overlay is used as overall surface opacity
      * so replace alpha with opacity
@@ -554,8 +657,320 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
     showBrainordinateHighlightRegionOfInterest(brain,
                                                surface,
                                                rgbaNodeColors);
+}
+
+/**
+ * Get the coloring for an overlay layer, coloring the layer if it
+ * is not cached.  A layer cached before coloring was last invalidated
+ * is colored again unless it is retainable and its file's palette
+ * and data are unchanged.
+ *
+ * @param displayPropertiesLabels
+ *    Display properties for labels.
+ * @param browserTabIndex
+ *    Index of tab.
+ * @param brainStructure
+ *    The brain structure that contains the data files.
+ * @param surface
+ *    Surface that has its nodes colored.
+ * @param layerKey
+ *    Key identifying the layer.
+ * @param selectedMapFile
+ *    File selected in the overlay.
+ * @return
+ *    Coloring of the layer.
+ */
+const SurfaceNodeColoring::ColoredLayer&
+SurfaceNodeColoring::getColoredLayer(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                     const int32_t browserTabIndex,
+                                     const BrainStructure* brainStructure,
+                                     const Surface* surface,
+                                     const LayerKey& layerKey,
+                                     CaretMappableDataFile* selectedMapFile)
+{
+    std::map<LayerKey, ColoredLayer>::iterator iter = m_coloredLayers.find(layerKey);
+    if (iter != m_coloredLayers.end()) {
+        ColoredLayer& layer = iter->second;
+        bool validFlag = (layer.m_validatedGeneration == m_invalidationGeneration);
+        if ( ! validFlag) {
+            LayerColoringState currentState;
+            currentState.setFromMapFile(selectedMapFile,
+                                        layerKey.m_mapIndex);
+            validFlag = (currentState == layer.m_coloringState);
+        }
+        if (validFlag) {
+            layer.m_validatedGeneration = m_invalidationGeneration;
+            layer.m_lastUsedGeneration  = m_invalidationGeneration;
+            return layer;
+        }
+    }
+    
+    ColoredLayer& layer = m_coloredLayers[layerKey];
+    layer.m_coloringState.setFromMapFile(selectedMapFile,
+                                         layerKey.m_mapIndex);
+    layer.m_rgba.resize(layerKey.m_numberOfNodes * 4);
+    layer.m_valid = assignOverlayColoring(displayPropertiesLabels,
+                                          browserTabIndex,
+                                          brainStructure,
+                                          surface,
+                                          selectedMapFile,
+                                          layerKey.m_mapIndex,
+                                          layerKey.m_numberOfNodes,
+                                          &layer.m_rgba[0]);
+    if ( ! layer.m_valid) {
+        layer.m_rgba.clear();
+    }
+    
+    m_coloringSerialNumberCounter++;
+    layer.m_coloringSerialNumber = m_coloringSerialNumberCounter;
+    layer.m_validatedGeneration  = m_invalidationGeneration;
+    layer.m_lastUsedGeneration   = m_invalidationGeneration;
+    
+    return layer;
+}
+
+/**
+ * Assign the coloring for the map selected in an overlay.
+ *
+ * @param displayPropertiesLabels
+ *    Display properties for labels.
+ * @param browserTabIndex
+ *    Index of tab.
+ * @param brainStructure
+ *    The brain structure that contains the data files.
+ * @param surface
+ *    Surface that has its nodes colored.
+ * @param selectedMapFile
+ *    File selected in the overlay.
+ * @param selectedMapIndex
+ *    Map selected in the overlay.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param rgbv
+ *    Color components set by this method.
+ *    Red, green, blue, valid.  If the valid component is
+ *    zero, it indicates that the overlay did not assign
+ *    any coloring to the node.
+ * @return
+ *    True if coloring is valid, else false.
+ */
+bool
+SurfaceNodeColoring::assignOverlayColoring(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                           const int32_t browserTabIndex,
+                                           const BrainStructure* brainStructure,
+                                           const Surface* surface,
+                                           CaretMappableDataFile* selectedMapFile,
+                                           const int32_t selectedMapIndex,
+                                           const int32_t numberOfNodes,
+                                           float* rgbv)
+{
+    CaretAssert(selectedMapFile);
+    const DataFileTypeEnum::Enum mapDataFileType = selectedMapFile->getDataFileType();
+    
+    bool isColoringValid = false;
+    switch (mapDataFileType) {
+        case DataFileTypeEnum::ANNOTATION:
+            break;
+        case DataFileTypeEnum::BORDER:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                            cmf,
+                                                                            selectedMapIndex,
+                                                                            numberOfNodes,
+                                                                            rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                            cmf,
+                                                                            selectedMapIndex,
+                                                                            numberOfNodes,
+                                                                            rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            isColoringValid = this->assignCiftiDenseLabelColoring(displayPropertiesLabels,
+                                                             browserTabIndex,
+                                                             brainStructure,
+                                                                  surface,
+                                                              dynamic_cast<CiftiBrainordinateLabelFile*>(selectedMapFile),
+                                                             selectedMapIndex,
+                                                              numberOfNodes,
+                                                              rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            isColoringValid = this->assignCiftiScalarColoring(brainStructure,
+                                                         dynamic_cast<CiftiBrainordinateScalarFile*>(selectedMapFile),
+                                                              selectedMapIndex,
+                                                         numberOfNodes,
+                                                         rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            isColoringValid = this->assignCiftiDataSeriesColoring(brainStructure,
+                                                              dynamic_cast<CiftiBrainordinateDataSeriesFile*>(selectedMapFile),
+                                                                  selectedMapIndex,
+                                                              numberOfNodes,
+                                                              rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+        {
+            CiftiParcelLabelFile* cplf = dynamic_cast<CiftiParcelLabelFile*>(selectedMapFile);
+            isColoringValid = assignCiftiParcelLabelColoring(displayPropertiesLabels,
+                                           browserTabIndex,
+                                           brainStructure,
+                                                             surface,
+                                           cplf,
+                                           selectedMapIndex,
+                                           numberOfNodes,
+                                           rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            isColoringValid = this->assignCiftiParcelScalarColoring(brainStructure,
+                                                                    dynamic_cast<CiftiParcelScalarFile*>(selectedMapFile),
+                                                                    selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            isColoringValid = this->assignCiftiParcelSeriesColoring(brainStructure,
+                                                                    dynamic_cast<CiftiParcelSeriesFile*>(selectedMapFile),
+                                                                    selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            break;
+        case DataFileTypeEnum::FOCI:
+            break;
+        case DataFileTypeEnum::IMAGE:
+            break;
+        case DataFileTypeEnum::LABEL:
+            isColoringValid = this->assignLabelColoring(displayPropertiesLabels,
+                                                        browserTabIndex,
+                                                        brainStructure,
+                                                        surface,
+                                                        dynamic_cast<LabelFile*>(selectedMapFile),
+                                                        selectedMapIndex,
+                                                        numberOfNodes, 
+                                                        rgbv);
+            break;
+        case DataFileTypeEnum::METRIC:
+            isColoringValid = this->assignMetricColoring(brainStructure, 
+                                                         dynamic_cast<MetricFile*>(selectedMapFile),
+                                                         selectedMapIndex,
+                                                         numberOfNodes, 
+                                                         rgbv);
+            break;
+        case DataFileTypeEnum::PALETTE:
+            break;
+        case DataFileTypeEnum::RGBA:
+            isColoringValid = this->assignRgbaColoring(brainStructure, 
+                                                       dynamic_cast<RgbaFile*>(selectedMapFile),
+                                                       selectedMapIndex,
+                                                       numberOfNodes, 
+                                                       rgbv);
+            break;
+        case DataFileTypeEnum::SCENE:
+            break;
+        case DataFileTypeEnum::SPECIFICATION:
+            break;
+        case DataFileTypeEnum::SURFACE:
+            break;
+        case DataFileTypeEnum::VOLUME:
+            break;
+        case DataFileTypeEnum::UNKNOWN:
+            break;
+    }
+    
+    return isColoringValid;
+}
+
+/**
+ * Blend the coloring of an overlay layer with the layers below it.
+ *
+ * @param layerRGBV
+ *    Coloring of the layer, nodes with a valid component of zero
+ *    are not colored by the layer.
+ * @param opacity
+ *    Opacity of the layer.
+ * @param firstLayerFlag
+ *    True if no layers are below this layer.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param rgbaNodeColors
+ *    Coloring of the layers below that is updated.
+ */
+void
+SurfaceNodeColoring::blendLayer(const float* layerRGBV,
+                                const float opacity,
+                                const bool firstLayerFlag,
+                                const int32_t numberOfNodes,
+                                float* rgbaNodeColors)
+{
+    /*
+     * When first layer, there is nothing to blend with
+     */
+    const float layerWeight = ((opacity < 1.0) ? opacity : 1.0);
+    const float belowWeight = (((opacity < 1.0) && ( ! firstLayerFlag)) ? (1.0 - opacity) : 0.0);
     
-    delete[] overlayRGBV;
+    for (int32_t i = 0; i < numberOfNodes; i++) {
+        const int32_t i4 = i * 4;
+        if (layerRGBV[i4 + 3] > 0.0) {
+            if (opacity < 1.0) {
+                rgbaNodeColors[i4]   = (layerRGBV[i4]   * layerWeight) + (rgbaNodeColors[i4]   * belowWeight);
+                rgbaNodeColors[i4+1] = (layerRGBV[i4+1] * layerWeight) + (rgbaNodeColors[i4+1] * belowWeight);
+                rgbaNodeColors[i4+2] = (layerRGBV[i4+2] * layerWeight) + (rgbaNodeColors[i4+2] * belowWeight);
+            }
+            else {
+                /*
+                 * No opacity so simple replace coloring
+                 */
+                rgbaNodeColors[i4]   = layerRGBV[i4];
+                rgbaNodeColors[i4+1] = layerRGBV[i4+1];
+                rgbaNodeColors[i4+2] = layerRGBV[i4+2];
+            }
+        }
+    }
 }
 
 /**
@@ -21,17 +21,24 @@
  */
 /*LICENSE_END*/
 
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "CaretColorEnum.h"
 #include "CaretObject.h"
 #include "CaretPointer.h"
 #include "DisplayGroupEnum.h"
+#include "EventListenerInterface.h"
 #include "LabelDrawingTypeEnum.h"
+#include "PaletteNormalizationModeEnum.h"
 
 namespace caret {
 
     class Brain;
     class BrainStructure;
     class BrowserTabContent;
+    class CaretMappableDataFile;
     class CiftiMappableConnectivityMatrixDataFile;
     class CiftiBrainordinateDataSeriesFile;
     class CiftiBrainordinateLabelFile;
@@ -52,7 +59,7 @@ namespace caret {
     class TopologyHelper;
     
     /// Performs coloring of surface nodes
-    class SurfaceNodeColoring : public CaretObject {
+    class SurfaceNodeColoring : public CaretObject, public EventListenerInterface {
         
     public:
         SurfaceNodeColoring();
@@ -63,6 +70,8 @@ namespace caret {
                                  Surface* surface,
                                  const int32_t browserTabIndex);
         
+        virtual void receiveEvent(Event* event);
+        
     private:
         SurfaceNodeColoring(const SurfaceNodeColoring&);
 
@@ -79,12 +88,125 @@ namespace caret {
             METRIC_COLOR_TYPE_DO_NOT_COLOR
         };        
         
+        /**
+         * Identifies the coloring of one overlay layer.  Label coloring
+         * depends upon the tab and surface, other coloring does not.
+         * The file is identified by its instance identifier since the
+         * address of a destroyed file may be used by a new file.
+         */
+        class LayerKey {
+        public:
+            LayerKey(const BrainStructure* brainStructure,
+                     const int32_t numberOfNodes,
+                     const CaretMappableDataFile* mapFile,
+                     const int32_t mapIndex,
+                     const int32_t browserTabIndex,
+                     const Surface* surface);
+            
+            bool operator<(const LayerKey& rhs) const;
+            
+            const BrainStructure* m_brainStructure;
+            
+            int32_t m_numberOfNodes;
+            
+            int64_t m_mapFileInstanceIdentifier;
+            
+            int32_t m_mapIndex;
+            
+            int32_t m_browserTabIndex;
+            
+            const Surface* m_surface;
+        };
+        
+        /**
+         * State of a file's map that determines its coloring
+         * and is compared to see if cached coloring is still valid.
+         */
+        class LayerColoringState {
+        public:
+            LayerColoringState();
+            
+            void setFromMapFile(const CaretMappableDataFile* mapFile,
+                                const int32_t mapIndex);
+            
+            bool operator==(const LayerColoringState& rhs) const;
+            
+            /** Coloring may be kept after coloring is invalidated */
+            bool m_retainableFlag;
+            
+            /** Normalization mode used with the palette */
+            PaletteNormalizationModeEnum::Enum m_paletteNormalizationMode;
+            
+            /** Copy of the map's palette color mapping, NULL if not palette mapped */
+            CaretPointer<PaletteColorMapping> m_paletteColorMapping;
+        };
+        
+        /** Coloring of an overlay layer */
+        class ColoredLayer {
+        public:
+            /** Layer has valid coloring */
+            bool m_valid;
+            
+            /** RGBA with alpha greater than zero for colored nodes */
+            std::vector<float> m_rgba;
+            
+            /** Unique for each coloring so that blending identifies the coloring */
+            int64_t m_coloringSerialNumber;
+            
+            /** Invalidation generation in which the coloring was created or verified */
+            int64_t m_validatedGeneration;
+            
+            /** Invalidation generation in which the layer was last displayed */
+            int64_t m_lastUsedGeneration;
+            
+            /** State of the map file when the layer was colored */
+            LayerColoringState m_coloringState;
+        };
+        
+        /** Coloring serial numbers of layers from bottom to top with the opacity of each */
+        typedef std::vector<std::pair<int64_t, float> > BlendKey;
+        
+        /** Result of blending layers */
+        class BlendedLayers {
+        public:
+            /** At least one valid layer was blended */
+            bool m_anyLayerBlended;
+            
+            /** RGBA of the blended layers */
+            std::vector<float> m_rgba;
+            
+            /** Invalidation generation in which the blending was last displayed */
+            int64_t m_lastUsedGeneration;
+        };
+        
         void colorSurfaceNodes(const DisplayPropertiesLabels* dpl,
                                const int32_t browserTabIndex,
                                const Surface* surface,
                                OverlaySet* overlaySet,
                                float* rgbaNodeColors);
         
+        const ColoredLayer& getColoredLayer(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                            const int32_t browserTabIndex,
+                                            const BrainStructure* brainStructure,
+                                            const Surface* surface,
+                                            const LayerKey& layerKey,
+                                            CaretMappableDataFile* selectedMapFile);
+        
+        bool assignOverlayColoring(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                   const int32_t browserTabIndex,
+                                   const BrainStructure* brainStructure,
+                                   const Surface* surface,
+                                   CaretMappableDataFile* selectedMapFile,
+                                   const int32_t selectedMapIndex,
+                                   const int32_t numberOfNodes,
+                                   float* rgbv);
+        
+        static void blendLayer(const float* layerRGBV,
+                               const float opacity,
+                               const bool firstLayerFlag,
+                               const int32_t numberOfNodes,
+                               float* rgbaNodeColors);
+        
         bool assignLabelColoring(const DisplayPropertiesLabels* dpl,
                                  const int32_t browserTabIndex,
                                  const BrainStructure* brainStructure,
@@ -167,6 +289,28 @@ namespace caret {
         void showBrainordinateHighlightRegionOfInterest(const Brain* brain,
                                                         const Surface* surface,
                                                         float* rgbaNodeColors);
+        
+        void clearCachedColoring();
+        
+        void invalidateCachedColoring();
+        
+        /** Colored overlay layers */
+        std::map<LayerKey, ColoredLayer> m_coloredLayers;
+        
+        /**
+         * Blended layers for a complete overlay stack and for the stack
+         * without its top layer
+         */
+        std::map<BlendKey, BlendedLayers> m_blendedLayers;
+        
+        /** Incremented each time surface coloring is invalidated */
+        int64_t m_invalidationGeneration;
+        
+        /** Invalidation generation in which surface nodes were last colored */
+        int64_t m_lastColoringGeneration;
+        
+        /** Source of layer coloring serial numbers */
+        int64_t m_coloringSerialNumberCounter;
     };
     
 #ifdef __SURFACE_NODE_COLORING_DECLARE__
@@ -849,23 +849,13 @@ void CiftiBrainModelsMap::ParseHelperModel::parseBrainModel2(QXmlStreamReader& x
 
 vector<int64_t> CiftiBrainModelsMap::ParseHelperModel::readIndexArray(QXmlStreamReader& xml)
 {
-    vector<int64_t> ret;
-    QString text = xml.readElementText();//raises error if it encounters a start element
-    if (xml.hasError()) return ret;
-    QStringList separated = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-    int64_t numElems = separated.size();
-    ret.reserve(numElems);
+    vector<int64_t> ret = CiftiMappingType::readIndexArray(xml);
+    int64_t numElems = (int64_t)ret.size();
     for (int64_t i = 0; i < numElems; ++i)
     {
-        bool ok = false;
-        ret.push_back(separated[i].toLongLong(&ok));
-        if (!ok)
+        if (ret[i] < 0)
         {
-            throw CaretException("found noninteger in index array: " + separated[i]);
-        }
-        if (ret.back() < 0)
-        {
-            throw CaretException("found negative integer in index array: " + separated[i]);
+            throw CaretException("found negative integer in index array: " + QString::number(ret[i]));
         }
     }
     return ret;
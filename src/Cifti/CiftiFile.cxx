@@ -30,6 +30,9 @@
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <cmath>
+#include <cstring>
+
 using namespace std;
 using namespace caret;
 
@@ -48,6 +51,7 @@ namespace
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
+        const NiftiHeader& getNiftiHeader() const { return m_nifti.getHeader(); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
@@ -64,6 +68,21 @@ namespace
         void setColumn(const float* dataIn, const int64_t& index);
     };
     
+    //read-only compact storage, each value is stored as an index into a table of at most 65536 floats, so decoding is a lookup
+    template<typename T>
+    class CiftiCompactMemoryImpl : public CiftiFile::ReadImplInterface
+    {
+        MultiDimArray<T> m_array;
+        vector<float> m_values;
+    public:
+        CiftiCompactMemoryImpl(const CiftiXML& xml, const vector<float>& values);
+        T* getCodes(const vector<int64_t>& indexSelect) { return m_array.get(1, indexSelect); }
+        const vector<float>& getValues() const { return m_values; }
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        bool isInMemory() const { return true; }
+    };
+    
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
     {
         CiftiXML m_xml;//because we need to parse it to check the dimensions anyway
@@ -95,12 +114,20 @@ namespace
         return (endian == CiftiFile::ANY);
     }
     
+    //returns NULL if the data should stay as float
+    CaretPointer<CiftiFile::ReadImplInterface> makeCompactImpl(const CiftiFile::ReadImplInterface* from, const CiftiXML& xml, const vector<int64_t>& dims,
+                                                               CiftiFile::RowObserver* observer);
+    
 }
 
 CiftiFile::ReadImplInterface::~ReadImplInterface()
 {
 }
 
+CiftiFile::RowObserver::~RowObserver()
+{
+}
+
 CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
@@ -188,13 +215,23 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
     m_xml.clearMutablesModified();
 }
 
-void CiftiFile::convertToInMemory()
+void CiftiFile::convertToInMemory(const MEMORY_STORAGE& storage, RowObserver* observer)
 {
-    if (isInMemory()) return;
+    if (isInMemory() && (m_writingImpl != NULL || storage != MEMORY_FLOAT32)) return;//compact storage only gets expanded to float when asked for writable storage
     m_writingFile = "";//make sure it doesn't do on-disk when set...() is called
     if (m_readingImpl == NULL) return;//not set up yet
+    if (storage != MEMORY_FLOAT32)
+    {
+        CaretPointer<ReadImplInterface> tempRead = makeCompactImpl(m_readingImpl, m_xml, m_dims, observer);
+        if (tempRead != NULL)
+        {
+            m_writingImpl.grabNew(NULL);//setRow/setColumn will expand it to float
+            m_readingImpl = tempRead;
+            return;
+        }
+    }
     CaretPointer<WriteImplInterface> tempWrite(new CiftiMemoryImpl(m_xml));//if we get an error while reading, free the memory immediately, and don't leave m_readingImpl and m_writingImpl pointing to different things
-    copyImplData(m_readingImpl, tempWrite, m_dims);
+    copyImplData(m_readingImpl, tempWrite, m_dims, observer);
     m_writingImpl = tempWrite;
     m_readingImpl = tempWrite;
 }
@@ -360,13 +397,15 @@ void CiftiFile::verifyWriteImpl()
     m_readingImpl = m_writingImpl;//read-only implementations are set up in specialized functions
 }
 
-void CiftiFile::copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const vector<int64_t>& dims)
+void CiftiFile::copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const vector<int64_t>& dims, RowObserver* observer)
 {
     vector<int64_t> iterateDims(dims.begin() + 1, dims.end());
     vector<float> scratchRow(dims[0]);
+    if (observer != NULL) observer->restart();
     for (MultiDimIterator<int64_t> iter(iterateDims); !iter.atEnd(); ++iter)
     {
         from->getRow(scratchRow.data(), *iter, false);
+        if (observer != NULL) observer->rowRead(scratchRow.data(), dims[0]);
         to->setRow(scratchRow.data(), *iter);
     }
 }
@@ -423,6 +462,117 @@ void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+template<typename T>
+CiftiCompactMemoryImpl<T>::CiftiCompactMemoryImpl(const CiftiXML& xml, const vector<float>& values)
+{
+    CaretAssert(xml.getNumberOfDimensions() != 0);
+    CaretAssert(values.size() == ((size_t)1 << (8 * sizeof(T))));//every possible code must have a value
+    m_array.resize(xml.getDimensions());
+    m_values = values;
+}
+
+template<typename T>
+void CiftiCompactMemoryImpl<T>::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    const T* ref = m_array.get(1, indexSelect);
+    const float* values = m_values.data();
+    int64_t rowSize = m_array.getDimensions()[0];
+    for (int64_t i = 0; i < rowSize; ++i)
+    {
+        dataOut[i] = values[ref[i]];
+    }
+}
+
+template<typename T>
+void CiftiCompactMemoryImpl<T>::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);
+    const T* ref = m_array.get(2, vector<int64_t>());
+    const float* values = m_values.data();
+    int64_t rowSize = m_array.getDimensions()[0];
+    int64_t colSize = m_array.getDimensions()[1];
+    CaretAssert(index >= 0 && index < rowSize);
+    for (int64_t i = 0; i < colSize; ++i)
+    {
+        dataOut[i] = values[ref[index + rowSize * i]];
+    }
+}
+
+namespace
+{
+    //the table holds the same float conversion NiftiIO does, so a value is only stored if it decodes to exactly the float that was read
+    template<typename T>
+    bool encodeScaledRow(const float* dataIn, const int64_t& count, const int64_t& minRaw, const double& mult, const double& offset, const vector<float>& values, T* codesOut)
+    {
+        const double maxCode = (double)(values.size() - 1);
+        for (int64_t i = 0; i < count; ++i)
+        {
+            double code = floor(0.5 + (dataIn[i] - offset) / mult) - minRaw;
+            if (!(code >= 0.0 && code <= maxCode)) return false;//also catches NaN
+            T intCode = (T)code;
+            if (values[intCode] != dataIn[i]) return false;
+            codesOut[i] = intCode;
+        }
+        return true;
+    }
+    
+    template<typename T>
+    CaretPointer<CiftiFile::ReadImplInterface> makeScaledImpl(const CiftiFile::ReadImplInterface* from, const CiftiXML& xml, const vector<int64_t>& dims,
+                                                              const int64_t& minRaw, const double& mult, const double& offset, CiftiFile::RowObserver* observer)
+    {
+        vector<float> values((size_t)1 << (8 * sizeof(T)));
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            values[i] = (float)(offset + mult * (long double)(minRaw + (int64_t)i));//same expression as NiftiIO::convertRead
+        }
+        CaretPointer<CiftiCompactMemoryImpl<T> > ret(new CiftiCompactMemoryImpl<T>(xml, values));
+        vector<int64_t> iterateDims(dims.begin() + 1, dims.end());
+        vector<float> scratchRow(dims[0]);
+        if (observer != NULL) observer->restart();
+        for (MultiDimIterator<int64_t> iter(iterateDims); !iter.atEnd(); ++iter)
+        {
+            from->getRow(scratchRow.data(), *iter, false);
+            if (observer != NULL) observer->rowRead(scratchRow.data(), dims[0]);
+            if (!encodeScaledRow(scratchRow.data(), dims[0], minRaw, mult, offset, ret->getValues(), ret->getCodes(*iter)))
+            {
+                return CaretPointer<CiftiFile::ReadImplInterface>();
+            }
+        }
+        return ret;
+    }
+    
+    CaretPointer<CiftiFile::ReadImplInterface> makeCompactImpl(const CiftiFile::ReadImplInterface* from, const CiftiXML& xml, const vector<int64_t>& dims,
+                                                               CiftiFile::RowObserver* observer)
+    {
+        CaretPointer<CiftiFile::ReadImplInterface> ret;
+        const CiftiOnDiskImpl* diskImpl = dynamic_cast<const CiftiOnDiskImpl*>(from);
+        if (diskImpl != NULL)//only files have a native type, anything else is already float
+        {
+            const NiftiHeader& myHeader = diskImpl->getNiftiHeader();
+            double mult, offset;
+            myHeader.getDataScaling(mult, offset);
+            switch (myHeader.getDataType())
+            {
+                case NIFTI_TYPE_UINT8:
+                    ret = makeScaledImpl<uint8_t>(from, xml, dims, 0, mult, offset, observer);
+                    break;
+                case NIFTI_TYPE_INT8:
+                    ret = makeScaledImpl<uint8_t>(from, xml, dims, -128, mult, offset, observer);
+                    break;
+                case NIFTI_TYPE_UINT16:
+                    ret = makeScaledImpl<uint16_t>(from, xml, dims, 0, mult, offset, observer);
+                    break;
+                case NIFTI_TYPE_INT16:
+                    ret = makeScaledImpl<uint16_t>(from, xml, dims, -32768, mult, offset, observer);
+                    break;
+                default:
+                    break;
+            }
+        }
+        return ret;
+    }
+}
+
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
 {//opens existing file for reading
     m_nifti.openRead(filename);//read-only, so we don't need write permission to read a cifti file
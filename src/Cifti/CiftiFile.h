@@ -44,6 +44,21 @@ namespace caret
             LITTLE,
             BIG
         };
+        
+        enum MEMORY_STORAGE
+        {
+            MEMORY_FLOAT32,//full precision, writable
+            MEMORY_NATIVE_INTEGER//keep 8 or 16 bit integer data as the file's integer type with its scl_slope/scl_inter, only when every value decodes back exactly, otherwise float
+        };
+
+        ///receives each row as convertToInMemory() reads it, so that summaries of the data can be made in the same pass, restart() is called before each pass over the rows
+        class RowObserver
+        {
+        public:
+            virtual void restart() = 0;
+            virtual void rowRead(const float* data, const int64_t& rowSize) = 0;
+            virtual ~RowObserver();
+        };
 
         CiftiFile() { m_endianPref = NATIVE; }
         explicit CiftiFile(const QString &fileName);//calls openFile
@@ -52,7 +67,7 @@ namespace caret
         void openURL(const QString& url);//same, without user/pass (or curently, reusing existing auth if the server matches
         void setWritingFile(const QString& fileName, const CiftiVersion& writingVersion = CiftiVersion(), const ENDIAN& endian = NATIVE);//starts on-disk writing
         void writeFile(const QString& fileName, const CiftiVersion& writingVersion = CiftiVersion(), const ENDIAN& endian = ANY);//leaves current state as-is, rewrites if already writing to that filename and version mismatch
-        void convertToInMemory();
+        void convertToInMemory(const MEMORY_STORAGE& storage = MEMORY_FLOAT32, RowObserver* observer = NULL);//compact storage is read-only, setRow()/setColumn() expand it to float first, observer only sees rows if data is read
         QString getFileName() const { return m_fileName; }
         
         bool isInMemory() const;
@@ -102,7 +117,7 @@ namespace caret
         ENDIAN m_endianPref;
         
         void verifyWriteImpl();
-        static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims);
+        static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims, RowObserver* observer = NULL);
     };
     
 }
@@ -21,8 +21,19 @@
 #include "CiftiMappingType.h"
 
 #include "CaretAssert.h"
+#include "CaretException.h"
 
 using namespace caret;
+using namespace std;
+
+namespace
+{
+    inline bool isIndexSpace(const ushort& c)
+    {//same set as \s in QRegExp, but check the ascii ones without a function call
+        if (c < 128) return c == ' ' || (c >= 9 && c <= 13);
+        return QChar(c).isSpace();
+    }
+}
 
 CiftiMappingType::~CiftiMappingType()
 {//to ensure that the class's vtable gets defined in an object file
@@ -70,3 +81,58 @@ void CiftiMappingType::clearMutablesModified() const
 {
     //nothing
 }
+
+vector<int64_t> CiftiMappingType::readIndexArray(QXmlStreamReader& xml)
+{//hand-written tokenizer, splitting with a regex and converting each piece took a large part of the time to read big mappings
+    vector<int64_t> ret;
+    QString text = xml.readElementText();//raises error if it encounters a start element
+    if (xml.hasError()) return ret;
+    const ushort* data = text.utf16();
+    const int length = text.size();
+    int64_t numElems = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        if (!isIndexSpace(data[i]) && (i == 0 || isIndexSpace(data[i - 1]))) ++numElems;
+    }
+    ret.reserve(numElems);
+    const uint64_t maxValue = (uint64_t)0x7fffffffffffffffLL;
+    int pos = 0;
+    while (pos < length)
+    {
+        if (isIndexSpace(data[pos]))
+        {
+            ++pos;
+            continue;
+        }
+        const int tokenStart = pos;
+        bool negative = false, ok = true;
+        if (data[pos] == '-' || data[pos] == '+')
+        {
+            negative = (data[pos] == '-');
+            ++pos;
+        }
+        if (pos == length || isIndexSpace(data[pos])) ok = false;//sign with no digits
+        uint64_t value = 0;
+        for (; pos < length && !isIndexSpace(data[pos]); ++pos)
+        {
+            if (data[pos] < '0' || data[pos] > '9')
+            {
+                ok = false;
+                continue;//finish the token so the error shows all of it
+            }
+            uint64_t digit = data[pos] - '0';
+            if (value > (maxValue - digit) / 10)
+            {
+                ok = false;
+                continue;
+            }
+            value = value * 10 + digit;
+        }
+        if (!ok)
+        {
+            throw CaretException("found noninteger in index array: " + text.mid(tokenStart, pos - tokenStart));
+        }
+        ret.push_back(negative ? -(int64_t)value : (int64_t)value);
+    }
+    return ret;
+}
@@ -27,6 +27,8 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include <vector>
+
 namespace caret
 {
     class CiftiMappingType
@@ -57,6 +59,7 @@ namespace caret
         virtual ~CiftiMappingType();
         
         static QString mappingTypeToName(const MappingType& type);
+        static std::vector<int64_t> readIndexArray(QXmlStreamReader& xml);//whitespace-separated integers, as in the brain models and parcels mappings
     };
 }
 
@@ -24,23 +24,36 @@
 #include "CaretLogger.h"
 
 #include <QStringList>
-#include <QRegExp>
+
+#include <algorithm>
 
 using namespace std;
 using namespace caret;
 
-void CiftiParcelsMap::addParcel(const CiftiParcelsMap::Parcel& parcel)
+namespace
 {
-    int64_t thisParcel = m_parcels.size();//slight hack: current number of parcels will be this parcel's index
-    for (int64_t i = 0; i < thisParcel; ++i)//also use it as endpoint of looping over existing parcels
+    //sorts the array and fills the set from it, which is linear instead of a tree search per element, returns false on repeated elements
+    template <typename T>
+    bool sortedToSet(vector<T>& array, set<T>& setOut)
     {
-        if (parcel.m_name == m_parcels[i].m_name)
+        sort(array.begin(), array.end());
+        for (size_t i = 1; i < array.size(); ++i)
         {
-            throw CaretException("cannot add parcel with duplicate name '" + parcel.m_name + "'");//NOTE: technically this restriction isn't in the standard, but that was probably an oversight
+            if (!(array[i - 1] < array[i])) return false;
         }
+        setOut.insert(array.begin(), array.end());//sorted input makes this linear
+        return true;
+    }
+}
+
+void CiftiParcelsMap::addParcel(const CiftiParcelsMap::Parcel& parcel)
+{
+    int64_t thisParcel = m_parcels.size();//slight hack: current number of parcels will be this parcel's index
+    if (m_nameLookup.find(parcel.m_name) != m_nameLookup.end())
+    {
+        throw CaretException("cannot add parcel with duplicate name '" + parcel.m_name + "'");//NOTE: technically this restriction isn't in the standard, but that was probably an oversight
     }
     int64_t voxelListSize = (int64_t)parcel.m_voxelIndices.size();
-    CaretCompact3DLookup<int64_t> tempLookup = m_volLookup;//a copy of the lookup should be faster than other methods of checking for overlap and repeat
     if (voxelListSize != 0)
     {
         const int64_t* dims = NULL;
@@ -64,11 +77,10 @@ void CiftiParcelsMap::addParcel(const CiftiParcelsMap::Parcel& parcel)
             {
                 throw CaretException("found invalid index triple in voxel list");
             }
-            if (tempLookup.find(iter->m_ijk) != NULL)
+            if (m_volLookup.find(iter->m_ijk) != NULL)//the voxels are a set, so only other parcels can overlap
             {
                 throw CaretException("parcels may not overlap in voxels");
             }
-            tempLookup.at(iter->m_ijk) = thisParcel;
         }
     }
     for (map<StructureEnum::Enum, set<int64_t> >::const_iterator iter = parcel.m_surfaceNodes.begin(); iter != parcel.m_surfaceNodes.end(); ++iter)
@@ -99,9 +111,9 @@ void CiftiParcelsMap::addParcel(const CiftiParcelsMap::Parcel& parcel)
             }
         }
     }
-    if (voxelListSize != 0)//all error checking done, modify
+    for (set<VoxelIJK>::const_iterator iter = parcel.m_voxelIndices.begin(); iter != parcel.m_voxelIndices.end(); ++iter)//all error checking done, modify
     {
-        m_volLookup = tempLookup;
+        m_volLookup.at(iter->m_ijk) = thisParcel;
     }
     for (map<StructureEnum::Enum, set<int64_t> >::const_iterator iter = parcel.m_surfaceNodes.begin(); iter != parcel.m_surfaceNodes.end(); ++iter)
     {
@@ -115,6 +127,7 @@ void CiftiParcelsMap::addParcel(const CiftiParcelsMap::Parcel& parcel)
         }
     }
     m_parcels.push_back(parcel);
+    m_nameLookup[parcel.m_name] = thisParcel;
 }
 
 void CiftiParcelsMap::addSurface(const int64_t& numberOfNodes, const StructureEnum::Enum& structure)
@@ -135,6 +148,7 @@ void CiftiParcelsMap::clear()
     m_haveVolumeSpace = false;
     m_ignoreVolSpace = false;
     m_parcels.clear();
+    m_nameLookup.clear();
     m_surfInfo.clear();
     m_volLookup.clear();
 }
@@ -203,12 +217,9 @@ int64_t CiftiParcelsMap::getIndexFromNumberOrName(const QString& numberOrName) c
         if (ret < 0 || ret >= getLength()) return -1;//if it is a number, do not try to use it as a name, under any circumstances
         return ret;
     } else {
-        int64_t length = getLength();
-        for (int64_t i = 0; i < length; ++i)
-        {
-            if (numberOrName == m_parcels[i].m_name) return i;
-        }
-        return -1;
+        map<QString, int64_t>::const_iterator iter = m_nameLookup.find(numberOrName);
+        if (iter == m_nameLookup.end()) return -1;
+        return iter->second;
     }
 }
 
@@ -512,14 +523,9 @@ CiftiParcelsMap::Parcel CiftiParcelsMap::readParcel1(QXmlStreamReader& xml)
             set<int64_t>& mySet = ret.m_surfaceNodes[myStructure];
             vector<int64_t> array = readIndexArray(xml);
             if (xml.hasError()) return ret;
-            int64_t arraySize = (int64_t)array.size();
-            for (int64_t i = 0; i < arraySize; ++i)
+            if (!sortedToSet(array, mySet))
             {
-                if (mySet.find(array[i]) != mySet.end())
-                {
-                    throw CaretException("Nodes elements may not reuse indices");
-                }
-                mySet.insert(array[i]);
+                throw CaretException("Nodes elements may not reuse indices");
             }
         } else if (name == "VoxelIndicesIJK") {
             if (haveVoxels)
@@ -533,14 +539,14 @@ CiftiParcelsMap::Parcel CiftiParcelsMap::readParcel1(QXmlStreamReader& xml)
             {
                 throw CaretException("number of indices in VoxelIndicesIJK must be a multiple of 3");
             }
+            vector<VoxelIJK> voxels(arraySize / 3);
             for (int64_t index3 = 0; index3 < arraySize; index3 += 3)
             {
-                VoxelIJK temp(array.data() + index3);
-                if (ret.m_voxelIndices.find(temp) != ret.m_voxelIndices.end())
-                {
-                    throw CaretException("VoxelIndicesIJK elements may not reuse voxels");
-                }
-                ret.m_voxelIndices.insert(temp);
+                voxels[index3 / 3] = VoxelIJK(array.data() + index3);
+            }
+            if (!sortedToSet(voxels, ret.m_voxelIndices))
+            {
+                throw CaretException("VoxelIndicesIJK elements may not reuse voxels");
             }
             haveVoxels = true;
         } else {
@@ -584,14 +590,9 @@ CiftiParcelsMap::Parcel CiftiParcelsMap::readParcel2(QXmlStreamReader& xml)
             set<int64_t>& mySet = ret.m_surfaceNodes[myStructure];
             vector<int64_t> array = readIndexArray(xml);
             if (xml.hasError()) return ret;
-            int64_t arraySize = (int64_t)array.size();
-            for (int64_t i = 0; i < arraySize; ++i)
+            if (!sortedToSet(array, mySet))
             {
-                if (mySet.find(array[i]) != mySet.end())
-                {
-                    throw CaretException("Vertices elements may not reuse indices");
-                }
-                mySet.insert(array[i]);
+                throw CaretException("Vertices elements may not reuse indices");
             }
         } else if (name == "VoxelIndicesIJK") {
             if (haveVoxels)
@@ -605,14 +606,14 @@ CiftiParcelsMap::Parcel CiftiParcelsMap::readParcel2(QXmlStreamReader& xml)
             {
                 throw CaretException("number of indices in VoxelIndicesIJK must be a multiple of 3");
             }
+            vector<VoxelIJK> voxels(arraySize / 3);
             for (int64_t index3 = 0; index3 < arraySize; index3 += 3)
             {
-                VoxelIJK temp(array.data() + index3);
-                if (ret.m_voxelIndices.find(temp) != ret.m_voxelIndices.end())
-                {
-                    throw CaretException("VoxelIndicesIJK elements may not reuse voxels");
-                }
-                ret.m_voxelIndices.insert(temp);
+                voxels[index3 / 3] = VoxelIJK(array.data() + index3);
+            }
+            if (!sortedToSet(voxels, ret.m_voxelIndices))
+            {
+                throw CaretException("VoxelIndicesIJK elements may not reuse voxels");
             }
             haveVoxels = true;
         } else {
@@ -623,26 +624,6 @@ CiftiParcelsMap::Parcel CiftiParcelsMap::readParcel2(QXmlStreamReader& xml)
     return ret;
 }
 
-vector<int64_t> CiftiParcelsMap::readIndexArray(QXmlStreamReader& xml)
-{
-    vector<int64_t> ret;
-    QString text = xml.readElementText();//raises error if it encounters a start element
-    if (xml.hasError()) return ret;
-    QStringList separated = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-    int64_t numElems = separated.size();
-    ret.reserve(numElems);
-    for (int64_t i = 0; i < numElems; ++i)
-    {
-        bool ok = false;
-        ret.push_back(separated[i].toLongLong(&ok));
-        if (!ok)
-        {
-            throw CaretException("found noninteger in index array: " + separated[i]);
-        }
-    }
-    return ret;
-}
-
 void CiftiParcelsMap::writeXML1(QXmlStreamWriter& xml) const
 {
     CaretAssert(!m_ignoreVolSpace);
@@ -76,6 +76,7 @@ namespace caret
         void writeXML2(QXmlStreamWriter& xml) const;
     private:
         std::vector<Parcel> m_parcels;
+        std::map<QString, int64_t> m_nameLookup;//parcel names are unique, so adding and finding parcels by name doesn't search the whole list
         VolumeSpace m_volSpace;
         bool m_haveVolumeSpace, m_ignoreVolSpace;//second is needed for parsing cifti-1
         struct SurfaceInfo
@@ -87,7 +88,6 @@ namespace caret
         std::map<StructureEnum::Enum, SurfaceInfo> m_surfInfo;
         static Parcel readParcel1(QXmlStreamReader& xml);
         static Parcel readParcel2(QXmlStreamReader& xml);
-        static std::vector<int64_t> readIndexArray(QXmlStreamReader& xml);
     };
 }
 
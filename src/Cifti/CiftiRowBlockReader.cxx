@@ -0,0 +1,149 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowBlockReader.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace caret;
+
+CiftiRowBlockReader::CiftiRowBlockReader(const vector<const CiftiFile*>& files, const int64_t& maxBufferBytes) : m_files(files), m_thread(this)
+{
+    m_numRows = 0;
+    m_rowsPerBlock = 1;
+    m_current.m_start = 0;
+    m_current.m_count = 0;
+    m_next.m_start = 0;
+    m_next.m_count = 0;
+    int numFiles = (int)m_files.size();
+    if (numFiles == 0) return;
+    int64_t bytesPerRow = 0;
+    for (int i = 0; i < numFiles; ++i)
+    {
+        CaretAssert(m_files[i] != NULL);
+        const vector<int64_t>& dims = m_files[i]->getDimensions();
+        if (dims.size() != 2)
+        {
+            throw DataFileException(m_files[i]->getFileName(), "multi-file row reading only supports 2D cifti files");
+        }
+        if (i == 0)
+        {
+            m_numRows = dims[1];
+        } else if (dims[1] != m_numRows) {
+            throw DataFileException(m_files[i]->getFileName(), "file has a different number of rows than '" + m_files[0]->getFileName() + "'");
+        }
+        m_rowLengths.push_back(dims[0]);
+        bytesPerRow += dims[0] * sizeof(float);
+    }
+    m_rowsPerBlock = max((int64_t)1, maxBufferBytes / max((int64_t)1, 2 * bytesPerRow));//two blocks are in memory at once
+    m_rowsPerBlock = min(m_rowsPerBlock, max(m_numRows, (int64_t)1));
+    m_current.m_fileData.resize(numFiles);
+    m_next.m_fileData.resize(numFiles);
+    for (int i = 0; i < numFiles; ++i)
+    {
+        m_current.m_fileData[i].resize(m_rowLengths[i] * m_rowsPerBlock);
+        m_next.m_fileData[i].resize(m_rowLengths[i] * m_rowsPerBlock);
+    }
+    startNextBlock(0);
+}
+
+CiftiRowBlockReader::~CiftiRowBlockReader()
+{
+    m_thread.wait();//don't let it write into freed buffers, errors no longer matter
+}
+
+void CiftiRowBlockReader::startNextBlock(const int64_t& start)
+{
+    m_next.m_start = start;
+    m_next.m_count = max((int64_t)0, min(m_rowsPerBlock, m_numRows - start));
+    if (m_next.m_count > 0)
+    {
+        m_thread.start();
+    }
+}
+
+void CiftiRowBlockReader::readBlock(Block& block)
+{
+    int numFiles = (int)m_files.size();
+    QString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int i = 0; i < numFiles; ++i)
+    {
+        try
+        {
+            float* rowPtr = block.m_fileData[i].data();
+            for (int64_t row = 0; row < block.m_count; ++row)
+            {
+                m_files[i]->getRow(rowPtr + row * m_rowLengths[i], block.m_start + row);
+            }
+        } catch (CaretException& e) {
+#pragma omp critical
+            {
+                if (errorMessage.isEmpty()) errorMessage = e.whatString();
+            }
+        } catch (std::exception& e) {
+#pragma omp critical
+            {
+                if (errorMessage.isEmpty()) errorMessage = e.what();
+            }
+        }
+    }
+    m_errorMessage = errorMessage;
+}
+
+bool CiftiRowBlockReader::readNextBlock()
+{
+    int64_t nextStart = m_current.m_start + m_current.m_count;
+    if (nextStart >= m_numRows)
+    {
+        m_current.m_start = m_numRows;
+        m_current.m_count = 0;
+        return false;
+    }
+    CaretAssert(m_next.m_start == nextStart);
+    m_thread.wait();
+    if (!m_errorMessage.isEmpty())
+    {
+        QString message = m_errorMessage;
+        m_errorMessage = "";
+        m_current.m_count = 0;
+        m_next.m_count = 0;
+        throw DataFileException(message);
+    }
+    m_current.m_start = m_next.m_start;
+    m_current.m_count = m_next.m_count;
+    m_current.m_fileData.swap(m_next.m_fileData);
+    startNextBlock(m_current.m_start + m_current.m_count);
+    return true;
+}
+
+const float* CiftiRowBlockReader::getRow(const int& whichFile, const int64_t& rowInBlock) const
+{
+    CaretAssertVectorIndex(m_files, whichFile);
+    CaretAssert(rowInBlock >= 0 && rowInBlock < m_current.m_count);
+    return m_current.m_fileData[whichFile].data() + rowInBlock * m_rowLengths[whichFile];
+}
@@ -0,0 +1,83 @@
+#ifndef __CIFTI_ROW_BLOCK_READER_H__
+#define __CIFTI_ROW_BLOCK_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+#include <QString>
+#include <QThread>
+
+#include <vector>
+
+namespace caret
+{
+    
+    class CiftiFile;
+    
+    //reads the same rows from many 2D cifti files with the same number of rows, for operations that combine inputs row by row
+    //each block of consecutive rows is read from all files concurrently (one file per thread, rows in order within a file, so each file
+    //sees sequential reads), and the next block is read on a background thread while the caller processes the current one
+    //
+    //NOTE: the files must not be used for anything else while this object exists, and blocks must be consumed in order
+    class CiftiRowBlockReader
+    {
+    public:
+        CiftiRowBlockReader(const std::vector<const CiftiFile*>& files, const int64_t& maxBufferBytes = ((int64_t)256) << 20);
+        ~CiftiRowBlockReader();
+        
+        //waits for the next block and starts reading the one after it, returns false when there are no more rows
+        bool readNextBlock();
+        int64_t getBlockStart() const { return m_current.m_start; }
+        int64_t getBlockRowCount() const { return m_current.m_count; }
+        int64_t getRowsPerBlock() const { return m_rowsPerBlock; }
+        //rowInBlock is relative to getBlockStart()
+        const float* getRow(const int& whichFile, const int64_t& rowInBlock) const;
+    private:
+        struct Block
+        {
+            int64_t m_start, m_count;
+            std::vector<std::vector<float> > m_fileData;//one array of rows per file
+        };
+        class ReadThread : public QThread
+        {
+        public:
+            ReadThread(CiftiRowBlockReader* reader) : m_reader(reader) { }
+            void run() { m_reader->readBlock(m_reader->m_next); }
+        private:
+            CiftiRowBlockReader* m_reader;
+        };
+        CiftiRowBlockReader(const CiftiRowBlockReader&);
+        CiftiRowBlockReader& operator=(const CiftiRowBlockReader&);
+        void readBlock(Block& block);
+        void startNextBlock(const int64_t& start);
+        
+        std::vector<const CiftiFile*> m_files;
+        std::vector<int64_t> m_rowLengths;
+        int64_t m_numRows, m_rowsPerBlock;
+        Block m_current, m_next;
+        ReadThread m_thread;
+        QString m_errorMessage;//set only by the read thread, checked after waiting on it
+    };
+    
+}
+
+#endif //__CIFTI_ROW_BLOCK_READER_H__
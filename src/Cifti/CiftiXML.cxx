@@ -23,11 +23,14 @@
 #include "CaretAssert.h"
 #include "CaretException.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "GiftiMetaData.h"
 #include "PaletteColorMapping.h"
 
+#include <QCryptographicHash>
 #include <QStringList>
 
+#include <map>
 #include <set>
 
 using namespace std;
@@ -121,6 +124,10 @@ const CiftiMappingType* CiftiXML::getMap(const int& direction) const
 CiftiMappingType* CiftiXML::getMap(const int& direction)
 {
     CaretAssertVectorIndex(m_indexMaps, direction);
+    if (m_indexMaps[direction] != NULL && m_indexMaps[direction].getReferenceCount() > 1)
+    {//parsed mappings may be shared with other files through the mapping cache, so make our own copy before allowing modification
+        m_indexMaps[direction] = CaretPointer<CiftiMappingType>(m_indexMaps[direction]->clone());
+    }
     return m_indexMaps[direction];
 }
 
@@ -274,7 +281,7 @@ void CiftiXML::clear()
 void CiftiXML::readXML(const QString& text)
 {
     QXmlStreamReader xml(text);
-    readXML(xml);
+    readXML(xml, &text);
 }
 
 void CiftiXML::readXML(const QByteArray& data)
@@ -332,6 +339,11 @@ int32_t CiftiXML::getIntentInfo(const CiftiVersion& writingVersion, char intentN
 }
 
 void CiftiXML::readXML(QXmlStreamReader& xml)
+{
+    readXML(xml, NULL);
+}
+
+void CiftiXML::readXML(QXmlStreamReader& xml, const QString* text)
 {
     clear();
     try
@@ -361,10 +373,10 @@ void CiftiXML::readXML(QXmlStreamReader& xml)
                         if (xml.hasError()) break;
                     } else if (m_parsedVersion == CiftiVersion(1, 1)) {
                         CaretLogWarning("parsing cifti version '1.1', this should not exist in the wild");
-                        parseCIFTI2(xml);//we used "1.1" to test our cifti-2 implementation
+                        parseCIFTI2(xml, text);//we used "1.1" to test our cifti-2 implementation
                         if (xml.hasError()) break;
                     } else if (m_parsedVersion == CiftiVersion(2, 0)) {
-                        parseCIFTI2(xml);
+                        parseCIFTI2(xml, text);
                         if (xml.hasError()) break;
                     } else {
                         throw CaretException("unknown Cifti Version: '" + m_parsedVersion.toString());
@@ -431,7 +443,7 @@ void CiftiXML::parseCIFTI1(QXmlStreamReader& xml)
     CaretAssert(xml.isEndElement() && xml.name() == "CIFTI");
 }
 
-void CiftiXML::parseCIFTI2(QXmlStreamReader& xml)//yes, these will often have largely similar code, but it seems cleaner than having only some functions split, or constantly rechecking the version
+void CiftiXML::parseCIFTI2(QXmlStreamReader& xml, const QString* text)//yes, these will often have largely similar code, but it seems cleaner than having only some functions split, or constantly rechecking the version
 {//also, helps keep changes to cifti-2 away from code that parses cifti-1
     bool haveMatrix = false;
     while (!xml.atEnd())
@@ -447,7 +459,7 @@ void CiftiXML::parseCIFTI2(QXmlStreamReader& xml)//yes, these will often have la
                 {
                     throw CaretException("Matrix element may only be specified once");
                 }
-                parseMatrix2(xml);
+                parseMatrix2(xml, text);
                 if (xml.hasError()) return;
                 haveMatrix = true;
             } else {
@@ -550,7 +562,7 @@ void CiftiXML::parseMatrix1(QXmlStreamReader& xml)
     CaretAssert(xml.isEndElement() && xml.name() == "Matrix");
 }
 
-void CiftiXML::parseMatrix2(QXmlStreamReader& xml)
+void CiftiXML::parseMatrix2(QXmlStreamReader& xml, const QString* text)
 {
     bool haveMetadata = false;
     while (!xml.atEnd())
@@ -570,7 +582,7 @@ void CiftiXML::parseMatrix2(QXmlStreamReader& xml)
                 if (xml.hasError()) return;
                 haveMetadata = true;
             } else if (name == "MatrixIndicesMap") {
-                parseMatrixIndicesMap2(xml);
+                parseMatrixIndicesMap2(xml, text);
                 if (xml.hasError()) return;
             } else {
                 throw CaretException("unexpected element in Matrix: " + name.toString());
@@ -650,7 +662,71 @@ void CiftiXML::parseMatrixIndicesMap1(QXmlStreamReader& xml)
     CaretAssert(xml.isEndElement() && xml.name() == "MatrixIndicesMap");
 }
 
-void CiftiXML::parseMatrixIndicesMap2(QXmlStreamReader& xml)
+namespace
+{//process-wide cache of parsed brain models and parcels mappings, keyed by a hash of their XML text
+    //many files use identical mappings (for instance, the standard grayordinates), so this parses them once and shares them
+    //only used for cifti-2, because cifti-1 sets the volume space on the mappings after parsing them
+    const int MAX_SHARED_MAPPINGS = 16;
+    CaretMutex sharedMappingMutex;
+    map<QByteArray, CaretPointer<CiftiMappingType> > sharedMappings;
+    
+    CaretPointer<CiftiMappingType> readSharedMapping2(QXmlStreamReader& xml, const QString* text, CaretPointer<CiftiMappingType> toRead)
+    {
+        const QString endTag = "</MatrixIndicesMap";
+        CiftiMappingType::MappingType type = toRead->getType();
+        QByteArray key;
+        int elementEnd = -1;
+        if (text != NULL && (type == CiftiMappingType::BRAIN_MODELS || type == CiftiMappingType::PARCELS))
+        {
+            int elementStart = (int)xml.characterOffset();//just after the start tag
+            elementEnd = text->indexOf(endTag, elementStart);//elements can't nest, so the first closing tag is ours, unless it is hiding in a comment, which the check after parsing catches
+            if (elementEnd != -1)
+            {
+                QCryptographicHash hasher(QCryptographicHash::Sha1);
+                QXmlStreamAttributes attributes = xml.attributes();
+                for (int i = 0; i < attributes.size(); ++i)
+                {
+                    if (attributes[i].name() == "AppliesToMatrixDimension") continue;//not part of the mapping
+                    QString attrText = attributes[i].name().toString() + "=" + attributes[i].value().toString() + "\n";
+                    hasher.addData(reinterpret_cast<const char*>(attrText.constData()), attrText.size() * sizeof(QChar));
+                }
+                hasher.addData(reinterpret_cast<const char*>(text->constData() + elementStart), (elementEnd - elementStart) * sizeof(QChar));
+                key = hasher.result();
+                CaretMutexLocker locked(&sharedMappingMutex);
+                map<QByteArray, CaretPointer<CiftiMappingType> >::iterator iter = sharedMappings.find(key);
+                if (iter != sharedMappings.end())
+                {
+                    xml.skipCurrentElement();//identical text parses identically, so the end tag we found is the real one
+                    CaretAssert(xml.hasError() || text->lastIndexOf(endTag, (int)xml.characterOffset() - 1) == elementEnd);
+                    return iter->second;
+                }
+            }
+        }
+        toRead->readXML2(xml);
+        if (!key.isEmpty() && !xml.hasError() && text->lastIndexOf(endTag, (int)xml.characterOffset() - 1) == elementEnd)
+        {
+            CaretMutexLocker locked(&sharedMappingMutex);
+            if ((int)sharedMappings.size() >= MAX_SHARED_MAPPINGS)
+            {//drop mappings no file is using anymore, or everything if that isn't enough
+                map<QByteArray, CaretPointer<CiftiMappingType> >::iterator iter = sharedMappings.begin();
+                while (iter != sharedMappings.end())
+                {
+                    if (iter->second.getReferenceCount() == 1)
+                    {
+                        sharedMappings.erase(iter++);
+                    } else {
+                        ++iter;
+                    }
+                }
+                if ((int)sharedMappings.size() >= MAX_SHARED_MAPPINGS) sharedMappings.clear();
+            }
+            sharedMappings[key] = toRead;
+        }
+        return toRead;
+    }
+}
+
+void CiftiXML::parseMatrixIndicesMap2(QXmlStreamReader& xml, const QString* text)
 {
     QXmlStreamAttributes attributes = xml.attributes();
     if (!attributes.hasAttribute("AppliesToMatrixDimension"))
@@ -693,7 +769,7 @@ void CiftiXML::parseMatrixIndicesMap2(QXmlStreamReader& xml)
     } else {
         throw CaretException("invalid value for IndicesMapToDataType in CIFTI-1: " + type.toString());
     }
-    toRead->readXML2(xml);
+    toRead = readSharedMapping2(xml, text, toRead);
     if (xml.hasError()) return;
     bool first = true;
     for (set<int>::iterator iter = used.begin(); iter != used.end(); ++iter)
@@ -107,12 +107,13 @@ namespace caret
         
         void copyHelper(const CiftiXML& rhs);
         //parsing functions
+        void readXML(QXmlStreamReader& xml, const QString* text);//text is what the reader is reading, if known, for the shared mapping cache
         void parseCIFTI1(QXmlStreamReader& xml);
         void parseMatrix1(QXmlStreamReader& xml);
-        void parseCIFTI2(QXmlStreamReader& xml);
-        void parseMatrix2(QXmlStreamReader& xml);
+        void parseCIFTI2(QXmlStreamReader& xml, const QString* text);
+        void parseMatrix2(QXmlStreamReader& xml, const QString* text);
         void parseMatrixIndicesMap1(QXmlStreamReader& xml);
-        void parseMatrixIndicesMap2(QXmlStreamReader& xml);
+        void parseMatrixIndicesMap2(QXmlStreamReader& xml, const QString* text);
         //writing functions
         void writeMatrix1(QXmlStreamWriter& xml) const;
         void writeMatrix2(QXmlStreamWriter& xml) const;
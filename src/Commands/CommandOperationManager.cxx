@@ -237,7 +237,9 @@
 #include "ProgramParameters.h"
 
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "dot_wrapper.h"
+#include "EventManager.h"
 #include "StructureEnum.h"
 
 #include <iostream>
@@ -245,6 +247,37 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //write the profile on the way out of runCommand, so a failing command still reports where its time went
+    class ProfileOutputGuard
+    {
+        AString m_fileName;
+    public:
+        ProfileOutputGuard(const AString& fileName) : m_fileName(fileName) { }
+        ~ProfileOutputGuard()
+        {
+            if (m_fileName.isEmpty()) return;
+            const EventManager* myEventManager = EventManager::get();
+            for (int i = 0; i < EventTypeEnum::EVENT_COUNT; ++i)
+            {//only event types that were sent, so the summary stays short
+                const EventTypeEnum::Enum eventType = static_cast<EventTypeEnum::Enum>(i);
+                const int64_t count = myEventManager->getEventDispatchCounter(eventType);
+                if (count == 0) continue;
+                const AString eventName = EventTypeEnum::toName(eventType);
+                CaretProfiler::setOtherData("event_count_" + eventName, count);
+                CaretProfiler::setOtherData("event_seconds_" + eventName, myEventManager->getEventDispatchTimeSeconds(eventType));
+            }
+            try
+            {
+                CaretProfiler::writeChromeTrace(m_fileName);
+            } catch (CaretException& e) {
+                CaretLogWarning("failed to write profile output: " + e.whatString());
+            }
+        }
+    };
+}
+
 /**
  * Get the command operation manager.
  *
@@ -540,6 +573,16 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
     }
+    AString profileFileName;
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        profileFileName = globalOptionArgs[0];
+        if (profileFileName.isEmpty()) throw CommandException("profile output file name must not be empty");
+        CaretProfiler::enable();
+        EventManager::get()->resetEventDispatchStatistics();
+        EventManager::get()->setEventDispatchTimingEnabled(true);
+    }
+    ProfileOutputGuard profileGuard(profileFileName);
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -641,7 +684,12 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    OptionInfo profileInfo = parseGlobalOption(parameters, "-profile", 1, globalOptionArgs, true);
+    if (profileInfo.specified && !profileInfo.complete)
+    {//output filename, no particular extension is required
+        return "fileglob *.json";
+    }
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -profile";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -922,6 +970,12 @@ void CommandOperationManager::printHelpInfo()
         cout << "         " << DotSIMDEnum::toName(*iter) << endl;
     }
     cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -profile <file>             write a Chrome trace format (JSON) timing profile" << endl;
+    cout << "                                  of the command, its algorithms and" << endl;
+    cout << "                                  sub-algorithms, and file reads/writes, with" << endl;
+    cout << "                                  byte counts and peak memory usage" << endl;
+    cout << endl;
     cout << "To get the help information of a processing subcommand, run it without any" << endl;
     cout << "   additional arguments." << endl;
     cout << endl;
@@ -27,6 +27,7 @@
 #include "CaretCommandLine.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "CiftiFile.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
@@ -64,6 +65,7 @@ void CommandParser::disableProvenance()
 
 void CommandParser::executeOperation(ProgramParameters& parameters)
 {
+    CaretProfileScope commandScope(getCommandLineSwitch(), "command");//includes reading inputs and writing outputs
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
     vector<OutputAssoc> myOutAssoc;
     m_provenance = caret_global_commandLine;
@@ -147,6 +149,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::BORDER:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<BorderFile> myFile(new BorderFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -171,6 +174,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::CIFTI:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     FileInformation myInfo(nextArg);
                     CaretPointer<CiftiFile> myFile(new CiftiFile());
                     myFile->openFile(nextArg);
@@ -211,6 +215,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::FOCI:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<FociFile> myFile(new FociFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -246,6 +251,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::LABEL:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<LabelFile> myFile(new LabelFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -270,6 +276,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::METRIC:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<MetricFile> myFile(new MetricFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -304,6 +311,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::SURFACE:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<SurfaceFile> myFile(new SurfaceFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -328,6 +336,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::VOLUME:
                 {
+                    CaretProfileScope readScope("read " + nextArg, "io");
                     CaretPointer<VolumeFile> myFile(new VolumeFile());
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
@@ -967,12 +976,14 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
             case OperationParametersEnum::BORDER:
             {
                 BorderFile* myFile = ((BorderParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::CIFTI:
             {
                 CiftiFile* myFile = ((CiftiParameter*)myParam)->m_parameter;//we can't set metadata here because the XML is already on disk, see provenanceForOnDiskOutputs
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);//this is basically a noop unless outputs and inputs collide, we opened ON_DISK and set cache file to this name back in makeOnDiskOutputs
                 break;
             }
@@ -985,18 +996,21 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
             case OperationParametersEnum::FOCI:
             {
                 FociFile* myFile = ((FociParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::LABEL:
             {
                 LabelFile* myFile = ((LabelParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::METRIC:
             {
                 MetricFile* myFile = ((MetricParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
@@ -1006,12 +1020,14 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
             case OperationParametersEnum::SURFACE:
             {
                 SurfaceFile* myFile = ((SurfaceParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::VOLUME:
             {
                 VolumeFile* myFile = ((VolumeParameter*)myParam)->m_parameter;
+                CaretProfileScope writeScope("write " + outAssociation[i].m_fileName, "io");
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
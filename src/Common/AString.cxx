@@ -26,6 +26,192 @@
 
 using namespace caret;
 
+namespace {
+    inline bool isNumberSeparator(const QChar& c)
+    {
+        const ushort u = c.unicode();
+        if (u < 128) {
+            return ((u == ' ')
+                    || ((u >= '\t') && (u <= '\r')));
+        }
+        return c.isSpace();
+    }
+    
+    /*
+     * Convert a token with the same result as QString::toInt(),
+     * without creating a string.
+     */
+    bool tokenToNumber(const QChar* start,
+                       const QChar* end,
+                       int32_t& valueOut)
+    {
+        const QChar* p = start;
+        bool negative = false;
+        if ((p < end)
+            && ((p->unicode() == '-') || (p->unicode() == '+'))) {
+            negative = (p->unicode() == '-');
+            p++;
+        }
+        if (p == end) {
+            return false;
+        }
+        const int64_t limit = (negative
+                               ? (int64_t)2147483648LL
+                               : (int64_t)2147483647LL);
+        int64_t value = 0;
+        for ( ; p < end; p++) {
+            const ushort u = p->unicode();
+            if ((u < '0') || (u > '9')) {
+                return false;
+            }
+            value = value * 10 + (u - '0');
+            if (value > limit) {
+                return false;
+            }
+        }
+        valueOut = static_cast<int32_t>(negative ? -value : value);
+        return true;
+    }
+    
+    /*
+     * Convert a token with the same result as QString::toFloat().  Decimal
+     * numbers with at most 15 significant digits and small exponents are
+     * converted exactly by a multiplication or division of two exactly
+     * representable doubles (so the double is correctly rounded, the same
+     * as Qt's conversion).  Anything else is converted by QString.
+     */
+    bool tokenToNumber(const QChar* start,
+                       const QChar* end,
+                       float& valueOut)
+    {
+        static const double powersOfTen[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        const int maximumSignificantDigits = 15;
+        
+        const QChar* p = start;
+        bool negative = false;
+        if ((p < end)
+            && ((p->unicode() == '-') || (p->unicode() == '+'))) {
+            negative = (p->unicode() == '-');
+            p++;
+        }
+        
+        int64_t mantissa = 0;
+        int numberOfSignificantDigits = 0;
+        int numberOfDigits = 0;
+        int exponent = 0;
+        bool fastPath = true;
+        for ( ; (p < end) && (p->unicode() >= '0') && (p->unicode() <= '9'); p++) {
+            numberOfDigits++;
+            if ((mantissa > 0) || (p->unicode() != '0')) {
+                if (numberOfSignificantDigits < maximumSignificantDigits) {
+                    mantissa = mantissa * 10 + (p->unicode() - '0');
+                    numberOfSignificantDigits++;
+                }
+                else {
+                    fastPath = false;
+                }
+            }
+        }
+        if ((p < end) && (p->unicode() == '.')) {
+            p++;
+            for ( ; (p < end) && (p->unicode() >= '0') && (p->unicode() <= '9'); p++) {
+                numberOfDigits++;
+                if ((mantissa > 0) || (p->unicode() != '0')) {
+                    if (numberOfSignificantDigits < maximumSignificantDigits) {
+                        mantissa = mantissa * 10 + (p->unicode() - '0');
+                        numberOfSignificantDigits++;
+                    }
+                    else {
+                        fastPath = false;
+                    }
+                }
+                exponent--;
+            }
+        }
+        if (numberOfDigits == 0) {
+            fastPath = false;
+        }
+        if (fastPath
+            && (p < end)
+            && ((p->unicode() == 'e') || (p->unicode() == 'E'))) {
+            p++;
+            bool negativeExponent = false;
+            if ((p < end)
+                && ((p->unicode() == '-') || (p->unicode() == '+'))) {
+                negativeExponent = (p->unicode() == '-');
+                p++;
+            }
+            if (p == end) {
+                fastPath = false;
+            }
+            int explicitExponent = 0;
+            for ( ; (p < end) && (p->unicode() >= '0') && (p->unicode() <= '9'); p++) {
+                if (explicitExponent < 1000) {
+                    explicitExponent = explicitExponent * 10 + (p->unicode() - '0');
+                }
+            }
+            exponent += (negativeExponent ? -explicitExponent : explicitExponent);
+        }
+        if (p != end) {
+            fastPath = false;
+        }
+        
+        if (fastPath) {
+            if (mantissa == 0) {
+                valueOut = (negative ? -0.0f : 0.0f);
+                return true;
+            }
+            if ((exponent >= -22)
+                && (exponent <= 22)) {
+                double value = static_cast<double>(mantissa);
+                if (exponent >= 0) {
+                    value *= powersOfTen[exponent];
+                }
+                else {
+                    value /= powersOfTen[-exponent];
+                }
+                valueOut = static_cast<float>(negative ? -value : value);
+                return true;
+            }
+        }
+        
+        bool valid = false;
+        valueOut = QString(start, static_cast<int>(end - start)).toFloat(&valid);
+        return valid;
+    }
+    
+    template <typename T>
+    bool textToNumbers(const QChar* text,
+                       const int64_t length,
+                       std::vector<T>& numbersOut)
+    {
+        numbersOut.clear();
+        const QChar* end = text + length;
+        const QChar* p = text;
+        while (p < end) {
+            while ((p < end) && isNumberSeparator(*p)) {
+                p++;
+            }
+            if (p == end) {
+                break;
+            }
+            const QChar* tokenStart = p;
+            while ((p < end) && ( ! isNumberSeparator(*p))) {
+                p++;
+            }
+            T value;
+            if ( ! tokenToNumber(tokenStart, p, value)) {
+                return false;
+            }
+            numbersOut.push_back(value);
+        }
+        return true;
+    }
+}
+
 std::ostream& operator << (std::ostream &lhs, const AString &rhs) 
 { 
     return lhs << rhs.toStdString(); 
@@ -378,6 +564,50 @@ AString::fromNumbers(const double* array,
     return s;
 }
 
+/**
+ * Convert text containing numbers separated by whitespace to floats.
+ * Unlike toNumbers(), the text is not copied and no text stream is
+ * created, so this is suitable for large arrays of numbers in files.
+ *
+ * @param text
+ *     Text containing the numbers.
+ * @param length
+ *     Number of characters in the text.
+ * @param numbersOut
+ *    Vector that will contain the numbers.
+ * @return
+ *    True if every piece of text is a valid number, else false.
+ */
+bool
+AString::toNumbersSeparatedByWhitespace(const QChar* text,
+                                        const int64_t length,
+                                        std::vector<float>& numbersOut)
+{
+    return textToNumbers(text, length, numbersOut);
+}
+
+/**
+ * Convert text containing numbers separated by whitespace to integers.
+ * Unlike toNumbers(), the text is not copied and no text stream is
+ * created, so this is suitable for large arrays of numbers in files.
+ *
+ * @param text
+ *     Text containing the numbers.
+ * @param length
+ *     Number of characters in the text.
+ * @param numbersOut
+ *    Vector that will contain the numbers.
+ * @return
+ *    True if every piece of text is a valid integer, else false.
+ */
+bool
+AString::toNumbersSeparatedByWhitespace(const QChar* text,
+                                        const int64_t length,
+                                        std::vector<int32_t>& numbersOut)
+{
+    return textToNumbers(text, length, numbersOut);
+}
+
 /**
  * Convert the contents of given string to floats.  Each 
  * piece of text is converted to float.  If a piece of 
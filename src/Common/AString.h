@@ -109,6 +109,13 @@ namespace caret {
         static void toNumbers(const AString& s,
                               std::vector<int32_t>& numbersOut);
         
+        static bool toNumbersSeparatedByWhitespace(const QChar* text,
+                                                   const int64_t length,
+                                                   std::vector<float>& numbersOut);
+        static bool toNumbersSeparatedByWhitespace(const QChar* text,
+                                                   const int64_t length,
+                                                   std::vector<int32_t>& numbersOut);
+        
         bool toBool() const;
                 
         //I may move these outside the class since they don't require access to the class's internals
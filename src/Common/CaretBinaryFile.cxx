@@ -28,6 +28,7 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "DataFileException.h"
 
 #include <QFile>
@@ -132,6 +133,7 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForRead()) throw DataFileException("file is not open for reading");
     m_impl->read(dataOut, count, numRead);
+    if (CaretProfiler::isEnabled()) CaretProfiler::addBytesRead(numRead == NULL ? count : *numRead);
 }
 
 void CaretBinaryFile::seek(const int64_t& position)
@@ -152,6 +154,7 @@ void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
     m_impl->write(dataIn, count);
+    if (CaretProfiler::isEnabled()) CaretProfiler::addBytesWritten(count);
 }
 
 #ifdef ZLIB_VERSION
@@ -34,5 +34,27 @@
 #define __CARET_FUNCTION_NAME__  __PRETTY_FUNCTION__
 #endif
 
+/**
+ * \def __CARET_CALLING_FUNCTION_NAME__
+ *
+ * When used as a default argument, the unadorned
+ * name of the function making the call (for a
+ * base class constructor, the derived constructor).
+ * Falls back to an empty string on compilers
+ * without __builtin_FUNCTION.
+ */
+#if defined(__clang__)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_FUNCTION)
+#define __CARET_CALLING_FUNCTION_NAME__  __builtin_FUNCTION()
+#endif
+#endif
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+#define __CARET_CALLING_FUNCTION_NAME__  __builtin_FUNCTION()
+#endif
+#ifndef __CARET_CALLING_FUNCTION_NAME__
+#define __CARET_CALLING_FUNCTION_NAME__  ""
+#endif
+
 
 #endif  //__CARET_FUNCTION_NAME_H__
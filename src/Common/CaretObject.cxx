@@ -25,10 +25,19 @@
 #include "CaretObject.h"
 #undef __CARET_OBJECT_DECLARE_H__
 
+#include "CaretMutex.h"
 #include "SystemUtilities.h"
 
 using namespace caret;
 
+#ifndef NDEBUG
+namespace
+{
+    //objects may be created and deleted by several threads at once
+    CaretMutex allocatedObjectsMutex;
+}
+#endif
+
 /**
  * Constructor.
  *
@@ -58,6 +67,7 @@ CaretObject::~CaretObject()
      * Erase returns the number of objects deleted.
      * If zero, then the object has already been deleted.
      */
+    CaretMutexLocker locked(&allocatedObjectsMutex);
     uint64_t numDeleted = CaretObject::allocatedObjects.erase(this);
     if (numDeleted <= 0) {
         std::cerr << "Destructor for a CaretObject called but the object is not allocated "
@@ -81,6 +91,7 @@ CaretObject::initializeMembersCaretObject()
 #ifndef NDEBUG
     SystemBacktrace myBacktrace;
     SystemUtilities::getBackTrace(myBacktrace);
+    CaretMutexLocker locked(&allocatedObjectsMutex);
     CaretObject::allocatedObjects.insert(
                std::make_pair(this,
                               myBacktrace));
@@ -129,6 +140,7 @@ CaretObject::printListOfObjectsNotDeleted(const bool showCallStack)
 #ifndef NDEBUG
     int count = 0;
     
+    CaretMutexLocker locked(&allocatedObjectsMutex);
     if (CaretObject::allocatedObjects.empty() == false) {
         std::cout << "These Caret Objects were not deleted:" << std::endl;
         for (CARET_OBJECT_TRACKER_MAP_ITERATOR iter = CaretObject::allocatedObjects.begin();
@@ -19,55 +19,91 @@
 /*LICENSE_END*/
 
 #include "CaretPointLocator.h"
-#include "CaretHeap.h"
+
+#include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
 
-void CaretPointLocator::addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet)
+namespace
 {
-    if (thisOct->m_leaf)
+    struct PointAxisLess
     {
-        thisOct->m_data.m_vector->push_back(Point(point, index, pointSet));
-        int curSize = (int)thisOct->m_data.m_vector->size();
-        if (curSize > NUM_POINTS_SPLIT)
-        {//test that not all points are the same, or that they have some minimum percentage spread, or...
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            Vector3D minBox = myVecRef[0].m_point, maxBox = myVecRef[0].m_point, tempvec;
-            tempvec[0] = thisOct->m_bounds[0][2] - thisOct->m_bounds[0][0];
-            tempvec[1] = thisOct->m_bounds[1][2] - thisOct->m_bounds[1][0];
-            tempvec[2] = thisOct->m_bounds[2][2] - thisOct->m_bounds[2][0];
-            float diagonal = tempvec.length();
-            bool safeToSplit = false;
-            for (int i = 1; i < curSize; ++i)
-            {//this will slow down if lots of stuff is continuously put in an Oct that is far too big - use random sampling?
-                if (myVecRef[i].m_point[0] < minBox[0]) minBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] < minBox[1]) minBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] < minBox[2]) minBox[2] = myVecRef[i].m_point[2];
-                if (myVecRef[i].m_point[0] > maxBox[0]) maxBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] > maxBox[1]) maxBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] > maxBox[2]) maxBox[2] = myVecRef[i].m_point[2];
-                tempvec = minBox - maxBox;
-                if (tempvec.length() > 0.01f * diagonal)//make sure points aren't all identical, would go to infinity recursively
-                {
-                    safeToSplit = true;
-                    break;
-                }
-            }
-            if (safeToSplit)
-            {
-                thisOct->makeChildren();
-                for (int i = 0; i < curSize; ++i)
-                {
-                    addPoint(thisOct->containingChild(myVecRef[i].m_point), myVecRef[i].m_point, myVecRef[i].m_index, myVecRef[i].m_mySet);
-                }
-                thisOct->m_data.freeData();
-            }
+        int m_axis;
+        PointAxisLess(const int axis) : m_axis(axis) { }
+        template <typename T>
+        bool operator()(const T& left, const T& right) const { return left.m_point[m_axis] < right.m_point[m_axis]; }
+    };
+    
+    inline float pointDistSquared(const float a[3], const float b[3])
+    {
+        float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+}
+
+float CaretPointLocator::boxDistSquared(const Node& thisNode, const float target[3])
+{
+    float ret = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float diff = 0.0f;
+        if (target[i] < thisNode.m_min[i])
+        {
+            diff = thisNode.m_min[i] - target[i];
+        } else if (target[i] > thisNode.m_max[i]) {
+            diff = target[i] - thisNode.m_max[i];
         }
-    } else {
-        addPoint(thisOct->containingChild(point), point, index, pointSet);
+        ret += diff * diff;
+    }
+    return ret;
+}
+
+void CaretPointLocator::buildNode(const int64_t start, const int64_t end)
+{//NOTE: recursion depth is only log2 of the number of points
+    int64_t myIndex = (int64_t)m_nodes.size();
+    m_nodes.push_back(Node());
+    Node& myNode = m_nodes.back();//careful, invalidated when the children are added
+    myNode.m_start = start;
+    myNode.m_end = end;
+    myNode.m_secondChild = -1;
+    for (int i = 0; i < 3; ++i)
+    {
+        myNode.m_min[i] = m_points[start].m_point[i];
+        myNode.m_max[i] = m_points[start].m_point[i];
+    }
+    for (int64_t j = start + 1; j < end; ++j)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (m_points[j].m_point[i] < myNode.m_min[i]) myNode.m_min[i] = m_points[j].m_point[i];
+            if (m_points[j].m_point[i] > myNode.m_max[i]) myNode.m_max[i] = m_points[j].m_point[i];
+        }
+    }
+    if (end - start <= NUM_POINTS_LEAF) return;
+    int axis = 0;//split the longest side at the median, this keeps the depth logarithmic even when points are duplicated
+    for (int i = 1; i < 3; ++i)
+    {
+        if (myNode.m_max[i] - myNode.m_min[i] > myNode.m_max[axis] - myNode.m_min[axis]) axis = i;
     }
+    int64_t middle = start + (end - start) / 2;
+    nth_element(m_points.begin() + start, m_points.begin() + middle, m_points.begin() + end, PointAxisLess(axis));
+    buildNode(start, middle);
+    int64_t secondChild = (int64_t)m_nodes.size();
+    buildNode(middle, end);
+    m_nodes[myIndex].m_secondChild = secondChild;
+}
+
+void CaretPointLocator::rebuildTree()
+{
+    m_nodes.clear();
+    if (m_points.empty()) return;
+    m_nodes.reserve(2 * (m_points.size() / (NUM_POINTS_LEAF / 2) + 1));//leaves have at least half the leaf size
+    buildNode(0, (int64_t)m_points.size());
 }
 
 int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numCoords)
@@ -75,279 +111,277 @@ int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numC
     CaretMutexLocker locked(&m_modifyMutex);
     int32_t setNum = newIndex();
     if (numCoords < 1) return setNum;
-    if (m_tree == NULL)
-    {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
-        {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
-        }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
-    }
+    int64_t oldSize = (int64_t)m_points.size();
+    m_points.resize(oldSize + numCoords);
     for (int64_t i = 0; i < numCoords; ++i)
     {
-        int64_t i3 = i * 3;
-        m_tree = m_tree->makeContains(coordsIn + i3);//make new root if needed
-        addPoint(m_tree, coordsIn + i3, i, setNum);//and add the point
+        Point& thisPoint = m_points[oldSize + i];
+        thisPoint.m_point[0] = coordsIn[i * 3];
+        thisPoint.m_point[1] = coordsIn[i * 3 + 1];
+        thisPoint.m_point[2] = coordsIn[i * 3 + 2];
+        thisPoint.m_index = i;
+        thisPoint.m_mySet = setNum;
     }
+    rebuildTree();//building is O(n log n) and cheap compared to the old incremental octree insertion, so just rebuild
     return setNum;
 }
 
 CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
 {
-    m_nextSetIndex = 1;//next set will be set #1
-    m_tree = NULL;
-    if (numCoords >= 1)
-    {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
-        {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
-        }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
-        for (int64_t i = 0; i < numCoords; ++i)
-        {
-            int64_t i3 = i * 3;
-            addPoint(m_tree, coordsIn + i3, i, 0);//this is set #0
-        }
-    }
+    m_nextSetIndex = 0;
+    addPointSet(coordsIn, numCoords);//this is set #0
 }
 
-CaretPointLocator::CaretPointLocator(const float minBounds[3], const float maxBounds[3])
+CaretPointLocator::CaretPointLocator(const float*, const float*)
 {
     m_nextSetIndex = 0;
-    m_tree = new Oct<LeafVector<Point> >(minBounds, maxBounds);
 }
 
-int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
+int64_t CaretPointLocator::closestHelper(const float target[3], const float& maxDist2, int32_t* setOut, Vector3D* coordsOut) const
 {
-    if (m_tree == NULL) return -1;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, bestDist = -1.0f, tempf, curDist = m_tree->distToPoint(target);
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist);
-    while (curDist < bestDist || first)
+    if (m_nodes.empty())
+    {
+        if (setOut != NULL) *setOut = -1;
+        return -1;
+    }
+    float bestDist2 = maxDist2;
+    const Point* bestPoint = NULL;
+    int64_t nodeStack[MAX_STACK];
+    float distStack[MAX_STACK];
+    int stackSize = 1;
+    nodeStack[0] = 0;
+    distStack[0] = boxDistSquared(m_nodes[0], target);
+    while (stackSize > 0)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
+        --stackSize;
+        if (distStack[stackSize] > bestDist2) continue;//bound may have tightened since this was pushed
+        const Node& thisNode = m_nodes[nodeStack[stackSize]];
+        if (thisNode.m_secondChild == -1)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            for (int64_t i = thisNode.m_start; i < thisNode.m_end; ++i)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || first)
+                float tempf = pointDistSquared(m_points[i].m_point, target);
+                if (tempf < bestDist2 || (bestPoint == NULL && tempf <= bestDist2))
                 {
-                    first = false;
                     bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
+                    bestPoint = &(m_points[i]);
                 }
             }
-            bestDist = sqrt(bestDist2);
         } else {
-            for (int ii = 0; ii < 2; ++ii)
+            int64_t first = nodeStack[stackSize] + 1, second = thisNode.m_secondChild;
+            float firstDist = boxDistSquared(m_nodes[first], target), secondDist = boxDistSquared(m_nodes[second], target);
+            if (firstDist > secondDist)
             {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distToPoint(target);
-                        if (tempf < bestDist || first)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
+                swap(first, second);
+                swap(firstDist, secondDist);
+            }
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            if (secondDist <= bestDist2)//push the farther child first, so the closer one is searched first
+            {
+                nodeStack[stackSize] = second;
+                distStack[stackSize] = secondDist;
+                ++stackSize;
+            }
+            if (firstDist <= bestDist2)
+            {
+                nodeStack[stackSize] = first;
+                distStack[stackSize] = firstDist;
+                ++stackSize;
             }
         }
-        if (myHeap.isEmpty())
-        {
-            break;//allows us to use top() without violating an assertion
-        }
-        myHeap.top(&curDist);//get the key for the next item
     }
+    if (bestPoint == NULL)
+    {
+        if (setOut != NULL) *setOut = -1;
+        return -1;
+    }
+    if (setOut != NULL) *setOut = bestPoint->m_mySet;
+    if (coordsOut != NULL) *coordsOut = bestPoint->m_point;
+    return bestPoint->m_index;
+}
+
+int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
+{
     if (infoOut != NULL)
     {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
+        infoOut->index = closestHelper(target, numeric_limits<float>::infinity(), &(infoOut->whichSet), &(infoOut->coords));
+        return infoOut->index;
     }
-    return bestIndex;
+    return closestHelper(target, numeric_limits<float>::infinity(), NULL, NULL);
 }
 
 int64_t CaretPointLocator::closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut) const
 {
-    if (m_tree == NULL) return -1;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2)
+    if (infoOut != NULL)
     {
-        if (infoOut != NULL)
-        {
-            infoOut->whichSet = -1;
-            infoOut->index = -1;
-        }
-        return -1;
+        infoOut->index = closestHelper(target, maxDist * maxDist, &(infoOut->whichSet), &(infoOut->coords));
+        return infoOut->index;
+    }
+    return closestHelper(target, maxDist * maxDist, NULL, NULL);
+}
+
+void CaretPointLocator::rangeHelper(const float target[3], const float& maxDist2, vector<LocatorInfo>& resultsOut) const
+{//appends, so that the batch version can accumulate per thread
+    if (m_nodes.empty()) return;
+    int64_t nodeStack[MAX_STACK];
+    int stackSize = 0;
+    if (boxDistSquared(m_nodes[0], target) <= maxDist2)
+    {
+        nodeStack[0] = 0;
+        stackSize = 1;
     }
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, tempf;
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist2);
-    while (curDist2 < bestDist2 || first)
+    while (stackSize > 0)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
+        --stackSize;
+        const Node& thisNode = m_nodes[nodeStack[stackSize]];
+        if (thisNode.m_secondChild == -1)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            for (int64_t i = thisNode.m_start; i < thisNode.m_end; ++i)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || (first && tempf <= maxDist2))
+                if (pointDistSquared(m_points[i].m_point, target) <= maxDist2)
                 {
-                    first = false;
-                    bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
+                    resultsOut.push_back(LocatorInfo(m_points[i].m_index, m_points[i].m_mySet, m_points[i].m_point));
                 }
             }
         } else {
-            for (int ii = 0; ii < 2; ++ii)
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            int64_t first = nodeStack[stackSize] + 1;
+            if (boxDistSquared(m_nodes[first], target) <= maxDist2)
             {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf < bestDist2 || (first && tempf <= maxDist2))
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
+                nodeStack[stackSize] = first;
+                ++stackSize;
+            }
+            if (boxDistSquared(m_nodes[thisNode.m_secondChild], target) <= maxDist2)
+            {
+                nodeStack[stackSize] = thisNode.m_secondChild;
+                ++stackSize;
             }
         }
-        if (myHeap.isEmpty())
-        {
-            break;//allows us to use top() without violating an assertion
-        }
-        myHeap.top(&curDist2);//get the key for the next item
     }
-    if (infoOut != NULL)
-    {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
-    }
-    return bestIndex;
 }
 
 set<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], const float& maxDist) const
 {
-    set<LocatorInfo> ret;
-    if (m_tree == NULL) return ret;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2) return ret;
-    vector<Oct<LeafVector<Point> >*> myStack;//since we don't need the points sorted by distance
-    myStack.push_back(m_tree);
-    while (!myStack.empty())
+    vector<LocatorInfo> temp;
+    rangeHelper(target, maxDist * maxDist, temp);
+    return set<LocatorInfo>(temp.begin(), temp.end());
+}
+
+void CaretPointLocator::pointsInRange(const float target[3], const float& maxDist, vector<LocatorInfo>& resultsOut) const
+{
+    resultsOut.clear();//keeps capacity
+    rangeHelper(target, maxDist * maxDist, resultsOut);
+}
+
+bool CaretPointLocator::anyHelper(const float target[3], const float& maxDist2) const
+{
+    if (m_nodes.empty()) return false;
+    int64_t nodeStack[MAX_STACK];
+    int stackSize = 0;
+    float rootDist = boxDistSquared(m_nodes[0], target);
+    if (rootDist <= maxDist2)
     {
-        Oct<LeafVector<Point> >* thisOct = myStack.back();
-        myStack.pop_back();
-        if (thisOct->m_leaf)
+        nodeStack[0] = 0;
+        stackSize = 1;
+    }
+    while (stackSize > 0)
+    {
+        --stackSize;
+        const Node& thisNode = m_nodes[nodeStack[stackSize]];
+        if (thisNode.m_secondChild == -1)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            for (int64_t i = thisNode.m_start; i < thisNode.m_end; ++i)
             {
-                float tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf <= maxDist2)
+                if (pointDistSquared(m_points[i].m_point, target) < maxDist2)
                 {
-                    ret.insert(LocatorInfo(myVecRef[i].m_index, myVecRef[i].m_mySet, myVecRef[i].m_point));
+                    return true;
                 }
             }
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
+        } else {//closer nodes are more likely to contain a close enough point
+            int64_t first = nodeStack[stackSize] + 1, second = thisNode.m_secondChild;
+            float firstDist = boxDistSquared(m_nodes[first], target), secondDist = boxDistSquared(m_nodes[second], target);
+            if (firstDist > secondDist)
             {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        float tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myStack.push_back(thisOct->m_children[ii][ij][ik]);
-                        }
-                    }
-                }
+                swap(first, second);
+                swap(firstDist, secondDist);
+            }
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            if (secondDist <= maxDist2)
+            {
+                nodeStack[stackSize] = second;
+                ++stackSize;
+            }
+            if (firstDist <= maxDist2)
+            {
+                nodeStack[stackSize] = first;
+                ++stackSize;
             }
         }
     }
-    return ret;
+    return false;
 }
 
 bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist) const
 {
-    if (m_tree == NULL) return false;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist, tempf;
-    if (curDist2 > maxDist2) return false;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;//closer octs are more likely to contain a close enough point
-    myHeap.push(m_tree, curDist2);
-    while (!myHeap.isEmpty())
+    return anyHelper(target, maxDist * maxDist);
+}
+
+void CaretPointLocator::closestPoints(const float* targets, const int64_t& numTargets, int64_t* indicesOut, const float& maxDist, int32_t* setsOut) const
+{
+    float maxDist2 = numeric_limits<float>::infinity();
+    if (maxDist >= 0.0f) maxDist2 = maxDist * maxDist;
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numTargets; ++i)
+    {
+        indicesOut[i] = closestHelper(targets + i * 3, maxDist2, (setsOut == NULL ? NULL : setsOut + i), NULL);
+    }
+}
+
+void CaretPointLocator::pointsInRange(const float* targets, const int64_t& numTargets, const float& maxDist,
+                                      vector<int64_t>& offsetsOut, vector<LocatorInfo>& resultsOut) const
+{
+    const float maxDist2 = maxDist * maxDist;
+    offsetsOut.resize(numTargets + 1);
+    resultsOut.clear();
+    vector<vector<LocatorInfo> > threadResults;
+#pragma omp CARET_PAR
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop(&curDist2);
-        if (thisOct->m_leaf)
+        int numThreads = 1, myThread = 0;
+#ifdef CARET_OMP
+        numThreads = omp_get_num_threads();
+        myThread = omp_get_thread_num();
+#endif
+#pragma omp CARET_SINGLE
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
-            {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < maxDist2)
-                {
-                    return true;
-                }
-            }
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
-            }
+            threadResults.resize(numThreads);
+        }//implicit barrier
+        //contiguous block per thread, so that concatenating in thread order keeps the targets in order
+        int64_t myStart = numTargets * myThread / numThreads, myEnd = numTargets * (myThread + 1) / numThreads;
+        vector<LocatorInfo>& myResults = threadResults[myThread];
+        for (int64_t i = myStart; i < myEnd; ++i)
+        {
+            offsetsOut[i] = (int64_t)myResults.size();//relative to this thread's block for now
+            rangeHelper(targets + i * 3, maxDist2, myResults);
         }
     }
-    return false;
+    const int numThreads = (int)threadResults.size();
+    int64_t totalSize = 0;
+    for (int t = 0; t < numThreads; ++t)
+    {
+        totalSize += (int64_t)threadResults[t].size();
+    }
+    resultsOut.reserve(totalSize);
+    for (int t = 0; t < numThreads; ++t)
+    {
+        int64_t myStart = numTargets * t / numThreads, myEnd = numTargets * (t + 1) / numThreads;
+        int64_t base = (int64_t)resultsOut.size();
+        for (int64_t i = myStart; i < myEnd; ++i)
+        {
+            offsetsOut[i] += base;
+        }
+        resultsOut.insert(resultsOut.end(), threadResults[t].begin(), threadResults[t].end());
+    }
+    offsetsOut[numTargets] = (int64_t)resultsOut.size();
 }
 
 int32_t CaretPointLocator::newIndex()
@@ -366,48 +400,16 @@ void CaretPointLocator::removePointSet(int32_t whichSet)
 {
     CaretMutexLocker locked(&m_modifyMutex);
     m_unusedIndexes.push_back(whichSet);
-    removeSetHelper(m_tree, whichSet);
-}
-
-void CaretPointLocator::removeSetHelper(Oct<LeafVector<CaretPointLocator::Point> >* thisOct, int32_t thisSet)
-{
-    if (thisOct == NULL) return;
-    if (thisOct->m_leaf)
+    int64_t numPoints = (int64_t)m_points.size(), outIndex = 0;
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-        int curSize = (int)myVecRef.size();
-        bool match = false;
-        for (int i = 0; i < curSize; ++i)//make sure something gets removed, so we don't have to do an allocation if it isn't needed
+        if (m_points[i].m_mySet != whichSet)
         {
-            if (myVecRef[i].m_mySet == thisSet)
-            {
-                match = true;
-                break;
-            }
-        }
-        if (match)
-        {
-            vector<Point> tempvec;
-            tempvec.reserve(curSize - 1);//because at least one is getting removed
-            for (int i = 0; i < curSize; ++i)
-            {
-                if (myVecRef[i].m_mySet != thisSet)
-                {
-                    tempvec.push_back(myVecRef[i]);
-                }
-            }
-            myVecRef = tempvec;
-        }
-    } else {
-        for (int ii = 0; ii < 2; ++ii)
-        {
-            for (int ij = 0; ij < 2; ++ij)
-            {
-                for (int ik = 0; ik < 2; ++ik)
-                {
-                    removeSetHelper(thisOct->m_children[ii][ij][ik], thisSet);
-                }
-            }
+            if (outIndex != i) m_points[outIndex] = m_points[i];
+            ++outIndex;
         }
     }
+    if (outIndex == numPoints) return;
+    m_points.resize(outIndex);
+    rebuildTree();
 }
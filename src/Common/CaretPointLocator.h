@@ -23,7 +23,6 @@
 /*LICENSE_END*/
 
 #include "CaretMutex.h"
-#include "OctTree.h"
 #include "Vector3D.h"
 
 #include <set>
@@ -53,27 +52,33 @@ namespace caret {
     {
         struct Point
         {
-            Vector3D m_point;
+            float m_point[3];
             int64_t m_index;
             int32_t m_mySet;
-            Point(const float point[3], const int64_t index, const int32_t mySet)
-            {
-                m_point = point;
-                m_index = index;
-                m_mySet = mySet;
-            }
+        };
+        struct Node
+        {//flat bounding volume hierarchy over the points, the first child of a non-leaf node immediately follows it
+            float m_min[3], m_max[3];
+            int64_t m_start, m_end;//range of m_points contained in this node
+            int64_t m_secondChild;//-1 for leaf nodes
         };
         CaretMutex m_modifyMutex;//thread safety, don't let multiple threads modify the point sets at once
-        Oct<LeafVector<Point> >* m_tree;
+        std::vector<Point> m_points;//reordered during build so that every node's points are contiguous
+        std::vector<Node> m_nodes;
         int32_t m_nextSetIndex;
         std::vector<int32_t> m_unusedIndexes;
-        void addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet);
         int32_t newIndex();
-        static const int NUM_POINTS_SPLIT = 100;
-        void removeSetHelper(Oct<LeafVector<Point> >* thisOct, const int32_t thisSet);
+        static const int NUM_POINTS_LEAF = 16;
+        static const int MAX_STACK = 128;//tree is split at the median, so depth is log2(points / leaf size)
+        void rebuildTree();
+        void buildNode(const int64_t start, const int64_t end);
+        int64_t closestHelper(const float target[3], const float& maxDist2, int32_t* setOut, Vector3D* coordsOut) const;
+        void rangeHelper(const float target[3], const float& maxDist2, std::vector<LocatorInfo>& resultsOut) const;
+        bool anyHelper(const float target[3], const float& maxDist2) const;
+        static float boxDistSquared(const Node& thisNode, const float target[3]);
         CaretPointLocator();
     public:
-        ///make an empty point locator with given bounding box (bounding box can expand later, but may be less efficient
+        ///make an empty point locator, the bounds are no longer needed, and are ignored
         CaretPointLocator(const float minBounds[3], const float maxBounds[3]);
         ///make a point locator with the bounding box of this point set, and use this point set as set #0
         CaretPointLocator(const float* coordsIn, const int64_t numCoords);
@@ -85,7 +90,17 @@ namespace caret {
         int64_t closestPoint(const float target[3], LocatorInfo* infoOut = NULL) const;
         int64_t closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut = NULL) const;
         std::set<LocatorInfo> pointsInRange(const float target[3], const float& maxDist) const;
+        ///clears and fills a caller-owned vector (reuse it across queries to avoid allocation), results are in no particular order
+        void pointsInRange(const float target[3], const float& maxDist, std::vector<LocatorInfo>& resultsOut) const;
         bool anyInRange(const float target[3], const float& maxDist) const;
+        
+        ///closest point to each of numTargets packed xyz targets, computed in parallel
+        ///if maxDist is not negative, targets with no point within maxDist get -1, like closestPointLimited
+        void closestPoints(const float* targets, const int64_t& numTargets, int64_t* indicesOut, const float& maxDist = -1.0f, int32_t* setsOut = NULL) const;
+        ///all points within maxDist of each target, computed in parallel, in compressed row form:
+        ///the results for target i are resultsOut[offsetsOut[i]] up to (not including) resultsOut[offsetsOut[i + 1]]
+        void pointsInRange(const float* targets, const int64_t& numTargets, const float& maxDist,
+                           std::vector<int64_t>& offsetsOut, std::vector<LocatorInfo>& resultsOut) const;
     };
 }
 
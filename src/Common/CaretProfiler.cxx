@@ -0,0 +1,297 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretProfiler.h"
+
+#include "CaretAssert.h"
+#include "CaretMutex.h"
+#include "DataFileException.h"
+#include "ElapsedTimer.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#ifndef CARET_OS_WINDOWS
+#include <sys/resource.h>
+#endif
+
+#include <map>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    struct ProfileOpenScope
+    {
+        AString m_name;
+        const char* m_category;
+        int64_t m_startMicros, m_bytesRead, m_bytesWritten;
+    };
+
+    struct ProfileEvent
+    {
+        AString m_name;
+        const char* m_category;
+        int64_t m_startMicros, m_durationMicros, m_bytesRead, m_bytesWritten, m_peakResident;
+        int m_threadIndex;
+    };
+
+    bool s_profilingEnabled = false;//only written before any threads are started, so no need for locking on read
+    CaretMutex s_profileMutex;
+    ElapsedTimer* s_profileTimer = NULL;
+    map<Qt::HANDLE, int> s_profileThreadIndices;
+    vector<vector<ProfileOpenScope> > s_profileThreadStacks;
+    vector<ProfileEvent> s_profileEvents;
+    int64_t s_profileTotalRead = 0, s_profileTotalWritten = 0;//updated when outermost scopes close, or directly for I/O outside any scope
+    map<AString, AString> s_profileOtherData;//values are already formatted as json numbers
+
+    //must hold s_profileMutex
+    vector<ProfileOpenScope>& getThreadStack(int* threadIndexOut = NULL)
+    {
+        Qt::HANDLE myThread = QThread::currentThreadId();
+        map<Qt::HANDLE, int>::iterator iter = s_profileThreadIndices.find(myThread);
+        int index;
+        if (iter == s_profileThreadIndices.end())
+        {
+            index = (int)s_profileThreadStacks.size();
+            s_profileThreadIndices[myThread] = index;
+            s_profileThreadStacks.push_back(vector<ProfileOpenScope>());
+        } else {
+            index = iter->second;
+        }
+        if (threadIndexOut != NULL) *threadIndexOut = index;
+        return s_profileThreadStacks[index];
+    }
+
+    int64_t getProfileMicros()
+    {
+        return (int64_t)(s_profileTimer->getElapsedTimeMilliseconds() * 1000.0);
+    }
+
+    AString jsonEscape(const AString& input)
+    {
+        AString ret;
+        ret.reserve(input.size());
+        for (int i = 0; i < input.size(); ++i)
+        {
+            const QChar thisChar = input[i];
+            switch (thisChar.unicode())
+            {
+                case '"':
+                    ret += "\\\"";
+                    break;
+                case '\\':
+                    ret += "\\\\";
+                    break;
+                case '\n':
+                    ret += "\\n";
+                    break;
+                case '\t':
+                    ret += "\\t";
+                    break;
+                default:
+                    if (thisChar.unicode() < 32)
+                    {
+                        ret += "\\u" + AString::number(thisChar.unicode(), 16).rightJustified(4, '0');
+                    } else {
+                        ret += thisChar;
+                    }
+            }
+        }
+        return ret;
+    }
+}
+
+void CaretProfiler::enable()
+{
+    CaretMutexLocker locked(&s_profileMutex);
+    if (s_profilingEnabled) return;
+    s_profileTimer = new ElapsedTimer();//never deleted, scopes may close during static destruction
+    s_profileTimer->start();
+    s_profilingEnabled = true;
+}
+
+bool CaretProfiler::isEnabled()
+{
+    return s_profilingEnabled;
+}
+
+void CaretProfiler::beginScope(const AString& name, const char* category)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    ProfileOpenScope toPush;
+    toPush.m_name = name;
+    toPush.m_category = category;
+    toPush.m_bytesRead = 0;
+    toPush.m_bytesWritten = 0;
+    toPush.m_startMicros = getProfileMicros();
+    getThreadStack().push_back(toPush);
+}
+
+void CaretProfiler::endScope()
+{
+    if (!s_profilingEnabled) return;
+    const int64_t peakResident = getPeakResidentBytes();//outside the lock, it is a system call
+    CaretMutexLocker locked(&s_profileMutex);
+    int threadIndex = -1;
+    vector<ProfileOpenScope>& myStack = getThreadStack(&threadIndex);
+    CaretAssert(!myStack.empty());
+    if (myStack.empty()) return;
+    const ProfileOpenScope& myScope = myStack.back();
+    ProfileEvent myEvent;
+    myEvent.m_name = myScope.m_name;
+    myEvent.m_category = myScope.m_category;
+    myEvent.m_startMicros = myScope.m_startMicros;
+    myEvent.m_durationMicros = getProfileMicros() - myScope.m_startMicros;
+    myEvent.m_bytesRead = myScope.m_bytesRead;
+    myEvent.m_bytesWritten = myScope.m_bytesWritten;
+    myEvent.m_peakResident = peakResident;
+    myEvent.m_threadIndex = threadIndex;
+    s_profileEvents.push_back(myEvent);
+    myStack.pop_back();
+    if (myStack.empty())
+    {
+        s_profileTotalRead += myEvent.m_bytesRead;
+        s_profileTotalWritten += myEvent.m_bytesWritten;
+    } else {//make byte counts inclusive of children
+        myStack.back().m_bytesRead += myEvent.m_bytesRead;
+        myStack.back().m_bytesWritten += myEvent.m_bytesWritten;
+    }
+}
+
+void CaretProfiler::addBytesRead(const int64_t& bytes)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    vector<ProfileOpenScope>& myStack = getThreadStack();
+    if (myStack.empty())
+    {
+        s_profileTotalRead += bytes;
+    } else {
+        myStack.back().m_bytesRead += bytes;
+    }
+}
+
+void CaretProfiler::addBytesWritten(const int64_t& bytes)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    vector<ProfileOpenScope>& myStack = getThreadStack();
+    if (myStack.empty())
+    {
+        s_profileTotalWritten += bytes;
+    } else {
+        myStack.back().m_bytesWritten += bytes;
+    }
+}
+
+void CaretProfiler::setOtherData(const AString& name, const int64_t& value)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    s_profileOtherData[name] = AString::number(value);
+}
+
+void CaretProfiler::setOtherData(const AString& name, const double& value)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    s_profileOtherData[name] = AString::number(value, 'f', 6);
+}
+
+int64_t CaretProfiler::getPeakResidentBytes()
+{
+#ifdef CARET_OS_WINDOWS
+    return -1;//would need psapi, not worth the extra link dependency
+#else
+    struct rusage myUsage;
+    if (getrusage(RUSAGE_SELF, &myUsage) != 0) return -1;
+#ifdef CARET_OS_MACOSX
+    return (int64_t)myUsage.ru_maxrss;//mac reports bytes
+#else
+    return ((int64_t)myUsage.ru_maxrss) * 1024;//linux reports kilobytes
+#endif
+#endif
+}
+
+void CaretProfiler::writeChromeTrace(const AString& filename)
+{
+    if (!s_profilingEnabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    QFile myFile(filename);
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        throw DataFileException(filename, "unable to open profile output file for writing");
+    }
+    QTextStream myStream(&myFile);
+    myStream.setCodec("UTF-8");
+    myStream << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (int i = 0; i < (int)s_profileThreadStacks.size(); ++i)
+    {
+        if (!first) myStream << ",\n";
+        first = false;
+        myStream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"";
+        if (i == 0)
+        {
+            myStream << "main";
+        } else {
+            myStream << "thread " << i;
+        }
+        myStream << "\"}}";
+    }
+    for (size_t i = 0; i < s_profileEvents.size(); ++i)
+    {
+        const ProfileEvent& myEvent = s_profileEvents[i];
+        if (!first) myStream << ",\n";
+        first = false;
+        myStream << "{\"name\":\"" << jsonEscape(myEvent.m_name) << "\",\"cat\":\"" << myEvent.m_category
+                 << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << myEvent.m_threadIndex
+                 << ",\"ts\":" << myEvent.m_startMicros << ",\"dur\":" << myEvent.m_durationMicros
+                 << ",\"args\":{\"bytes_read\":" << myEvent.m_bytesRead << ",\"bytes_written\":" << myEvent.m_bytesWritten;
+        if (myEvent.m_peakResident >= 0)
+        {
+            myStream << ",\"peak_rss_bytes\":" << myEvent.m_peakResident;
+        }
+        myStream << "}}";
+        if (myEvent.m_peakResident >= 0)
+        {//counter track, so memory growth shows up on the timeline
+            myStream << ",\n{\"name\":\"peak RSS\",\"ph\":\"C\",\"pid\":1,\"ts\":" << (myEvent.m_startMicros + myEvent.m_durationMicros)
+                     << ",\"args\":{\"bytes\":" << myEvent.m_peakResident << "}}";
+        }
+    }
+    myStream << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"total_bytes_read\":" << s_profileTotalRead
+             << ",\"total_bytes_written\":" << s_profileTotalWritten
+             << ",\"peak_rss_bytes\":" << getPeakResidentBytes();
+    for (map<AString, AString>::const_iterator iter = s_profileOtherData.begin(); iter != s_profileOtherData.end(); ++iter)
+    {
+        myStream << ",\n\"" << jsonEscape(iter->first) << "\":" << iter->second;
+    }
+    myStream << "}}\n";
+    myStream.flush();
+    if (myStream.status() != QTextStream::Ok)
+    {
+        throw DataFileException(filename, "error writing profile output file");
+    }
+}
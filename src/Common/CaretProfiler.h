@@ -0,0 +1,80 @@
+#ifndef __CARET_PROFILER_H__
+#define __CARET_PROFILER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <stdint.h>
+
+namespace caret {
+
+    ///records nested timed scopes per thread (commands, algorithms, file reads and writes), with byte counts and peak RSS, and writes them as Chrome trace JSON
+    ///everything is a no-op until enable() is called, so scopes can be left in production code
+    class CaretProfiler
+    {
+        CaretProfiler();//static only
+    public:
+        ///start recording, timestamps are relative to this call
+        static void enable();
+        static bool isEnabled();
+
+        ///use CaretProfileScope instead of calling these directly, category must be a string literal (pointer is stored)
+        static void beginScope(const AString& name, const char* category);
+        static void endScope();
+
+        ///attributed to the innermost open scope of the calling thread, and added to its parents when it closes
+        static void addBytesRead(const int64_t& bytes);
+        static void addBytesWritten(const int64_t& bytes);
+
+        ///returns -1 if not available on this platform
+        static int64_t getPeakResidentBytes();
+
+        ///record a named summary value, written with the totals at the end of the trace, replaces any previous value with the same name
+        static void setOtherData(const AString& name, const int64_t& value);
+        static void setOtherData(const AString& name, const double& value);
+
+        ///write everything recorded so far, in the format read by chrome://tracing and similar viewers
+        static void writeChromeTrace(const AString& filename);
+    };
+
+    ///times the lifetime of the object as a named scope when profiling is enabled
+    class CaretProfileScope
+    {
+        bool m_active;
+        CaretProfileScope();
+        CaretProfileScope(const CaretProfileScope&);
+        CaretProfileScope& operator=(const CaretProfileScope&);
+    public:
+        CaretProfileScope(const AString& name, const char* category)
+        {
+            m_active = CaretProfiler::isEnabled();
+            if (m_active) CaretProfiler::beginScope(name, category);
+        }
+        ~CaretProfileScope()
+        {
+            if (m_active) CaretProfiler::endScope();
+        }
+    };
+
+} // namespace
+
+#endif  //__CARET_PROFILER_H__
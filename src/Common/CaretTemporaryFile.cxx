@@ -235,6 +235,25 @@ CaretTemporaryFile::readFile(const AString& filename)
     }
 }
 
+/**
+ * Create the temporary file with no content, so that it can be opened
+ * by name for writing (such as with CaretBinaryFile).  The file is still
+ * deleted when this instance goes out of scope.
+ *
+ * @throws DataFileException
+ *    If the file could not be created.
+ */
+void
+CaretTemporaryFile::createEmptyFile()
+{
+    if ( ! m_temporaryFile->open()) {
+        throw DataFileException(m_temporaryFile->fileTemplate(),
+                                "Unable to create temporary file.");
+    }
+    m_temporaryFile->close();
+    setFileName(m_temporaryFile->fileName());
+}
+
 /**
  * Write the contents of the temporary file to a local file with
  * the given name.
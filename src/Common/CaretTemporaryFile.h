@@ -48,6 +48,8 @@ namespace caret {
         
         virtual void writeFile(const AString& filename);
 
+        void createEmptyFile();
+        
         // ADD_NEW_METHODS_HERE
 
     private:
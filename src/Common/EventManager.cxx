@@ -32,10 +32,38 @@
 #include "ApplicationInformation.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "ElapsedTimer.h"
 #include "EventAlertUser.h"
 #include "EventListenerInterface.h"
 
 using namespace caret;
+
+namespace {
+    /**
+     * Increments a depth counter and decrements it when destroyed
+     * so that the depth is restored if a listener throws an exception.
+     */
+    class SendingDepthGuard {
+    public:
+        SendingDepthGuard(int32_t& depth)
+        : m_depth(depth)
+        {
+            m_depth++;
+        }
+        
+        ~SendingDepthGuard()
+        {
+            m_depth--;
+        }
+        
+    private:
+        SendingDepthGuard(const SendingDepthGuard&);
+        
+        SendingDepthGuard& operator=(const SendingDepthGuard&);
+        
+        int32_t& m_depth;
+    };
+}
 /**
  * \class  caret::EventManager
  * \brief  The event manager.
@@ -73,6 +101,15 @@ EventManager::EventManager()
 {
     m_eventIssuedCounter = 0;
     m_eventBlockingCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    
+    for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+        m_eventListenerSnapshots[i] = NULL;
+        m_eventProcessedListenerSnapshots[i] = NULL;
+    }
+    m_eventSendingDepth = 0;
+    m_eventDispatchCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_eventDispatchSeconds.resize(EventTypeEnum::EVENT_COUNT, 0.0);
+    m_eventDispatchTimingEnabled = false;
 }
 
 /**
@@ -111,6 +148,16 @@ EventManager::~EventManager()
             << std::endl;
         }
     }
+    
+    for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+        delete m_eventListenerSnapshots[i];
+        delete m_eventProcessedListenerSnapshots[i];
+    }
+    for (std::vector<EVENT_LISTENER_SNAPSHOT*>::iterator iter = m_retiredListenerSnapshots.begin();
+         iter != m_retiredListenerSnapshots.end();
+         iter++) {
+        delete *iter;
+    }
 }
 
 /**
@@ -175,6 +222,8 @@ EventManager::addEventListener(EventListenerInterface* eventListener,
 #else
     INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
 #endif
+    invalidateListenerSnapshot(m_eventListenerSnapshots,
+                               listenForEventType);
     
     //std::cout << "Adding listener from class "
     //<< typeid(*eventListener).name()
@@ -205,6 +254,8 @@ EventManager::addProcessedEventListener(EventListenerInterface* eventListener,
 #else
     INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
 #endif
+    invalidateListenerSnapshot(m_eventProcessedListenerSnapshots,
+                               listenForEventType);
     
     //std::cout << "Adding listener from class "
     //<< typeid(*eventListener).name()
@@ -225,6 +276,13 @@ void
 EventManager::removeEventFromListener(EventListenerInterface* eventListener,
                                   const EventTypeEnum::Enum listenForEventType)
 {
+    /*
+     * Listeners are removed from all event types when destroyed so
+     * only replace the snapshots of event types that were changed.
+     */
+    const size_t numberOfListeners = m_eventListeners[listenForEventType].size();
+    const size_t numberOfProcessedListeners = m_eventProcessedListeners[listenForEventType].size();
+    
 #ifdef CONTAINER_VECTOR
     /*
      * Remove from NORMAL listeners
@@ -310,6 +368,15 @@ EventManager::removeEventFromListener(EventListenerInterface* eventListener,
 #else
     INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
 #endif
+    
+    if (m_eventListeners[listenForEventType].size() != numberOfListeners) {
+        invalidateListenerSnapshot(m_eventListenerSnapshots,
+                                   listenForEventType);
+    }
+    if (m_eventProcessedListeners[listenForEventType].size() != numberOfProcessedListeners) {
+        invalidateListenerSnapshot(m_eventProcessedListenerSnapshots,
+                                   listenForEventType);
+    }
 }
 
 /**
@@ -325,6 +392,57 @@ EventManager::removeAllEventsFromListener(EventListenerInterface* eventListener)
     }
 }
 
+/**
+ * Get the snapshot of the listeners for an event type, creating
+ * the snapshot if the listeners have changed.
+ *
+ * @param snapshots
+ *    The snapshots for all event types.
+ * @param containers
+ *    The listeners for all event types.
+ * @param eventType
+ *    Type of event.
+ * @return
+ *    The snapshot which remains valid until the outermost event
+ *    being sent has completed.
+ */
+const EventManager::EVENT_LISTENER_SNAPSHOT*
+EventManager::getListenerSnapshot(EVENT_LISTENER_SNAPSHOT* snapshots[],
+                                  const EVENT_LISTENER_CONTAINER containers[],
+                                  const EventTypeEnum::Enum eventType)
+{
+    if (snapshots[eventType] == NULL) {
+        snapshots[eventType] = new EVENT_LISTENER_SNAPSHOT(containers[eventType].begin(),
+                                                           containers[eventType].end());
+    }
+    return snapshots[eventType];
+}
+
+/**
+ * Replace the snapshot of the listeners for an event type after its
+ * listeners have changed.  If events are being sent, the snapshot may
+ * be in use so it is deleted after the outermost event has completed.
+ *
+ * @param snapshots
+ *    The snapshots for all event types.
+ * @param eventType
+ *    Type of event.
+ */
+void
+EventManager::invalidateListenerSnapshot(EVENT_LISTENER_SNAPSHOT* snapshots[],
+                                         const EventTypeEnum::Enum eventType)
+{
+    if (snapshots[eventType] != NULL) {
+        if (m_eventSendingDepth > 0) {
+            m_retiredListenerSnapshots.push_back(snapshots[eventType]);
+        }
+        else {
+            delete snapshots[eventType];
+        }
+        snapshots[eventType] = NULL;
+    }
+}
+
 /**
  * Send an event.
  * 
@@ -335,20 +453,17 @@ void
 EventManager::sendEvent(Event* event)
 {   
     EventTypeEnum::Enum eventType = event->getEventType();
-    const AString eventNumberString = AString::number(m_eventIssuedCounter);
-    const AString eventMessagePrefix = ("Event "
-                                        + eventNumberString
-                                        + ": "
-                                        + event->toString() 
-                                        + " from thread: " 
-                                        + AString::number((uint64_t)QThread::currentThread())
-                                        + " ");
     
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
     if (m_eventBlockingCounter[eventTypeIndex] > 0) {
-        AString msg = (eventMessagePrefix
-                       + " is blocked.  Blocking counter="
+        AString msg = ("Event "
+                       + AString::number(m_eventIssuedCounter)
+                       + ": "
+                       + event->toString() 
+                       + " from thread: " 
+                       + AString::number((uint64_t)QThread::currentThread())
+                       + "  is blocked.  Blocking counter="
                        + AString::number(m_eventBlockingCounter[eventTypeIndex]));
         CaretLogFiner(msg);
     }
@@ -367,23 +482,106 @@ EventManager::sendEvent(Event* event)
             }
         }
         
+        const int64_t eventNumber = m_eventIssuedCounter;
+        m_eventDispatchCounter[eventTypeIndex]++;
+        
+        {
+            SendingDepthGuard depthGuard(m_eventSendingDepth);
+            if (m_eventDispatchTimingEnabled) {
+                ElapsedTimer timer;
+                timer.start();
+                dispatchEvent(event,
+                              eventNumber);
+                m_eventDispatchSeconds[eventTypeIndex] += timer.getElapsedTimeSeconds();
+            }
+            else {
+                dispatchEvent(event,
+                              eventNumber);
+            }
+        }
+        
         /*
-         * Get listeners for event.
+         * Snapshots replaced while sending are no longer in use
          */
-        EVENT_LISTENER_CONTAINER listeners = m_eventListeners[eventType];
+        if ((m_eventSendingDepth == 0)
+            && ( ! m_retiredListenerSnapshots.empty())) {
+            for (std::vector<EVENT_LISTENER_SNAPSHOT*>::iterator iter = m_retiredListenerSnapshots.begin();
+                 iter != m_retiredListenerSnapshots.end();
+                 iter++) {
+                delete *iter;
+            }
+            m_retiredListenerSnapshots.clear();
+        }
+
+        m_eventIssuedCounter++;
+    }
+}
+
+/**
+ * Send an event to its listeners.  The snapshots of the listeners are
+ * used so that listeners may be added or removed while an event is
+ * sent without copying the listeners for each event.  Listeners
+ * added or removed while sending an event do not change the
+ * listeners that receive the event.
+ *
+ * @param event
+ *    Event that is sent.
+ * @param eventNumber
+ *    Number of the event for messages.
+ */
+void
+EventManager::dispatchEvent(Event* event,
+                            const int64_t eventNumber)
+{
+    const EventTypeEnum::Enum eventType = event->getEventType();
+    
+    /*
+     * Get listeners for event.
+     */
+    const EVENT_LISTENER_SNAPSHOT* listeners = getListenerSnapshot(m_eventListenerSnapshots,
+                                                                   m_eventListeners,
+                                                                   eventType);
+    
+    // Too many prints (JWH)
+    //AString msg = (eventMessagePrefix + " SENT.");
+    //CaretLogFiner(msg);
+    //std::cout << msg << std::endl;
+    
+    /*
+     * Send event to each of the listeners.
+     */
+    for (EVENT_LISTENER_SNAPSHOT::const_iterator iter = listeners->begin();
+         iter != listeners->end();
+         iter++) {
+        EventListenerInterface* listener = *iter;
         
-        const AString eventNumberString = AString::number(m_eventIssuedCounter);
+        //std::cout << "Sending event from class "
+        //<< typeid(*listener).name()
+        //<< " for "
+        //<< EventTypeEnum::toName(eventType)
+        //<< std::endl;
         
-        // Too many prints (JWH)
-        //AString msg = (eventMessagePrefix + " SENT.");
-        //CaretLogFiner(msg);
-        //std::cout << msg << std::endl;
         
+        listener->receiveEvent(event);
+        
+        if (event->isError()) {
+            CaretLogWarning("Event " + AString::number(eventNumber) + " had error: " + event->toString() + ": " + event->getErrorMessage());
+            break;
+        }
+    }
+    
+    /*
+     * Verify event was processed.
+     */
+    if (event->getEventProcessCount() > 0) {
         /*
-         * Send event to each of the listeners.
+         * Send event to each of the PROCESSED listeners.
          */
-        for (EVENT_LISTENER_CONTAINER_ITERATOR iter = listeners.begin();
-             iter != listeners.end();
+        const EVENT_LISTENER_SNAPSHOT* processedListeners = getListenerSnapshot(m_eventProcessedListenerSnapshots,
+                                                                                m_eventProcessedListeners,
+                                                                                eventType);
+        for (EVENT_LISTENER_SNAPSHOT::const_iterator iter = processedListeners->begin();
+             iter != processedListeners->end();
              iter++) {
             EventListenerInterface* listener = *iter;
             
@@ -397,44 +595,13 @@ EventManager::sendEvent(Event* event)
             listener->receiveEvent(event);
             
             if (event->isError()) {
-                CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString() + ": " + event->getErrorMessage());
+                CaretLogWarning("Event " + AString::number(eventNumber) + " had error: " + event->toString());
                 break;
             }
         }
-        
-        /*
-         * Verify event was processed.
-         */
-        if (event->getEventProcessCount() > 0) {
-            /*
-             * Send event to each of the PROCESSED listeners.
-             */
-            EVENT_LISTENER_CONTAINER processedListeners = m_eventProcessedListeners[eventType];
-            for (EVENT_LISTENER_CONTAINER_ITERATOR iter = processedListeners.begin();
-                 iter != processedListeners.end();
-                 iter++) {
-                EventListenerInterface* listener = *iter;
-                
-                //std::cout << "Sending event from class "
-                //<< typeid(*listener).name()
-                //<< " for "
-                //<< EventTypeEnum::toName(eventType)
-                //<< std::endl;
-                
-                
-                listener->receiveEvent(event);
-                
-                if (event->isError()) {
-                    CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString());
-                    break;
-                }
-            }
-        }
-        else {
-            // Too many prints (JWH) CaretLogFine("Event " + eventNumberString + " not processed: " + event->toString());
-        }
-
-        m_eventIssuedCounter++;
+    }
+    else {
+        // Too many prints (JWH) CaretLogFine("Event " + eventNumberString + " not processed: " + event->toString());
     }
 }
 
@@ -599,4 +766,53 @@ EventManager::getEventIssuedCounter() const
     return m_eventIssuedCounter;
 }
 
+/**
+ * Enable timing of sending events.  When enabled, the time spent
+ * sending each type of event (including events sent by its 
+ * listeners) is accumulated.
+ *
+ * @param enabled
+ *    New status of timing.
+ */
+void
+EventManager::setEventDispatchTimingEnabled(const bool enabled)
+{
+    m_eventDispatchTimingEnabled = enabled;
+}
 
+/**
+ * @return The number of times an event type was sent to its listeners.
+ *
+ * @param eventType
+ *    Type of event.
+ */
+int64_t
+EventManager::getEventDispatchCounter(const EventTypeEnum::Enum eventType) const
+{
+    CaretAssertVectorIndex(m_eventDispatchCounter, eventType);
+    return m_eventDispatchCounter[eventType];
+}
+
+/**
+ * @return The time, in seconds, spent sending an event type while 
+ * timing was enabled.
+ *
+ * @param eventType
+ *    Type of event.
+ */
+double
+EventManager::getEventDispatchTimeSeconds(const EventTypeEnum::Enum eventType) const
+{
+    CaretAssertVectorIndex(m_eventDispatchSeconds, eventType);
+    return m_eventDispatchSeconds[eventType];
+}
+
+/**
+ * Reset the counters and times of sending events.
+ */
+void
+EventManager::resetEventDispatchStatistics()
+{
+    std::fill(m_eventDispatchCounter.begin(), m_eventDispatchCounter.end(), 0);
+    std::fill(m_eventDispatchSeconds.begin(), m_eventDispatchSeconds.end(), 0.0);
+}
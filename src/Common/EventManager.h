@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <stdint.h>
+#include <vector>
 
 #include "CaretObject.h"
 
@@ -94,11 +95,25 @@ namespace caret {
         
         int64_t getEventIssuedCounter() const;
         
+        void setEventDispatchTimingEnabled(const bool enabled);
+        
+        int64_t getEventDispatchCounter(const EventTypeEnum::Enum eventType) const;
+        
+        double getEventDispatchTimeSeconds(const EventTypeEnum::Enum eventType) const;
+        
+        void resetEventDispatchStatistics();
+        
     private:
         EventManager();
         
         virtual ~EventManager();
         
+        /**
+         * Listeners in the order they are sent an event.  A snapshot
+         * is never modified, when listeners change it is replaced.
+         */
+        typedef std::vector<EventListenerInterface*> EVENT_LISTENER_SNAPSHOT;
+        
         /**
          * Define the container
          */
@@ -119,6 +134,16 @@ namespace caret {
          */
         typedef EVENT_LISTENER_CONTAINER::iterator EVENT_LISTENER_CONTAINER_ITERATOR;
         
+        void dispatchEvent(Event* event,
+                           const int64_t eventNumber);
+        
+        const EVENT_LISTENER_SNAPSHOT* getListenerSnapshot(EVENT_LISTENER_SNAPSHOT* snapshots[],
+                                                           const EVENT_LISTENER_CONTAINER containers[],
+                                                           const EventTypeEnum::Enum eventType);
+        
+        void invalidateListenerSnapshot(EVENT_LISTENER_SNAPSHOT* snapshots[],
+                                        const EventTypeEnum::Enum eventType);
+        
         /**
          * The event listeners
          */
@@ -129,6 +154,30 @@ namespace caret {
          */
         EVENT_LISTENER_CONTAINER m_eventProcessedListeners[EventTypeEnum::EVENT_COUNT];
         
+        /** 
+         * Snapshots of the event listeners used when sending events, NULL
+         * if the listeners have changed since the snapshot was created
+         */
+        EVENT_LISTENER_SNAPSHOT* m_eventListenerSnapshots[EventTypeEnum::EVENT_COUNT];
+        
+        /** Snapshots of the processed event listeners */
+        EVENT_LISTENER_SNAPSHOT* m_eventProcessedListenerSnapshots[EventTypeEnum::EVENT_COUNT];
+        
+        /** Snapshots replaced while sending events, deleted when the outermost event completes */
+        std::vector<EVENT_LISTENER_SNAPSHOT*> m_retiredListenerSnapshots;
+        
+        /** Number of events being sent (events may be sent by listeners) */
+        int32_t m_eventSendingDepth;
+        
+        /** Number of times each event type was sent to its listeners */
+        std::vector<int64_t> m_eventDispatchCounter;
+        
+        /** Cumulative time spent sending each event type when timing is enabled */
+        std::vector<double> m_eventDispatchSeconds;
+        
+        /** Time sending of events */
+        bool m_eventDispatchTimingEnabled;
+        
         /** Counter that is incremented each time an event is issued */
         int64_t m_eventIssuedCounter;
         
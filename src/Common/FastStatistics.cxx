@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -61,14 +62,46 @@ void FastStatistics::reset()
     m_mostAbs = 0.0;
     m_min = 0.0f;
     m_max = 0.0f;
+    m_blockSum2 = 0.0;
 }
 
 void FastStatistics::update(const float* data, const int64_t& dataCount)
+{
+    BlockSummary mySummary;
+    mySummary.addData(data, dataCount);
+    startBlocks(mySummary);
+    addBlock(data, dataCount);
+    finishBlocks();
+}
+
+FastStatistics::BlockSummary::BlockSummary()
 {
     reset();
-    CaretArray<float> positives(dataCount), negatives(dataCount), absolutes(dataCount);
-    double sum = 0.0;//for numerical stability
-    bool first = true;//so min can be positive and max can be negative
+}
+
+void FastStatistics::BlockSummary::reset()
+{
+    m_posCount = 0;
+    m_zeroCount = 0;
+    m_negCount = 0;
+    m_infCount = 0;
+    m_negInfCount = 0;
+    m_nanCount = 0;
+    m_dataCount = 0;
+    m_sum = 0.0;
+    m_mostNeg = 0.0f;
+    m_leastNeg = -numeric_limits<float>::max();
+    m_leastPos = numeric_limits<float>::max();
+    m_mostPos = 0.0f;
+    m_leastAbs = numeric_limits<float>::max();
+    m_mostAbs = 0.0f;
+    m_min = 0.0f;
+    m_max = 0.0f;
+}
+
+void FastStatistics::BlockSummary::addData(const float* data, const int64_t& dataCount)
+{
+    bool first = (m_posCount + m_zeroCount + m_negCount == 0);//so min can be positive and max can be negative
     for (int64_t i = 0; i < dataCount; ++i)
     {
         if (data[i] != data[i])
@@ -87,15 +120,11 @@ void FastStatistics::update(const float* data, const int64_t& dataCount)
                     ++m_negInfCount;
                     continue;//skip neg infs
                 } else {
-                    negatives[m_negCount] = data[i];
                     ++m_negCount;
                     if (data[i] > m_leastNeg) m_leastNeg = data[i];
                     if (data[i] < m_mostNeg) m_mostNeg = data[i];
-                    
-                    absolutes[m_absCount] = -data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
+                    if (-data[i] > m_mostAbs) m_mostAbs = -data[i];
+                    if (-data[i] < m_leastAbs) m_leastAbs = -data[i];
                 }
             } else {
                 if (data[i] * 2.0f == data[i])
@@ -103,48 +132,40 @@ void FastStatistics::update(const float* data, const int64_t& dataCount)
                     ++m_infCount;
                     continue;//skip infs
                 } else {
-                    positives[m_posCount] = data[i];
                     ++m_posCount;
                     if (data[i] > m_mostPos) m_mostPos = data[i];
                     if (data[i] < m_leastPos) m_leastPos = data[i];
-                    
-                    absolutes[m_absCount] = data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
+                    if (data[i] > m_mostAbs) m_mostAbs = data[i];
+                    if (data[i] < m_leastAbs) m_leastAbs = data[i];
                 }
             }
         }
         if (data[i] > m_max || first) m_max = data[i];
         if (data[i] < m_min || first) m_min = data[i];
-        sum += data[i];//use a two-pass method for stability, only do mean this pass
+        m_sum += data[i];//use a two-pass method for stability, only do mean this pass
         first = false;
     }
-    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
-    m_mean = sum / totalGood;
-    float tempf;
-    double sum2 = 0.0;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {
-        if (data[i] != data[i]) continue;//skip NaNs
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        tempf = data[i] - m_mean;
-        sum2 += tempf * tempf;
-    }
-    if (totalGood > 0)
-    {
-        m_stdDevPop = sqrt(sum2 / totalGood);
-        if (totalGood > 1)
-        {
-            m_stdDevSample = sqrt(sum2 / (totalGood - 1));
-        }
-    }
-    int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
-    m_negPercentHist.update(usebuckets, negatives, m_negCount);
-    m_posPercentHist.update(usebuckets, positives, m_posCount);
-    m_absPercentHist.update(usebuckets, absolutes, m_absCount);
-    
+    m_dataCount += dataCount;
+}
+
+void FastStatistics::startBlocks(const BlockSummary& allBlocks)
+{
+    reset();
+    m_min = allBlocks.m_min;
+    m_max = allBlocks.m_max;
+    m_posCount = allBlocks.m_posCount;
+    m_zeroCount = allBlocks.m_zeroCount;
+    m_negCount = allBlocks.m_negCount;
+    m_infCount = allBlocks.m_infCount;
+    m_negInfCount = allBlocks.m_negInfCount;
+    m_nanCount = allBlocks.m_nanCount;
+    m_absCount = m_posCount + m_negCount;
+    m_mostPos = allBlocks.m_mostPos;
+    m_leastPos = allBlocks.m_leastPos;
+    m_leastNeg = allBlocks.m_leastNeg;
+    m_mostNeg = allBlocks.m_mostNeg;
+    m_leastAbs = allBlocks.m_leastAbs;
+    m_mostAbs = allBlocks.m_mostAbs;
     if (m_negCount <= 0)
     {
         m_leastNeg = 0.0;
@@ -160,6 +181,57 @@ void FastStatistics::update(const float* data, const int64_t& dataCount)
         m_leastAbs = 0.0;
         m_mostAbs  = 0.0;
     }
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    m_mean = allBlocks.m_sum / totalGood;
+    m_blockSum2 = 0.0;
+    int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, allBlocks.m_dataCount);//10,000 will probably allow us to approximate the percentiles pretty closely, and eats only 80K of memory each
+    m_negPercentHist.startBlocks(usebuckets, m_mostNeg, m_leastNeg);
+    m_posPercentHist.startBlocks(usebuckets, m_leastPos, m_mostPos);
+    m_absPercentHist.startBlocks(usebuckets, m_leastAbs, m_mostAbs);
+}
+
+void FastStatistics::addBlock(const float* data, const int64_t& dataCount)
+{
+    vector<float> positives, negatives, absolutes;//only as big as the block, and only the percentile histograms need them
+    positives.reserve(dataCount);
+    negatives.reserve(dataCount);
+    absolutes.reserve(dataCount);
+    float tempf;
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        if (data[i] != data[i]) continue;//skip NaNs
+        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
+        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
+        tempf = data[i] - m_mean;
+        m_blockSum2 += tempf * tempf;
+        if (data[i] < 0.0f)
+        {
+            negatives.push_back(data[i]);
+            absolutes.push_back(-data[i]);
+        } else if (data[i] > 0.0f) {
+            positives.push_back(data[i]);
+            absolutes.push_back(data[i]);
+        }
+    }
+    m_negPercentHist.addBlock(negatives.data(), (int64_t)negatives.size());
+    m_posPercentHist.addBlock(positives.data(), (int64_t)positives.size());
+    m_absPercentHist.addBlock(absolutes.data(), (int64_t)absolutes.size());
+}
+
+void FastStatistics::finishBlocks()
+{
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    if (totalGood > 0)
+    {
+        m_stdDevPop = sqrt(m_blockSum2 / totalGood);
+        if (totalGood > 1)
+        {
+            m_stdDevSample = sqrt(m_blockSum2 / (totalGood - 1));
+        }
+    }
+    m_negPercentHist.finishBlocks();
+    m_posPercentHist.finishBlocks();
+    m_absPercentHist.finishBlocks();
 }
 
 void FastStatistics::update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
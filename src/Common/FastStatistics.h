@@ -29,11 +29,37 @@ namespace caret
     ///this class does statistics that are linear in complexity only, NO SORTING, this means its percentiles are approximate, using interpolation from a histogram
     class FastStatistics
     {
+    public:
+        ///linear summary of data given in blocks (counts, extremes, sum), so the second pass over the blocks knows the ranges for the percentile histograms
+        class BlockSummary
+        {
+            float m_min, m_max;
+            float m_mostPos, m_leastPos, m_leastNeg, m_mostNeg, m_leastAbs, m_mostAbs;
+            int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount, m_dataCount;
+            double m_sum;
+            friend class FastStatistics;
+        public:
+            BlockSummary();
+            
+            void reset();
+            
+            void addData(const float* data, const int64_t& dataCount);
+            
+            int64_t getDataCount() const { return m_dataCount; }
+            
+            float getMin() const { return m_min; }
+            
+            float getMax() const { return m_max; }
+        };
+        
+    private:
         Histogram m_posPercentHist, m_negPercentHist, m_absPercentHist;
         float m_min, m_max, m_mean, m_stdDevPop, m_stdDevSample;
         float m_mostPos, m_leastPos, m_leastNeg, m_mostNeg, m_leastAbs, m_mostAbs;
         ///counts of each class of number
         int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount, m_absCount;
+        ///sum of squared deviations from the mean, accumulated over blocks
+        double m_blockSum2;
         
         void reset();
         
@@ -46,6 +72,13 @@ namespace caret
         
         void update(const float* data, const int64_t& dataCount);
         
+        ///for data that isn't available in one array: summarize all blocks and start with that, add each block again (for the deviation and percentile histograms), then finish
+        void startBlocks(const BlockSummary& allBlocks);
+        
+        void addBlock(const float* data, const int64_t& dataCount);
+        
+        void finishBlocks();
+        
         ///statistics and display are really not that related, so for now, only include a continuous clipping range, excluding the middle from data will do weird things to standard deviation
         void update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive);
         
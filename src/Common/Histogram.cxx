@@ -60,6 +60,8 @@ void Histogram::resize(const int& buckets)
 
 void Histogram::reset()
 {
+    m_limited = false;
+    m_limitsValid = true;
     m_posCount = 0;
     m_zeroCount = 0;
     m_negCount = 0;
@@ -83,104 +85,54 @@ void Histogram::update(const int& numBuckets, const float* data, const int64_t&
 
 void Histogram::update(const float* data, const int64_t& dataCount)
 {
-    int numBuckets = (int)m_buckets.size();
-    reset();
     bool first = true;
+    float dataMin = 0.0f, dataMax = 0.0f;
     for (int64_t i = 0; i < dataCount; ++i)
-    {//count value classes
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
-            {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    ++m_negCount;
-                }
-            } else {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_infCount;
-                    continue;//skip infs
-                } else {
-                    ++m_posCount;
-                }
-            }
-        }
+    {//find the range of the numerical values, counting is done while binning
+        if (data[i] != data[i]) continue;//skip NaNs
+        if (data[i] != 0.0f && data[i] * 2.0f == data[i]) continue;//skip infs
         if (first)
         {
             first = false;
-            m_bucketMin = data[i];
-            m_bucketMax = data[i];
+            dataMin = data[i];
+            dataMax = data[i];
         } else {
-            if (data[i] > m_bucketMax)
+            if (data[i] > dataMax)
             {
-                m_bucketMax = data[i];
-            } else if (data[i] < m_bucketMin) {//skip testing for new minimum if we found a new maximum
-                m_bucketMin = data[i];
+                dataMax = data[i];
+            } else if (data[i] < dataMin) {//skip testing for new minimum if we found a new maximum
+                dataMin = data[i];
             }
         }
     }
-    if (first)
-    {
-        m_bucketMin = m_bucketMax = 0.0f;
-        return;//our arrays are already zeroed, so just return if no valid data
-    }
-    if (m_bucketMin == m_bucketMax)
-    {
-        int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
-        for (int i = 0; i < numBuckets - 1; ++i)
-        {
-            m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-            if (i == 0)
-            {
-                m_buckets[i] = m_cumulative[i];
-            } else {
-                m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
-            }
-        }//display is already zeroed, so just return
-        m_cumulative[numBuckets - 1] = totalValid;//make sure the last one has all of them
-        if (numBuckets > 1)
-        {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-        } else {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
-        }
-        return;
-    }
-    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {//determine histogram
-        if (data[i] != data[i]) continue;//exclude NaN
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
-    }
-    computeCumulative();
-    for (int i = 0; i < numBuckets; ++i)
-    {//compute display values by normalizing by bucket size
-        m_display[i] = m_buckets[i] / bucketsize;
-    }
+    startBlocks((int)m_buckets.size(), dataMin, dataMax);
+    addBlock(data, dataCount);
+    finishBlocks();
 }
 
 void Histogram::update(const float* data, const int64_t& dataCount, float mostPositiveValueInclusive,
                        float leastPositiveValueInclusive, float leastNegativeValueInclusive,
                        float mostNegativeValueInclusive, const bool& includeZeroValues)
 {
-    int numBuckets = (int)m_buckets.size();
+    startBlocks((int)m_buckets.size(), mostPositiveValueInclusive, leastPositiveValueInclusive, leastNegativeValueInclusive, mostNegativeValueInclusive, includeZeroValues);
+    addBlock(data, dataCount);
+    finishBlocks();
+}
+
+void Histogram::startBlocks(const int& numBuckets, const float& bucketMin, const float& bucketMax)
+{
+    CaretAssert(bucketMin <= bucketMax);
+    resize(numBuckets);
+    reset();
+    m_limited = false;
+    m_bucketMin = bucketMin;
+    m_bucketMax = bucketMax;
+}
+
+void Histogram::startBlocks(const int& numBuckets, float mostPositiveValueInclusive, float leastPositiveValueInclusive,
+                            float leastNegativeValueInclusive, float mostNegativeValueInclusive, const bool& includeZeroValues)
+{
+    resize(numBuckets);
     reset();
     if (mostNegativeValueInclusive > 0.0f) mostNegativeValueInclusive = 0.0f;//sanity check the inputs without asserting
     if (mostPositiveValueInclusive < 0.0f) mostPositiveValueInclusive = 0.0f;
@@ -198,10 +150,22 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
     } else {
         m_bucketMin = leastPositiveValueInclusive;
     }
+    m_limited = true;
     float sanity = m_bucketMax + m_bucketMin;
-    if (m_bucketMax <= m_bucketMin || sanity != sanity)
-    {//bad input ranges, so collect counts, make a mock histogram if equal, and return (display values will be zeros)
-        int64_t equalCount = 0;
+    m_limitsValid = !(m_bucketMax <= m_bucketMin || sanity != sanity);
+    m_mostPositiveLimit = mostPositiveValueInclusive;
+    m_leastPositiveLimit = leastPositiveValueInclusive;
+    m_leastNegativeLimit = leastNegativeValueInclusive;
+    m_mostNegativeLimit = mostNegativeValueInclusive;
+    m_includeZeroValues = includeZeroValues;
+    m_equalCount = 0;
+}
+
+void Histogram::addBlock(const float* data, const int64_t& dataCount)
+{
+    int numBuckets = (int)m_buckets.size();
+    if (m_limited && !m_limitsValid)
+    {//bad input ranges, so only collect counts, finishBlocks() makes a mock histogram if equal
         for (int64_t i = 0; i < dataCount; ++i)
         {
             if (data[i] != data[i])
@@ -221,44 +185,14 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
             }
             if (data[i] == m_bucketMax)
             {
-                ++equalCount;
-            }
-        }
-        if (m_bucketMax == m_bucketMin)
-        {
-            if (m_bucketMax == 0.0f)
-            {
-                m_zeroCount = equalCount;
-            } else {
-                if (m_bucketMax < 0.0f)
-                {
-                    m_negCount = equalCount;
-                } else {
-                    m_posCount = equalCount;
-                }
-            }
-            for (int i = 0; i < numBuckets - 1; ++i)
-            {
-                m_cumulative[i] = (i + 1) * equalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-                if (i == 0)
-                {
-                    m_buckets[i] = m_cumulative[i];
-                } else {
-                    m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
-                }
-            }//display is already zeroed, so just return
-            m_cumulative[numBuckets - 1] = equalCount;//make sure the last one has all of them
-            if (numBuckets > 1)
-            {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-            } else {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+                ++m_equalCount;
             }
         }
         return;
     }
+    bool binning = (m_bucketMin != m_bucketMax);
     float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)//do the histogram
+    for (int64_t i = 0; i < dataCount; ++i)
     {//count value classes
         if (data[i] != data[i])
         {
@@ -267,7 +201,7 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
         }
         if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
         {
-            if (!includeZeroValues) continue;//don't count what is excluded
+            if (m_limited && !m_includeZeroValues) continue;//don't count what is excluded
             ++m_zeroCount;
         } else {
             if (data[i] < 0.0f)
@@ -277,7 +211,7 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                     ++m_negInfCount;
                     continue;//skip neg infs
                 } else {
-                    if (data[i] > leastNegativeValueInclusive || data[i] < mostNegativeValueInclusive) continue;//exclude negatives outside range
+                    if (m_limited && (data[i] > m_leastNegativeLimit || data[i] < m_mostNegativeLimit)) continue;//exclude negatives outside range
                     ++m_negCount;
                 }
             } else {
@@ -286,17 +220,59 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                     ++m_infCount;
                     continue;//skip infs
                 } else {
-                    if (data[i] > mostPositiveValueInclusive || data[i] < leastPositiveValueInclusive) continue;//exclude negatives outside range
+                    if (m_limited && (data[i] > m_mostPositiveLimit || data[i] < m_leastPositiveLimit)) continue;//exclude positives outside range
                     ++m_posCount;
                 }
             }
         }
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
+        if (binning)
+        {
+            int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
+            if (bucket < 0) bucket = 0;//because of this
+            if (bucket >= numBuckets) bucket = numBuckets - 1;
+            CaretAssertVectorIndex(m_buckets, bucket);
+            ++m_buckets[bucket];
+        }
     }
+}
+
+void Histogram::finishBlocks()
+{
+    int numBuckets = (int)m_buckets.size();
+    if (m_limited && !m_limitsValid)
+    {
+        if (m_bucketMax == m_bucketMin)
+        {
+            if (m_bucketMax == 0.0f)
+            {
+                m_zeroCount = m_equalCount;
+            } else {
+                if (m_bucketMax < 0.0f)
+                {
+                    m_negCount = m_equalCount;
+                } else {
+                    m_posCount = m_equalCount;
+                }
+            }
+            splitEvenly(m_equalCount);
+        }
+        return;
+    }
+    int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
+    if (!m_limited)
+    {
+        if (totalValid == 0)
+        {
+            m_bucketMin = m_bucketMax = 0.0f;
+            return;//our arrays are already zeroed, so just return if no valid data
+        }
+        if (m_bucketMin == m_bucketMax)
+        {
+            splitEvenly(totalValid);
+            return;
+        }
+    }
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
     computeCumulative();
     for (int i = 0; i < numBuckets; ++i)
     {//compute display values by normalizing by bucket size
@@ -304,6 +280,28 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
     }
 }
 
+void Histogram::splitEvenly(const int64_t& totalCount)
+{
+    int numBuckets = (int)m_buckets.size();
+    for (int i = 0; i < numBuckets - 1; ++i)
+    {
+        m_cumulative[i] = (i + 1) * totalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
+        if (i == 0)
+        {
+            m_buckets[i] = m_cumulative[i];
+        } else {
+            m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+        }
+    }//display is already zeroed
+    m_cumulative[numBuckets - 1] = totalCount;//make sure the last one has all of them
+    if (numBuckets > 1)
+    {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+    } else {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+    }
+}
+
 void Histogram::computeCumulative()
 {
     int numBuckets = (int)m_buckets.size();
@@ -34,6 +34,10 @@ namespace caret
         float m_bucketMin, m_bucketMax;
         ///counts of each class of number
         int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+        ///value limits when using the limited range update, counts of values equal to the range when the limits are bad
+        bool m_limited, m_limitsValid, m_includeZeroValues;
+        float m_mostPositiveLimit, m_leastPositiveLimit, m_leastNegativeLimit, m_mostNegativeLimit;
+        int64_t m_equalCount;
         
         void resize(const int& buckets);
         
@@ -41,6 +45,8 @@ namespace caret
         
         void computeCumulative();
         
+        void splitEvenly(const int64_t& totalCount);
+        
     public:
         Histogram(const int& numBuckets = 100);
         
@@ -60,6 +66,21 @@ namespace caret
                     float mostNegativeValueInclusive,
                     const bool& includeZeroValues);
         
+        ///for data that isn't available in one array: set the range first (values outside it go into the end buckets), add each block of data, then finish
+        void startBlocks(const int& numBuckets, const float& bucketMin, const float& bucketMax);
+        
+        ///limited range version, the range comes from the limits rather than the data
+        void startBlocks(const int& numBuckets,
+                         float mostPositiveValueInclusive,
+                         float leastPositiveValueInclusive,
+                         float leastNegativeValueInclusive,
+                         float mostNegativeValueInclusive,
+                         const bool& includeZeroValues);
+        
+        void addBlock(const float* data, const int64_t& dataCount);
+        
+        void finishBlocks();
+        
         ///get raw counts (useful mathematically)
         const std::vector<int64_t>& getHistogramCounts() const { return m_buckets; }
         
@@ -1721,36 +1721,48 @@ void Border::readXML3(QXmlStreamReader& xml)
                 if (haveVertices) throw DataFileException("multiple Vertices elements in one BorderPart element");
                 QString vertexText = xml.readElementText();//errors on unexpected element
                 if (xml.hasError()) throw DataFileException("XML parsing error in Vertices: " + xml.errorString());
-                QStringList vertexStrings = vertexText.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-                int numItems = (int)vertexStrings.size();
+                if (!AString::toNumbersSeparatedByWhitespace(vertexText.constData(), vertexText.size(), vertices))
+                {//tokenize without a string per item, only split the text to report the bad item
+                    QStringList vertexStrings = vertexText.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+                    for (int i = 0; i < (int)vertexStrings.size(); ++i)
+                    {
+                        bool ok = false;
+                        vertexStrings[i].toInt(&ok);
+                        if (!ok) throw DataFileException("non-integer item in Vertices text: " + vertexStrings[i]);
+                    }
+                    throw DataFileException("non-integer item in Vertices text");
+                }
+                int numItems = (int)vertices.size();
                 if (numItems % 3 != 0) throw DataFileException("number of items in Vertices element text is not a multiple of 3");
                 for (int i = 0; i < numItems; ++i)
                 {
-                    bool ok = false;
-                    int tempVal = vertexStrings[i].toInt(&ok);
-                    if (!ok) throw DataFileException("non-integer item in Vertices text: " + vertexStrings[i]);
-                    if (tempVal < 0) throw DataFileException("negative value in Vertices");
-                    vertices.push_back(tempVal);
+                    if (vertices[i] < 0) throw DataFileException("negative value in Vertices");
                 }
                 haveVertices = true;
             } else if (name == "Weights") {
                 if (haveWeights) throw DataFileException("multiple Weights elements in one BorderPart element");
                 QString vertexText = xml.readElementText();//errors on unexpected element
                 if (xml.hasError()) throw DataFileException("XML parsing error in Weights: " + xml.errorString());
-                QStringList vertexStrings = vertexText.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-                int numItems = (int)vertexStrings.size();
+                if (!AString::toNumbersSeparatedByWhitespace(vertexText.constData(), vertexText.size(), weights))
+                {
+                    QStringList vertexStrings = vertexText.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+                    for (int i = 0; i < (int)vertexStrings.size(); ++i)
+                    {
+                        bool ok = false;
+                        vertexStrings[i].toFloat(&ok);
+                        if (!ok) throw DataFileException("non-numeric item in Weights text: " + vertexStrings[i]);
+                    }
+                    throw DataFileException("non-numeric item in Weights text");
+                }
+                int numItems = (int)weights.size();
                 if (numItems % 3 != 0) throw DataFileException("number of items in Weights element text is not a multiple of 3");
                 for (int i = 0; i < numItems; ++i)
                 {
-                    bool ok = false;
-                    float tempVal = vertexStrings[i].toFloat(&ok);
-                    if (!ok) throw DataFileException("non-numeric item in Weights text: " + vertexStrings[i]);
-                    if (tempVal < 0.0f)
+                    if (weights[i] < 0.0f)
                     {
                         CaretLogWarning("negative value in Weights, set to zero");
-                        tempVal = 0.0f;
+                        weights[i] = 0.0f;
                     }
-                    weights.push_back(tempVal);
                 }
                 haveWeights = true;
             } else {
@@ -1763,6 +1775,7 @@ void Border::readXML3(QXmlStreamReader& xml)
     if (!haveVertices || !haveWeights) throw DataFileException("BorderPart missing required Vertices or Weights element");
     if (vertices.size() != weights.size()) throw DataFileException("Vertices and Weights don't contain the same number of elements");
     int numPoints = (int)vertices.size() / 3;
+    m_points.reserve(numPoints);
     for (int i = 0; i < numPoints; ++i)
     {
         int i3 = i * 3;
@@ -24,11 +24,18 @@
 #undef __CARET_DATA_FILE_DECLARE__
 
 #include "CaretMappableDataFile.h"
+#include "CaretMutex.h"
 #include "DataFileContentInformation.h"
 #include "SceneClass.h"
 
 using namespace caret;
 
+namespace
+{
+    //files may be created by several threads at once
+    CaretMutex instanceIdentifierMutex;
+}
+
 
     
 /**
@@ -46,6 +53,7 @@ CaretDataFile::CaretDataFile(const DataFileTypeEnum::Enum dataFileType)
 SceneableInterface()
 {
     m_dataFileType = dataFileType;
+    m_dataFileInstanceIdentifier = createDataFileInstanceIdentifier();
     
     AString name = (DataFileTypeEnum::toName(m_dataFileType).toLower()
                     + "_file_"
@@ -74,6 +82,31 @@ CaretDataFile::getDataFileType() const
     return m_dataFileType; 
 }
 
+/**
+ * @return Identifier of this file instance.  Unlike the address of
+ * the file, the identifier is never used by another file instance
+ * so it may be used to identify data derived from the file after
+ * the file has been destroyed.
+ */
+int64_t
+CaretDataFile::getDataFileInstanceIdentifier() const
+{
+    return m_dataFileInstanceIdentifier;
+}
+
+/**
+ * @return A new, unique file instance identifier.
+ */
+int64_t
+CaretDataFile::createDataFileInstanceIdentifier()
+{
+    CaretMutexLocker locker(&instanceIdentifierMutex);
+    
+    const int64_t identifier = s_dataFileInstanceIdentifierCounter;
+    s_dataFileInstanceIdentifierCounter++;
+    return identifier;
+}
+
 /**
  * Override the default data type for the file.
  * Use this with extreme caution as using a type invalid
@@ -97,6 +130,7 @@ CaretDataFile::CaretDataFile(const CaretDataFile& cdf)
 : DataFile(cdf),
 SceneableInterface(cdf)
 {
+    m_dataFileInstanceIdentifier = createDataFileInstanceIdentifier();
     copyDataCaretDataFile(cdf);
 }
 
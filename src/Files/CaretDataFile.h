@@ -54,6 +54,8 @@ namespace caret {
         
         DataFileTypeEnum::Enum getDataFileType() const;
         
+        int64_t getDataFileInstanceIdentifier() const;
+        
         /**
          * @return Get access to the file's metadata.
          */
@@ -101,17 +103,26 @@ namespace caret {
     private:
         void copyDataCaretDataFile(const CaretDataFile& cdf);
         
+        static int64_t createDataFileInstanceIdentifier();
+        
         DataFileTypeEnum::Enum m_dataFileType;
         
+        /** Identifies this instance, never reused by another instance */
+        int64_t m_dataFileInstanceIdentifier;
+        
         /** A counter that is used when creating default file names */
         static int64_t s_defaultFileNameCounter;
         
+        /** A counter that is used when creating instance identifiers */
+        static int64_t s_dataFileInstanceIdentifierCounter;
+        
         static AString s_fileReadingUsername;
         static AString s_fileReadingPassword;
     };
     
 #ifdef __CARET_DATA_FILE_DECLARE__
     int64_t CaretDataFile::s_defaultFileNameCounter = 1;
+    int64_t CaretDataFile::s_dataFileInstanceIdentifierCounter = 1;
     AString CaretDataFile::s_fileReadingUsername = "";
     AString CaretDataFile::s_fileReadingPassword = "";
 #endif // __CARET_DATA_FILE_DECLARE__
@@ -24,6 +24,7 @@
 
 #include "CaretMappableDataFile.h"
 #include "CiftiMappableDataFile.h"
+#include "DrawnWithOpenGLTextureInfo.h"
 
 using namespace caret;
 
@@ -33,6 +34,21 @@ using namespace caret;
  * \ingroup Files
  */
 
+/**
+ * Constructor.
+ */
+ChartableMatrixInterface::ChartableMatrixInterface()
+: m_matrixChartTextureColoringKey(0)
+{
+}
+
+/**
+ * Destructor.
+ */
+ChartableMatrixInterface::~ChartableMatrixInterface()
+{
+    clearMatrixChartTextureInfo();
+}
 
 /**
  * Is the given chart data type supported by this file.
@@ -105,4 +121,49 @@ ChartableMatrixInterface::getMatrixChartCiftiMappableDataFile() const
     return cmdf;
 }
 
+/**
+ * Get the texture information used for drawing the matrix coloring as
+ * OpenGL textures.  A large matrix is drawn as several textures (tiles).
+ * The texture information is created when first requested and replaced
+ * when the coloring key or number of textures changes.  Replacing the
+ * texture information releases the textures in all windows so that
+ * each window will load the new coloring into new textures.
+ *
+ * @param coloringKey
+ *     Key that identifies the current coloring (a hash of the coloring).
+ * @param numberOfTextures
+ *     Number of textures needed for the matrix.
+ * @param textureInfoOut
+ *     Output containing the texture information for each texture.
+ */
+void
+ChartableMatrixInterface::getMatrixChartTextureInfo(const uint64_t coloringKey,
+                                                    const int32_t numberOfTextures,
+                                                    std::vector<DrawnWithOpenGLTextureInfo*>& textureInfoOut)
+{
+    CaretAssert(numberOfTextures >= 0);
+    if ((coloringKey != m_matrixChartTextureColoringKey)
+        || (numberOfTextures != static_cast<int32_t>(m_matrixChartTextureInfo.size()))) {
+        clearMatrixChartTextureInfo();
+        for (int32_t i = 0; i < numberOfTextures; i++) {
+            m_matrixChartTextureInfo.push_back(new DrawnWithOpenGLTextureInfo());
+        }
+        m_matrixChartTextureColoringKey = coloringKey;
+    }
+    
+    textureInfoOut = m_matrixChartTextureInfo;
+}
 
+/**
+ * Delete the texture information which releases any textures.
+ */
+void
+ChartableMatrixInterface::clearMatrixChartTextureInfo()
+{
+    for (std::vector<DrawnWithOpenGLTextureInfo*>::iterator iter = m_matrixChartTextureInfo.begin();
+         iter != m_matrixChartTextureInfo.end();
+         iter++) {
+        delete *iter;
+    }
+    m_matrixChartTextureInfo.clear();
+}
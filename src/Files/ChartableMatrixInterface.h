@@ -21,6 +21,9 @@
  */
 /*LICENSE_END*/
 
+#include <stdint.h>
+#include <vector>
+
 #include "CaretColorEnum.h"
 #include "ChartDataTypeEnum.h"
 #include "ChartMatrixLoadingDimensionEnum.h"
@@ -33,13 +36,14 @@ namespace caret {
     class ChartMatrixDisplayProperties;
     class CiftiMappableDataFile;
     class CiftiParcelsMap;
+    class DrawnWithOpenGLTextureInfo;
     
     class ChartableMatrixInterface {
         
     protected:
-        ChartableMatrixInterface() { }
+        ChartableMatrixInterface();
         
-        virtual ~ChartableMatrixInterface() { }
+        virtual ~ChartableMatrixInterface();
         
     public:
         /**
@@ -159,6 +163,10 @@ namespace caret {
         
         bool isMatrixChartDataTypeSupported(const ChartDataTypeEnum::Enum chartDataType) const;
         
+        void getMatrixChartTextureInfo(const uint64_t coloringKey,
+                                       const int32_t numberOfTextures,
+                                       std::vector<DrawnWithOpenGLTextureInfo*>& textureInfoOut);
+        
         // ADD_NEW_METHODS_HERE
         
     private:
@@ -166,6 +174,14 @@ namespace caret {
         
         ChartableMatrixInterface& operator=(const ChartableMatrixInterface&);
         
+        void clearMatrixChartTextureInfo();
+        
+        /** Textures (tiles) holding the matrix coloring when drawn by OpenGL */
+        std::vector<DrawnWithOpenGLTextureInfo*> m_matrixChartTextureInfo;
+        
+        /** Identifies the coloring that is in the textures */
+        uint64_t m_matrixChartTextureColoringKey;
+        
         // ADD_NEW_MEMBERS_HERE
         
     };
@@ -18,6 +18,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <set>
 
 #define __CIFTI_MAPPABLE_DATA_FILE_DECLARE__
@@ -53,6 +54,29 @@
 
 using namespace caret;
 
+namespace {
+    /**
+     * Summarizes rows of data as they are read into memory.
+     */
+    class FileDataSummaryRowObserver : public CiftiFile::RowObserver {
+    public:
+        FileDataSummaryRowObserver(FastStatistics::BlockSummary& summary)
+        : m_summary(summary) { }
+        
+        virtual void restart() {
+            m_summary.reset();
+        }
+        
+        virtual void rowRead(const float* data,
+                             const int64_t& rowSize) {
+            m_summary.addData(data,
+                              rowSize);
+        }
+        
+    private:
+        FastStatistics::BlockSummary& m_summary;
+    };
+}
 
     
 /**
@@ -90,6 +114,7 @@ CiftiMappableDataFile::CiftiMappableDataFile(const DataFileTypeEnum::Enum dataFi
     m_dataMappingDirectionForCiftiXML = S_CIFTI_XML_ALONG_INVALID;
     m_dataReadingDirectionForCiftiXML = S_CIFTI_XML_ALONG_INVALID;
     
+    m_fileDataSummary.grabNew(NULL);
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
@@ -426,6 +451,7 @@ CiftiMappableDataFile::clearPrivate()
      */
     
     m_ciftiFile.grabNew(NULL);
+    m_fileDataSummary.grabNew(NULL);
     
     resetDataLoadingMembers();
     
@@ -611,7 +637,7 @@ CiftiMappableDataFile::readFile(const AString& ciftiMapFileName)
                 tempFile.readFile(ciftiMapFileName);
                 m_ciftiFile.grabNew(new CiftiFile());
                 m_ciftiFile->openFile(tempFile.getFileName());
-                m_ciftiFile->convertToInMemory();
+                convertFileDataToMemory();
             }
             else {
                 m_ciftiFile.grabNew(new CiftiFile());
@@ -653,7 +679,7 @@ CiftiMappableDataFile::readFile(const AString& ciftiMapFileName)
                     
                     switch (m_fileDataReadingType) {
                         case FILE_READ_DATA_ALL:
-                            m_ciftiFile->convertToInMemory();
+                            convertFileDataToMemory();
                             break;
                         case FILE_READ_DATA_AS_NEEDED:
                             break;
@@ -1336,6 +1362,14 @@ CiftiMappableDataFile::setMapData(const int32_t mapIndex,
     m_forceUpdateOfGroupAndNameHierarchy = true;
     
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    
+    /*
+     * Statistics on all data in the file are now stale
+     */
+    m_fileDataSummary.grabNew(NULL);
+    m_fileFastStatistics.grabNew(NULL);
+    m_fileHistogram.grabNew(NULL);
+    m_fileHistorgramLimitedValues.grabNew(NULL);
 }
 
 /**
@@ -1398,6 +1432,78 @@ CiftiMappableDataFile::getFileData(std::vector<float>& data) const
     }
 }
 
+/**
+ * Read all of the file's data into memory.  The data is summarized
+ * as it is read so that statistics and histograms on all data in the
+ * file do not need an extra pass through the data.
+ */
+void
+CiftiMappableDataFile::convertFileDataToMemory()
+{
+    CaretAssert(m_ciftiFile);
+    
+    CaretPointer<FastStatistics::BlockSummary> summary(new FastStatistics::BlockSummary());
+    FileDataSummaryRowObserver observer(*summary);
+    m_ciftiFile->convertToInMemory(CiftiFile::MEMORY_NATIVE_INTEGER,
+                                   &observer);
+    
+    /*
+     * Summary is not made if the data was already in memory
+     */
+    const int64_t dataCount = (m_ciftiFile->getNumberOfRows()
+                               * m_ciftiFile->getNumberOfColumns());
+    if ((dataCount > 0)
+        && (summary->getDataCount() == dataCount)) {
+        m_fileDataSummary = summary;
+    }
+    else {
+        m_fileDataSummary.grabNew(NULL);
+    }
+}
+
+/**
+ * @return Number of rows in each block when computing statistics and
+ * histograms on all data in the file, so that all of the file's data
+ * is not copied into one array.
+ */
+int64_t
+CiftiMappableDataFile::getFileDataRowsPerBlock() const
+{
+    CaretAssert(m_ciftiFile);
+    const int64_t blockElementCount = 4 * 1024 * 1024;
+    const int64_t numCols = std::max(m_ciftiFile->getNumberOfColumns(),
+                                     static_cast<int64_t>(1));
+    return std::max(blockElementCount / numCols,
+                    static_cast<int64_t>(1));
+}
+
+/**
+ * Get a block of consecutive rows of the file's data.
+ *
+ * @param firstRow
+ *    Index of first row in the block.
+ * @param numberOfRows
+ *    Number of rows in the block (fewer at the end of the file).
+ * @param dataOut
+ *    Filled with data from the rows.
+ */
+void
+CiftiMappableDataFile::getFileDataRowBlock(const int64_t firstRow,
+                                           const int64_t numberOfRows,
+                                           std::vector<float>& dataOut) const
+{
+    CaretAssert(m_ciftiFile);
+    const int64_t numCols = m_ciftiFile->getNumberOfColumns();
+    const int64_t lastRow = std::min(firstRow + numberOfRows,
+                                     m_ciftiFile->getNumberOfRows());
+    dataOut.resize((lastRow - firstRow) * numCols);
+    
+    for (int64_t iRow = firstRow; iRow < lastRow; iRow++) {
+        m_ciftiFile->getRow(&dataOut[(iRow - firstRow) * numCols],
+                            iRow);
+    }
+}
+
 /**
  * Get the RGBA mapped version of the file's data matrix.
  *
@@ -1609,12 +1715,54 @@ const FastStatistics*
 CiftiMappableDataFile::getFileFastStatistics()
 {
     if (m_fileFastStatistics == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
+        CaretAssert(m_ciftiFile);
+        
+        /*
+         * Statistics are computed from blocks of rows so that all of
+         * the file's data is never copied into one array.  The counts
+         * and ranges needed by the pass for the deviation and
+         * percentile histograms are made while the file is read or,
+         * if not available, by a first pass through the blocks.
+         */
+        const int64_t numRows = ((m_ciftiFile->getNumberOfColumns() > 0)
+                                 ? m_ciftiFile->getNumberOfRows()
+                                 : 0);
+        const int64_t rowsPerBlock = getFileDataRowsPerBlock();
+        std::vector<float> blockData;
+        bool blockDataValid = false;
+        if (m_fileDataSummary == NULL) {
+            CaretPointer<FastStatistics::BlockSummary> fileSummary(new FastStatistics::BlockSummary());
+            for (int64_t iRow = 0; iRow < numRows; iRow += rowsPerBlock) {
+                getFileDataRowBlock(iRow,
+                                    rowsPerBlock,
+                                    blockData);
+                fileSummary->addData(&blockData[0],
+                                     blockData.size());
+            }
+            m_fileDataSummary = fileSummary;
+            blockDataValid = (numRows <= rowsPerBlock);
+        }
+        
+        if (m_fileDataSummary->getDataCount() > 0) {
             m_fileFastStatistics.grabNew(new FastStatistics());
-            m_fileFastStatistics->update(&fileData[0],
-                                         fileData.size());
+            m_fileFastStatistics->startBlocks(*m_fileDataSummary);
+            if (blockDataValid) {
+                /*
+                 * Only one block and it has already been read
+                 */
+                m_fileFastStatistics->addBlock(&blockData[0],
+                                               blockData.size());
+            }
+            else {
+                for (int64_t iRow = 0; iRow < numRows; iRow += rowsPerBlock) {
+                    getFileDataRowBlock(iRow,
+                                        rowsPerBlock,
+                                        blockData);
+                    m_fileFastStatistics->addBlock(&blockData[0],
+                                                   blockData.size());
+                }
+            }
+            m_fileFastStatistics->finishBlocks();
         }
     }
     
@@ -1634,12 +1782,43 @@ const Histogram*
 CiftiMappableDataFile::getFileHistogram()
 {
     if (m_fileHistogram == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
+        /*
+         * The summary of the file's data, usually made while the
+         * file is read, provides the range of the data so that the
+         * histogram only needs one pass through the blocks.
+         */
+        float dataMinimum = 0.0;
+        float dataMaximum = 0.0;
+        bool haveRangeFlag = false;
+        if (m_fileDataSummary != NULL) {
+            dataMinimum = m_fileDataSummary->getMin();
+            dataMaximum = m_fileDataSummary->getMax();
+            haveRangeFlag = (m_fileDataSummary->getDataCount() > 0);
+        }
+        else {
+            const FastStatistics* fileStatistics = getFileFastStatistics();
+            if (fileStatistics != NULL) {
+                dataMinimum = fileStatistics->getMin();
+                dataMaximum = fileStatistics->getMax();
+                haveRangeFlag = true;
+            }
+        }
+        if (haveRangeFlag) {
             m_fileHistogram.grabNew(new Histogram());
-            m_fileHistogram->update(&fileData[0],
-                                    fileData.size());
+            m_fileHistogram->startBlocks(m_fileHistogram->getNumberOfBuckets(),
+                                         dataMinimum,
+                                         dataMaximum);
+            const int64_t numRows = m_ciftiFile->getNumberOfRows();
+            const int64_t rowsPerBlock = getFileDataRowsPerBlock();
+            std::vector<float> blockData;
+            for (int64_t iRow = 0; iRow < numRows; iRow += rowsPerBlock) {
+                getFileDataRowBlock(iRow,
+                                    rowsPerBlock,
+                                    blockData);
+                m_fileHistogram->addBlock(&blockData[0],
+                                          blockData.size());
+            }
+            m_fileHistogram->finishBlocks();
         }
     }
     return m_fileHistogram;
@@ -1686,19 +1865,34 @@ CiftiMappableDataFile::getFileHistogram(const float mostPositiveValueInclusive,
     }
     
     if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
+        CaretAssert(m_ciftiFile);
+        const int64_t numRows = m_ciftiFile->getNumberOfRows();
+        const int64_t numCols = m_ciftiFile->getNumberOfColumns();
+        if ((numRows * numCols) > 0) {
             if (m_fileHistorgramLimitedValues == NULL) {
                 m_fileHistorgramLimitedValues.grabNew(new Histogram());
             }
-            m_fileHistorgramLimitedValues->update(&fileData[0],
-                                                  fileData.size(),
-                                                  mostPositiveValueInclusive,
-                                                  leastPositiveValueInclusive,
-                                                  leastNegativeValueInclusive,
-                                                  mostNegativeValueInclusive,
-                                                  includeZeroValues);
+            
+            /*
+             * Range of histogram comes from the limits so only
+             * one pass through blocks of rows is needed.
+             */
+            m_fileHistorgramLimitedValues->startBlocks(m_fileHistorgramLimitedValues->getNumberOfBuckets(),
+                                                       mostPositiveValueInclusive,
+                                                       leastPositiveValueInclusive,
+                                                       leastNegativeValueInclusive,
+                                                       mostNegativeValueInclusive,
+                                                       includeZeroValues);
+            const int64_t rowsPerBlock = getFileDataRowsPerBlock();
+            std::vector<float> blockData;
+            for (int64_t iRow = 0; iRow < numRows; iRow += rowsPerBlock) {
+                getFileDataRowBlock(iRow,
+                                    rowsPerBlock,
+                                    blockData);
+                m_fileHistorgramLimitedValues->addBlock(&blockData[0],
+                                                        blockData.size());
+            }
+            m_fileHistorgramLimitedValues->finishBlocks();
             
             m_fileHistogramLimitedValuesMostPositiveValueInclusive  = mostPositiveValueInclusive;
             m_fileHistogramLimitedValuesLeastPositiveValueInclusive = leastPositiveValueInclusive;
@@ -27,6 +27,7 @@
 #include "CiftiMappingType.h"
 #include "CiftiXMLElements.h"
 #include "DisplayGroupEnum.h"
+#include "FastStatistics.h"
 #include "VolumeMappableInterface.h"
 
 #include <set>
@@ -38,7 +39,6 @@ namespace caret {
     class CiftiFile;
     class CiftiParcelsMap;
     class CiftiXML;
-    class FastStatistics;
     class GroupAndNameHierarchyModel;
     class Histogram;
     class SparseVolumeIndexer;
@@ -627,6 +627,14 @@ namespace caret {
         
         void clearPrivate();
         
+        void convertFileDataToMemory();
+        
+        int64_t getFileDataRowsPerBlock() const;
+        
+        void getFileDataRowBlock(const int64_t firstRow,
+                                 const int64_t numberOfRows,
+                                 std::vector<float>& dataOut) const;
+        
     protected:
         void initializeAfterReading(const AString& filename);
         
@@ -713,6 +721,9 @@ namespace caret {
         
         NiftiTimeUnitsEnum::Enum m_mappingTimeUnits;
         
+        /** Counts and ranges of all data in file, made while the file is read, NULL if not available */
+        CaretPointer<FastStatistics::BlockSummary> m_fileDataSummary;
+        
         /** Fast statistics used when statistics computed on all data in file */
         CaretPointer<FastStatistics> m_fileFastStatistics;
         
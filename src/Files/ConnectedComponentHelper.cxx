@@ -0,0 +1,174 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ConnectedComponentHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t MIN_CHUNK_SIZE = 65536;//don't split small inputs across threads
+
+    //path halving, roots are always the lowest index in their set
+    inline int64_t findRoot(int64_t* parents, int64_t index)
+    {
+        while (parents[index] != index)
+        {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    }
+
+    inline void joinSets(int64_t* parents, const int64_t& first, const int64_t& second)
+    {
+        int64_t firstRoot = findRoot(parents, first), secondRoot = findRoot(parents, second);
+        if (firstRoot < secondRoot)
+        {
+            parents[secondRoot] = firstRoot;
+        } else if (secondRoot < firstRoot) {
+            parents[firstRoot] = secondRoot;
+        }
+    }
+}
+
+ConnectedComponentHelper::ConnectedComponentHelper(const TopologyHelper* myTopoHelp)
+{
+    m_isVolume = false;
+    m_dims[0] = 0; m_dims[1] = 0; m_dims[2] = 0;
+    m_numElements = myTopoHelp->getNumberOfNodes();
+    m_neighStarts.resize(m_numElements + 1);
+    m_neighStarts[0] = 0;
+    for (int32_t i = 0; i < (int32_t)m_numElements; ++i)
+    {
+        int32_t numNeigh = 0;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        m_neighbors.insert(m_neighbors.end(), neighbors, neighbors + numNeigh);
+        m_neighStarts[i + 1] = (int64_t)m_neighbors.size();
+    }
+}
+
+ConnectedComponentHelper::ConnectedComponentHelper(const int64_t dims[3])
+{
+    m_isVolume = true;
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    m_numElements = dims[0] * dims[1] * dims[2];
+}
+
+//joins an element with its marked neighbors that have lower indices, so each edge is only visited once
+//neighbors before rangeStart belong to another thread's range, so they are saved for the serial pass instead
+void ConnectedComponentHelper::joinLowerNeighbors(const int64_t& index, const int64_t& rangeStart, const char* marked, int64_t* parents, vector<int64_t>& crossJoins) const
+{
+    if (m_isVolume)
+    {
+        const int64_t sliceSize = m_dims[0] * m_dims[1];
+        int64_t lower[3];
+        int numLower = 0;
+        if (index % m_dims[0] != 0) lower[numLower++] = index - 1;
+        if ((index / m_dims[0]) % m_dims[1] != 0) lower[numLower++] = index - m_dims[0];
+        if (index >= sliceSize) lower[numLower++] = index - sliceSize;
+        for (int n = 0; n < numLower; ++n)
+        {
+            if (!marked[lower[n]]) continue;
+            if (lower[n] < rangeStart)
+            {
+                crossJoins.push_back(index);
+                crossJoins.push_back(lower[n]);
+            } else {
+                joinSets(parents, index, lower[n]);
+            }
+        }
+    } else {
+        const int64_t end = m_neighStarts[index + 1];
+        for (int64_t n = m_neighStarts[index]; n < end; ++n)
+        {
+            const int64_t neighbor = m_neighbors[n];
+            if (neighbor >= index || !marked[neighbor]) continue;
+            if (neighbor < rangeStart)
+            {
+                crossJoins.push_back(index);
+                crossJoins.push_back(neighbor);
+            } else {
+                joinSets(parents, index, neighbor);
+            }
+        }
+    }
+}
+
+int64_t ConnectedComponentHelper::labelComponents(const vector<char>& marked, vector<int64_t>& labelsOut) const
+{
+    CaretAssert((int64_t)marked.size() == m_numElements);
+    vector<int64_t> parents(m_numElements);
+    int numChunks = 1;
+#ifdef CARET_OMP
+    if (!omp_in_parallel() && m_numElements >= 2 * MIN_CHUNK_SIZE)
+    {//when labeling many maps at once, each map is labeled by a single thread
+        numChunks = min((int64_t)omp_get_max_threads(), m_numElements / MIN_CHUNK_SIZE);
+    }
+#endif
+    vector<vector<int64_t> > crossJoins(numChunks);
+#pragma omp CARET_PARFOR schedule(static, 1) if (numChunks > 1)
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {//each chunk only modifies the parents within its own range
+        const int64_t rangeStart = m_numElements * chunk / numChunks, rangeEnd = m_numElements * (chunk + 1) / numChunks;
+        for (int64_t i = rangeStart; i < rangeEnd; ++i)
+        {
+            parents[i] = (marked[i] ? i : -1);
+        }
+        for (int64_t i = rangeStart; i < rangeEnd; ++i)
+        {
+            if (marked[i]) joinLowerNeighbors(i, rangeStart, marked.data(), parents.data(), crossJoins[chunk]);
+        }
+    }
+    for (int chunk = 1; chunk < numChunks; ++chunk)
+    {
+        const vector<int64_t>& thisJoins = crossJoins[chunk];
+        for (size_t i = 0; i < thisJoins.size(); i += 2)
+        {
+            joinSets(parents.data(), thisJoins[i], thisJoins[i + 1]);
+        }
+    }
+    labelsOut.resize(m_numElements);
+    int64_t numComponents = 0;
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {//the root of each set is its lowest index, so it gets labeled before any other member
+        if (parents[i] < 0)
+        {
+            labelsOut[i] = -1;
+        } else {
+            int64_t root = findRoot(parents.data(), i);
+            if (root == i)
+            {
+                labelsOut[i] = numComponents;
+                ++numComponents;
+            } else {
+                labelsOut[i] = labelsOut[root];
+            }
+        }
+    }
+    return numComponents;
+}
@@ -0,0 +1,56 @@
+#ifndef __CONNECTED_COMPONENT_HELPER_H__
+#define __CONNECTED_COMPONENT_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    class TopologyHelper;
+
+    //labels connected components of marked vertices or voxels with union-find, instead of a flood fill per component
+    //takes a snapshot of the neighbor structure, labelComponents() is const so multiple maps can be labeled concurrently
+    class ConnectedComponentHelper
+    {
+        std::vector<int64_t> m_neighStarts;//surface: vertex neighbors in compressed rows
+        std::vector<int32_t> m_neighbors;
+        int64_t m_dims[3];//volume: face neighbors (6-connected) are computed from the dimensions
+        int64_t m_numElements;
+        bool m_isVolume;
+
+        void joinLowerNeighbors(const int64_t& index, const int64_t& rangeStart, const char* marked, int64_t* parents, std::vector<int64_t>& crossJoins) const;
+    public:
+        ConnectedComponentHelper(const TopologyHelper* myTopoHelp);
+        ConnectedComponentHelper(const int64_t dims[3]);
+
+        int64_t getNumberOfElements() const { return m_numElements; }
+
+        //nonzero in marked means the element is included, unmarked elements get label -1
+        //components are numbered from 0 in order of their lowest index, which is the order a flood fill in index order finds them
+        //returns the number of components
+        int64_t labelComponents(const std::vector<char>& marked, std::vector<int64_t>& labelsOut) const;
+    };
+
+}
+
+#endif //__CONNECTED_COMPONENT_HELPER_H__
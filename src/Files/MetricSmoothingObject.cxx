@@ -46,7 +46,7 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != (int32_t)m_weightSums.size())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +54,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != (int32_t)m_weightSums.size() || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(m_weightSums.size(), 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != (int32_t)m_weightSums.size())
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +75,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != (int32_t)m_weightSums.size())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != (int32_t)m_weightSums.size())
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightSums.size()))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,18 +113,18 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != (int32_t)m_weightSums.size())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != (int32_t)m_weightSums.size() || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(m_weightSums.size(), numCols);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != (int32_t)m_weightSums.size())
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -140,6 +140,61 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     }
 }
 
+void MetricSmoothingObject::smoothValues(const float* valuesIn, float* valuesOut, const vector<bool>* roiLookup) const
+{
+    CaretAssert(valuesIn != NULL);
+    CaretAssert(valuesOut != NULL);
+    CaretAssert(valuesIn != valuesOut);
+    CaretAssert(roiLookup == NULL || roiLookup->size() == m_weightSums.size());
+    int32_t numNodes = (int32_t)m_weightSums.size();
+    if (roiLookup == NULL)
+    {
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            if (m_weightSums[i] != 0.0f)
+            {
+                float sum = 0.0f;
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
+                {
+                    sum += m_weights[j] * valuesIn[m_weightNodes[j]];
+                }
+                valuesOut[i] = sum / m_weightSums[i];
+            } else {
+                valuesOut[i] = 0.0f;
+            }
+        }
+    } else {
+        const vector<bool>& roiRef = *roiLookup;
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            if (roiRef[i] && m_weightSums[i] != 0.0f)
+            {
+                float sum = 0.0f, weightsum = 0.0f;
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
+                {
+                    int32_t neighbor = m_weightNodes[j];
+                    if (roiRef[neighbor])
+                    {
+                        float weight = m_weights[j];
+                        sum += weight * valuesIn[neighbor];
+                        weightsum += weight;
+                    }
+                }
+                if (weightsum != 0.0f)
+                {
+                    valuesOut[i] = sum / weightsum;
+                } else {
+                    valuesOut[i] = 0.0f;
+                }
+            } else {
+                valuesOut[i] = 0.0f;
+            }
+        }
+    }
+}
+
 void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
@@ -154,17 +209,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[m_weightNodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +237,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += m_weights[j] * myColumn[m_weightNodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -218,18 +271,17 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_weightNodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +300,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t weightEnd = m_weightStarts[i + 1];
+                for (int64_t j = m_weightStarts[i]; j < weightEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_weightNodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -671,4 +722,34 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    flattenWeights();
+}
+
+void MetricSmoothingObject::flattenWeights()
+{//compressed sparse rows, so the smoothing loops walk contiguous memory instead of a separate allocation per node
+    int32_t numNodes = (int32_t)m_weightLists.size();
+    m_weightStarts.resize(numNodes + 1);
+    m_weightSums.resize(numNodes);
+    int64_t total = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_weightStarts[i] = total;
+        total += (int64_t)m_weightLists[i].m_nodes.size();
+    }
+    m_weightStarts[numNodes] = total;
+    m_weightNodes.resize(total);
+    m_weights.resize(total);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        const WeightList& myWeightRef = m_weightLists[i];
+        int64_t base = m_weightStarts[i];
+        int32_t numWeights = (int32_t)myWeightRef.m_nodes.size();
+        for (int32_t j = 0; j < numWeights; ++j)
+        {
+            m_weightNodes[base + j] = myWeightRef.m_nodes[j];
+            m_weights[base + j] = myWeightRef.m_weights[j];
+        }
+        m_weightSums[i] = (numWeights == 0 ? 0.0f : myWeightRef.m_weightSum);
+    }
+    vector<WeightList>().swap(m_weightLists);//release the per-node allocations
 }
@@ -52,6 +52,9 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        //for callers that parallelize over many columns themselves, uses no threading and no file objects, roiLookup acts like a per-call ROI
+        void smoothValues(const float* valuesIn, float* valuesOut, const std::vector<bool>* roiLookup = NULL) const;
+        int32_t getNumberOfNodes() const { return (int32_t)m_weightSums.size(); }
     private:
         struct WeightList
         {
@@ -59,7 +62,12 @@ namespace caret {
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        std::vector<WeightList> m_weightLists;//only used while computing weights, then flattened into the arrays below
+        std::vector<int64_t> m_weightStarts;//gathering kernel of node i is [m_weightStarts[i], m_weightStarts[i + 1])
+        std::vector<int32_t> m_weightNodes;
+        std::vector<float> m_weights;
+        std::vector<float> m_weightSums;
+        void flattenWeights();
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
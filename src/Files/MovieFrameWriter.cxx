@@ -0,0 +1,735 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "MovieFrameWriter.h"
+
+#include <exception>
+
+#include <QMutexLocker>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+
+using namespace caret;
+
+namespace {
+    /** Maximum frames waiting to be written, limits memory when capture is faster than writing */
+    const int32_t MAXIMUM_QUEUED_FRAMES = 4;
+
+    /** AVI 1.0 sizes are 32-bit and many readers treat them as signed */
+    const int64_t MAXIMUM_AVI_FILE_SIZE = 0x7FFFFFFF;
+
+    /** Sizes of the AVI header chunks */
+    const uint32_t AVI_MAIN_HEADER_SIZE   = 56;
+    const uint32_t AVI_STREAM_HEADER_SIZE = 56;
+    const uint32_t AVI_BITMAP_HEADER_SIZE = 40;
+    const uint32_t AVI_INDEX_ENTRY_SIZE   = 16;
+}
+
+/**
+ * \class caret::MovieFrameWriter
+ * \brief Writes captured images as the frames of an uncompressed movie.
+ * \ingroup Files
+ *
+ * Frames are converted and written by a worker thread while the
+ * caller continues rendering the next frame, so no image files
+ * are written and the movie is complete when recording finishes.
+ * The YUV4MPEG2 (.y4m) format is a stream and may be written to a
+ * pipe (such as an encoder's standard input).  The AVI (.avi) format
+ * contains uncompressed 24-bit frames and requires a file.
+ *
+ * All frames have the size of the first frame, frames with a
+ * different size are scaled.
+ */
+
+/**
+ * Get the movie format from a file's extension.
+ *
+ * @param fileName
+ *     Name of the file.
+ * @param formatOut
+ *     Output with the format.
+ * @return
+ *     True if the extension is a supported movie format, else false.
+ */
+bool
+MovieFrameWriter::getFormatFromFileName(const AString& fileName,
+                                        Format& formatOut)
+{
+    const AString lowerName = fileName.toLower();
+    if (lowerName.endsWith(".y4m")) {
+        formatOut = FORMAT_Y4M;
+        return true;
+    }
+    else if (lowerName.endsWith(".avi")) {
+        formatOut = FORMAT_AVI;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Constructor for writing a movie file.  The format is
+ * determined by the file's extension.
+ *
+ * @param fileName
+ *     Name of the movie file, ending in ".y4m" or ".avi".
+ * @param frameRateNumerator
+ *     Numerator of the frame rate in frames per second.
+ * @param frameRateDenominator
+ *     Denominator of the frame rate in frames per second.
+ * @throws DataFileException
+ *     If the format is not supported or the file cannot be created.
+ */
+MovieFrameWriter::MovieFrameWriter(const AString& fileName,
+                                   const int32_t frameRateNumerator,
+                                   const int32_t frameRateDenominator)
+{
+    m_fileName = fileName;
+    if ( ! getFormatFromFileName(fileName,
+                                 m_format)) {
+        throw DataFileException(fileName,
+                                "Movie file name must end with \".y4m\" or \".avi\"");
+    }
+
+    m_file.setFileName(fileName);
+    if ( ! m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw DataFileException(fileName,
+                                "Unable to create movie file: "
+                                + m_file.errorString());
+    }
+    if ((m_format == FORMAT_AVI)
+        && m_file.isSequential()) {
+        throw DataFileException(fileName,
+                                "AVI movies cannot be written to a pipe, use a \".y4m\" file");
+    }
+
+    initialize(frameRateNumerator,
+               frameRateDenominator);
+}
+
+/**
+ * Constructor for writing a YUV4MPEG2 stream to a pipe.  The
+ * pipe is not closed by this instance.
+ *
+ * @param pipeStream
+ *     The pipe, opened for writing.
+ * @param pipeDescription
+ *     Describes the pipe in error messages.
+ * @param frameRateNumerator
+ *     Numerator of the frame rate in frames per second.
+ * @param frameRateDenominator
+ *     Denominator of the frame rate in frames per second.
+ * @throws DataFileException
+ *     If the pipe is not valid.
+ */
+MovieFrameWriter::MovieFrameWriter(FILE* pipeStream,
+                                   const AString& pipeDescription,
+                                   const int32_t frameRateNumerator,
+                                   const int32_t frameRateDenominator)
+{
+    m_fileName = pipeDescription;
+    m_format = FORMAT_Y4M;
+
+    if ((pipeStream == NULL)
+        || ( ! m_file.open(pipeStream,
+                           QIODevice::WriteOnly))) {
+        throw DataFileException(pipeDescription,
+                                "Unable to write movie to pipe");
+    }
+
+    initialize(frameRateNumerator,
+               frameRateDenominator);
+}
+
+/**
+ * Destructor.  If finish() was not called (an exception is being
+ * thrown), frames already added are still written.
+ */
+MovieFrameWriter::~MovieFrameWriter()
+{
+    if (m_file.isOpen()) {
+        try {
+            finish();
+        }
+        catch (const DataFileException& dfe) {
+            CaretLogWarning(dfe.whatString());
+        }
+    }
+}
+
+/**
+ * Initialize members and start the writer thread.
+ *
+ * @param frameRateNumerator
+ *     Numerator of the frame rate in frames per second.
+ * @param frameRateDenominator
+ *     Denominator of the frame rate in frames per second.
+ */
+void
+MovieFrameWriter::initialize(const int32_t frameRateNumerator,
+                             const int32_t frameRateDenominator)
+{
+    if ((frameRateNumerator <= 0)
+        || (frameRateDenominator <= 0)) {
+        m_file.close();
+        throw DataFileException(m_fileName,
+                                "Invalid movie frame rate "
+                                + AString::number(frameRateNumerator)
+                                + "/"
+                                + AString::number(frameRateDenominator));
+    }
+    m_frameRateNumerator   = frameRateNumerator;
+    m_frameRateDenominator = frameRateDenominator;
+    m_width  = 0;
+    m_height = 0;
+    m_numberOfFramesAdded   = 0;
+    m_numberOfFramesWritten = 0;
+    m_resizeWarningIssued = false;
+    m_aviTotalFramesOffset  = -1;
+    m_aviStreamLengthOffset = -1;
+    m_aviMoviListOffset     = -1;
+    m_aviFrameChunkSize = 0;
+    m_finished = false;
+
+    m_thread = new WriterThread(this);
+    m_thread->start();
+}
+
+/**
+ * Add a frame to the movie.  The frame is written by the writer thread,
+ * this only waits when several frames are already waiting to be written.
+ *
+ * @param image
+ *     Image for the frame.
+ * @throws DataFileException
+ *     If writing a previous frame failed.
+ */
+void
+MovieFrameWriter::addFrame(const QImage& image)
+{
+    if (image.isNull()) {
+        throw DataFileException(m_fileName,
+                                "Movie frame image is invalid");
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while ((static_cast<int32_t>(m_queue.size()) >= MAXIMUM_QUEUED_FRAMES)
+           && m_errorMessage.isEmpty()) {
+        m_queueChanged.wait(&m_mutex);
+    }
+    if ( ! m_errorMessage.isEmpty()) {
+        throw DataFileException(m_fileName,
+                                m_errorMessage);
+    }
+    if (m_finished) {
+        throw DataFileException(m_fileName,
+                                "Movie frame added after the movie was finished");
+    }
+
+    if (m_numberOfFramesAdded == 0) {
+        m_width  = image.width();
+        m_height = image.height();
+    }
+    m_queue.push_back(image);
+    m_numberOfFramesAdded++;
+    m_queueChanged.wakeAll();
+}
+
+/**
+ * @return Number of frames that have been added.
+ */
+int64_t
+MovieFrameWriter::getNumberOfFramesAdded() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_numberOfFramesAdded;
+}
+
+/**
+ * Wait for all frames to be written and complete the movie file.
+ *
+ * @throws DataFileException
+ *     If writing the movie failed.
+ */
+void
+MovieFrameWriter::finish()
+{
+    waitForThread();
+
+    if ( ! m_file.isOpen()) {
+        return;
+    }
+
+    try {
+        if ( ! m_errorMessage.isEmpty()) {
+            throw DataFileException(m_fileName,
+                                    m_errorMessage);
+        }
+
+        if ((m_format == FORMAT_AVI)
+            && (m_numberOfFramesWritten > 0)) {
+            finishAVI();
+        }
+
+        if ( ! m_file.flush()) {
+            throw DataFileException(m_fileName,
+                                    "Error writing movie: "
+                                    + m_file.errorString());
+        }
+    }
+    catch (const DataFileException&) {
+        m_file.close();
+        throw;
+    }
+
+    m_file.close();
+}
+
+/**
+ * Tell the thread there are no more frames and wait for it to write
+ * the frames remaining in the queue.
+ */
+void
+MovieFrameWriter::waitForThread()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+        m_queueChanged.wakeAll();
+    }
+    if (m_thread != NULL) {
+        m_thread->wait();
+        delete m_thread;
+        m_thread = NULL;
+    }
+}
+
+/**
+ * Run by the writer thread, writes frames from the queue until finish is
+ * requested and the queue is empty or an error occurs.
+ */
+void
+MovieFrameWriter::writeQueuedFrames()
+{
+    while (true) {
+        QImage image;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.empty()
+                   && ( ! m_finished)) {
+                m_queueChanged.wait(&m_mutex);
+            }
+            if (m_queue.empty()) {
+                return;
+            }
+            image = m_queue.front();
+            m_queue.pop_front();
+            m_queueChanged.wakeAll();
+        }
+
+        /*
+         * An exception must not escape the thread, pass the error
+         * to the main thread which reports it in addFrame() or finish()
+         */
+        AString errorMessage;
+        try {
+            writeFrame(image);
+        }
+        catch (const DataFileException& dfe) {
+            errorMessage = dfe.whatString();
+        }
+        catch (const std::exception& e) {
+            errorMessage = ("Error writing movie frame: "
+                            + AString(e.what()));
+        }
+        catch (...) {
+            errorMessage = "Unknown error writing movie frame";
+        }
+        if ( ! errorMessage.isEmpty()) {
+            /*
+             * Discard remaining frames
+             */
+            QMutexLocker locker(&m_mutex);
+            m_errorMessage = errorMessage;
+            m_queue.clear();
+            m_queueChanged.wakeAll();
+            return;
+        }
+    }
+}
+
+/**
+ * Write a frame, called only by the writer thread.
+ *
+ * @param image
+ *     Image for the frame.
+ */
+void
+MovieFrameWriter::writeFrame(const QImage& image)
+{
+    if (m_numberOfFramesWritten == 0) {
+        writeHeader();
+    }
+
+    QImage frameImage = image;
+    if ((frameImage.width() != m_width)
+        || (frameImage.height() != m_height)) {
+        if ( ! m_resizeWarningIssued) {
+            CaretLogWarning("Movie frame size "
+                            + AString::number(frameImage.width())
+                            + "x"
+                            + AString::number(frameImage.height())
+                            + " differs from first frame size "
+                            + AString::number(m_width)
+                            + "x"
+                            + AString::number(m_height)
+                            + ", frames will be scaled to the first frame size.");
+            m_resizeWarningIssued = true;
+        }
+        frameImage = frameImage.scaled(m_width,
+                                       m_height,
+                                       Qt::IgnoreAspectRatio,
+                                       Qt::SmoothTransformation);
+    }
+    if (frameImage.format() != QImage::Format_RGB32) {
+        frameImage = frameImage.convertToFormat(QImage::Format_RGB32);
+    }
+
+    switch (m_format) {
+        case FORMAT_Y4M:
+            writeFrameY4M(frameImage);
+            break;
+        case FORMAT_AVI:
+            writeFrameAVI(frameImage);
+            break;
+    }
+
+    m_numberOfFramesWritten++;
+}
+
+/**
+ * Write the header of the movie, called when the first frame is written.
+ * Fields that depend upon the number of frames are updated by finishAVI().
+ */
+void
+MovieFrameWriter::writeHeader()
+{
+    CaretAssert((m_width > 0) && (m_height > 0));
+
+    switch (m_format) {
+        case FORMAT_Y4M:
+        {
+            /*
+             * Progressive, square pixels, full resolution chroma
+             */
+            const AString header = ("YUV4MPEG2 W"
+                                    + AString::number(m_width)
+                                    + " H"
+                                    + AString::number(m_height)
+                                    + " F"
+                                    + AString::number(m_frameRateNumerator)
+                                    + ":"
+                                    + AString::number(m_frameRateDenominator)
+                                    + " Ip A1:1 C444\n");
+            const QByteArray headerBytes = header.toAscii();
+            writeBytes(headerBytes.constData(),
+                       headerBytes.size());
+        }
+            break;
+        case FORMAT_AVI:
+        {
+            /*
+             * Rows of DIB are padded to four bytes
+             */
+            const uint32_t rowBytes = ((static_cast<uint32_t>(m_width) * 3 + 3) / 4) * 4;
+            m_aviFrameChunkSize = rowBytes * static_cast<uint32_t>(m_height);
+
+            const uint32_t streamListSize = (4
+                                             + 8 + AVI_STREAM_HEADER_SIZE
+                                             + 8 + AVI_BITMAP_HEADER_SIZE);
+            const uint32_t headerListSize = (4
+                                             + 8 + AVI_MAIN_HEADER_SIZE
+                                             + 8 + streamListSize);
+
+            writeChunkHeader("RIFF", 0);
+            writeBytes("AVI ", 4);
+
+            writeChunkHeader("LIST", headerListSize);
+            writeBytes("hdrl", 4);
+
+            writeChunkHeader("avih", AVI_MAIN_HEADER_SIZE);
+            writeUInt32(static_cast<uint32_t>((1000000.0 * m_frameRateDenominator) / m_frameRateNumerator));
+            writeUInt32(static_cast<uint32_t>((static_cast<double>(m_aviFrameChunkSize) * m_frameRateNumerator) / m_frameRateDenominator));
+            writeUInt32(0);      // padding granularity
+            writeUInt32(0x10);   // AVIF_HASINDEX
+            m_aviTotalFramesOffset = m_file.pos();
+            writeUInt32(0);      // total frames
+            writeUInt32(0);      // initial frames
+            writeUInt32(1);      // streams
+            writeUInt32(m_aviFrameChunkSize + 8);
+            writeUInt32(m_width);
+            writeUInt32(m_height);
+            for (int32_t i = 0; i < 4; i++) {
+                writeUInt32(0);  // reserved
+            }
+
+            writeChunkHeader("LIST", streamListSize);
+            writeBytes("strl", 4);
+
+            writeChunkHeader("strh", AVI_STREAM_HEADER_SIZE);
+            writeBytes("vids", 4);
+            writeBytes("DIB ", 4);
+            writeUInt32(0);      // flags
+            writeUInt16(0);      // priority
+            writeUInt16(0);      // language
+            writeUInt32(0);      // initial frames
+            writeUInt32(m_frameRateDenominator);
+            writeUInt32(m_frameRateNumerator);
+            writeUInt32(0);      // start
+            m_aviStreamLengthOffset = m_file.pos();
+            writeUInt32(0);      // length in frames
+            writeUInt32(m_aviFrameChunkSize);
+            writeUInt32(0xFFFFFFFF);  // quality, use default
+            writeUInt32(0);      // sample size
+            writeUInt16(0);      // frame rectangle
+            writeUInt16(0);
+            writeUInt16(static_cast<uint16_t>(m_width));
+            writeUInt16(static_cast<uint16_t>(m_height));
+
+            writeChunkHeader("strf", AVI_BITMAP_HEADER_SIZE);
+            writeUInt32(AVI_BITMAP_HEADER_SIZE);
+            writeUInt32(m_width);
+            writeUInt32(m_height);  // positive height is bottom to top rows
+            writeUInt16(1);      // planes
+            writeUInt16(24);     // bits per pixel
+            writeUInt32(0);      // BI_RGB, no compression
+            writeUInt32(m_aviFrameChunkSize);
+            for (int32_t i = 0; i < 4; i++) {
+                writeUInt32(0);  // resolution and colors
+            }
+
+            m_aviMoviListOffset = m_file.pos();
+            writeChunkHeader("LIST", 0);
+            writeBytes("movi", 4);
+        }
+            break;
+    }
+}
+
+/**
+ * Write a frame as YUV4MPEG2 with BT.601 colors.
+ *
+ * @param image
+ *     Image for the frame in RGB32 format.
+ */
+void
+MovieFrameWriter::writeFrameY4M(const QImage& image)
+{
+    writeBytes("FRAME\n", 6);
+
+    const int64_t planeSize = static_cast<int64_t>(m_width) * m_height;
+    m_frameBytes.resize(planeSize * 3);
+    unsigned char* yPlane = &m_frameBytes[0];
+    unsigned char* uPlane = yPlane + planeSize;
+    unsigned char* vPlane = uPlane + planeSize;
+
+    for (int32_t j = 0; j < m_height; j++) {
+        const QRgb* pixels = reinterpret_cast<const QRgb*>(image.scanLine(j));
+        const int64_t rowOffset = static_cast<int64_t>(j) * m_width;
+        for (int32_t i = 0; i < m_width; i++) {
+            const int32_t r = qRed(pixels[i]);
+            const int32_t g = qGreen(pixels[i]);
+            const int32_t b = qBlue(pixels[i]);
+            /*
+             * Offsets keep the shifted values positive
+             */
+            yPlane[rowOffset + i] = static_cast<unsigned char>(((  66 * r + 129 * g +  25 * b + 128) >> 8) + 16);
+            uPlane[rowOffset + i] = static_cast<unsigned char>(((( -38 * r -  74 * g + 112 * b + 128) + (128 << 8)) >> 8));
+            vPlane[rowOffset + i] = static_cast<unsigned char>((((112 * r -  94 * g -  18 * b + 128) + (128 << 8)) >> 8));
+        }
+    }
+
+    writeBytes(reinterpret_cast<const char*>(&m_frameBytes[0]),
+               m_frameBytes.size());
+}
+
+/**
+ * Write a frame as an uncompressed AVI chunk.
+ *
+ * @param image
+ *     Image for the frame in RGB32 format.
+ */
+void
+MovieFrameWriter::writeFrameAVI(const QImage& image)
+{
+    const int64_t frameOffset = m_file.pos();
+    const int64_t indexSize = static_cast<int64_t>(m_aviFrameOffsets.size() + 1) * AVI_INDEX_ENTRY_SIZE;
+    if ((frameOffset + 8 + m_aviFrameChunkSize + 8 + indexSize) > MAXIMUM_AVI_FILE_SIZE) {
+        throw DataFileException(m_fileName,
+                                "AVI movie would exceed 2GB after "
+                                + AString::number(m_numberOfFramesWritten)
+                                + " frames, use a \".y4m\" file for longer movies");
+    }
+
+    const uint32_t rowBytes = m_aviFrameChunkSize / m_height;
+    m_frameBytes.assign(m_aviFrameChunkSize, 0);
+
+    /*
+     * DIB rows are bottom to top, pixels are blue, green, red
+     */
+    for (int32_t j = 0; j < m_height; j++) {
+        const QRgb* pixels = reinterpret_cast<const QRgb*>(image.scanLine(m_height - 1 - j));
+        unsigned char* row = &m_frameBytes[static_cast<int64_t>(j) * rowBytes];
+        for (int32_t i = 0; i < m_width; i++) {
+            row[i * 3]     = static_cast<unsigned char>(qBlue(pixels[i]));
+            row[i * 3 + 1] = static_cast<unsigned char>(qGreen(pixels[i]));
+            row[i * 3 + 2] = static_cast<unsigned char>(qRed(pixels[i]));
+        }
+    }
+
+    /*
+     * Index offsets are relative to the "movi" identifier
+     */
+    m_aviFrameOffsets.push_back(static_cast<uint32_t>(frameOffset - (m_aviMoviListOffset + 8)));
+    writeChunkHeader("00db", m_aviFrameChunkSize);
+    writeBytes(reinterpret_cast<const char*>(&m_frameBytes[0]),
+               m_frameBytes.size());
+}
+
+/**
+ * Write the AVI index and update the sizes and frame counts in the header.
+ */
+void
+MovieFrameWriter::finishAVI()
+{
+    const int64_t indexOffset = m_file.pos();
+    const uint32_t numberOfFrames = static_cast<uint32_t>(m_aviFrameOffsets.size());
+    writeChunkHeader("idx1", numberOfFrames * AVI_INDEX_ENTRY_SIZE);
+    for (uint32_t i = 0; i < numberOfFrames; i++) {
+        writeBytes("00db", 4);
+        writeUInt32(0x10);   // AVIIF_KEYFRAME
+        writeUInt32(m_aviFrameOffsets[i]);
+        writeUInt32(m_aviFrameChunkSize);
+    }
+    const int64_t fileSize = m_file.pos();
+
+    writeUInt32At(4, static_cast<uint32_t>(fileSize - 8));
+    writeUInt32At(m_aviMoviListOffset + 4, static_cast<uint32_t>(indexOffset - (m_aviMoviListOffset + 8)));
+    writeUInt32At(m_aviTotalFramesOffset, numberOfFrames);
+    writeUInt32At(m_aviStreamLengthOffset, numberOfFrames);
+
+    if ( ! m_file.seek(fileSize)) {
+        throw DataFileException(m_fileName,
+                                "Error seeking in movie: "
+                                + m_file.errorString());
+    }
+}
+
+/**
+ * Write bytes to the movie.
+ *
+ * @param bytes
+ *     The bytes.
+ * @param numberOfBytes
+ *     Number of bytes.
+ */
+void
+MovieFrameWriter::writeBytes(const char* bytes,
+                             const int64_t numberOfBytes)
+{
+    if (m_file.write(bytes, numberOfBytes) != numberOfBytes) {
+        throw DataFileException(m_fileName,
+                                "Error writing movie: "
+                                + m_file.errorString());
+    }
+}
+
+/**
+ * Write a RIFF chunk header.
+ *
+ * @param fourCC
+ *     Identifier of the chunk.
+ * @param chunkSize
+ *     Size of the chunk's data.
+ */
+void
+MovieFrameWriter::writeChunkHeader(const char fourCC[4],
+                                   const uint32_t chunkSize)
+{
+    writeBytes(fourCC, 4);
+    writeUInt32(chunkSize);
+}
+
+/**
+ * Write a little endian 16-bit value.
+ *
+ * @param value
+ *     The value.
+ */
+void
+MovieFrameWriter::writeUInt16(const uint16_t value)
+{
+    const char bytes[2] = {
+        static_cast<char>(value & 0xFF),
+        static_cast<char>((value >> 8) & 0xFF)
+    };
+    writeBytes(bytes, 2);
+}
+
+/**
+ * Write a little endian 32-bit value.
+ *
+ * @param value
+ *     The value.
+ */
+void
+MovieFrameWriter::writeUInt32(const uint32_t value)
+{
+    const char bytes[4] = {
+        static_cast<char>(value & 0xFF),
+        static_cast<char>((value >> 8) & 0xFF),
+        static_cast<char>((value >> 16) & 0xFF),
+        static_cast<char>((value >> 24) & 0xFF)
+    };
+    writeBytes(bytes, 4);
+}
+
+/**
+ * Replace a little endian 32-bit value that was previously written.
+ *
+ * @param offset
+ *     Offset of the value in the file.
+ * @param value
+ *     The value.
+ */
+void
+MovieFrameWriter::writeUInt32At(const int64_t offset,
+                                const uint32_t value)
+{
+    if ( ! m_file.seek(offset)) {
+        throw DataFileException(m_fileName,
+                                "Error seeking in movie: "
+                                + m_file.errorString());
+    }
+    writeUInt32(value);
+}
@@ -0,0 +1,163 @@
+#ifndef __MOVIE_FRAME_WRITER_H__
+#define __MOVIE_FRAME_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "AString.h"
+
+namespace caret {
+
+    class MovieFrameWriter {
+
+    public:
+        /** Format of the movie file */
+        enum Format {
+            /** YUV4MPEG2 stream (4:4:4), may be written to a pipe */
+            FORMAT_Y4M,
+            /** AVI with uncompressed 24-bit frames, limited to 2GB */
+            FORMAT_AVI
+        };
+
+        static bool getFormatFromFileName(const AString& fileName,
+                                          Format& formatOut);
+
+        MovieFrameWriter(const AString& fileName,
+                         const int32_t frameRateNumerator,
+                         const int32_t frameRateDenominator);
+
+        MovieFrameWriter(FILE* pipeStream,
+                         const AString& pipeDescription,
+                         const int32_t frameRateNumerator,
+                         const int32_t frameRateDenominator);
+
+        ~MovieFrameWriter();
+
+        void addFrame(const QImage& image);
+
+        void finish();
+
+        int64_t getNumberOfFramesAdded() const;
+
+    private:
+        class WriterThread : public QThread {
+        public:
+            WriterThread(MovieFrameWriter* movieWriter) : m_movieWriter(movieWriter) { }
+            void run() { m_movieWriter->writeQueuedFrames(); }
+        private:
+            MovieFrameWriter* m_movieWriter;
+        };
+
+        MovieFrameWriter(const MovieFrameWriter&);
+
+        MovieFrameWriter& operator=(const MovieFrameWriter&);
+
+        void initialize(const int32_t frameRateNumerator,
+                        const int32_t frameRateDenominator);
+
+        void writeQueuedFrames();
+
+        void writeFrame(const QImage& image);
+
+        void writeHeader();
+
+        void writeFrameY4M(const QImage& image);
+
+        void writeFrameAVI(const QImage& image);
+
+        void finishAVI();
+
+        void writeBytes(const char* bytes,
+                        const int64_t numberOfBytes);
+
+        void writeChunkHeader(const char fourCC[4],
+                              const uint32_t chunkSize);
+
+        void writeUInt16(const uint16_t value);
+
+        void writeUInt32(const uint32_t value);
+
+        void writeUInt32At(const int64_t offset,
+                           const uint32_t value);
+
+        void waitForThread();
+
+        AString m_fileName;
+
+        Format m_format;
+
+        QFile m_file;
+
+        int32_t m_frameRateNumerator;
+
+        int32_t m_frameRateDenominator;
+
+        /** Size of all frames, from the first frame */
+        int32_t m_width;
+
+        int32_t m_height;
+
+        /** Frames added, including frames still in the queue */
+        int64_t m_numberOfFramesAdded;
+
+        /** Frames written by the writer thread */
+        int64_t m_numberOfFramesWritten;
+
+        bool m_resizeWarningIssued;
+
+        std::vector<unsigned char> m_frameBytes;
+
+        /** AVI offsets of header fields that are updated when finished */
+        int64_t m_aviTotalFramesOffset;
+
+        int64_t m_aviStreamLengthOffset;
+
+        int64_t m_aviMoviListOffset;
+
+        /** AVI offset and size of each frame chunk for the index */
+        std::vector<uint32_t> m_aviFrameOffsets;
+
+        uint32_t m_aviFrameChunkSize;
+
+        WriterThread* m_thread;
+
+        std::deque<QImage> m_queue;
+
+        mutable QMutex m_mutex;
+
+        QWaitCondition m_queueChanged;
+
+        bool m_finished;
+
+        AString m_errorMessage;
+    };
+
+} // namespace
+#endif  //__MOVIE_FRAME_WRITER_H__
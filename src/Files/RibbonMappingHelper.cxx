@@ -54,6 +54,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "TopologyHelper.h"
 #include "VolumeSpace.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -67,6 +68,7 @@ namespace
     {
         Vector3D m_xyz[3];
         float m_planeEq[3];//x coef, y coef, const : z = [0] * x + [1] * y + [2]
+        float m_xRange[2];//a point with x outside (min, max] can never pass the PNPOLY test, so check it before doing any math
         bool vertRayHit(const float* xyz);//true if a +z ray from point hits this triangle
         TriInfo(const float* xyz1, const float* xyz2, const float* xyz3);
         TriInfo() {};
@@ -75,6 +77,7 @@ namespace
     struct QuadInfo
     {
         TriInfo m_tris[2][2];
+        float m_xRange[2];
         int vertRayHit(const float* xyz);//+z ray intersect: 0 if never, 1 if only 1 of the 2 triangulations, 2 if both
         QuadInfo(const float* xyz1, const float* xyz2, const float* xyz3, const float* xyz4);
         QuadInfo() {};
@@ -84,6 +87,7 @@ namespace
     {
         std::vector<TriInfo> m_tris;
         std::vector<QuadInfo> m_quads;
+        float m_xRange[2];
         PolyInfo(const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t node);//surfaces MUST be in node correspondence, otherwise SEVERE strangeness, possible crashes
         PolyInfo() {};
         int isInside(const float* xyz);//0 for no, 2 for yes, 1 for if only half the triangulations (between the two triangulations of one of the quad faces)
@@ -100,6 +104,7 @@ namespace
 
     int PolyInfo::isInside(const float* xyz)
     {
+        if (xyz[0] <= m_xRange[0] || xyz[0] > m_xRange[1]) return 0;//no triangle can be hit, so the sample point is outside
         int i, temp, numQuads = (int)m_quads.size();
         bool toggle = false;
         for (i = 0; i < numQuads; ++i)
@@ -137,6 +142,18 @@ namespace
                 }
             }
         }
+        m_xRange[0] = 0.0f;
+        m_xRange[1] = 0.0f;
+        for (int i = 0; i < (int)m_quads.size(); ++i)
+        {
+            if (i == 0 || m_quads[i].m_xRange[0] < m_xRange[0]) m_xRange[0] = m_quads[i].m_xRange[0];
+            if (i == 0 || m_quads[i].m_xRange[1] > m_xRange[1]) m_xRange[1] = m_quads[i].m_xRange[1];
+        }
+        for (int i = 0; i < (int)m_tris.size(); ++i)
+        {//the root vertex is only in the cap triangles, so they can extend the range beyond the quads
+            if (m_tris[i].m_xRange[0] < m_xRange[0]) m_xRange[0] = m_tris[i].m_xRange[0];
+            if (m_tris[i].m_xRange[1] > m_xRange[1]) m_xRange[1] = m_tris[i].m_xRange[1];
+        }
     }
 
     QuadInfo::QuadInfo(const float* xyz1, const float* xyz2, const float* xyz3, const float* xyz4)
@@ -145,10 +162,13 @@ namespace
         m_tris[0][1] = TriInfo(xyz1, xyz3, xyz4);
         m_tris[1][0] = TriInfo(xyz1, xyz2, xyz4);
         m_tris[1][1] = TriInfo(xyz2, xyz3, xyz4);
+        m_xRange[0] = min(m_tris[0][0].m_xRange[0], m_tris[0][1].m_xRange[0]);
+        m_xRange[1] = max(m_tris[0][0].m_xRange[1], m_tris[0][1].m_xRange[1]);
     }
 
     int QuadInfo::vertRayHit(const float* xyz)
     {
+        if (xyz[0] <= m_xRange[0] || xyz[0] > m_xRange[1]) return 0;
         int ret = 0;
         if (m_tris[0][0].vertRayHit(xyz) != m_tris[0][1].vertRayHit(xyz)) ++ret;
         if (m_tris[1][0].vertRayHit(xyz) != m_tris[1][1].vertRayHit(xyz)) ++ret;
@@ -158,6 +178,8 @@ namespace
     TriInfo::TriInfo(const float* xyz1, const float* xyz2, const float* xyz3)
     {
         m_xyz[0] = xyz1; m_xyz[1] = xyz2; m_xyz[2] = xyz3;
+        m_xRange[0] = min(min(xyz1[0], xyz2[0]), xyz3[0]);
+        m_xRange[1] = max(max(xyz1[0], xyz2[0]), xyz3[0]);
         FloatMatrix myRref;
         myRref.resize(3, 4);
         for (int i = 0; i < 3; ++i)//ax + by + c = z
@@ -180,6 +202,7 @@ namespace
 
     bool TriInfo::vertRayHit(const float* xyz)
     {
+        if (xyz[0] <= m_xRange[0] || xyz[0] > m_xRange[1]) return false;//the PNPOLY test below counts no crossings in this case, regardless of the plane
         if (!MathFunctions::isNumeric(m_planeEq[0]))
         {//plane is vertical, nothing can hit it
             return false;
@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <QFile>
 #include <QTextStream>
 
 #include <algorithm>
@@ -534,10 +535,33 @@ SceneFile::readFile(const AString& filenameIn)
     checkFileReadability(filename);
     
     this->setFileName(filename);
-    SceneFileSaxReader saxReader(this);
-    std::auto_ptr<XmlSaxParser> parser(XmlSaxParser::createXmlParser());
     try {
-        parser->parseFile(filename, &saxReader);
+        /*
+         * Scene files may contain many scenes so read only the 
+         * name and description of each scene.  A scene's classes 
+         * are read when the scene is first accessed.
+         */
+        bool scenesDeferred = false;
+        if (DataFile::isFileOnNetwork(filename) == false) {
+            QFile file(filename);
+            if (file.open(QFile::ReadOnly)) {
+                const QByteArray fileContent = file.readAll();
+                file.close();
+                
+                SceneFileSaxReader saxReader(this);
+                scenesDeferred = saxReader.readWithDeferredScenes(fileContent);
+                if ( ! scenesDeferred) {
+                    clear();
+                    this->setFileName(filename);
+                }
+            }
+        }
+        
+        if ( ! scenesDeferred) {
+            SceneFileSaxReader saxReader(this);
+            std::auto_ptr<XmlSaxParser> parser(XmlSaxParser::createXmlParser());
+            parser->parseFile(filename, &saxReader);
+        }
     }
     catch (const XmlSaxParserException& e) {
         clear();
@@ -701,7 +725,16 @@ SceneFile::addToDataFileContentInformation(DataFileContentInformation& dataFileI
             {
                 sceneNamesText += ":";
                 const SceneAttributes* myAttrs = scene->getAttributes();
-                const SceneClass* guiMgrClass = scene->getClassWithName("guiManager");
+                const SceneClass* guiMgrClass = NULL;
+                try
+                {
+                    guiMgrClass = scene->getClassWithName("guiManager");
+                }
+                catch (const DataFileException& dfe)
+                {
+                    sceneNamesText.appendWithNewLine(dfe.whatString());
+                    continue;
+                }
                 if (guiMgrClass == NULL)
                 {
                     sceneNamesText.appendWithNewLine("missing guiManager class");
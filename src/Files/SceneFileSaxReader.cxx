@@ -18,8 +18,11 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <sstream>
 
+#include <QXmlStreamReader>
+
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "GiftiMetaDataSaxReader.h"
@@ -37,6 +40,58 @@
 
 using namespace caret;
 
+namespace {
+    /*
+     * QXmlStreamReader reports offsets in characters but scenes
+     * are located by byte offsets in the UTF-8 file content.
+     * Offsets must be converted in increasing order so that
+     * the file content is only scanned once.
+     */
+    class Utf8OffsetConverter {
+    public:
+        Utf8OffsetConverter(const QByteArray& content)
+        : m_content(content), m_byteOffset(0), m_characterOffset(0) {
+            /*
+             * Byte order mark is not reported as a character
+             */
+            if (content.startsWith("\xEF\xBB\xBF")) {
+                m_byteOffset = 3;
+            }
+        }
+        
+        int64_t toByteOffset(const int64_t characterOffset) {
+            const char* data = m_content.constData();
+            const int64_t numBytes = m_content.size();
+            while ((m_characterOffset < characterOffset)
+                   && (m_byteOffset < numBytes)) {
+                const unsigned char c = data[m_byteOffset];
+                if (c >= 0xF0) {
+                    m_byteOffset += 4;
+                    m_characterOffset += 2; // surrogate pair
+                }
+                else if (c >= 0xE0) {
+                    m_byteOffset += 3;
+                    m_characterOffset++;
+                }
+                else if (c >= 0xC0) {
+                    m_byteOffset += 2;
+                    m_characterOffset++;
+                }
+                else {
+                    m_byteOffset++;
+                    m_characterOffset++;
+                }
+            }
+            return std::min(m_byteOffset, numBytes);
+        }
+        
+    private:
+        const QByteArray& m_content;
+        int64_t m_byteOffset;
+        int64_t m_characterOffset;
+    };
+}
+
 /**
  * \class caret::SceneFileSaxReader
  * \brief Reads a scene file using a SAX XML Parser.
@@ -162,19 +217,7 @@ SceneFileSaxReader::startElement(const AString& namespaceURI,
             }
             else if (qName == SceneXmlElements::SCENE_TAG) {
                 m_state = STATE_SCENE;
-                const AString sceneTypeName = attributes.getValue(SceneXmlElements::SCENE_TYPE_ATTRIBUTE);
-                bool validName = false;
-                const SceneTypeEnum::Enum sceneType = SceneTypeEnum::fromName(sceneTypeName,
-                                                                              &validName);
-                if (validName == false) {
-                    const AString msg = XmlUtilities::createInvalidAttributeMessage(SceneXmlElements::SCENE_TAG, 
-                                                                                    SceneXmlElements::SCENE_TYPE_ATTRIBUTE,
-                                                                                    sceneTypeName);
-                    XmlSaxParserException e(msg);
-                    CaretLogThrowing(e);
-                    throw e;
-                }
-                m_scene = new Scene(sceneType);
+                m_scene = new Scene(getSceneTypeFromAttributes(attributes));
                 m_sceneSaxReader = new SceneSaxReader(m_sceneFile->getFileName(),
                                                       m_scene);
                 m_sceneSaxReader->startElement(namespaceURI, localName, qName, attributes);
@@ -360,3 +403,205 @@ SceneFileSaxReader::endDocument()
 {
 }
 
+/**
+ * @return The type of scene from the attributes of a scene element.
+ *
+ * @param attributes
+ *    Attributes of the scene element.
+ * @throws XmlSaxParserException
+ *    If the scene type is invalid.
+ */
+SceneTypeEnum::Enum
+SceneFileSaxReader::getSceneTypeFromAttributes(const XmlAttributes& attributes) const
+{
+    const AString sceneTypeName = attributes.getValue(SceneXmlElements::SCENE_TYPE_ATTRIBUTE);
+    bool validName = false;
+    const SceneTypeEnum::Enum sceneType = SceneTypeEnum::fromName(sceneTypeName,
+                                                                  &validName);
+    if (validName == false) {
+        const AString msg = XmlUtilities::createInvalidAttributeMessage(SceneXmlElements::SCENE_TAG, 
+                                                                        SceneXmlElements::SCENE_TYPE_ATTRIBUTE,
+                                                                        sceneTypeName);
+        XmlSaxParserException e(msg);
+        CaretLogThrowing(e);
+        throw e;
+    }
+    
+    return sceneType;
+}
+
+/**
+ * Read the content of a scene file with a streaming reader.  The metadata
+ * and scene info are processed by this handler as when parsing with
+ * a SAX parser.  For each scene, only the name and description are read
+ * and the scene's classes are read from the file content when the scene 
+ * is first accessed.  Since most scenes in a large scene file are never
+ * displayed, this avoids creating all of the scene classes.
+ *
+ * @param fileContent
+ *    Content of the scene file.
+ * @return
+ *    True if the file was read.  False if the location of a scene in the
+ *    file content could not be verified (such as a file that is not UTF-8)
+ *    in which case the file must be read with a SAX parser.
+ * @throws XmlSaxParserException
+ *    If there is an error in the XML.
+ */
+bool
+SceneFileSaxReader::readWithDeferredScenes(const QByteArray& fileContent)
+{
+    const QByteArray sceneStartTag("<" + SceneXmlElements::SCENE_TAG.toAscii());
+    const QByteArray sceneEndTag("</" + SceneXmlElements::SCENE_TAG.toAscii());
+    
+    /*
+     * Offsets reported by the stream reader are used to narrow the
+     * search for the scene tags, allow for a few characters of slack.
+     */
+    const int64_t offsetSlack = 4;
+    
+    Utf8OffsetConverter offsetConverter(fileContent);
+    QXmlStreamReader xml(fileContent);
+    
+    while ( ! xml.atEnd()) {
+        /*
+         * Offset at end of the previous token
+         */
+        const int64_t previousTokenEndOffset = xml.characterOffset();
+        
+        xml.readNext();
+        switch (xml.tokenType()) {
+            case QXmlStreamReader::StartDocument:
+                if (( ! xml.documentEncoding().isEmpty())
+                    && (xml.documentEncoding().toString().compare("UTF-8", Qt::CaseInsensitive) != 0)) {
+                    return false;
+                }
+                startDocument();
+                break;
+            case QXmlStreamReader::EndDocument:
+                endDocument();
+                break;
+            case QXmlStreamReader::StartElement:
+            {
+                XmlAttributes attributes;
+                const QXmlStreamAttributes streamAttributes = xml.attributes();
+                for (int32_t i = 0; i < streamAttributes.size(); i++) {
+                    attributes.addAttribute(streamAttributes[i].qualifiedName().toString(),
+                                            streamAttributes[i].value().toString());
+                }
+                
+                const AString qName = xml.qualifiedName().toString();
+                if ((m_state == STATE_SCENE_FILE)
+                    && (qName == SceneXmlElements::SCENE_TAG)) {
+                    const int64_t searchStart = std::max(offsetConverter.toByteOffset(previousTokenEndOffset) - offsetSlack,
+                                                         (int64_t)0);
+                    const int64_t startTagEnd = offsetConverter.toByteOffset(xml.characterOffset());
+                    
+                    readDeferredScene(xml,
+                                      attributes);
+                    
+                    const int64_t endTagEnd = offsetConverter.toByteOffset(xml.characterOffset());
+                    const int64_t sceneStart = fileContent.indexOf(sceneStartTag,
+                                                                   static_cast<int>(searchStart));
+                    const int64_t sceneEndTagStart = fileContent.indexOf(sceneEndTag,
+                                                                         static_cast<int>(std::max(endTagEnd - sceneEndTag.size() - 1 - offsetSlack,
+                                                                                                   (int64_t)0)));
+                    const int64_t sceneEnd = ((sceneEndTagStart >= 0)
+                                              ? fileContent.indexOf('>', static_cast<int>(sceneEndTagStart)) + 1
+                                              : 0);
+                    if ((sceneStart < 0)
+                        || (sceneStart >= startTagEnd)
+                        || (sceneEndTagStart < 0)
+                        || (sceneEnd <= sceneEndTagStart)
+                        || (sceneEnd > (endTagEnd + offsetSlack))) {
+                        CaretLogFine("Unable to locate scene \""
+                                     + m_scene->getName()
+                                     + "\" in "
+                                     + m_sceneFile->getFileName()
+                                     + ", scenes will not be deferred.");
+                        return false;
+                    }
+                    
+                    m_scene->setDeferredSceneXml(m_sceneFile->getFileName(),
+                                                 fileContent,
+                                                 sceneStart,
+                                                 sceneEnd - sceneStart);
+                    m_sceneFile->addScene(m_scene);
+                    m_scene = NULL; // do not delete since added to scene file
+                }
+                else {
+                    startElement(xml.namespaceUri().toString(),
+                                 xml.name().toString(),
+                                 qName,
+                                 attributes);
+                }
+            }
+                break;
+            case QXmlStreamReader::EndElement:
+                endElement(xml.namespaceUri().toString(),
+                           xml.name().toString(),
+                           xml.qualifiedName().toString());
+                break;
+            case QXmlStreamReader::Characters:
+                characters(xml.text().toString().toStdString().c_str());
+                break;
+            default:
+                break;
+        }
+    }
+    
+    if (xml.hasError()) {
+        throw XmlSaxParserException(xml.errorString(),
+                                    xml.lineNumber(),
+                                    xml.columnNumber());
+    }
+    
+    return true;
+}
+
+/**
+ * Read the name and description of a scene whose start element was
+ * just read by the stream reader and skip the scene's objects.  On
+ * exit, the stream reader is at the end element of the scene.
+ *
+ * @param xml
+ *    The stream reader.
+ * @param attributes
+ *    Attributes of the scene element.
+ * @throws XmlSaxParserException
+ *    If there is an error in the XML.
+ */
+void
+SceneFileSaxReader::readDeferredScene(QXmlStreamReader& xml,
+                                      const XmlAttributes& attributes)
+{
+    CaretAssert(m_scene == NULL);
+    m_scene = new Scene(getSceneTypeFromAttributes(attributes));
+    
+    while (xml.readNextStartElement()) {
+        const AString qName = xml.qualifiedName().toString();
+        if (qName == SceneXmlElements::SCENE_NAME_TAG) {
+            m_scene->setName(xml.readElementText().trimmed());
+        }
+        else if (qName == SceneXmlElements::SCENE_DESCRIPTION_TAG) {
+            m_scene->setDescription(xml.readElementText().trimmed());
+        }
+        else if (qName == SceneXmlElements::OBJECT_TAG) {
+            xml.skipCurrentElement();
+        }
+        else {
+            const AString msg = XmlUtilities::createInvalidChildElementMessage(SceneXmlElements::SCENE_TAG, 
+                                                                               qName);
+            XmlSaxParserException e(msg,
+                                    xml.lineNumber(),
+                                    xml.columnNumber());
+            CaretLogThrowing(e);
+            throw e;
+        }
+    }
+    
+    if (xml.hasError()) {
+        throw XmlSaxParserException(xml.errorString(),
+                                    xml.lineNumber(),
+                                    xml.columnNumber());
+    }
+}
@@ -28,9 +28,12 @@
 
 #include "AString.h"
 #include "SceneSaxReader.h"
+#include "SceneTypeEnum.h"
 #include "XmlSaxParserException.h"
 #include "XmlSaxParserHandlerInterface.h"
 
+class QByteArray;
+class QXmlStreamReader;
 
 namespace caret {
 
@@ -69,8 +72,14 @@ namespace caret {
         
         void endDocument();
         
+        bool readWithDeferredScenes(const QByteArray& fileContent);
         
     protected:
+        SceneTypeEnum::Enum getSceneTypeFromAttributes(const XmlAttributes& attributes) const;
+        
+        void readDeferredScene(QXmlStreamReader& xml,
+                               const XmlAttributes& attributes);
+        
         /// file reading states
         enum STATE {
             /// no state
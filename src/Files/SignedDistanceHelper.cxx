@@ -45,129 +45,213 @@ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FO
 DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
-#include "BoundingBox.h"
-#include "CaretHeap.h"
+#include "CaretAssert.h"
+#include "MathFunctions.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
 using namespace caret;
 
-float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+namespace
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    float boxDistSquared(const float coord[3], const float boxMin[3], const float boxMax[3])
+    {
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float tempf = 0.0f;
+            if (coord[i] < boxMin[i])
+            {
+                tempf = boxMin[i] - coord[i];
+            } else if (coord[i] > boxMax[i]) {
+                tempf = coord[i] - boxMax[i];
+            }
+            ret += tempf * tempf;
+        }
+        return ret;
+    }
+    
+    bool positiveZRayHitsBox(const float start[3], const float boxMin[3], const float boxMax[3])
+    {//same as the general ray test, but for the +z ray used by the winding logic, with the divisions optimized out
+        return start[0] >= boxMin[0] && start[0] <= boxMax[0] && start[1] >= boxMin[1] && start[1] <= boxMax[1] && start[2] <= boxMax[2];
+    }
+    
+    bool lineSegmentHitsBox(const float start[3], const float end[3], const float boxMin[3], const float boxMax[3])
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        float curlow = 0.0f, curhigh = 1.0f;//parameterize the line segment to the range [0, 1] of t
+        for (int i = 0; i < 3; ++i)
         {
-            if (curOct->m_leaf)
+            float direction = end[i] - start[i];
+            if (direction != 0.0f)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
+                float templow, temphigh;
+                if (direction > 0.0f)
                 {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
+                    templow = (boxMin[i] - start[i]) / direction;//compute the range of t over which this line lies between the planes for this axis
+                    temphigh = (boxMax[i] - start[i]) / direction;
+                } else {
+                    templow = (boxMax[i] - start[i]) / direction;
+                    temphigh = (boxMin[i] - start[i]) / direction;
                 }
+                if (templow > curlow) curlow = templow;//intersect the ranges
+                if (temphigh < curhigh) curhigh = temphigh;
+                if (curhigh < curlow) return false;
             } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
+                if (start[i] < boxMin[i] || start[i] > boxMax[i]) return false;
             }
         }
+        return true;
     }
-    while (numChanged)
+    
+    float halfSurfaceArea(const float boxMin[3], const float boxMax[3])
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
+        float extent[3] = { boxMax[0] - boxMin[0], boxMax[1] - boxMin[1], boxMax[2] - boxMin[2] };
+        return extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0];
     }
-    return bestTriDist * computeSign(coord, bestInfo, myWinding);
+    
+    struct CentroidLess
+    {//for median splits
+        const float* m_centroids;
+        int m_axis;
+        CentroidLess(const float* centroids, const int axis) : m_centroids(centroids), m_axis(axis) { }
+        bool operator()(const int32_t left, const int32_t right) const
+        {
+            return m_centroids[left * 3 + m_axis] < m_centroids[right * 3 + m_axis];
+        }
+    };
+    
+    struct CentroidBin
+    {//computes which SAH bin a triangle falls in, and doubles as the partition predicate
+        const float* m_centroids;
+        int m_axis, m_numBins, m_splitBin;
+        float m_low, m_scale;
+        CentroidBin(const float* centroids, const int axis, const int numBins, const float low, const float high) :
+            m_centroids(centroids), m_axis(axis), m_numBins(numBins), m_splitBin(-1), m_low(low), m_scale(numBins / (high - low)) { }
+        int getBin(const int32_t tri) const
+        {
+            int ret = (int)((m_centroids[tri * 3 + m_axis] - m_low) * m_scale);
+            if (ret >= m_numBins) ret = m_numBins - 1;
+            if (ret < 0) ret = 0;
+            return ret;
+        }
+        bool operator()(const int32_t tri) const
+        {
+            return getBin(tri) <= m_splitBin;
+        }
+    };
 }
 
-void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+float SignedDistanceHelper::closestTriangle(const float coord[3], ClosestPointInfo& bestInfo, const int32_t hintTriangle)
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
+    const vector<SignedDistanceHelperBase::TriNode>& myNodes = m_base->m_nodes;
+    const int32_t* triOrder = m_base->m_triOrder.data();
+    ClosestPointInfo tempInfo;
+    float tempf, bestTriDist = -1.0f, bestDistSqr = -1.0f;
     bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    if (hintTriangle >= 0)
+    {//the closest triangle to a nearby point gives a tight bound before we even start the traversal
+        bestTriDist = unsignedDistToTri(coord, hintTriangle, bestInfo);
+        bestDistSqr = bestTriDist * bestTriDist;
+        first = false;
+    }
+    CaretAssert(!myNodes.empty());
+    int32_t nodeStack[SignedDistanceHelperBase::MAX_STACK];
+    float distStack[SignedDistanceHelperBase::MAX_STACK];
+    int stackSize;
+    nodeStack[0] = 0;
+    distStack[0] = boxDistSquared(coord, myNodes[0].m_min, myNodes[0].m_max);
+    stackSize = 1;
+    while (stackSize > 0)
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        --stackSize;
+        if (!first && distStack[stackSize] >= bestDistSqr) continue;//bound may have tightened since this was pushed
+        const SignedDistanceHelperBase::TriNode& curNode = myNodes[nodeStack[stackSize]];
+        if (curNode.m_secondChild == -1)
         {
-            if (curOct->m_leaf)
+            for (int32_t i = curNode.m_start; i < curNode.m_end; ++i)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
+                if (triOrder[i] == hintTriangle) continue;
+                tempf = unsignedDistToTri(coord, triOrder[i], tempInfo);
+                if (first || tempf < bestTriDist)
                 {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
+                    bestInfo = tempInfo;
+                    bestTriDist = tempf;
+                    bestDistSqr = tempf * tempf;
+                    first = false;
                 }
             }
+        } else {
+            int32_t nearChild = nodeStack[stackSize] + 1, farChild = curNode.m_secondChild;
+            float nearDist = boxDistSquared(coord, myNodes[nearChild].m_min, myNodes[nearChild].m_max);
+            float farDist = boxDistSquared(coord, myNodes[farChild].m_min, myNodes[farChild].m_max);
+            if (farDist < nearDist)
+            {
+                swap(nearChild, farChild);
+                swap(nearDist, farDist);
+            }
+            CaretAssert(stackSize + 2 <= SignedDistanceHelperBase::MAX_STACK);
+            if (first || farDist < bestDistSqr)
+            {//push the far child first, so the near child gets popped first
+                nodeStack[stackSize] = farChild;
+                distStack[stackSize] = farDist;
+                ++stackSize;
+            }
+            if (first || nearDist < bestDistSqr)
+            {
+                nodeStack[stackSize] = nearChild;
+                distStack[stackSize] = nearDist;
+                ++stackSize;
+            }
         }
     }
-    while (numChanged)
+    return bestTriDist;
+}
+
+float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
+    return bestTriDist * computeSign(coord, bestInfo, myWinding);
+}
+
+void SignedDistanceHelper::dist(const float* coordsIn, const int64_t& numCoords, float* distsOut, WindingLogic myWinding)
+{
+    ClosestPointInfo bestInfo;
+    int32_t hint = -1;
+    for (int64_t i = 0; i < numCoords; ++i)
+    {
+        const float* thisCoord = coordsIn + i * 3;
+        float bestTriDist = closestTriangle(thisCoord, bestInfo, hint);
+        hint = bestInfo.triangle;
+        distsOut[i] = bestTriDist * computeSign(thisCoord, bestInfo, myWinding);
+    }
+}
+
+void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
+    fillBarycentricInfo(bestInfo, bestTriDist, baryInfoOut);
+}
+
+void SignedDistanceHelper::barycentricWeights(const float* coordsIn, const int64_t& numCoords, BarycentricInfo* baryInfoOut)
+{
+    ClosestPointInfo bestInfo;
+    int32_t hint = -1;
+    for (int64_t i = 0; i < numCoords; ++i)
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//clean up
+        float bestTriDist = closestTriangle(coordsIn + i * 3, bestInfo, hint);
+        hint = bestInfo.triangle;
+        fillBarycentricInfo(bestInfo, bestTriDist, baryInfoOut[i]);
     }
+}
+
+void SignedDistanceHelper::fillBarycentricInfo(const ClosestPointInfo& bestInfo, const float& bestTriDist, BarycentricInfo& baryInfoOut)
+{
     baryInfoOut.triangle = bestInfo.triangle;
     baryInfoOut.point = bestInfo.tempPoint;
     baryInfoOut.absDistance = bestTriDist;
@@ -252,68 +336,48 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
         case NEGATIVE:
         case NONZERO:
             {
-                int numChanged = 0;
-                float positiveZ[3] = {0, 0, 1};
-                Vector3D point2 = point + positiveZ;
-                int crossCount = 0;
-                vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                myStack.push_back(m_base->m_indexRoot);
-                while (!myStack.empty())
+                int crossCount = 0;//cast a ray in +z, count crossings
+                const vector<SignedDistanceHelperBase::TriNode>& myNodes = m_base->m_nodes;
+                const int32_t* triOrder = m_base->m_triOrder.data();
+                int32_t nodeStack[SignedDistanceHelperBase::MAX_STACK];
+                int stackSize = 0;
+                if (positiveZRayHitsBox(coord, myNodes[0].m_min, myNodes[0].m_max)) nodeStack[stackSize++] = 0;
+                while (stackSize > 0)
                 {
-                    Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                    myStack.pop_back();
-                    if (curOct->m_leaf)
+                    int32_t curIndex = nodeStack[--stackSize];
+                    const SignedDistanceHelperBase::TriNode& curNode = myNodes[curIndex];
+                    if (curNode.m_secondChild == -1)
                     {
-                        vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                        int numTris = (int)myVecRef.size();
-                        for (int i = 0; i < numTris; ++i)
+                        for (int32_t i = curNode.m_start; i < curNode.m_end; ++i)
                         {
-                            if (m_triMarked[myVecRef[i]] != 1)
+                            const int32_t* myTileNodes = m_base->getTriangle(triOrder[i]);
+                            Vector3D verts[3];
+                            verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                            verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                            verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                            Vector3D triNormal;
+                            MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                            float factor = triNormal[2];//equivalent to dot product with positiveZ
+                            if (factor != 0.0f)
                             {
-                                m_triMarked[myVecRef[i]] = 1;
-                                m_triMarkChanged[numChanged++] = myVecRef[i];
-                                const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                Vector3D verts[3];
-                                verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                Vector3D triNormal;
-                                MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                float factor = triNormal[2];//equivalent to dot product with positiveZ
-                                if (factor != 0.0f)
+                                if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
                                 {
-                                    if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
+                                    if (triNormal[2] < 0.0f)
                                     {
-                                        if (triNormal[2] < 0.0f)
-                                        {
-                                            ++crossCount;
-                                        } else {
-                                            --crossCount;
-                                        }
+                                        ++crossCount;
+                                    } else {
+                                        --crossCount;
                                     }
                                 }
                             }
                         }
                     } else {
-                        for (int ci = 0; ci < 2; ++ci)
-                        {
-                            for (int cj = 0; cj < 2; ++cj)
-                            {
-                                for (int ck = 0; ck < 2; ++ck)
-                                {
-                                    if (curOct->m_children[ci][cj][ck]->rayIntersects(coord, point2))
-                                    {
-                                        myStack.push_back(curOct->m_children[ci][cj][ck]);
-                                    }
-                                }
-                            }
-                        }
+                        CaretAssert(stackSize + 2 <= SignedDistanceHelperBase::MAX_STACK);
+                        if (positiveZRayHitsBox(coord, myNodes[curIndex + 1].m_min, myNodes[curIndex + 1].m_max)) nodeStack[stackSize++] = curIndex + 1;
+                        const SignedDistanceHelperBase::TriNode& secondNode = myNodes[curNode.m_secondChild];
+                        if (positiveZRayHitsBox(coord, secondNode.m_min, secondNode.m_max)) nodeStack[stackSize++] = curNode.m_secondChild;
                     }
                 }
-                while (numChanged)
-                {
-                    m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                }
                 switch (myWinding)
                 {
                     case EVEN_ODD:
@@ -339,7 +403,6 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                 case 0://node
                     {
                         int curSign = 0;
-                        int numChanged = 0;
                         const vector<int>& myTiles = m_base->m_topoHelp->getNodeTiles(myInfo.node1);
                         bool first = true;
                         float bestNorm = 0;
@@ -382,71 +445,54 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                         {
                             midAxis = 2;
                         }
-                        vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                        myStack.push_back(m_base->m_indexRoot);
-                        while (!myStack.empty())
+                        const vector<SignedDistanceHelperBase::TriNode>& myNodes = m_base->m_nodes;
+                        const int32_t* triOrder = m_base->m_triOrder.data();
+                        int32_t nodeStack[SignedDistanceHelperBase::MAX_STACK];
+                        int stackSize = 0;
+                        if (lineSegmentHitsBox(coord, bestCent, myNodes[0].m_min, myNodes[0].m_max)) nodeStack[stackSize++] = 0;
+                        while (stackSize > 0)
                         {
-                            Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                            myStack.pop_back();
-                            if (curOct->m_leaf)
+                            int32_t curIndex = nodeStack[--stackSize];
+                            const SignedDistanceHelperBase::TriNode& curNode = myNodes[curIndex];
+                            if (curNode.m_secondChild == -1)
                             {
-                                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                                int numTris = (int)myVecRef.size();
-                                for (int i = 0; i < numTris; ++i)
+                                for (int32_t i = curNode.m_start; i < curNode.m_end; ++i)
                                 {
-                                    if (m_triMarked[myVecRef[i]] != 1)
+                                    const int32_t* myTileNodes = m_base->getTriangle(triOrder[i]);
+                                    Vector3D verts[3];
+                                    verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                                    verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                                    verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                                    Vector3D triNormal;
+                                    MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                                    float factor = triNormal.dot(segNormal);
+                                    if (factor == 0.0f)
                                     {
-                                        m_triMarked[myVecRef[i]] = 1;
-                                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                                        const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                        Vector3D verts[3];
-                                        verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                        verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                        verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                        Vector3D triNormal;
-                                        MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                        float factor = triNormal.dot(segNormal);
-                                        if (factor == 0.0f)
-                                        {
-                                            continue;//skip triangles parallel to the line segment
-                                        }
-                                        float intersectDist = triNormal.dot(point - verts[0]) / factor;
-                                        if (intersectDist > 0.0f && intersectDist < bestDist)
-                                        {
-                                            Vector3D inPlane = point - intersectDist * segNormal;
-                                            if (pointInTri(verts, inPlane, majAxis, midAxis))
-                                            {
-                                                bestDist = intersectDist;
-                                                if (triNormal.dot(mySeg) > 0.0f)
-                                                {
-                                                    curSign = 1;
-                                                } else {
-                                                    curSign = -1;
-                                                }
-                                            }
-                                        }
+                                        continue;//skip triangles parallel to the line segment
                                     }
-                                }
-                            } else {
-                                for (int ci = 0; ci < 2; ++ci)
-                                {
-                                    for (int cj = 0; cj < 2; ++cj)
+                                    float intersectDist = triNormal.dot(point - verts[0]) / factor;
+                                    if (intersectDist > 0.0f && intersectDist < bestDist)
                                     {
-                                        for (int ck = 0; ck < 2; ++ck)
+                                        Vector3D inPlane = point - intersectDist * segNormal;
+                                        if (pointInTri(verts, inPlane, majAxis, midAxis))
                                         {
-                                            if (curOct->m_children[ci][cj][ck]->lineSegmentIntersects(coord, bestCent))
+                                            bestDist = intersectDist;
+                                            if (triNormal.dot(mySeg) > 0.0f)
                                             {
-                                                myStack.push_back(curOct->m_children[ci][cj][ck]);
+                                                curSign = 1;
+                                            } else {
+                                                curSign = -1;
                                             }
                                         }
                                     }
                                 }
+                            } else {
+                                CaretAssert(stackSize + 2 <= SignedDistanceHelperBase::MAX_STACK);
+                                if (lineSegmentHitsBox(coord, bestCent, myNodes[curIndex + 1].m_min, myNodes[curIndex + 1].m_max)) nodeStack[stackSize++] = curIndex + 1;
+                                const SignedDistanceHelperBase::TriNode& secondNode = myNodes[curNode.m_secondChild];
+                                if (lineSegmentHitsBox(coord, bestCent, secondNode.m_min, secondNode.m_max)) nodeStack[stackSize++] = curNode.m_secondChild;
                             }
                         }
-                        while (numChanged)
-                        {
-                            m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                        }
                         return curSign;
                     }
                     break;
@@ -713,24 +759,11 @@ float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t tria
 SignedDistanceHelper::SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase)
 {
     m_base = myBase;
-    int32_t numTris = m_base->m_numTris;
-    m_triMarked = CaretArray<int>(numTris);
-    m_triMarkChanged = CaretArray<int>(numTris);
-    for (int32_t i = 0; i < numTris; ++i)
-    {
-        m_triMarked[i] = 0;
-    }
 }
 
 SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
 {
     m_topoHelp = mySurf->getTopologyHelper();
-    const float* myBB = mySurf->getBoundingBox()->getBounds();
-    Vector3D minCoord, maxCoord;
-    minCoord[0] = myBB[0]; maxCoord[0] = myBB[1];
-    minCoord[1] = myBB[2]; maxCoord[1] = myBB[3];
-    minCoord[2] = myBB[4]; maxCoord[2] = myBB[5];
-    m_indexRoot.grabNew(new Oct<TriVector>(minCoord, maxCoord));
     const float* myCoordData = mySurf->getCoordinateData();
     m_numNodes = mySurf->getNumberOfNodes();
     int32_t numNodes3 = m_numNodes * 3;
@@ -741,6 +774,8 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
     }
     m_numTris = mySurf->getNumberOfTriangles();
     m_triangleList.resize(m_numTris * 3);
+    vector<float> triBounds(m_numTris * 6), centroids(m_numTris * 3);//bounds are min xyz, then max xyz
+    m_triOrder.resize(m_numTris);
     for (int32_t i = 0; i < m_numTris; ++i)
     {
         int32_t i3 = i * 3;
@@ -748,106 +783,146 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
         m_triangleList[i3] = thisTri[0];
         m_triangleList[i3 + 1] = thisTri[1];
         m_triangleList[i3 + 2] = thisTri[2];
-        maxCoord = minCoord = myCoordData + thisTri[0] * 3;//set both to the coordinates of the first node in the triangle
-        for (int j = 1; j < 3; ++j)
+        float* thisBounds = triBounds.data() + i * 6;
+        for (int axis = 0; axis < 3; ++axis)
         {
-            int32_t thisNode3 = thisTri[j] * 3;
-            if (myCoordData[thisNode3] < minCoord[0]) minCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] < minCoord[1]) minCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] < minCoord[2]) minCoord[2] = myCoordData[thisNode3 + 2];
-            if (myCoordData[thisNode3] > maxCoord[0]) maxCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] > maxCoord[1]) maxCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] > maxCoord[2]) maxCoord[2] = myCoordData[thisNode3 + 2];
+            thisBounds[axis] = thisBounds[axis + 3] = myCoordData[thisTri[0] * 3 + axis];
+            for (int j = 1; j < 3; ++j)
+            {
+                float tempf = myCoordData[thisTri[j] * 3 + axis];
+                if (tempf < thisBounds[axis]) thisBounds[axis] = tempf;
+                if (tempf > thisBounds[axis + 3]) thisBounds[axis + 3] = tempf;
+            }
+            centroids[i3 + axis] = (thisBounds[axis] + thisBounds[axis + 3]) * 0.5f;//box center splits better than the true centroid for long thin triangles
         }
-        addTriangle(m_indexRoot, i, minCoord, maxCoord);//use bounding box for now as an easy test to capture any chance of the triangle intersecting the Oct
+        m_triOrder[i] = i;
+    }
+    if (m_numTris > 0)
+    {
+        m_nodes.reserve(2 * (m_numTris / NUM_TRIS_LEAF) + 1);//most leaves will be full
+        buildNode(0, m_numTris, 0, triBounds, centroids);
     }
 }
 
-void SignedDistanceHelperBase::addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3])
+void SignedDistanceHelperBase::buildNode(const int32_t start, const int32_t end, const int depth, const vector<float>& triBounds, const vector<float>& centroids)
 {
-    if (thisOct->m_leaf)
+    int32_t myIndex = (int32_t)m_nodes.size();
+    m_nodes.push_back(TriNode());
+    float myMin[3], myMax[3], centMin[3], centMax[3];
+    for (int axis = 0; axis < 3; ++axis)
     {
-        thisOct->m_data.m_triList->push_back(triangle);
-        int numTris = (int)thisOct->m_data.m_triList->size();
-        if (numTris >= NUM_TRIS_TO_TEST && numTris % NUM_TRIS_TEST_INCR == NUM_TRIS_TO_TEST % NUM_TRIS_TEST_INCR)//the second modulus should const out
+        myMin[axis] = triBounds[m_triOrder[start] * 6 + axis];
+        myMax[axis] = triBounds[m_triOrder[start] * 6 + axis + 3];
+        centMin[axis] = centMax[axis] = centroids[m_triOrder[start] * 3 + axis];
+    }
+    for (int32_t i = start + 1; i < end; ++i)
+    {
+        const float* thisBounds = triBounds.data() + m_triOrder[i] * 6;
+        const float* thisCent = centroids.data() + m_triOrder[i] * 3;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (thisBounds[axis] < myMin[axis]) myMin[axis] = thisBounds[axis];
+            if (thisBounds[axis + 3] > myMax[axis]) myMax[axis] = thisBounds[axis + 3];
+            if (thisCent[axis] < centMin[axis]) centMin[axis] = thisCent[axis];
+            if (thisCent[axis] > centMax[axis]) centMax[axis] = thisCent[axis];
+        }
+    }
+    TriNode& myNode = m_nodes[myIndex];//don't keep this reference across the recursion, push_back can invalidate it
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        myNode.m_min[axis] = myMin[axis];
+        myNode.m_max[axis] = myMax[axis];
+    }
+    myNode.m_start = start;
+    myNode.m_end = end;
+    myNode.m_secondChild = -1;
+    int32_t count = end - start;
+    if (count <= NUM_TRIS_LEAF) return;
+    int splitAxis = 0;//split on the axis with the most spread in centroids
+    if (centMax[1] - centMin[1] > centMax[splitAxis] - centMin[splitAxis]) splitAxis = 1;
+    if (centMax[2] - centMin[2] > centMax[splitAxis] - centMin[splitAxis]) splitAxis = 2;
+    if (!(centMax[splitAxis] > centMin[splitAxis])) return;//all centroids identical (or NaN coordinates), nothing to split on
+    int32_t* orderStart = m_triOrder.data() + start;
+    int32_t* orderEnd = m_triOrder.data() + end;
+    int32_t mid = -1;
+    if (depth < MAX_SAH_DEPTH)
+    {//binned SAH: cost of a split is proportional to the sum over children of surface area times triangle count
+        CentroidBin myBinner(centroids.data(), splitAxis, NUM_SAH_BINS, centMin[splitAxis], centMax[splitAxis]);
+        int32_t binCounts[NUM_SAH_BINS];
+        float binMin[NUM_SAH_BINS][3], binMax[NUM_SAH_BINS][3];
+        for (int b = 0; b < NUM_SAH_BINS; ++b)
+        {
+            binCounts[b] = 0;
+        }
+        for (int32_t i = start; i < end; ++i)
         {
-            Vector3D tempMinCoord, tempMaxCoord;
-            const float* myCoordData = m_coordList.data();
-            int totalSize = 0;
-            int numSplit = 0;
-            for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+            const float* thisBounds = triBounds.data() + m_triOrder[i] * 6;
+            int b = myBinner.getBin(m_triOrder[i]);
+            for (int axis = 0; axis < 3; ++axis)
             {
-                const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                for (int j = 1; j < 3; ++j)
-                {
-                    int32_t thisNode3 = tempTri[j] * 3;
-                    if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                    if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                }
-                int minOct[3], maxOct[3];
-                thisOct->containingChild(tempMinCoord, minOct);
-                thisOct->containingChild(tempMaxCoord, maxOct);
-                int splitSize = 8;
-                if (minOct[0] == maxOct[0]) splitSize >>= 1;
-                if (minOct[1] == maxOct[1]) splitSize >>= 1;
-                if (minOct[2] == maxOct[2]) splitSize >>= 1;
-                totalSize += splitSize;
-                if (splitSize != 8) ++numSplit;
+                if (binCounts[b] == 0 || thisBounds[axis] < binMin[b][axis]) binMin[b][axis] = thisBounds[axis];
+                if (binCounts[b] == 0 || thisBounds[axis + 3] > binMax[b][axis]) binMax[b][axis] = thisBounds[axis + 3];
             }
-            if (numSplit > 0 && totalSize < 3.0f * numTris)//don't split if all triangles end up in all child octs, and try to balance speedup with memory usage
+            ++binCounts[b];
+        }
+        float rightArea[NUM_SAH_BINS];//area of the union of bins above each split
+        int32_t rightCount[NUM_SAH_BINS];
+        float accumMin[3], accumMax[3];
+        int32_t accumCount = 0;
+        for (int b = NUM_SAH_BINS - 1; b > 0; --b)
+        {
+            if (binCounts[b] > 0)
             {
-                thisOct->makeChildren();//do the split
-                for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+                for (int axis = 0; axis < 3; ++axis)
                 {
-                    const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                    tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                    for (int j = 1; j < 3; ++j)
-                    {
-                        int32_t thisNode3 = tempTri[j] * 3;
-                        if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                        if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                    }
-                    for (int ci = 0; ci < 2; ++ci)
-                    {
-                        for (int cj = 0; cj < 2; ++cj)
-                        {
-                            for (int ck = 0; ck < 2; ++ck)
-                            {
-                                if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(tempMinCoord, tempMaxCoord))
-                                {
-                                    addTriangle(thisOct->m_children[ci][cj][ck], (*(thisOct->m_data.m_triList))[i], tempMinCoord, tempMaxCoord);
-                                }
-                            }
-                        }
-                    }
+                    if (accumCount == 0 || binMin[b][axis] < accumMin[axis]) accumMin[axis] = binMin[b][axis];
+                    if (accumCount == 0 || binMax[b][axis] > accumMax[axis]) accumMax[axis] = binMax[b][axis];
                 }
-                thisOct->m_data.freeData();//and free up some memory
+                accumCount += binCounts[b];
             }
+            rightCount[b] = accumCount;
+            rightArea[b] = (accumCount > 0 ? halfSurfaceArea(accumMin, accumMax) : 0.0f);
         }
-    } else {
-        for (int ci = 0; ci < 2; ++ci)
+        accumCount = 0;
+        float bestCost = -1.0f;
+        for (int b = 0; b < NUM_SAH_BINS - 1; ++b)//split is between b and b + 1
         {
-            for (int cj = 0; cj < 2; ++cj)
+            if (binCounts[b] > 0)
             {
-                for (int ck = 0; ck < 2; ++ck)
+                for (int axis = 0; axis < 3; ++axis)
                 {
-                    if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(minCoord, maxCoord))
-                    {
-                        addTriangle(thisOct->m_children[ci][cj][ck], triangle, minCoord, maxCoord);
-                    }
+                    if (accumCount == 0 || binMin[b][axis] < accumMin[axis]) accumMin[axis] = binMin[b][axis];
+                    if (accumCount == 0 || binMax[b][axis] > accumMax[axis]) accumMax[axis] = binMax[b][axis];
                 }
+                accumCount += binCounts[b];
+            }
+            if (accumCount == 0 || rightCount[b + 1] == 0) continue;
+            float cost = halfSurfaceArea(accumMin, accumMax) * accumCount + rightArea[b + 1] * rightCount[b + 1];
+            if (bestCost < 0.0f || cost < bestCost)
+            {
+                bestCost = cost;
+                myBinner.m_splitBin = b;
+            }
+        }
+        if (myBinner.m_splitBin != -1)
+        {
+            float leafCost = halfSurfaceArea(myMin, myMax) * count;//cost of testing every triangle, with node traversal considered as cheap as one triangle test
+            if (count <= MAX_TRIS_LEAF && leafCost <= bestCost + halfSurfaceArea(myMin, myMax))
+            {
+                return;
             }
+            mid = (int32_t)(partition(orderStart, orderEnd, myBinner) - m_triOrder.data());
         }
     }
+    if (mid <= start || mid >= end)
+    {//too deep, or binning failed to separate anything, so split at the median
+        mid = start + count / 2;
+        nth_element(orderStart, m_triOrder.data() + mid, orderEnd, CentroidLess(centroids.data(), splitAxis));
+    }
+    buildNode(start, mid, depth + 1, triBounds, centroids);//first child is always at myIndex + 1
+    int32_t secondChild = (int32_t)m_nodes.size();
+    m_nodes[myIndex].m_secondChild = secondChild;
+    buildNode(mid, end, depth + 1, triBounds, centroids);
 }
 
 const float* SignedDistanceHelperBase::getCoordinate(const int32_t nodeIndex) const
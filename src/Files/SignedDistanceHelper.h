@@ -22,9 +22,7 @@
 /*LICENSE_END*/
 
 #include "Vector3D.h"
-#include "CaretMutex.h"
 #include "CaretPointer.h"
-#include "OctTree.h"
 #include <vector>
 
 namespace caret {
@@ -34,29 +32,25 @@ namespace caret {
     
     class SignedDistanceHelperBase
     {
-        struct TriVector
-        {//specifically so we can cleanly deallocate the vector from non-leaf nodes when they split
-            std::vector<int32_t>* m_triList;
-            TriVector() { m_triList = new std::vector<int32_t>(); }
-            ~TriVector() { freeData(); }
-            void freeData()
-            {
-                if (m_triList != NULL)
-                {
-                    delete m_triList;
-                    m_triList = NULL;
-                }
-            }
+        struct TriNode
+        {//flat BVH node, first child immediately follows its parent, second child is at m_secondChild, -1 for leaves
+            float m_min[3], m_max[3];
+            int32_t m_start, m_end;//range in m_triOrder
+            int32_t m_secondChild;
         };
-        static const int NUM_TRIS_TO_TEST = 50;//test for whether to split leaf at this number
-        static const int NUM_TRIS_TEST_INCR = 50;//and again at further multiples of this
-        CaretPointer<Oct<TriVector> > m_indexRoot;
+        static const int NUM_TRIS_LEAF = 4;//always make a leaf at this many triangles
+        static const int MAX_TRIS_LEAF = 16;//leaves can be this big if SAH says splitting isn't worth it
+        static const int NUM_SAH_BINS = 16;
+        static const int MAX_SAH_DEPTH = 48;//after this depth, fall back to median splits to bound the traversal stack
+        static const int MAX_STACK = 128;//traversal pushes at most one sibling per level, and median splits can't add more than 31 levels to MAX_SAH_DEPTH
+        std::vector<TriNode> m_nodes;
+        std::vector<int32_t> m_triOrder;//triangle indices, reordered so that each node covers a contiguous range
         int32_t m_numTris, m_numNodes;
         std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
         std::vector<int32_t> m_triangleList;
         CaretPointer<TopologyHelper> m_topoHelp;
         SignedDistanceHelperBase();
-        void addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3]);
+        void buildNode(const int32_t start, const int32_t end, const int depth, const std::vector<float>& triBounds, const std::vector<float>& centroids);
         const float* getCoordinate(const int32_t nodeIndex) const;//make these public? probably don't want them to be widely used, that is what SurfaceFile is for (but we don't want to store a SurfaceFile pointer)
         const int32_t* getTriangle(const int32_t tileIndex) const;
     public:
@@ -92,10 +86,7 @@ namespace caret {
             NORMALS
         };
     private:
-        CaretMutex m_mutex;
         CaretPointer<SignedDistanceHelperBase> m_base;
-        CaretArray<int> m_triMarked;
-        CaretArray<int> m_triMarkChanged;
         SignedDistanceHelper();
         struct ClosestPointInfo
         {
@@ -103,6 +94,8 @@ namespace caret {
             int32_t node1, node2, triangle;
             Vector3D tempPoint;
         };
+        float closestTriangle(const float coord[3], ClosestPointInfo& bestInfo, const int32_t hintTriangle = -1);
+        void fillBarycentricInfo(const ClosestPointInfo& myInfo, const float& absDistance, BarycentricInfo& baryInfoOut);
         float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo);
         int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding);
         bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis);
@@ -112,9 +105,16 @@ namespace caret {
         ///return the signed distance value at the point
         float dist(const float coord[3], WindingLogic myWinding);
         
+        ///signed distance for many points at once, coordsIn is xyz triples
+        ///consecutive points should be spatially coherent (for instance, voxels along a scanline), as each search starts bounded by the previous point's closest triangle
+        void dist(const float* coordsIn, const int64_t& numCoords, float* distsOut, WindingLogic myWinding);
+        
         ///find the closest point ON the surface, and return information about it
         ///will never have negative barycentric weights, or a point outside the triangle
         void barycentricWeights(const float coordIn[3], BarycentricInfo& baryInfoOut);
+        
+        ///batched version of the above, with the same coherence advice as batched dist()
+        void barycentricWeights(const float* coordsIn, const int64_t& numCoords, BarycentricInfo* baryInfoOut);
     };
 
 }
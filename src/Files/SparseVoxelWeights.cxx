@@ -0,0 +1,287 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SparseVoxelWeights.h"
+
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const char magic[] = "\0\0\0\0cvw\0";
+    const int64_t FILE_VERSION = 1;
+}
+
+SparseVoxelWeights::SparseVoxelWeights()
+{
+    m_inputKey = 0;
+    m_divideByTotal = false;
+    m_rowStarts.push_back(0);
+}
+
+void SparseVoxelWeights::setWeights(const vector<vector<VoxelWeight> >& weights, const VolumeSpace& volSpace, const uint64_t& inputKey, const bool& divideByTotal)
+{
+    m_volSpace = volSpace;
+    m_inputKey = inputKey;
+    m_divideByTotal = divideByTotal;
+    int64_t numNodes = (int64_t)weights.size();
+    m_rowStarts.resize(numNodes + 1);
+    m_rowStarts[0] = 0;
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        m_rowStarts[i + 1] = m_rowStarts[i] + (int64_t)weights[i].size();
+    }
+    m_voxelIndices.resize(m_rowStarts[numNodes]);
+    m_weights.resize(m_rowStarts[numNodes]);
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        int64_t base = m_rowStarts[i];
+        int64_t rowSize = (int64_t)weights[i].size();
+        for (int64_t j = 0; j < rowSize; ++j)
+        {
+            m_voxelIndices[base + j] = volSpace.getIndex(weights[i][j].ijk);
+            m_weights[base + j] = weights[i][j].weight;
+        }
+    }
+    computeTotals();
+}
+
+void SparseVoxelWeights::computeTotals()
+{
+    int64_t numNodes = getNumberOfNodes();
+    m_rowTotals.resize(numNodes);
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        float total = 0.0f;//same summation order as the original per-vertex loop
+        for (int64_t j = m_rowStarts[i]; j < m_rowStarts[i + 1]; ++j)
+        {
+            total += m_weights[j];
+        }
+        m_rowTotals[i] = total;
+    }
+}
+
+bool SparseVoxelWeights::matches(const VolumeSpace& volSpace, const int64_t& numNodes, const uint64_t& inputKey) const
+{
+    return getNumberOfNodes() == numNodes && m_inputKey == inputKey && m_volSpace.matches(volSpace);
+}
+
+void SparseVoxelWeights::getNodeWeights(const int64_t& node, vector<VoxelWeight>& weightsOut) const
+{
+    CaretAssert(node >= 0 && node < getNumberOfNodes());
+    const int64_t* dims = m_volSpace.getDims();
+    weightsOut.clear();
+    weightsOut.reserve(m_rowStarts[node + 1] - m_rowStarts[node]);
+    for (int64_t j = m_rowStarts[node]; j < m_rowStarts[node + 1]; ++j)
+    {
+        int64_t index = m_voxelIndices[j];
+        int64_t ijk[3];
+        ijk[0] = index % dims[0];
+        index /= dims[0];
+        ijk[1] = index % dims[1];
+        ijk[2] = index / dims[1];
+        weightsOut.push_back(VoxelWeight(m_weights[j], ijk));
+    }
+}
+
+void SparseVoxelWeights::applyToFrames(const float* const* framesIn, const int64_t& numFrames, float* const* nodeValuesOut) const
+{
+    const int FRAME_BLOCK = 16;//each weight and voxel index gets loaded once per this many frames
+    int64_t numNodes = getNumberOfNodes();
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += FRAME_BLOCK)
+    {
+        int blockSize = (int)min((int64_t)FRAME_BLOCK, numFrames - blockStart);
+        const float* const* blockFrames = framesIn + blockStart;
+        float* const* blockOut = nodeValuesOut + blockStart;
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+        for (int64_t node = 0; node < numNodes; ++node)
+        {
+            double accum[FRAME_BLOCK];
+            for (int b = 0; b < blockSize; ++b)
+            {
+                accum[b] = 0.0;
+            }
+            int64_t rowEnd = m_rowStarts[node + 1];
+            for (int64_t j = m_rowStarts[node]; j < rowEnd; ++j)
+            {
+                int64_t voxel = m_voxelIndices[j];
+                double weight = m_weights[j];
+                for (int b = 0; b < blockSize; ++b)
+                {
+                    accum[b] += weight * blockFrames[b][voxel];
+                }
+            }
+            if (m_divideByTotal)
+            {
+                float total = m_rowTotals[node];
+                for (int b = 0; b < blockSize; ++b)
+                {
+                    blockOut[b][node] = (total != 0.0f ? accum[b] / total : 0.0f);
+                }
+            } else {
+                for (int b = 0; b < blockSize; ++b)
+                {
+                    blockOut[b][node] = accum[b];
+                }
+            }
+        }
+    }
+}
+
+void SparseVoxelWeights::readFile(const AString& filename)
+{
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException(filename, "voxel weights files cannot be read while compressed");
+    }
+    CaretBinaryFile myFile(filename);
+    char buf[8];
+    myFile.read(buf, 8);
+    for (int i = 0; i < 8; ++i)
+    {
+        if (buf[i] != magic[i]) throw DataFileException(filename, "file has the wrong magic string");
+    }
+    int64_t header[5];//version, dims, divide flag
+    myFile.read(header, 5 * sizeof(int64_t));
+    float sform[12];
+    myFile.read(sform, 12 * sizeof(float));
+    uint64_t inputKey;
+    myFile.read(&inputKey, sizeof(uint64_t));
+    int64_t sizes[2];//number of vertices, number of weights
+    myFile.read(sizes, 2 * sizeof(int64_t));
+    bool swap = ByteOrderEnum::isSystemBigEndian();//file is always little endian
+    if (swap)
+    {
+        ByteSwapping::swapBytes(header, 5);
+        ByteSwapping::swapBytes(sform, 12);
+        ByteSwapping::swapBytes(&inputKey, 1);
+        ByteSwapping::swapBytes(sizes, 2);
+    }
+    if (header[0] != FILE_VERSION) throw DataFileException(filename, "unsupported voxel weights file version: " + AString::number(header[0]));
+    if (header[1] < 1 || header[2] < 1 || header[3] < 1) throw DataFileException(filename, "volume dimensions must be positive");
+    if (sizes[0] < 0 || sizes[1] < 0) throw DataFileException(filename, "impossible sizes found in header");
+    vector<int64_t> rowStarts(sizes[0] + 1), voxelIndices(sizes[1]);
+    vector<float> weights(sizes[1]);
+    myFile.read(rowStarts.data(), rowStarts.size() * sizeof(int64_t));
+    myFile.read(voxelIndices.data(), voxelIndices.size() * sizeof(int64_t));
+    myFile.read(weights.data(), weights.size() * sizeof(float));
+    if (swap)
+    {
+        ByteSwapping::swapBytes(rowStarts.data(), rowStarts.size());
+        ByteSwapping::swapBytes(voxelIndices.data(), voxelIndices.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+    }
+    if (rowStarts[0] != 0 || rowStarts[sizes[0]] != sizes[1]) throw DataFileException(filename, "impossible value found in row start array");
+    for (int64_t i = 0; i < sizes[0]; ++i)
+    {
+        if (rowStarts[i + 1] < rowStarts[i]) throw DataFileException(filename, "impossible value found in row start array");
+    }
+    int64_t frameSize = header[1] * header[2] * header[3];
+    for (int64_t i = 0; i < sizes[1]; ++i)
+    {
+        if (voxelIndices[i] < 0 || voxelIndices[i] >= frameSize) throw DataFileException(filename, "voxel index out of range of volume dimensions");
+    }
+    m_volSpace.setSpace(header + 1, sform);
+    m_inputKey = inputKey;
+    m_divideByTotal = (header[4] != 0);
+    m_rowStarts.swap(rowStarts);
+    m_voxelIndices.swap(voxelIndices);
+    m_weights.swap(weights);
+    computeTotals();
+}
+
+void SparseVoxelWeights::writeFile(const AString& filename) const
+{
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException(filename, "voxel weights files cannot be written compressed");
+    }
+    CaretBinaryFile myFile(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    myFile.write(magic, 8);
+    const int64_t* dims = m_volSpace.getDims();
+    int64_t header[5] = { FILE_VERSION, dims[0], dims[1], dims[2], (m_divideByTotal ? 1 : 0) };
+    const vector<vector<float> >& sformRef = m_volSpace.getSform();
+    float sform[12];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            sform[i * 4 + j] = sformRef[i][j];
+        }
+    }
+    uint64_t inputKey = m_inputKey;
+    int64_t sizes[2] = { getNumberOfNodes(), (int64_t)m_weights.size() };
+    bool swap = ByteOrderEnum::isSystemBigEndian();
+    if (swap)
+    {
+        ByteSwapping::swapBytes(header, 5);
+        ByteSwapping::swapBytes(sform, 12);
+        ByteSwapping::swapBytes(&inputKey, 1);
+        ByteSwapping::swapBytes(sizes, 2);
+        vector<int64_t> rowStarts = m_rowStarts, voxelIndices = m_voxelIndices;
+        vector<float> weights = m_weights;
+        ByteSwapping::swapBytes(rowStarts.data(), rowStarts.size());
+        ByteSwapping::swapBytes(voxelIndices.data(), voxelIndices.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+        myFile.write(header, 5 * sizeof(int64_t));
+        myFile.write(sform, 12 * sizeof(float));
+        myFile.write(&inputKey, sizeof(uint64_t));
+        myFile.write(sizes, 2 * sizeof(int64_t));
+        myFile.write(rowStarts.data(), rowStarts.size() * sizeof(int64_t));
+        myFile.write(voxelIndices.data(), voxelIndices.size() * sizeof(int64_t));
+        myFile.write(weights.data(), weights.size() * sizeof(float));
+    } else {
+        myFile.write(header, 5 * sizeof(int64_t));
+        myFile.write(sform, 12 * sizeof(float));
+        myFile.write(&inputKey, sizeof(uint64_t));
+        myFile.write(sizes, 2 * sizeof(int64_t));
+        myFile.write(m_rowStarts.data(), m_rowStarts.size() * sizeof(int64_t));
+        myFile.write(m_voxelIndices.data(), m_voxelIndices.size() * sizeof(int64_t));
+        myFile.write(m_weights.data(), m_weights.size() * sizeof(float));
+    }
+    myFile.close();
+}
+
+uint64_t SparseVoxelWeights::getHashSeed()
+{
+    return (((uint64_t)0xcbf29ce4) << 32) | 0x84222325;//FNV-1a 64 bit offset basis
+}
+
+uint64_t SparseVoxelWeights::hashData(const void* data, const int64_t& numBytes, const uint64_t& previousHash)
+{
+    const uint64_t FNV_PRIME = (((uint64_t)1) << 40) | 0x1b3;
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t ret = previousHash;
+    for (int64_t i = 0; i < numBytes; ++i)
+    {
+        ret ^= bytes[i];
+        ret *= FNV_PRIME;
+    }
+    return ret;
+}
@@ -0,0 +1,76 @@
+#ifndef __SPARSE_VOXEL_WEIGHTS_H__
+#define __SPARSE_VOXEL_WEIGHTS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "RibbonMappingHelper.h"
+#include "VolumeSpace.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    ///per-vertex voxel weights for volume to surface mapping, in compressed sparse row form
+    ///applies the weights to several frames per pass, and can be saved to a file so that weights can be reused when the inputs haven't changed
+    class SparseVoxelWeights
+    {
+        VolumeSpace m_volSpace;
+        uint64_t m_inputKey;
+        bool m_divideByTotal;
+        std::vector<int64_t> m_rowStarts;//one per vertex, plus one for the end
+        std::vector<int64_t> m_voxelIndices;//index within a frame
+        std::vector<float> m_weights;
+        std::vector<float> m_rowTotals;//derived, not written to the file
+        void computeTotals();
+    public:
+        SparseVoxelWeights();
+        
+        ///inputKey should identify everything the weights were computed from (see hashData), divideByTotal means weights are not already normalized
+        void setWeights(const std::vector<std::vector<VoxelWeight> >& weights, const VolumeSpace& volSpace, const uint64_t& inputKey, const bool& divideByTotal);
+        
+        int64_t getNumberOfNodes() const { return (int64_t)m_rowStarts.size() - 1; }
+        
+        const VolumeSpace& getVolumeSpace() const { return m_volSpace; }
+        
+        ///true if these weights were made from the same inputs
+        bool matches(const VolumeSpace& volSpace, const int64_t& numNodes, const uint64_t& inputKey) const;
+        
+        ///get the weights of one vertex, as they were given to setWeights
+        void getNodeWeights(const int64_t& node, std::vector<VoxelWeight>& weightsOut) const;
+        
+        ///apply the weights to numFrames frames in the volume space of the weights, each output array must have one value per vertex
+        void applyToFrames(const float* const* framesIn, const int64_t& numFrames, float* const* nodeValuesOut) const;
+        
+        void readFile(const AString& filename);
+        
+        void writeFile(const AString& filename) const;
+        
+        ///64 bit FNV-1a, chain calls through previousHash to build an input key from several arrays
+        static uint64_t hashData(const void* data, const int64_t& numBytes, const uint64_t& previousHash = getHashSeed());
+        
+        static uint64_t getHashSeed();
+    };
+    
+}
+
+#endif //__SPARSE_VOXEL_WEIGHTS_H__
@@ -45,6 +45,7 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceGeometryHelper.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -136,6 +137,7 @@ SurfaceFile::clear()
     trianglePointer = NULL;
     GiftiTypeFile::clear();
     invalidateHelpers();
+    invalidateGeometryHelper();
     this->invalidateNodeColoringForBrowserTabs();
 }
 
@@ -174,6 +176,7 @@ void
 SurfaceFile::validateDataArraysAfterReading()
 {
     this->initializeMembersSurfaceFile();
+    invalidateGeometryHelper();
     
     int numDataArrays = this->giftiFile->getNumberOfDataArrays();
     if (numDataArrays != 2) {
@@ -321,6 +324,7 @@ void SurfaceFile::setNumberOfNodesAndTriangles(const int32_t& nodes, const int32
     trianglePointer = NULL;
     giftiFile->clearAndKeepMetadata();
     invalidateHelpers();
+    invalidateGeometryHelper();
     this->invalidateNodeColoringForBrowserTabs();
     std::vector<int64_t> dims(2);
     dims[1] = 3;
@@ -459,6 +463,7 @@ void SurfaceFile::setTriangle(const int32_t& index, const int32_t& node1, const
     trianglePointer[offset + 1] = node2;
     trianglePointer[offset + 2] = node3;
     invalidateHelpers();
+    invalidateGeometryHelper();
     invalidateNormals();
     setModified();
 }
@@ -587,52 +592,11 @@ SurfaceFile::computeNormals()
     
     const int32_t numTriangles = this->getNumberOfTriangles();
     if ((numCoords > 0) && (numTriangles > 0)) {
-        float* normalPointer = &this->normalVectors[0];
-        std::vector<int> numContribute(numCoords, 0);
-
-        float triangleNormal[3];
-        for (int32_t i = 0; i < numTriangles; i++) {
-            const int32_t it3 = i * 3;
-            const int n1 = this->trianglePointer[it3];
-            const int n2 = this->trianglePointer[it3 + 1];
-            const int n3 = this->trianglePointer[it3 + 2];
-            const int32_t c1 = n1 * 3;
-            const int32_t c2 = n2 * 3;
-            const int32_t c3 = n3 * 3;
-            if ((n1 >= 0)
-                && (n2 >= 0)
-                && (n3 >= 0)) {
-                
-                MathFunctions::normalVector(&this->coordinatePointer[c1],
-                                            &this->coordinatePointer[c2],
-                                            &this->coordinatePointer[c3],
-                                            triangleNormal);
-                
-                normalPointer[c1 + 0] += triangleNormal[0];//+= is not guaranteed to be atomic, do not parallelize
-                normalPointer[c1 + 1] += triangleNormal[1];
-                normalPointer[c1 + 2] += triangleNormal[2];
-                numContribute[n1] += 1;
-                normalPointer[c2 + 0] += triangleNormal[0];
-                normalPointer[c2 + 1] += triangleNormal[1];
-                normalPointer[c2 + 2] += triangleNormal[2];
-                numContribute[n2] += 1;
-                normalPointer[c3 + 0] += triangleNormal[0];
-                normalPointer[c3 + 1] += triangleNormal[1];
-                normalPointer[c3 + 2] += triangleNormal[2];
-                numContribute[n3] += 1;
-            }
-        }
-        
-        for (int i = 0; i < numCoords; i++) {
-            const int i3 = i * 3;
-            if (numContribute[i] > 0) {
-                MathFunctions::normalizeVector(normalPointer + i3);
-            } else {
-                normalPointer[i3 + 0] = 0.0f;//zero the normals for unconnected nodes
-                normalPointer[i3 + 1] = 0.0f;
-                normalPointer[i3 + 2] = 0.0f;
-            }
-        }
+        /*
+         * Each node gathers the normals of its triangles, so the
+         * nodes can be done in parallel
+         */
+        getGeometryHelper()->computeNormals(this->coordinatePointer, &this->normalVectors[0]);
     }
 }
 
@@ -886,6 +850,12 @@ void SurfaceFile::invalidateHelpers()
     }
 }
 
+void SurfaceFile::invalidateGeometryHelper()
+{//not in invalidateHelpers(), since it only uses the topology and coordinates change on every iteration of smoothing
+    CaretMutexLocker myLock(&m_geometryHelperMutex);
+    m_geometryHelper.grabNew(NULL);
+}
+
 /**
  * @return A bounding box for this surface.
  */
@@ -1048,6 +1018,7 @@ SurfaceFile::flipNormals()
     }
     invalidateNormals();
     invalidateHelpers();//sorted topology helpers would change, so just for completeness
+    invalidateGeometryHelper();//triangle winding is used for normals
     setModified();
 }
 
@@ -1130,24 +1101,10 @@ SurfaceFile::getSurfaceArea() const
 void SurfaceFile::computeNodeAreas(std::vector<float>& areasOut) const
 {
     CaretAssert(this->trianglePointer);
-    int32_t triEnd = getNumberOfTriangles();
     int32_t numNodes = getNumberOfNodes();
     areasOut.resize(numNodes);
-    for (int32_t i = 0; i < numNodes; ++i)
-    {
-        areasOut[i] = 0.0f;
-    }
-    for (int32_t i = 0; i < triEnd; ++i)
-    {
-        const int32_t* thisTri = getTriangle(i);
-        const float* node1 = getCoordinate(thisTri[0]);
-        const float* node2 = getCoordinate(thisTri[1]);
-        const float* node3 = getCoordinate(thisTri[2]);
-        float area3 = MathFunctions::triangleArea(node1, node2, node3) / 3.0f;
-        areasOut[thisTri[0]] += area3;
-        areasOut[thisTri[1]] += area3;
-        areasOut[thisTri[2]] += area3;
-    }
+    if (numNodes <= 0) return;
+    getGeometryHelper()->computeNodeAreas(this->coordinatePointer, areasOut.data());
 }
 
 /**
@@ -1188,6 +1145,16 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<SurfaceGeometryHelper> SurfaceFile::getGeometryHelper() const
+{
+    CaretMutexLocker myLock(&m_geometryHelperMutex);//lock before reading, invalidateHelpers() may be replacing it
+    if (m_geometryHelper == NULL)
+    {
+        m_geometryHelper.grabNew(new SurfaceGeometryHelper(this->trianglePointer, getNumberOfTriangles(), getNumberOfNodes()));
+    }
+    return m_geometryHelper;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1212,6 +1179,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_geometryHelperMutex);
+        m_geometryHelper.grabNew(NULL);
+    }
 }
 
 /**
@@ -46,6 +46,7 @@ namespace caret {
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
     class SignedDistanceHelperBase;
+    class SurfaceGeometryHelper;
     class TopologyHelper;
     class TopologyHelperBase;
     
@@ -292,12 +293,20 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///triangles using each node, for normals and node areas, kept when only the coordinates change
+        mutable CaretPointer<SurfaceGeometryHelper> m_geometryHelper;
+        
+        CaretPointer<SurfaceGeometryHelper> getGeometryHelper() const;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
+        ///used to track when the topology gets changed
+        void invalidateGeometryHelper();
+        
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_geometryHelperMutex;
     };
 
 } // namespace
@@ -0,0 +1,281 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include "SurfaceGeometryHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+SurfaceGeometryHelper::SurfaceGeometryHelper(const int32_t* triangles, const int32_t& numTriangles, const int32_t& numNodes)
+{
+    m_triangles.assign(triangles, triangles + numTriangles * 3);
+    m_numNodes = numNodes;
+    m_hasNeighbors = false;
+    m_neighborsSorted = false;
+    buildTiles();
+}
+
+SurfaceGeometryHelper::SurfaceGeometryHelper(const SurfaceFile* mySurf, const bool& sortNeighbors)
+{
+    const int32_t numTriangles = mySurf->getNumberOfTriangles();
+    m_numNodes = mySurf->getNumberOfNodes();
+    if (numTriangles > 0)
+    {
+        m_triangles.assign(mySurf->getTriangle(0), mySurf->getTriangle(0) + numTriangles * 3);
+    }
+    buildTiles();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper(sortNeighbors);
+    m_neighStarts.resize(m_numNodes + 1);
+    m_neighStarts[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh = 0;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        m_neighbors.insert(m_neighbors.end(), neighbors, neighbors + numNeigh);
+        m_neighStarts[i + 1] = (int32_t)m_neighbors.size();
+    }
+    m_hasNeighbors = true;
+    m_neighborsSorted = sortNeighbors;
+}
+
+void SurfaceGeometryHelper::buildTiles()
+{//counting sort of triangle corners by vertex, so each vertex's triangles stay in increasing order
+    const int32_t numTriangles = (int32_t)(m_triangles.size() / 3);
+    m_tileStarts.assign(m_numNodes + 1, 0);
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        const int32_t* thisTri = m_triangles.data() + i * 3;
+        if (thisTri[0] < 0 || thisTri[1] < 0 || thisTri[2] < 0) continue;//unused triangle slots are marked with negative indices
+        for (int j = 0; j < 3; ++j)
+        {
+            CaretAssert(thisTri[j] < m_numNodes);
+            ++m_tileStarts[thisTri[j] + 1];
+        }
+    }
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_tileStarts[i + 1] += m_tileStarts[i];
+    }
+    m_tiles.resize(m_tileStarts[m_numNodes]);
+    vector<int32_t> fillPos(m_tileStarts.begin(), m_tileStarts.end() - 1);
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        const int32_t* thisTri = m_triangles.data() + i * 3;
+        if (thisTri[0] < 0 || thisTri[1] < 0 || thisTri[2] < 0) continue;
+        for (int j = 0; j < 3; ++j)
+        {
+            m_tiles[fillPos[thisTri[j]]++] = i;
+        }
+    }
+}
+
+void SurfaceGeometryHelper::computeNormals(const float* coords, float* normalsOut) const
+{
+    const int32_t numTriangles = (int32_t)(m_triangles.size() / 3);
+    vector<float> triNormals(numTriangles * 3);
+#pragma omp CARET_PAR
+    {
+#pragma omp CARET_FOR schedule(dynamic, 4096)
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t* thisTri = m_triangles.data() + i * 3;
+            if (thisTri[0] < 0 || thisTri[1] < 0 || thisTri[2] < 0) continue;
+            MathFunctions::normalVector(coords + thisTri[0] * 3, coords + thisTri[1] * 3, coords + thisTri[2] * 3, triNormals.data() + i * 3);
+        }//implicit barrier
+#pragma omp CARET_FOR schedule(dynamic, 4096)
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {//sum in increasing triangle order, which is the order the serial scatter used to add them
+            float* thisNormal = normalsOut + i * 3;
+            thisNormal[0] = 0.0f; thisNormal[1] = 0.0f; thisNormal[2] = 0.0f;
+            const int32_t end = m_tileStarts[i + 1];
+            for (int32_t j = m_tileStarts[i]; j < end; ++j)
+            {
+                const float* triNormal = triNormals.data() + m_tiles[j] * 3;
+                thisNormal[0] += triNormal[0];
+                thisNormal[1] += triNormal[1];
+                thisNormal[2] += triNormal[2];
+            }
+            if (end > m_tileStarts[i])
+            {
+                MathFunctions::normalizeVector(thisNormal);
+            }//unconnected vertices keep the zero vector
+        }
+    }
+}
+
+void SurfaceGeometryHelper::computeNodeAreas(const float* coords, float* areasOut) const
+{
+    const int32_t numTriangles = (int32_t)(m_triangles.size() / 3);
+    vector<float> triAreas(numTriangles, 0.0f);
+#pragma omp CARET_PAR
+    {
+#pragma omp CARET_FOR schedule(dynamic, 4096)
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t* thisTri = m_triangles.data() + i * 3;
+            if (thisTri[0] < 0 || thisTri[1] < 0 || thisTri[2] < 0) continue;
+            triAreas[i] = MathFunctions::triangleArea(coords + thisTri[0] * 3, coords + thisTri[1] * 3, coords + thisTri[2] * 3) / 3.0f;
+        }
+#pragma omp CARET_FOR schedule(dynamic, 4096)
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            float accum = 0.0f;
+            const int32_t end = m_tileStarts[i + 1];
+            for (int32_t j = m_tileStarts[i]; j < end; ++j)
+            {
+                accum += triAreas[m_tiles[j]];
+            }
+            areasOut[i] = accum;
+        }
+    }
+}
+
+void SurfaceGeometryHelper::computeCurvature(const float* coords, const float* normals, float* meanOut, float* gaussOut) const
+{
+    CaretAssert(m_hasNeighbors);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        const int32_t* neighbors = m_neighbors.data() + m_neighStarts[i];
+        const int numNeigh = m_neighStarts[i + 1] - m_neighStarts[i];
+        float k1 = 0.0f, k2 = 0.0f;
+        if (numNeigh > 0)
+        {
+            Vector3D center = coords + i * 3;
+            Vector3D normal = normals + i * 3;
+            Vector3D basisStart;//default constructor is 0 vector
+            if (abs(normal[0]) > abs(normal[1]))
+            {//a vector not parallel to the normal
+                basisStart[1] = 1.0f;
+            } else {
+                basisStart[0] = 1.0f;
+            }
+            Vector3D ihat = normal.cross(basisStart).normal();
+            Vector3D jhat = normal.cross(ihat);
+            float sig_x = 0.0f, sig_xy = 0.0f, sig_y = 0.0f;
+            float norm_x = 0.0f, norm_xy = 0.0f, norm_y = 0.0f;
+            for (int j = 0; j < numNeigh; ++j)
+            {//center node contributes 0 to each sum, so skip it
+                Vector3D neighNormal = normals + neighbors[j] * 3;
+                Vector3D neighDiff = Vector3D(coords + neighbors[j] * 3) - center;
+                float normProj[2] = { neighNormal.dot(ihat), neighNormal.dot(jhat) };
+                float diffProj[2] = { neighDiff.dot(ihat), neighDiff.dot(jhat) };
+                sig_x += diffProj[0] * diffProj[0];
+                sig_xy += diffProj[0] * diffProj[1];
+                sig_y += diffProj[1] * diffProj[1];
+                norm_x += normProj[0] * diffProj[0];
+                norm_xy += normProj[0] * diffProj[1] + normProj[1] * diffProj[0];
+                norm_y += normProj[1] * diffProj[1];
+            }
+            float sig_xy2 = sig_xy * sig_xy;
+            float denom = (sig_x + sig_y) * (-sig_xy2 + sig_x * sig_y);
+            if (denom != 0.0f)
+            {
+                float a = (norm_x * (-sig_xy2 + sig_x * sig_y + sig_y * sig_y) -
+                           norm_xy * sig_xy * sig_y +
+                           norm_y * sig_xy2) / denom;
+                float b = (-norm_x * sig_xy * sig_y +
+                           norm_xy * sig_x * sig_y -
+                           norm_y * sig_x * sig_xy) / denom;
+                float c = (norm_x * sig_xy2 -
+                           norm_xy * sig_x * sig_xy +
+                           norm_y * (sig_x * sig_x - sig_xy2 + sig_x * sig_y)) / denom;
+                float trC = a + c;
+                float detC = a * c - b * b;
+                float temp = trC * trC - 4 * detC;
+                if (temp >= 0.0f)
+                {
+                    float delta = sqrt(temp);
+                    k1 = (trC + delta) / 2;
+                    k2 = (trC - delta) / 2;
+                }
+            }
+        }
+        if (meanOut != NULL) meanOut[i] = (k1 + k2) / 2;
+        if (gaussOut != NULL) gaussOut[i] = k1 * k2;
+    }
+}
+
+void SurfaceGeometryHelper::smoothCoordinates(const float* coordsIn, const float& strength, float* coordsOut) const
+{
+    CaretAssert(m_hasNeighbors && m_neighborsSorted);//consecutive neighbors must form triangles with the center vertex
+    const float inverseStrength = 1.0 - strength;
+#pragma omp CARET_PAR
+    {
+        vector<float> triangleAreas(100);
+        vector<float> triangleCenters(100 * 3);
+#pragma omp CARET_FOR schedule(dynamic, 4096)
+        for (int32_t iNode = 0; iNode < m_numNodes; ++iNode)
+        {
+            const int32_t* neighbors = m_neighbors.data() + m_neighStarts[iNode];
+            const int32_t numNeighbors = m_neighStarts[iNode + 1] - m_neighStarts[iNode];
+            const float* c1 = coordsIn + iNode * 3;
+            if (numNeighbors < 2)
+            {
+                coordsOut[iNode * 3] = c1[0];
+                coordsOut[iNode * 3 + 1] = c1[1];
+                coordsOut[iNode * 3 + 2] = c1[2];
+                continue;
+            }
+            if (numNeighbors > (int32_t)triangleAreas.size())
+            {
+                triangleAreas.resize(numNeighbors);
+                triangleCenters.resize(numNeighbors * 3);
+            }
+            double totalArea = 0.0;
+            for (int jn = 0; jn < numNeighbors; ++jn)
+            {//triangle formed by the vertex and two consecutive neighbors
+                const float* c2 = coordsIn + neighbors[jn] * 3;
+                const float* c3 = coordsIn + neighbors[(jn + 1 < numNeighbors) ? jn + 1 : 0] * 3;
+                const float area = MathFunctions::triangleArea(c1, c2, c3);
+                triangleAreas[jn] = area;
+                totalArea += area;
+                for (int k = 0; k < 3; ++k)
+                {
+                    triangleCenters[jn * 3 + k] = (c1[k] + c2[k] + c3[k]) / 3.0;
+                }
+            }
+            float neighborAverageX = 0.0f, neighborAverageY = 0.0f, neighborAverageZ = 0.0f;
+            for (int j = 0; j < numNeighbors; ++j)
+            {
+                if (triangleAreas[j] > 0.0)
+                {
+                    const float weight = triangleAreas[j] / totalArea;
+                    neighborAverageX += (weight * triangleCenters[j * 3]);
+                    neighborAverageY += (weight * triangleCenters[j * 3 + 1]);
+                    neighborAverageZ += (weight * triangleCenters[j * 3 + 2]);
+                }
+            }
+            coordsOut[iNode * 3] = ((c1[0] * inverseStrength) + (neighborAverageX * strength));
+            coordsOut[iNode * 3 + 1] = ((c1[1] * inverseStrength) + (neighborAverageY * strength));
+            coordsOut[iNode * 3 + 2] = ((c1[2] * inverseStrength) + (neighborAverageZ * strength));
+        }
+    }
+}
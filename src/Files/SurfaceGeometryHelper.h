@@ -0,0 +1,67 @@
+#ifndef __SURFACE_GEOMETRY_HELPER_H__
+#define __SURFACE_GEOMETRY_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    class SurfaceFile;
+
+    //per-vertex geometry kernels for normals, vertex areas, curvature, and smoothing
+    //each vertex gathers from its own triangles or neighbors in a fixed order instead of triangles scattering into vertices,
+    //so the vertex loops can be parallelized and the results do not depend on the number of threads
+    //coordinates stay interleaved xyz, as in SurfaceFile, so no conversion is needed between passes
+    class SurfaceGeometryHelper
+    {
+        std::vector<int32_t> m_triangles;
+        std::vector<int32_t> m_tileStarts, m_tiles;//triangles using each vertex in compressed rows, in increasing order
+        std::vector<int32_t> m_neighStarts, m_neighbors;//vertex neighbors in compressed rows, only from the SurfaceFile constructor
+        int32_t m_numNodes;
+        bool m_hasNeighbors, m_neighborsSorted;
+
+        void buildTiles();
+    public:
+        //topology only, for normals and vertex areas
+        SurfaceGeometryHelper(const int32_t* triangles, const int32_t& numTriangles, const int32_t& numNodes);
+        //also takes the neighbors from the surface's topology helper, sorted neighbors are needed for smoothing
+        SurfaceGeometryHelper(const SurfaceFile* mySurf, const bool& sortNeighbors = false);
+
+        int32_t getNumberOfNodes() const { return m_numNodes; }
+
+        //normalized average of the normals of the triangles using each vertex, unconnected vertices get a zero vector
+        void computeNormals(const float* coords, float* normalsOut) const;
+
+        //one third of the area of each triangle using the vertex
+        void computeNodeAreas(const float* coords, float* areasOut) const;
+
+        //either output may be NULL
+        void computeCurvature(const float* coords, const float* normals, float* meanOut, float* gaussOut) const;
+
+        //one iteration of area weighted smoothing, coordsIn and coordsOut must not overlap
+        void smoothCoordinates(const float* coordsIn, const float& strength, float* coordsOut) const;
+    };
+
+}
+
+#endif //__SURFACE_GEOMETRY_HELPER_H__
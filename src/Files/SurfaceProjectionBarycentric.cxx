@@ -33,6 +33,8 @@
 #include <QXmlStreamReader>
 #include <QStringList>
 
+#include <vector>
+
 using namespace caret;
 
     
@@ -443,6 +445,8 @@ void SurfaceProjectionBarycentric::readBorderFileXML1(QXmlStreamReader& xml)
     reset();
     CaretAssert(xml.isStartElement() && xml.name() == "ProjectionBarycentric");
     bool haveAreas = false, haveNodes = false, haveDist = false;
+    std::vector<float> areas;
+    std::vector<int32_t> nodes;
     for (xml.readNext(); !xml.atEnd() && !xml.isEndElement(); xml.readNext())
     {
         switch (xml.tokenType())
@@ -455,26 +459,30 @@ void SurfaceProjectionBarycentric::readBorderFileXML1(QXmlStreamReader& xml)
                     if (haveAreas) throw DataFileException("multiple TriangleAreas elements in one ProjectionBarycentric element");
                     QString text = xml.readElementText();//errors on unexpected element
                     if (xml.hasError()) throw DataFileException("XML parsing error in TriangleAreas: " + xml.errorString());
-                    QStringList areaStrings = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-                    if (areaStrings.size() != 3) throw DataFileException("TriangleAreas element must contain 3 numbers separated by whitespace");
-                    bool ok = false;
+                    if (!AString::toNumbersSeparatedByWhitespace(text.constData(), text.size(), areas) || areas.size() != 3)
+                    {//only split the text to report the error
+                        QStringList areaStrings = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+                        if (areaStrings.size() != 3) throw DataFileException("TriangleAreas element must contain 3 numbers separated by whitespace");
+                        throw DataFileException("found non-numeric string in TriangleAreas: " + text);
+                    }
                     for (int i = 0; i < 3; ++i)
                     {
-                        triangleAreas[i] = areaStrings[i].toFloat(&ok);
-                        if (!ok) throw DataFileException("found non-numeric string in TriangleAreas: " + areaStrings[i]);
+                        triangleAreas[i] = areas[i];
                     }
                     haveAreas = true;
                 } else if (name == "TriangleNodes") {
                     if (haveNodes) throw DataFileException("multiple TriangleNodes elements in one ProjectionBarycentric element");
                     QString text = xml.readElementText();//errors on unexpected element
                     if (xml.hasError()) throw DataFileException("XML parsing error in TriangleNodes: " + xml.errorString());
-                    QStringList nodeStrings = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-                    if (nodeStrings.size() != 3) throw DataFileException("TriangleNodes element must contain 3 integers separated by whitespace");
-                    bool ok = false;
+                    if (!AString::toNumbersSeparatedByWhitespace(text.constData(), text.size(), nodes) || nodes.size() != 3)
+                    {
+                        QStringList nodeStrings = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+                        if (nodeStrings.size() != 3) throw DataFileException("TriangleNodes element must contain 3 integers separated by whitespace");
+                        throw DataFileException("found non-integer string in TriangleNodes: " + text);
+                    }
                     for (int i = 0; i < 3; ++i)
                     {
-                        triangleNodes[i] = nodeStrings[i].toInt(&ok);
-                        if (!ok) throw DataFileException("found non-integer string in TriangleNodes: " + nodeStrings[i]);
+                        triangleNodes[i] = nodes[i];
                     }
                     haveNodes = true;
                 } else if (name == "SignedDistanceAboveSurface") {
@@ -27,6 +27,7 @@
 #undef __SURFACE_PROJECTOR_DEFINE__
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FociFile.h"
 #include "Focus.h"
 #include "MathFunctions.h"
@@ -109,6 +110,29 @@ m_surfaceFileRight(rightSurfaceFile),
 m_surfaceFileCerebellum(cerebellumSurfaceFile),
 m_mode(MODE_LEFT_RIGHT_CEREBELLUM)
 {
+    initializeMembersSurfaceProjector();
+}
+
+/**
+ * Copy constructor, used to give each thread its own projector
+ * when projecting in parallel.  Only the surfaces and options are
+ * copied, the state of the item being projected is not.
+ *
+ * @param o
+ *     Projector that is copied.
+ */
+SurfaceProjector::SurfaceProjector(const SurfaceProjector& o)
+: CaretObject(o),
+m_surfaceFiles(o.m_surfaceFiles),
+m_surfaceFileLeft(o.m_surfaceFileLeft),
+m_surfaceFileRight(o.m_surfaceFileRight),
+m_surfaceFileCerebellum(o.m_surfaceFileCerebellum),
+m_mode(o.m_mode)
+{
+    initializeMembersSurfaceProjector();
+    m_surfaceOffset = o.m_surfaceOffset;
+    m_surfaceOffsetValid = o.m_surfaceOffsetValid;
+    m_validateFlag = o.m_validateFlag;
 }
 
 
@@ -164,28 +188,26 @@ SurfaceProjector::projectFociFile(FociFile* fociFile)
     CaretAssert(fociFile);
     const int32_t numberOfFoci = fociFile->getNumberOfFoci();
     
+    std::vector<Focus*> foci(numberOfFoci);
+    for (int32_t i = 0; i < numberOfFoci; i++) {
+        foci[i] = fociFile->getFocus(i);
+    }
+    
+    std::vector<AString> focusErrorMessages;
+    projectFoci(foci,
+                focusErrorMessages);
+    
     AString errorMessage = "";
     for (int32_t i = 0; i < numberOfFoci; i++) {
-        Focus* focus = fociFile->getFocus(i);
-        try {
-            if (m_validateFlag) {
-                m_validateItemName = ("Focus "
-                                      + AString::number(i)
-                                      + ", "
-                                      + focus->getName());
-            }
-            projectFocus(i,
-                         focus);
-        }
-        catch (const SurfaceProjectorException& spe) {
+        if (focusErrorMessages[i].isEmpty() == false) {
             if (errorMessage.isEmpty() == false) {
                 errorMessage += "\n";
             }
-            errorMessage += (focus->getName()
+            errorMessage += (foci[i]->getName()
                              + ", index="
                              + AString::number(i)
                              + ": "
-                             + spe.whatString());
+                             + focusErrorMessages[i]);
         }
     }
     
@@ -194,6 +216,65 @@ SurfaceProjector::projectFociFile(FociFile* fociFile)
     }
 }
 
+/**
+ * Project a group of foci.  The foci are projected in parallel,
+ * each thread using its own copy of this projector, while the
+ * search structures of the surfaces (cached by each SurfaceFile
+ * until its coordinates change) are shared by all threads.
+ * Warnings are logged in the order of the foci.
+ *
+ * @param foci
+ *    The foci, index of a focus in this vector is used as its
+ *    index in warning messages.
+ * @param errorMessagesOut
+ *    Output with one element for each focus that contains the
+ *    error message if projecting the focus failed, otherwise it
+ *    is empty.
+ */
+void
+SurfaceProjector::projectFoci(const std::vector<Focus*>& foci,
+                              std::vector<AString>& errorMessagesOut)
+{
+    const int32_t numberOfFoci = static_cast<int32_t>(foci.size());
+    errorMessagesOut.clear();
+    errorMessagesOut.resize(numberOfFoci);
+    std::vector<AString> projectionWarnings(numberOfFoci);
+    
+    /*
+     * Validation output is only useful when it is in order
+     */
+#pragma omp CARET_PAR if ((numberOfFoci > 1) && (m_validateFlag == false))
+    {
+        SurfaceProjector threadProjector(*this);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t i = 0; i < numberOfFoci; i++) {
+            Focus* focus = foci[i];
+            CaretAssert(focus);
+            try {
+                if (threadProjector.m_validateFlag) {
+                    threadProjector.m_validateItemName = ("Focus "
+                                                          + AString::number(i)
+                                                          + ", "
+                                                          + focus->getName());
+                }
+                threadProjector.projectFocusWithoutLogging(focus);
+                projectionWarnings[i] = threadProjector.m_projectionWarning;
+            }
+            catch (const CaretException& e) {
+                errorMessagesOut[i] = e.whatString();
+            }
+        }
+    }
+    
+    for (int32_t i = 0; i < numberOfFoci; i++) {
+        if (projectionWarnings[i].isEmpty() == false) {
+            logFocusProjectionWarning(i,
+                                      foci[i],
+                                      projectionWarnings[i]);
+        }
+    }
+}
+
 /**
  * Project a focus.
  * @param focusIndex
@@ -206,6 +287,25 @@ SurfaceProjector::projectFociFile(FociFile* fociFile)
 void
 SurfaceProjector::projectFocus(const int32_t focusIndex,
                                Focus* focus)
+{
+    projectFocusWithoutLogging(focus);
+    
+    if (m_projectionWarning.isEmpty() == false) {
+        logFocusProjectionWarning(focusIndex,
+                                  focus,
+                                  m_projectionWarning);
+    }
+}
+
+/**
+ * Project a focus, any warning is left in m_projectionWarning.
+ * @param focus
+ *    The focus.
+ * @throws SurfaceProjectorException
+ *      If projecting an item failed.
+ */
+void
+SurfaceProjector::projectFocusWithoutLogging(Focus* focus)
 {
     const int32_t numberOfProjections = focus->getNumberOfProjections();
     CaretAssert(numberOfProjections > 0);
@@ -221,8 +321,14 @@ SurfaceProjector::projectFocus(const int32_t focusIndex,
     }
     
     m_allowEdgeProjection = true;
-    projectItem(spi,
-                spiSecond);
+    try {
+        projectItem(spi,
+                    spiSecond);
+    }
+    catch (const SurfaceProjectorException&) {
+        delete spiSecond;
+        throw;
+    }
     
     if (spiSecond != NULL) {
         if (spiSecond->hasValidProjection()) {
@@ -233,18 +339,31 @@ SurfaceProjector::projectFocus(const int32_t focusIndex,
             spiSecond = NULL;
         }
     }
-    
-    if (m_projectionWarning.isEmpty() == false) {
-        AString msg = ("Focus: Name="
-                       + focus->getName());
-        if (focusIndex >= 0) {
-            msg += (", Index="
-                    + AString::number(focusIndex));
-        }
-        msg += (": "
-                + m_projectionWarning);
-        CaretLogWarning(msg);;
+}
+
+/**
+ * Log a warning that was produced while projecting a focus.
+ * @param focusIndex
+ *    Index of the focus (negative indicates no index)
+ * @param focus
+ *    The focus.
+ * @param projectionWarning
+ *    The warning.
+ */
+void
+SurfaceProjector::logFocusProjectionWarning(const int32_t focusIndex,
+                                            const Focus* focus,
+                                            const AString& projectionWarning) const
+{
+    AString msg = ("Focus: Name="
+                   + focus->getName());
+    if (focusIndex >= 0) {
+        msg += (", Index="
+                + AString::number(focusIndex));
     }
+    msg += (": "
+            + projectionWarning);
+    CaretLogWarning(msg);
 }
 
 /**
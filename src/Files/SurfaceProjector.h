@@ -28,6 +28,7 @@
 #include <stdint.h>
 
 #include <set>
+#include <vector>
 
 namespace caret {
     
@@ -65,6 +66,9 @@ namespace caret {
         void projectFocus(const int32_t focusIndex,
                           Focus* focus);
         
+        void projectFoci(const std::vector<Focus*>& foci,
+                         std::vector<AString>& errorMessagesOut);
+        
         void setSurfaceOffset(const float surfaceOffset);
         
     private:
@@ -122,6 +126,12 @@ namespace caret {
 
         void initializeMembersSurfaceProjector();
         
+        void projectFocusWithoutLogging(Focus* focus);
+        
+        void logFocusProjectionWarning(const int32_t focusIndex,
+                                       const Focus* focus,
+                                       const AString& projectionWarning) const;
+        
         void getProjectionLocation(const SurfaceFile* surfaceFile,
                                    const float xyz[3],
                                    ProjectionLocation& projectionLocation) const;
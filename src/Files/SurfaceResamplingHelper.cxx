@@ -34,7 +34,6 @@
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 
-#include <set>
 #include <map>
 
 using namespace std;
@@ -401,89 +400,131 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
 void SurfaceResamplingHelper::computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                          const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
-    vector<map<int, float> > forward, reverse, reverse_gather;
+    WeightRows forward, reverse;
     makeBarycentricWeights(currentSphere, newSphere, forward, NULL);//don't use an roi until after we have done area correction, because area correction MUST ignore ROI
     makeBarycentricWeights(newSphere, currentSphere, reverse, NULL);
-    int numNewNodes = (int)forward.size(), numOldNodes = currentSphere->getNumberOfNodes();
-    reverse_gather.resize(numNewNodes);
-    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)//this loop can't be parallelized
+    int numNewNodes = forward.getNumberOfRows(), numOldNodes = currentSphere->getNumberOfNodes();
+    WeightRows reverse_gather;//convert scattering weights to gathering weights with a counting sort
+    reverse_gather.rowStarts.resize(numNewNodes + 1, 0);
+    int numReverse = (int)reverse.elems.size();
+    for (int i = 0; i < numReverse; ++i)
     {
-        for (map<int, float>::iterator iter = reverse[oldNode].begin(); iter != reverse[oldNode].end(); ++iter)//convert scattering weights to gathering weights
-        {
-            reverse_gather[iter->first][oldNode] = iter->second;
-        }
+        ++reverse_gather.rowStarts[reverse.elems[i].node + 1];
     }
-    vector<map<int, float> > adap_gather(numNewNodes);
-#pragma omp CARET_PARFOR schedule(dynamic)
     for (int newNode = 0; newNode < numNewNodes; ++newNode)
     {
-        set<int> forwardused;//build set of all nodes used by forward weights (really only 3, but this is a bit cleaner and more generic)
-        for (map<int, float>::iterator iter = forward[newNode].begin(); iter != forward[newNode].end(); ++iter)
+        reverse_gather.rowStarts[newNode + 1] += reverse_gather.rowStarts[newNode];
+    }
+    reverse_gather.elems.resize(numReverse);
+    vector<int> fillPos(reverse_gather.rowStarts.begin(), reverse_gather.rowStarts.end() - 1);
+    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)//this loop is linear and cheap, and filling in order of old node keeps each row sorted
+    {
+        for (int i = reverse.rowStarts[oldNode]; i < reverse.rowStarts[oldNode + 1]; ++i)
         {
-            forwardused.insert(iter->first);
+            const WeightElem& elem = reverse.elems[i];
+            reverse_gather.elems[fillPos[elem.node]] = WeightElem(oldNode, elem.weight);
+            ++fillPos[elem.node];
         }
-        bool useforward = true;
-        for (map<int, float>::iterator iter = reverse_gather[newNode].begin(); iter != reverse_gather[newNode].end(); ++iter)
+    }
+    WeightRows adap_gather;
+    vector<char> useforward(numNewNodes);//avoid bitpacking so it can be modified in parallel
+    adap_gather.rowStarts.resize(numNewNodes + 1);
+    adap_gather.rowStarts[0] = 0;
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        useforward[newNode] = 1;
+        for (int i = reverse_gather.rowStarts[newNode]; i < reverse_gather.rowStarts[newNode + 1]; ++i)
         {
-            if (forwardused.find(iter->first) == forwardused.end())
+            bool found = false;//forward weights have at most 3 nodes, so just scan them
+            for (int j = forward.rowStarts[newNode]; j < forward.rowStarts[newNode + 1]; ++j)
             {
-                useforward = false;//if the reverse scatter weights include something the forward gather weights don't, use reverse scatter
+                if (forward.elems[j].node == reverse_gather.elems[i].node)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                useforward[newNode] = 0;//if the reverse scatter weights include something the forward gather weights don't, use reverse scatter
                 break;
             }
         }
-        if (useforward)
-        {
-            adap_gather[newNode] = forward[newNode];
-        } else {
-            adap_gather[newNode] = reverse_gather[newNode];
-        }
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)//begin area correction by multiplying by target node area
+        const WeightRows& source = (useforward[newNode] ? forward : reverse_gather);
+        adap_gather.rowStarts[newNode + 1] = source.rowStarts[newNode + 1] - source.rowStarts[newNode];
+    }
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        adap_gather.rowStarts[newNode + 1] += adap_gather.rowStarts[newNode];
+    }
+    adap_gather.elems.resize(adap_gather.rowStarts[numNewNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        const WeightRows& source = (useforward[newNode] ? forward : reverse_gather);
+        int outPos = adap_gather.rowStarts[newNode];
+        for (int i = source.rowStarts[newNode]; i < source.rowStarts[newNode + 1]; ++i)
         {
-            iter->second *= newAreas[newNode];//begin the process of area correction by multiplying by gathering node areas
+            adap_gather.elems[outPos] = source.elems[i];
+            adap_gather.elems[outPos].weight *= newAreas[newNode];//begin the process of area correction by multiplying by gathering node areas
+            ++outPos;
         }
     }
     vector<float> correctionSum(numOldNodes, 0.0f);
-    for (int newNode = 0; newNode < numNewNodes; ++newNode)//this loop is separate because it can't be parallelized
+    int numAdap = (int)adap_gather.elems.size();
+    for (int i = 0; i < numAdap; ++i)//this loop is separate because it can't be parallelized
     {
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
-        {
-            correctionSum[iter->first] += iter->second;//now, sum the scattering weights to prepare for first normalization
-        }
+        correctionSum[adap_gather.elems[i].node] += adap_gather.elems[i].weight;//now, sum the scattering weights to prepare for first normalization
     }
-#pragma omp CARET_PARFOR schedule(dynamic)
+    vector<int> numKept(numNewNodes);
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
     for (int newNode = 0; newNode < numNewNodes; ++newNode)
     {
         double weightsum = 0.0f;
-        vector<map<int, float>::iterator> toRemove;
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+        int rowStart = adap_gather.rowStarts[newNode], keptEnd = rowStart;
+        for (int i = rowStart; i < adap_gather.rowStarts[newNode + 1]; ++i)
         {
-            if (currentRoi == NULL || currentRoi[iter->first] > 0.0f)
+            WeightElem elem = adap_gather.elems[i];
+            if (currentRoi == NULL || currentRoi[elem.node] > 0.0f)
             {
-                iter->second *= currentAreas[iter->first] / correctionSum[iter->first];//divide the weights by their scatter sum, then multiply by current areas
-                weightsum += iter->second;//and compute the sum
-            } else {
-                toRemove.push_back(iter);
+                elem.weight *= currentAreas[elem.node] / correctionSum[elem.node];//divide the weights by their scatter sum, then multiply by current areas
+                weightsum += elem.weight;//and compute the sum
+                adap_gather.elems[keptEnd] = elem;//drop nodes outside the roi by shifting the kept ones down, order is preserved
+                ++keptEnd;
             }
         }
-        int numToRemove = (int)toRemove.size();
-        for (int i = 0; i < numToRemove; ++i)
+        numKept[newNode] = keptEnd - rowStart;
+        if (weightsum != 0.0f)//this shouldn't happen unless no nodes remain due to roi, or node areas can be zero
         {
-            adap_gather[newNode].erase(toRemove[i]);
+            for (int i = rowStart; i < keptEnd; ++i)
+            {
+                adap_gather.elems[i].weight /= weightsum;//and normalize to a sum of 1
+            }
         }
-        if (weightsum != 0.0f)//this shouldn't happen unless no nodes remain due to roi, or node areas can be zero
+    }
+    if (currentRoi != NULL)
+    {//close the gaps left by removed nodes
+        int outPos = 0;
+        for (int newNode = 0; newNode < numNewNodes; ++newNode)
         {
-            for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+            int rowStart = adap_gather.rowStarts[newNode];
+            adap_gather.rowStarts[newNode] = outPos;
+            for (int i = 0; i < numKept[newNode]; ++i)
             {
-                iter->second /= weightsum;//and normalize to a sum of 1
+                adap_gather.elems[outPos] = adap_gather.elems[rowStart + i];
+                ++outPos;
             }
         }
+        adap_gather.rowStarts[numNewNodes] = outPos;
+        adap_gather.elems.resize(outPos);
     }
     compactWeights(adap_gather);//and compact them into the internal weight storage
 }
 
 void SurfaceResamplingHelper::computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi)
 {
-    vector<map<int, float> > forward;
+    WeightRows forward;
     makeBarycentricWeights(currentSphere, newSphere, forward, currentRoi);//this should ensure they sum to 1, so we are done
     compactWeights(forward);
 }
@@ -533,83 +574,96 @@ void SurfaceResamplingHelper::changeRadius(const float& radius, const SurfaceFil
     output->setCoordinates(newCoordData.data());
 }
 
-void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& weights)
+void SurfaceResamplingHelper::compactWeights(const WeightRows& weights)
 {
-    int compactsize = 0;
-    int numNodes = (int)weights.size();
+    int numNodes = weights.getNumberOfRows();
+    int compactsize = (int)weights.elems.size();
+    CaretAssert(weights.rowStarts[numNodes] == compactsize);
     m_weights = CaretArray<WeightElem*>(numNodes + 1);//include a "one-after" pointer
-    for (int i = 0; i < numNodes; ++i)
+    m_storagechunk = CaretArray<WeightElem>(compactsize);
+    for (int i = 0; i < compactsize; ++i)
     {
-        compactsize += (int)weights[i].size();
+        m_storagechunk[i] = weights.elems[i];
     }
-    m_storagechunk = CaretArray<WeightElem>(compactsize);
-    int curpos = 0;
-    for (int i = 0; i < numNodes; ++i)
+    for (int i = 0; i <= numNodes; ++i)
+    {
+        m_weights[i] = m_storagechunk + weights.rowStarts[i];
+    }
+}
+
+namespace
+{
+    //adds a weight to a row of at most 3 elements, keeping it sorted by node, and replacing the weight if the node is already there
+    //nodes and weights are separate arrays because WeightElem is private to the class
+    void addToSortedRow(int* rowNodes, float* rowWeights, int& rowSize, const int& node, const float& weight)
     {
-        m_weights[i] = m_storagechunk + curpos;
-        for (map<int, float>::const_iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
+        int pos = 0;
+        while (pos < rowSize && rowNodes[pos] < node) ++pos;
+        if (pos < rowSize && rowNodes[pos] == node)
+        {
+            rowWeights[pos] = weight;
+            return;
+        }
+        for (int i = rowSize; i > pos; --i)
         {
-            m_storagechunk[curpos] = WeightElem(iter->first, iter->second);
-            ++curpos;
+            rowNodes[i] = rowNodes[i - 1];
+            rowWeights[i] = rowWeights[i - 1];
         }
+        rowNodes[pos] = node;
+        rowWeights[pos] = weight;
+        ++rowSize;
     }
-    CaretAssert(curpos == compactsize);
-    m_weights[numNodes] = m_storagechunk + compactsize;
 }
 
-void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, vector<map<int, float> >& weights, const float* currentRoi)
+void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, WeightRows& weights, const float* currentRoi)
 {
     int numToNodes = to->getNumberOfNodes();
-    weights.resize(numToNodes);
     const float* toCoordData = to->getCoordinateData();
-    if (currentRoi == NULL)
-    {
-#pragma omp CARET_PAR
-        {
-            CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int i = 0; i < numToNodes; ++i)
-            {
-                BarycentricInfo myInfo;
-                mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f) weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                if (myInfo.baryWeights[1] != 0.0f) weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                if (myInfo.baryWeights[2] != 0.0f) weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
-            }
-        }
-    } else {
+    vector<int> rowNodes(numToNodes * 3), rowSizes(numToNodes);//fixed stride of 3 while searching, compacted afterwards
+    vector<float> rowWeights(numToNodes * 3);
 #pragma omp CARET_PAR
+    {
+        CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
+#pragma omp CARET_FOR schedule(dynamic, 256)
+        for (int i = 0; i < numToNodes; ++i)
         {
-            CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int i = 0; i < numToNodes; ++i)
+            BarycentricInfo myInfo;
+            int* myNodes = rowNodes.data() + i * 3;
+            float* myWeights = rowWeights.data() + i * 3;
+            int& mySize = rowSizes[i];
+            mySize = 0;
+            mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
+            float weightsum = 0.0f;//there are only 3 weights, so don't bother with double precision
+            for (int j = 0; j < 3; ++j)
             {
-                BarycentricInfo myInfo;
-                float weightsum = 0.0f;//there are only 3 weights, so don't bother with double precision
-                mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f && currentRoi[myInfo.nodes[0]] > 0.0f)
-                {
-                    weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                    weightsum += myInfo.baryWeights[0];
-                }
-                if (myInfo.baryWeights[1] != 0.0f && currentRoi[myInfo.nodes[1]] > 0.0f)
+                if (myInfo.baryWeights[j] != 0.0f && (currentRoi == NULL || currentRoi[myInfo.nodes[j]] > 0.0f))
                 {
-                    weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                    weightsum += myInfo.baryWeights[1];
+                    addToSortedRow(myNodes, myWeights, mySize, myInfo.nodes[j], myInfo.baryWeights[j]);
+                    weightsum += myInfo.baryWeights[j];
                 }
-                if (myInfo.baryWeights[2] != 0.0f && currentRoi[myInfo.nodes[2]] > 0.0f)
-                {
-                    weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
-                    weightsum += myInfo.baryWeights[2];
-                }
-                if (weightsum != 0.0f)
+            }
+            if (currentRoi != NULL && weightsum != 0.0f)
+            {
+                for (int j = 0; j < mySize; ++j)
                 {
-                    for (map<int, float>::iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
-                    {
-                        iter->second /= weightsum;
-                    }
+                    myWeights[j] /= weightsum;
                 }
             }
         }
     }
+    weights.rowStarts.resize(numToNodes + 1);
+    weights.rowStarts[0] = 0;
+    for (int i = 0; i < numToNodes; ++i)
+    {
+        weights.rowStarts[i + 1] = weights.rowStarts[i] + rowSizes[i];
+    }
+    weights.elems.resize(weights.rowStarts[numToNodes]);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int i = 0; i < numToNodes; ++i)
+    {
+        for (int j = 0; j < rowSizes[i]; ++j)
+        {
+            weights.elems[weights.rowStarts[i] + j] = WeightElem(rowNodes[i * 3 + j], rowWeights[i * 3 + j]);
+        }
+    }
 }
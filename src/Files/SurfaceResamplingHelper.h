@@ -24,7 +24,6 @@
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
-#include <map>
 #include <vector>
 
 namespace caret {
@@ -40,14 +39,20 @@ namespace caret {
             WeightElem() { }
             WeightElem(const int& nodeIn, const float& weightIn) : node(nodeIn), weight(weightIn) { }
         };
+        struct WeightRows
+        {//compressed rows, nodes are sorted within each row, avoids a map per node while building weights
+            std::vector<int> rowStarts;//includes a "one-after" element
+            std::vector<WeightElem> elems;
+            int getNumberOfRows() const { return (int)rowStarts.size() - 1; }
+        };
         CaretArray<WeightElem> m_storagechunk;
         CaretArray<WeightElem*> m_weights;
         static bool checkSphere(const SurfaceFile* surface);
         static void changeRadius(const float& radius, const SurfaceFile* input, SurfaceFile* output);
         void computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas, const float* currentRoi);
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
-        static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
-        void compactWeights(const std::vector<std::map<int, float> >& weights);
+        static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, WeightRows& weights, const float* currentRoi);
+        void compactWeights(const WeightRows& weights);
     public:
         SurfaceResamplingHelper() { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
@@ -19,7 +19,9 @@
 /*LICENSE_END*/
 
 #include <QDir>
+#include <QFile>
 #include <QFileDialog>
+#include <csignal>
 #include <unistd.h>
 
 #include "MovieDialog.h"
@@ -41,6 +43,7 @@
 #include "Model.h"
 #include "ModelSurface.h"
 #include "ModelSurfaceSelector.h"
+#include "MovieFrameWriter.h"
 #include "SessionManager.h"
 #include "Surface.h"
 #include "WuQMessageBox.h"
@@ -64,6 +67,11 @@ MovieDialog::MovieDialog(QWidget *parent) :
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_GRAPHICS_UPDATE_ALL_WINDOWS);
 
     m_browserWindowIndex = 0;
+    m_movieFrameWriter = NULL;
+    m_movieEncoderPipe = NULL;
+#ifndef CARET_OS_WINDOWS
+    m_previousSigPipeHandler = SIG_DFL;
+#endif // CARET_OS_WINDOWS
     frame_number = 0;
     rotate_frame_number = 0;
 
@@ -89,6 +97,7 @@ MovieDialog::MovieDialog(QWidget *parent) :
 MovieDialog::~MovieDialog()
 {
     ui->animateButton->setChecked(false);    
+    finishMovieRecording();
     delete ui;
     EventManager::get()->removeAllEventsFromListener(this);
 
@@ -206,63 +215,166 @@ void MovieDialog::on_recordButton_toggled(bool checked)
             imageX = ui->windowWidthSpinBox->value();
             imageY = ui->windowHeightSpinBox->value();
         }
+
+        if ( ! startMovieRecording()) {
+            ui->recordButton->blockSignals(true);
+            ui->recordButton->setChecked(false);
+            ui->recordButton->blockSignals(false);
+        }
     }
-    if(!checked&&(frame_number > 0))
+    else
     {
-        //render frames....
+        finishMovieRecording();
+    }
+}
 
-        QString formatString("Movie Files (*.mpg *.mp4)");
+/**
+ * Get the name of the movie file and start the movie.  Frames are
+ * written as they are captured, so the movie is complete when
+ * recording stops.  YUV4MPEG2 and AVI movies are written directly,
+ * other formats are encoded by ffmpeg reading frames from a pipe.
+ *
+ * @return
+ *     True if recording started, else false.
+ */
+bool MovieDialog::startMovieRecording()
+{
+    CaretAssert(m_movieFrameWriter == NULL);
 
-        AString fileName = QFileDialog::getSaveFileName( this, tr("Save File"),QString::null, formatString );
-        AString tempDir = QDir::tempPath();
-        if ( !fileName.isEmpty() )
-        {
-//            int crop[4];
-//            crop[0] = imageX;
-//            crop[1] = imageY;
-//            crop[2] = 0;
-//            crop[3] = 0;            
-//            if(!(crop[0]&&crop[1])) GuiManager::get()->getBrowserWindowByWindowIndex(m_browserWindowIndex)->getViewportSize(crop[0],crop[1]);
-    
+    QString formatString("Movie Files (*.mpg *.mp4);;"
+                         "YUV4MPEG2 Files (*.y4m);;"
+                         "Uncompressed AVI Files (*.avi)");
 
-            unlink(fileName);
-            CaretLogInfo("Rendering movie to:" + fileName);
-            AString ffmpeg = SystemUtilities::getWorkbenchHome() + AString("/ffmpeg ");            
+    AString fileName = QFileDialog::getSaveFileName( this, tr("Save File"),QString::null, formatString );
+    if (fileName.isEmpty()) {
+        return false;
+    }
 
-           // JWH ffmpeg = "/mnt/myelin/distribution/caret7_distribution/workbench//macosx64_apps/ffmpeg ";
-            
-            
-            double frame_rate = 30.0/double(1 + this->ui->repeatFramesSpinBox->value());
+    /*
+     * Repeated frames lower the frame rate
+     */
+    const int32_t frameRateNumerator   = 30;
+    const int32_t frameRateDenominator = 1 + this->ui->repeatFramesSpinBox->value();
 
-            
-//            if(ui->cropImageCheckBox->isChecked())
-//            {                
-//                this->getImageCrop(tempDir + "/movie0" + AString(".png"),crop);
-//            }
-//
-//            crop[0] = (crop[0]/2)*2;
-//            crop[1] = (crop[1]/2)*2;
-//            CaretLogInfo("Resizing image from " + AString::number(imageX) + AString(":") + AString::number(imageY) + AString(" to ") +
-//                         AString::number(crop[0]) + AString(":") + AString::number(crop[1]));
-//
-//            AString command = ffmpeg + AString("-threads 4 -r " + AString::number(frame_rate) + " -i "+ tempDir + "/movie%d.png -r 30 -q:v 1 -vf crop=" + 
-//                AString::number(crop[0]) + ":" + AString::number(crop[1]) + ":" + 
-//                AString::number(crop[2]) + ":" + AString::number(crop[3]) + " " + fileName);
-            AString command = ffmpeg + AString("-threads 4 -r " + AString::number(frame_rate) + " -i "+ tempDir + "/movie%d.png -r 30 -q:v 1 "
-                                               + fileName);
+    unlink(fileName);
+    try {
+        MovieFrameWriter::Format movieFormat;
+        if (MovieFrameWriter::getFormatFromFileName(fileName,
+                                                    movieFormat)) {
+            m_movieFrameWriter = new MovieFrameWriter(fileName,
+                                                      frameRateNumerator,
+                                                      frameRateDenominator);
+        }
+        else {
+            const AString ffmpeg = SystemUtilities::getWorkbenchHome() + AString("/ffmpeg");
+            if (( ! QFile::exists(ffmpeg))
+                && ( ! QFile::exists(ffmpeg + ".exe"))) {
+                WuQMessageBox::errorOk(this,
+                                       "ffmpeg was not found in " + SystemUtilities::getWorkbenchHome()
+                                       + ".  Save the movie as a YUV4MPEG2 (.y4m) or AVI (.avi) file.");
+                return false;
+            }
+
+            AString command = ("\"" + ffmpeg + "\" -y -f yuv4mpegpipe -i - -r 30 -q:v 1 \""
+                               + fileName + "\"");
             CaretLogFine("running " + command);
 
-            system(command.toAscii().data());
-            CaretLogFine("Finished rendering " + fileName);
+#ifdef CARET_OS_WINDOWS
+            m_movieEncoderPipe = _popen(command.toLocal8Bit().constData(), "wb");
+#else // CARET_OS_WINDOWS
+            /*
+             * If ffmpeg exits early, writing reports an error instead of a signal ending wb_view.
+             * The previous handler is restored when the pipe is closed.
+             */
+            m_previousSigPipeHandler = signal(SIGPIPE, SIG_IGN);
+            m_movieEncoderPipe = popen(command.toLocal8Bit().constData(), "w");
+            if (m_movieEncoderPipe == NULL) {
+                signal(SIGPIPE, m_previousSigPipeHandler);
+            }
+#endif // CARET_OS_WINDOWS
+            if (m_movieEncoderPipe == NULL) {
+                WuQMessageBox::errorOk(this,
+                                       "Unable to run " + ffmpeg);
+                return false;
+            }
+            m_movieFrameWriter = new MovieFrameWriter(m_movieEncoderPipe,
+                                                      "ffmpeg encoding " + fileName,
+                                                      frameRateNumerator,
+                                                      frameRateDenominator);
+        }
+    }
+    catch (const DataFileException& dfe) {
+        finishMovieRecording();
+        WuQMessageBox::errorOk(this,
+                               dfe.whatString());
+        return false;
+    }
+
+    m_movieFileName = fileName;
+    frame_number = 0;
+    CaretLogInfo("Rendering movie to:" + fileName);
+
+    return true;
+}
+
+/**
+ * Wait for captured frames to be written and complete the movie.
+ */
+void MovieDialog::finishMovieRecording()
+{
+    if ((m_movieFrameWriter == NULL)
+        && (m_movieEncoderPipe == NULL)) {
+        return;
+    }
 
+    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+
+    /*
+     * A frame that failed to be added stops recording, the error
+     * is reported here so that it is not reported again by finish()
+     */
+    AString errorMessage = m_movieErrorMessage;
+    m_movieErrorMessage.clear();
+    if (m_movieFrameWriter != NULL) {
+        try {
+            m_movieFrameWriter->finish();
         }
-        for(int i = 0;i<frame_number;i++)
-        {
-            AString tempFile = tempDir + "/movie" + AString::number(i) + AString(".png");
-            unlink(tempFile);
+        catch (const DataFileException& dfe) {
+            if (errorMessage.isEmpty()) {
+                errorMessage = dfe.whatString();
+            }
+        }
+        delete m_movieFrameWriter;
+        m_movieFrameWriter = NULL;
+    }
+
+    if (m_movieEncoderPipe != NULL) {
+        /*
+         * Closing the pipe waits for ffmpeg to finish encoding
+         */
+#ifdef CARET_OS_WINDOWS
+        const int exitStatus = _pclose(m_movieEncoderPipe);
+#else // CARET_OS_WINDOWS
+        const int exitStatus = pclose(m_movieEncoderPipe);
+        signal(SIGPIPE, m_previousSigPipeHandler);
+#endif // CARET_OS_WINDOWS
+        m_movieEncoderPipe = NULL;
+        if ((exitStatus != 0)
+            && errorMessage.isEmpty()) {
+            errorMessage = "ffmpeg failed encoding " + m_movieFileName;
         }
-        frame_number = 0;
     }
+
+    QApplication::restoreOverrideCursor();
+
+    if (errorMessage.isEmpty()) {
+        CaretLogFine("Finished rendering " + m_movieFileName);
+    }
+    else {
+        WuQMessageBox::errorOk(this,
+                               errorMessage);
+    }
+    frame_number = 0;
 }
 
 //void MovieDialog::getImageCrop(AString fileName, int *cropOut)
@@ -388,13 +500,11 @@ MovieDialog::receiveEvent(Event* event)
        event->getEventType() == EventTypeEnum::EVENT_GRAPHICS_UPDATE_ONE_WINDOW    )
     {
 
-        AString tempPath = QDir::tempPath();
-        if(this->ui->recordButton->isChecked())
+        if(this->ui->recordButton->isChecked()
+           && (m_movieFrameWriter != NULL))
         {
-            this->captureFrame(tempPath + AString("/movie") + AString::number(frame_number) + AString(".png"));
+            this->captureFrame();
 
-            AString temp = tempPath + AString("/movie") + AString::number(frame_number) + AString(".png");
-            CaretLogFine(temp);
             CaretLogFine("frame number:" + QString::number(frame_number));
             frame_number++;
         }
@@ -664,7 +774,7 @@ void MovieDialog::processUpdateVolumeSlice()
 	}
 }
 
-void MovieDialog::captureFrame(AString filename)
+void MovieDialog::captureFrame()
 {
     
 
@@ -717,28 +827,6 @@ void MovieDialog::captureFrame(AString filename)
         croppedImageY = imageFile.getAsQImage()->size().width();
     }*/
 
-    std::vector<AString> imageFileExtensions;
-    AString defaultFileExtension;
-    ImageFile::getImageFileExtensions(imageFileExtensions, 
-        defaultFileExtension);
-
-
-
-    bool validExtension = false;
-    for (std::vector<AString>::iterator extensionIterator = imageFileExtensions.begin();
-        extensionIterator != imageFileExtensions.end();
-        extensionIterator++) {
-            if (filename.endsWith(*extensionIterator)) {
-                validExtension = true;
-            }
-    }
-
-    if (validExtension == false) {
-        if (defaultFileExtension.isEmpty() == false) {
-            filename += ("." + defaultFileExtension);
-        }
-    }
-
     uint8_t backgroundColor[3];
     imageCaptureEvent.getBackgroundColor(backgroundColor);
     
@@ -748,11 +836,19 @@ void MovieDialog::captureFrame(AString filename)
             imageFile.addMargin(marginSize,
                                 backgroundColor);
         }
-        imageFile.writeFile(filename);
+        m_movieFrameWriter->addFrame(*imageFile.getAsQImage());
     }
-    catch (const DataFileException& /*e*/) {
-        QString msg("Unable to save: " + filename);
-        WuQMessageBox::errorOk(this, msg);
+    catch (const DataFileException& dfe) {
+        /*
+         * Unchecking the record button finishes the movie and reports the error
+         */
+        m_movieErrorMessage = dfe.whatString();
+        if (ui->recordButton->isChecked()) {
+            ui->recordButton->setChecked(false);
+        }
+        else {
+            finishMovieRecording();
+        }
     }
 }
 
@@ -25,6 +25,7 @@
 #include <VolumeSliceViewPlaneEnum.h>
 #include "Event.h"
 #include "EventListenerInterface.h"
+#include <cstdio>
 #include <stdint.h>
 
 
@@ -34,6 +35,7 @@ namespace Ui {
 
 using namespace caret;
 namespace caret { 
+    class MovieFrameWriter;
     class Surface;
 }
 class MovieDialog : public QDialog, public EventListenerInterface
@@ -69,7 +71,11 @@ public:
 private:
     Ui::MovieDialog *ui;
 
-    void captureFrame(AString filename);
+    void captureFrame();
+
+    bool startMovieRecording();
+
+    void finishMovieRecording();
 
     void processRotateTransformation(const double dx,
         const double dy,
@@ -79,6 +85,22 @@ private:
 
     int32_t m_browserWindowIndex;
 
+    /** Writes frames to the movie while recording */
+    MovieFrameWriter* m_movieFrameWriter;
+
+    /** Encoder reading frames when movie is not written by m_movieFrameWriter directly */
+    FILE* m_movieEncoderPipe;
+
+#ifndef CARET_OS_WINDOWS
+    /** SIGPIPE handler that is restored when the encoder pipe is closed */
+    void (*m_previousSigPipeHandler)(int);
+#endif // CARET_OS_WINDOWS
+
+    AString m_movieFileName;
+
+    /** First error while recording, reported when recording finishes */
+    AString m_movieErrorMessage;
+
     int frame_number;
     int rotate_frame_number;
     double dx;
@@ -1326,7 +1326,16 @@ SceneDialog::showSceneButtonClicked()
     }
     Scene* scene = getSelectedScene();
     if (scene != NULL) {
-        if (scene->hasFilesWithRemotePaths()) {
+        bool hasFilesWithRemotePathsFlag = false;
+        try {
+            hasFilesWithRemotePathsFlag = scene->hasFilesWithRemotePaths();
+        }
+        catch (const DataFileException& dfe) {
+            WuQMessageBox::errorOk(this,
+                                   dfe.whatString());
+            return;
+        }
+        if (hasFilesWithRemotePathsFlag) {
             const QString msg("This scene contains files that are on the network.  "
                               "If accessing the files requires a username and "
                               "password, enter it here.  Otherwise, remove any "
@@ -1498,7 +1507,20 @@ SceneDialog::displayScenePrivate(SceneFile* sceneFile,
     
     const AString sceneFileName = sceneFile->getFileName();
     
-    const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    const SceneClass* guiManagerClass = NULL;
+    try {
+        guiManagerClass = scene->getClassWithName("guiManager");
+    }
+    catch (const DataFileException& dfe) {
+        WuQMessageBox::errorOk(this,
+                               dfe.whatString());
+        return false;
+    }
+    if (guiManagerClass == NULL) {
+        WuQMessageBox::errorOk(this,
+                               "Scene does not contain a guiManager class");
+        return false;
+    }
     if (guiManagerClass->getName() != "guiManager") {
         WuQMessageBox::errorOk(this,"Top level scene class should be guiManager but it is: "
                                + guiManagerClass->getName());
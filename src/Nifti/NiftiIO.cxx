@@ -22,9 +22,118 @@
 
 #include "DataFileException.h"
 
+#include <cmath>
+#include <cstring>
+
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    //byteswap by value with shifts, so that swapping can be done in the same loop as conversion without a branch per byte
+    inline uint8_t swapValue(const uint8_t& value) { return value; }
+    inline int8_t swapValue(const int8_t& value) { return value; }
+    inline uint16_t swapValue(const uint16_t& value) { return (uint16_t)((value >> 8) | (value << 8)); }
+    inline int16_t swapValue(const int16_t& value) { return (int16_t)swapValue((uint16_t)value); }
+    inline uint32_t swapValue(const uint32_t& value)
+    {
+        return (value >> 24) | ((value >> 8) & 0xff00u) | ((value << 8) & 0xff0000u) | (value << 24);
+    }
+    inline int32_t swapValue(const int32_t& value) { return (int32_t)swapValue((uint32_t)value); }
+    inline uint64_t swapValue(const uint64_t& value)
+    {
+        return ((uint64_t)swapValue((uint32_t)value) << 32) | swapValue((uint32_t)(value >> 32));
+    }
+    inline float swapValue(const float& value)
+    {
+        uint32_t temp;
+        memcpy(&temp, &value, sizeof(float));
+        temp = swapValue(temp);
+        float ret;
+        memcpy(&ret, &temp, sizeof(float));
+        return ret;
+    }
+    inline double swapValue(const double& value)
+    {
+        uint64_t temp;
+        memcpy(&temp, &value, sizeof(double));
+        temp = swapValue(temp);
+        double ret;
+        memcpy(&ret, &temp, sizeof(double));
+        return ret;
+    }
+    
+    //each case is a separate simple loop, so the compiler can vectorize them
+    //scaling uses double rather than long double, which is plenty when the data on one side is float
+    template<typename FROM>
+    void convertToFloat(float* out, const FROM* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+    {
+        if (swapped)
+        {
+            if (doScale)
+            {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (float)(offset + mult * (double)swapValue(in[i]));
+                }
+            } else {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (float)swapValue(in[i]);
+                }
+            }
+        } else {
+            if (doScale)
+            {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (float)(offset + mult * (double)in[i]);
+                }
+            } else {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (float)in[i];
+                }
+            }
+        }
+    }
+    
+    template<typename TO>
+    void convertFromFloat(TO* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+    {
+        const bool doRound = numeric_limits<TO>::is_integer;//do round to nearest when integer output type
+        if (doScale)
+        {
+            for (int64_t i = 0; i < count; ++i)
+            {
+                double value = ((double)in[i] - offset) / mult;
+                if (doRound) value = floor(0.5 + value);
+                out[i] = (TO)value;
+            }
+        } else {
+            if (doRound)
+            {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (TO)floor(0.5 + in[i]);
+                }
+            } else {
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    out[i] = (TO)in[i];
+                }
+            }
+        }
+        if (swapped && sizeof(TO) > 1)
+        {//the output is in cache already, so a second pass is cheap here
+            for (int64_t i = 0; i < count; ++i)
+            {
+                out[i] = swapValue(out[i]);
+            }
+        }
+    }
+}
+
 void NiftiIO::openRead(const QString& filename)
 {
     m_file.open(filename);
@@ -124,3 +233,93 @@ int NiftiIO::numBytesPerElem()
             throw DataFileException("internal error, report what you did to the developers");
     }
 }
+
+bool NiftiIO::convertReadFast(float* out, const uint8_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const int8_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const uint16_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const int16_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const uint32_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const int32_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertReadFast(float* out, const double* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertToFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(uint8_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(int8_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(uint16_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(int16_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(uint32_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(int32_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
+
+bool NiftiIO::convertWriteFast(float* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset)
+{
+    convertFromFloat(out, in, count, swapped, doScale, mult, offset);
+    return true;
+}
@@ -49,6 +49,26 @@ namespace caret
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
+        //kernels for the common conversions to and from float, reading byteswaps in the same pass as converting, return false if there is no kernel for the types
+        template<typename TO, typename FROM>
+        static bool convertReadFast(TO*, const FROM*, const int64_t&, const bool&, const bool&, const double&, const double&) { return false; }
+        static bool convertReadFast(float* out, const uint8_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const int8_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const uint16_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const int16_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const uint32_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const int32_t* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertReadFast(float* out, const double* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        template<typename TO, typename FROM>
+        static bool convertWriteFast(TO*, const FROM*, const int64_t&, const bool&, const bool&, const double&, const double&) { return false; }
+        static bool convertWriteFast(uint8_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(int8_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(uint16_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(int16_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(uint32_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(int32_t* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
+        static bool convertWriteFast(float* out, const float* in, const int64_t& count, const bool& swapped, const bool& doScale, const double& mult, const double& offset);
     public:
         void openRead(const QString& filename);
         void writeNew(const QString& filename, const NiftiHeader& header, const int& version = 1, const bool& withRead = false, const bool& swapEndian = false);
@@ -211,12 +231,13 @@ namespace caret
     template<typename TO, typename FROM>
     void NiftiIO::convertRead(TO* out, FROM* in, const int64_t& count)
     {
+        double mult, offset;
+        bool doScale = m_header.getDataScaling(mult, offset);
+        if (convertReadFast(out, in, count, m_header.isSwapped(), doScale, mult, offset)) return;
         if (m_header.isSwapped())
         {
             ByteSwapping::swapArray(in, count);
         }
-        double mult, offset;
-        bool doScale = m_header.getDataScaling(mult, offset);
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
         {
             if (doScale)
@@ -252,6 +273,7 @@ namespace caret
     {
         double mult, offset;
         bool doScale = m_header.getDataScaling(mult, offset);
+        if (convertWriteFast(out, in, count, m_header.isSwapped(), doScale, mult, offset)) return;
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
         {
             if (doScale)
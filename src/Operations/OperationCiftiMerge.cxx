@@ -24,6 +24,7 @@
 #include "CaretAssert.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiRowBlockReader.h"
 
 #include <algorithm>
 
@@ -140,7 +141,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +151,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -255,54 +255,73 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
             CaretAssert(false);
     }
     ciftiOut->setCiftiXML(outXML);
-    int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    vector<const CiftiFile*> inputFiles(numInputs);
+    vector<vector<int64_t> > inputColumns(numInputs);//columns to take from each input, in output order, empty means the whole row
+    vector<int64_t> inputRowLengths(numInputs);
+    for (int i = 0; i < numInputs; ++i)
+    {//resolve the column selections once, rather than once per row
+        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+        inputFiles[i] = ciftiIn;
+        inputRowLengths[i] = ciftiIn->getDimensions()[0];
+        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        for (int j = 0; j < numColumnOpts; ++j)
+        {
+            int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+            OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
+            if (upToOpt->m_present)
+            {
+                int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                if (reverse)
+                {
+                    for (int c = finalColumn; c >= initialColumn; --c)
+                    {
+                        inputColumns[i].push_back(c);
+                    }
+                } else {
+                    for (int c = initialColumn; c <= finalColumn; ++c)
+                    {
+                        inputColumns[i].push_back(c);
+                    }
+                }
+            } else {
+                inputColumns[i].push_back(initialColumn);
+            }
+        }
+    }
+    CiftiRowBlockReader myReader(inputFiles);//reads ahead from all inputs concurrently, instead of one row from each file in turn
+    vector<float> outRow(numOutColumns);
+    while (myReader.readNextBlock())
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        int64_t blockRows = myReader.getBlockRowCount();
+        for (int64_t row = 0; row < blockRows; ++row)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            curCol = 0;
+            for (int i = 0; i < numInputs; ++i)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                const float* inRow = myReader.getRow(i, row);
+                const vector<int64_t>& thisColumns = inputColumns[i];
+                int64_t numSelected = (int64_t)thisColumns.size();
+                if (numSelected > 0)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    for (int64_t j = 0; j < numSelected; ++j)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
-                        {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        }
-                    } else {
-                        outRow[curCol] = scratchRow[initialColumn];
+                        outRow[curCol] = inRow[thisColumns[j]];
+                        ++curCol;
+                    }
+                } else {
+                    int64_t rowLength = inputRowLengths[i];
+                    for (int64_t j = 0; j < rowLength; ++j)
+                    {
+                        outRow[curCol] = inRow[j];
                         ++curCol;
                     }
                 }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
             }
+            CaretAssert(curCol == numOutColumns);
+            ciftiOut->setRow(outRow.data(), myReader.getBlockStart() + row);
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
     }
 }
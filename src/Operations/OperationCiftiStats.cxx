@@ -191,7 +191,7 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     vector<float> colScratch(colLength);
     if (useColumn == -1)
     {
-        myInput->convertToInMemory();//we will be getting all columns, so read it all in first
+        myInput->convertToInMemory(CiftiFile::MEMORY_NATIVE_INTEGER);//we will be getting all columns, so read it all in first, without expanding integer data
         if (matchColumnMode)
         {
             roiCifti->convertToInMemory();//ditto
@@ -393,7 +393,7 @@ void OperationCiftiWeightedStats::useParameters(OperationParameters* myParams, P
     vector<float> inColumn(colLength);
     if (useColumn == -1)
     {
-        myInput->convertToInMemory();//we will be getting all columns, so read it all in first
+        myInput->convertToInMemory(CiftiFile::MEMORY_NATIVE_INTEGER);//we will be getting all columns, so read it all in first, without expanding integer data
         if (matchColumnMode)
         {
             myRoi->convertToInMemory();//ditto
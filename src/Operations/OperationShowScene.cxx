@@ -19,21 +19,33 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <map>
 
 #ifdef HAVE_OSMESA
 #include <GL/osmesa.h>
 #endif // HAVE_OSMESA
 
-#include <QImage>
 #include <QColor>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QWaitCondition>
 
 
 #include "Brain.h"
 #include "BrainOpenGLFixedPipeline.h"
 #include "BrainOpenGLViewportContent.h"
 #include "CaretAssert.h"
+#include "CaretException.h"
 #include "CaretLogger.h"
 #include "DataFileException.h"
 #include "EventBrowserTabGet.h"
@@ -42,6 +54,7 @@
 #include "DummyFontTextRenderer.h"
 #include "FtglFontTextRenderer.h"
 #include "ImageFile.h"
+#include "MovieFrameWriter.h"
 #include "OperationShowScene.h"
 #include "OperationException.h"
 #include "Scene.h"
@@ -106,6 +119,14 @@ OperationShowScene::getParameters()
     
     ret->createOptionalParameter(7, "-no-scene-colors", "Do not use background and foreground colors in scene");
     
+    OptionalParameter* batchOpt = ret->createOptionalParameter(8, "-batch", "also render the scenes listed in a file, keeping data files loaded between scenes");
+    batchOpt->addStringParameter(1, "batch-file", "text file with one scene to render per line");
+    
+    OptionalParameter* movieOpt = ret->createOptionalParameter(9, "-movie", "write the images as the frames of a movie instead of image files");
+    movieOpt->addStringParameter(1, "movie-file", "output movie file, ending in .y4m or .avi");
+    OptionalParameter* frameRateOpt = movieOpt->createOptionalParameter(2, "-frame-rate", "set the frame rate of the movie (default 30)");
+    frameRateOpt->addDoubleParameter(1, "rate", "frames per second");
+    
     AString helpText("Render content of browser windows displayed in a scene "
                      "into image file(s).  The image file name should be "
                      "similar to \"capture.png\".  If there is only one image "
@@ -143,6 +164,26 @@ OperationShowScene::getParameters()
                  "      of the graphics region, the width and height specified\n"
                  "      on the command line is used for the size of the \n"
                  "      output image.\n"
+                 "\n"
+                 "The -batch option renders many scenes in one run, after the scene\n"
+                 "given by the required arguments.  Each line of the batch file is a\n"
+                 "scene file, scene name or number, and image file name, optionally\n"
+                 "followed by image width and height (otherwise the width and height\n"
+                 "on the command line are used), separated by tabs.  Empty lines and\n"
+                 "lines starting with \"#\" are ignored.  Data files that have the\n"
+                 "same path in consecutive scenes are not read again, and images are\n"
+                 "written while the next scene is rendering.  If a scene fails, the\n"
+                 "remaining scenes are still rendered and the command reports the\n"
+                 "failures at the end.\n"
+                 "\n"
+                 "The -movie option writes each rendered image as a frame of an\n"
+                 "uncompressed movie, in the order rendered, and image files are not\n"
+                 "written (image file names are ignored).  Use -batch with a scene for\n"
+                 "each frame (such as scenes with increasing rotation) to make a movie.\n"
+                 "Frames are written while the next scene is rendering.  A \".y4m\"\n"
+                 "(YUV4MPEG2) file may also be a named pipe read by an encoder such as\n"
+                 "ffmpeg.  AVI files are limited to 2GB.  All frames are scaled to the\n"
+                 "size of the first frame.\n"
                  );
     
     
@@ -163,46 +204,562 @@ OperationShowScene::useParameters(OperationParameters* /*myParams*/,
                              "not being built with the Mesa OffScreen Library");
 }
 #else // HAVE_OSMESA
+
+namespace {
+    /*
+     * Destroys an OSMesa context when it goes out of scope.
+     */
+    class ShowSceneMesaContextDeleter {
+    public:
+        ShowSceneMesaContextDeleter(OSMesaContext mesaContext) : m_mesaContext(mesaContext) { }
+        ~ShowSceneMesaContextDeleter() { OSMesaDestroyContext(m_mesaContext); }
+    private:
+        ShowSceneMesaContextDeleter(const ShowSceneMesaContextDeleter&);
+        ShowSceneMesaContextDeleter& operator=(const ShowSceneMesaContextDeleter&);
+        OSMesaContext m_mesaContext;
+    };
+}
+
+namespace caret {
+    
+    /**
+     * Writes rendered images, on worker threads when there is more than
+     * one job, so that encoding and writing an image overlaps with
+     * restoring and rendering the next scene.
+     */
+    class ShowSceneImageWriter {
+        
+    public:
+        ShowSceneImageWriter(const int32_t numberOfThreads,
+                             MovieFrameWriter* movieFrameWriter);
+        
+        ~ShowSceneImageWriter();
+        
+        void addImage(const AString& outputImageName,
+                      const unsigned char* imageContent,
+                      const int32_t imageWidth,
+                      const int32_t imageHeight);
+        
+        void finish();
+        
+    private:
+        struct ImageJob {
+            AString m_outputImageName;
+            std::vector<unsigned char> m_imageContent;
+            int32_t m_imageWidth;
+            int32_t m_imageHeight;
+        };
+        
+        class WriterThread : public QThread {
+        public:
+            WriterThread(ShowSceneImageWriter* imageWriter) : m_imageWriter(imageWriter) { }
+            void run() { m_imageWriter->writeQueuedImages(); }
+        private:
+            ShowSceneImageWriter* m_imageWriter;
+        };
+        
+        ShowSceneImageWriter(const ShowSceneImageWriter&);
+        
+        ShowSceneImageWriter& operator=(const ShowSceneImageWriter&);
+        
+        void writeQueuedImages();
+        
+        static void writeImage(const ImageJob& imageJob);
+        
+        void waitForThreads();
+        
+        std::vector<WriterThread*> m_threads;
+        
+        MovieFrameWriter* m_movieFrameWriter;
+        
+        std::deque<ImageJob*> m_queue;
+        
+        QMutex m_mutex;
+        
+        QWaitCondition m_queueChanged;
+        
+        bool m_finished;
+        
+        std::vector<AString> m_errorMessages;
+    };
+}
+
+/**
+ * Constructor.
+ *
+ * @param numberOfThreads
+ *     Number of writer threads, zero writes each image before addImage() returns.
+ * @param movieFrameWriter
+ *     If not NULL, images are added as frames to this movie instead of
+ *     being written to image files (the movie writer has its own thread).
+ */
+ShowSceneImageWriter::ShowSceneImageWriter(const int32_t numberOfThreads,
+                                           MovieFrameWriter* movieFrameWriter)
+{
+    m_movieFrameWriter = movieFrameWriter;
+    m_finished = false;
+    for (int32_t i = 0; i < numberOfThreads; i++) {
+        m_threads.push_back(new WriterThread(this));
+        m_threads.back()->start();
+    }
+}
+
+/**
+ * Destructor, if finish() was not called (an exception is being thrown),
+ * any images already queued are still written.
+ */
+ShowSceneImageWriter::~ShowSceneImageWriter()
+{
+    waitForThreads();
+    for (std::deque<ImageJob*>::iterator iter = m_queue.begin();
+         iter != m_queue.end();
+         iter++) {
+        delete *iter;
+    }
+}
+
+/**
+ * Write an image, or queue it for writing.  The image content is copied.
+ *
+ * @param outputImageName
+ *     Name of image file.
+ * @param imageContent
+ *     RGBA content of image, origin at bottom.
+ * @param imageWidth
+ *     width of image.
+ * @param imageHeight
+ *     height of image.
+ */
+void
+ShowSceneImageWriter::addImage(const AString& outputImageName,
+                               const unsigned char* imageContent,
+                               const int32_t imageWidth,
+                               const int32_t imageHeight)
+{
+    ImageJob* imageJob = new ImageJob();
+    imageJob->m_outputImageName = outputImageName;
+    imageJob->m_imageContent.assign(imageContent,
+                                    imageContent + (imageWidth * imageHeight * 4));
+    imageJob->m_imageWidth  = imageWidth;
+    imageJob->m_imageHeight = imageHeight;
+    
+    if (m_movieFrameWriter != NULL) {
+        CaretPointer<ImageJob> deleter(imageJob);
+        try {
+            ImageFile imageFile(&imageJob->m_imageContent[0],
+                                imageJob->m_imageWidth,
+                                imageJob->m_imageHeight,
+                                ImageFile::IMAGE_DATA_ORIGIN_AT_BOTTOM);
+            m_movieFrameWriter->addFrame(*imageFile.getAsQImage());
+        }
+        catch (const DataFileException& dfe) {
+            throw OperationException(dfe);
+        }
+        return;
+    }
+    
+    if (m_threads.empty()) {
+        CaretPointer<ImageJob> deleter(imageJob);
+        writeImage(*imageJob);
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    /*
+     * Limit the number of images waiting so that memory use stays bounded
+     * when rendering is faster than writing.
+     */
+    const int32_t maximumQueued = static_cast<int32_t>(m_threads.size()) * 2;
+    while (static_cast<int32_t>(m_queue.size()) >= maximumQueued) {
+        m_queueChanged.wait(&m_mutex);
+    }
+    m_queue.push_back(imageJob);
+    m_queueChanged.wakeAll();
+}
+
+/**
+ * Wait for all images to be written.
+ *
+ * @throws OperationException
+ *     If writing any image failed.
+ */
+void
+ShowSceneImageWriter::finish()
+{
+    waitForThreads();
+    
+    if ( ! m_errorMessages.empty()) {
+        AString msg;
+        for (std::vector<AString>::iterator iter = m_errorMessages.begin();
+             iter != m_errorMessages.end();
+             iter++) {
+            if ( ! msg.isEmpty()) {
+                msg += "\n";
+            }
+            msg += *iter;
+        }
+        m_errorMessages.clear();
+        throw OperationException(msg);
+    }
+}
+
+/**
+ * Tell the threads there are no more images and wait for them to write
+ * the images remaining in the queue.
+ */
+void
+ShowSceneImageWriter::waitForThreads()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+        m_queueChanged.wakeAll();
+    }
+    for (std::vector<WriterThread*>::iterator iter = m_threads.begin();
+         iter != m_threads.end();
+         iter++) {
+        (*iter)->wait();
+        delete *iter;
+    }
+    m_threads.clear();
+}
+
+/**
+ * Run by the writer threads, writes images from the queue until finish is requested
+ * and the queue is empty.
+ */
+void
+ShowSceneImageWriter::writeQueuedImages()
+{
+    while (true) {
+        ImageJob* imageJob = NULL;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.empty()
+                   && ( ! m_finished)) {
+                m_queueChanged.wait(&m_mutex);
+            }
+            if (m_queue.empty()) {
+                return;
+            }
+            imageJob = m_queue.front();
+            m_queue.pop_front();
+            m_queueChanged.wakeAll();
+        }
+        
+        /*
+         * An exception must not escape the thread, pass the
+         * error to the main thread which reports it in finish()
+         */
+        CaretPointer<ImageJob> deleter(imageJob);
+        AString errorMessage;
+        try {
+            writeImage(*imageJob);
+        }
+        catch (const CaretException& e) {
+            errorMessage = e.whatString();
+        }
+        catch (const std::exception& e) {
+            errorMessage = ("Error writing "
+                            + imageJob->m_outputImageName
+                            + ": "
+                            + AString(e.what()));
+        }
+        catch (...) {
+            errorMessage = ("Unknown error writing "
+                            + imageJob->m_outputImageName);
+        }
+        if ( ! errorMessage.isEmpty()) {
+            QMutexLocker locker(&m_mutex);
+            m_errorMessages.push_back(errorMessage);
+        }
+    }
+}
+
+/**
+ * Write the image data to a Image File.
+ *
+ * @param imageJob
+ *     Name, content, and size of the image.
+ */
+void
+ShowSceneImageWriter::writeImage(const ImageJob& imageJob)
+{
+    try {
+        ImageFile imageFile(&imageJob.m_imageContent[0],
+                            imageJob.m_imageWidth,
+                            imageJob.m_imageHeight,
+                            ImageFile::IMAGE_DATA_ORIGIN_AT_BOTTOM);
+        imageFile.writeFile(imageJob.m_outputImageName);
+    }
+    catch (const DataFileException& dfe) {
+        throw OperationException(dfe);
+    }
+}
+
 void
 OperationShowScene::useParameters(OperationParameters* myParams,
                                   ProgressObject* myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    AString sceneFileName = FileInformation(myParams->getString(1)).getAbsoluteFilePath();
-    AString sceneNameOrNumber = myParams->getString(2);
-    AString imageFileName = FileInformation(myParams->getString(3)).getAbsoluteFilePath();
-    const int32_t userImageWidth  = myParams->getInteger(4);
-    const int32_t userImageHeight = myParams->getInteger(5);
+    std::vector<ShowSceneJob> sceneJobs;
+    ShowSceneJob firstJob;
+    firstJob.m_sceneFileName = FileInformation(myParams->getString(1)).getAbsoluteFilePath();
+    firstJob.m_sceneNameOrNumber = myParams->getString(2);
+    firstJob.m_imageFileName = FileInformation(myParams->getString(3)).getAbsoluteFilePath();
+    firstJob.m_imageWidth  = myParams->getInteger(4);
+    firstJob.m_imageHeight = myParams->getInteger(5);
+    sceneJobs.push_back(firstJob);
     
     OptionalParameter* useWindowSizeParam = myParams->getOptionalParameter(6);
     const bool useWindowSizeForImageSizeFlag = useWindowSizeParam->m_present;
     
     const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(7)->m_present;
     
+    OptionalParameter* batchParam = myParams->getOptionalParameter(8);
+    if (batchParam->m_present) {
+        readBatchFile(batchParam->getString(1),
+                      firstJob.m_imageWidth,
+                      firstJob.m_imageHeight,
+                      sceneJobs);
+    }
+    
     if ( ! useWindowSizeForImageSizeFlag) {
-        if ((userImageWidth <= 0)
-            || (userImageHeight <= 0)) {
-            throw OperationException("Invalid image size width="
-                                     + QString::number(userImageWidth)
-                                     + " height="
-                                     + QString::number(userImageHeight));
+        for (std::vector<ShowSceneJob>::iterator iter = sceneJobs.begin();
+             iter != sceneJobs.end();
+             iter++) {
+            if ((iter->m_imageWidth <= 0)
+                || (iter->m_imageHeight <= 0)) {
+                throw OperationException("Invalid image size width="
+                                         + QString::number(iter->m_imageWidth)
+                                         + " height="
+                                         + QString::number(iter->m_imageHeight)
+                                         + " for image "
+                                         + iter->m_imageFileName);
+            }
         }
     }
     
     /*
-     * Read the scene file and load the scene
+     * Enable voxel coloring since it is defaulted off for commands
+     */
+    VolumeFile::setVoxelColoringEnabled(true);
+    
+    /*
+     * All jobs restore into the same session, so data files that are not
+     * modified and have the same path in the next scene are kept loaded
+     * instead of being read again (see Brain::loadSpecFileFromScene()).
+     * Session state is global, so scenes are rendered one at a time, and
+     * images are written by other threads while the next scene renders.
      */
-    SceneFile sceneFile;
-    sceneFile.readFile(sceneFileName);
-    Scene* scene = sceneFile.getSceneWithName(sceneNameOrNumber);
+    const int32_t numberOfJobs = static_cast<int32_t>(sceneJobs.size());
+    CaretPointer<MovieFrameWriter> movieFrameWriter;
+    OptionalParameter* movieParam = myParams->getOptionalParameter(9);
+    if (movieParam->m_present) {
+        /*
+         * Frame rate as a ratio of integers, to the nearest 1/1000 when not integral
+         */
+        double frameRate = 30.0;
+        OptionalParameter* frameRateParam = movieParam->getOptionalParameter(2);
+        if (frameRateParam->m_present) {
+            frameRate = frameRateParam->getDouble(1);
+            if ((frameRate <= 0.0)
+                || (frameRate > 1000.0)) {
+                throw OperationException("Movie frame rate must be greater than zero and at most 1000");
+            }
+        }
+        int32_t frameRateNumerator   = static_cast<int32_t>(frameRate + 0.5);
+        int32_t frameRateDenominator = 1;
+        if (std::fabs(frameRate - frameRateNumerator) > 1.0e-6) {
+            frameRateNumerator   = static_cast<int32_t>(frameRate * 1000.0 + 0.5);
+            frameRateDenominator = 1000;
+        }
+        try {
+            movieFrameWriter.grabNew(new MovieFrameWriter(FileInformation(movieParam->getString(1)).getAbsoluteFilePath(),
+                                                          frameRateNumerator,
+                                                          frameRateDenominator));
+        }
+        catch (const DataFileException& dfe) {
+            throw OperationException(dfe);
+        }
+    }
+    int32_t numberOfWriterThreads = 0;
+    if ((numberOfJobs > 1)
+        && (movieFrameWriter.getPointer() == NULL)) {
+        numberOfWriterThreads = std::max(1, std::min(4, QThread::idealThreadCount() - 1));
+    }
+    ShowSceneImageWriter imageWriter(numberOfWriterThreads,
+                                     movieFrameWriter);
+    
+    std::map<AString, CaretPointer<SceneFile> > sceneFiles;
+    AString failureMessages;
+    int32_t numberOfFailedJobs = 0;
+    for (int32_t iJob = 0; iJob < numberOfJobs; iJob++) {
+        const ShowSceneJob& job = sceneJobs[iJob];
+        try {
+            /*
+             * Read the scene file, or use it from a previous job
+             */
+            std::map<AString, CaretPointer<SceneFile> >::iterator sceneFileIter = sceneFiles.find(job.m_sceneFileName);
+            if (sceneFileIter == sceneFiles.end()) {
+                CaretPointer<SceneFile> sceneFile(new SceneFile());
+                sceneFile->readFile(job.m_sceneFileName);
+                sceneFileIter = sceneFiles.insert(std::make_pair(job.m_sceneFileName,
+                                                                 sceneFile)).first;
+            }
+            
+            renderScene(sceneFileIter->second,
+                        job,
+                        useWindowSizeForImageSizeFlag,
+                        useWindowSizeParam->m_optionSwitch,
+                        doNotUseSceneColorsFlag,
+                        imageWriter);
+        }
+        catch (const CaretException& e) {
+            if (numberOfJobs == 1) {
+                throw;
+            }
+            const AString msg = ("Scene \""
+                                 + job.m_sceneNameOrNumber
+                                 + "\" in "
+                                 + job.m_sceneFileName
+                                 + " failed: "
+                                 + e.whatString());
+            CaretLogSevere(msg);
+            failureMessages += (msg + "\n");
+            numberOfFailedJobs++;
+        }
+    }
+    
+    imageWriter.finish();
+    
+    if (movieFrameWriter.getPointer() != NULL) {
+        try {
+            movieFrameWriter->finish();
+        }
+        catch (const DataFileException& dfe) {
+            throw OperationException(dfe);
+        }
+    }
+    
+    if (numberOfFailedJobs > 0) {
+        throw OperationException(AString::number(numberOfFailedJobs)
+                                 + " of "
+                                 + AString::number(numberOfJobs)
+                                 + " scenes failed to render:\n"
+                                 + failureMessages);
+    }
+}
+
+/**
+ * Read the jobs from a batch file.
+ *
+ * @param batchFileName
+ *     Name of the batch file.
+ * @param defaultImageWidth
+ *     Width for jobs that do not specify a size.
+ * @param defaultImageHeight
+ *     Height for jobs that do not specify a size.
+ * @param sceneJobsOut
+ *     Jobs from the file are added to this.
+ */
+void
+OperationShowScene::readBatchFile(const AString& batchFileName,
+                                  const int32_t defaultImageWidth,
+                                  const int32_t defaultImageHeight,
+                                  std::vector<ShowSceneJob>& sceneJobsOut)
+{
+    QFile batchFile(batchFileName);
+    if ( ! batchFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        throw OperationException("Unable to open batch file "
+                                 + batchFileName
+                                 + ": "
+                                 + batchFile.errorString());
+    }
+    
+    QTextStream stream(&batchFile);
+    int32_t lineNumber = 0;
+    while ( ! stream.atEnd()) {
+        const QString line = stream.readLine();
+        lineNumber++;
+        if (line.trimmed().isEmpty()
+            || line.trimmed().startsWith("#")) {
+            continue;
+        }
+        
+        const QStringList fields = line.split("\t");
+        if ((fields.size() != 3)
+            && (fields.size() != 5)) {
+            throw OperationException("Batch file "
+                                     + batchFileName
+                                     + " line "
+                                     + AString::number(lineNumber)
+                                     + " must have 3 or 5 tab separated fields, but it has "
+                                     + AString::number(fields.size()));
+        }
+        
+        ShowSceneJob job;
+        job.m_sceneFileName = FileInformation(fields[0].trimmed()).getAbsoluteFilePath();
+        job.m_sceneNameOrNumber = fields[1].trimmed();
+        job.m_imageFileName = FileInformation(fields[2].trimmed()).getAbsoluteFilePath();
+        job.m_imageWidth  = defaultImageWidth;
+        job.m_imageHeight = defaultImageHeight;
+        if (fields.size() == 5) {
+            bool widthValid  = false;
+            bool heightValid = false;
+            job.m_imageWidth  = fields[3].trimmed().toInt(&widthValid);
+            job.m_imageHeight = fields[4].trimmed().toInt(&heightValid);
+            if (( ! widthValid)
+                || ( ! heightValid)) {
+                throw OperationException("Batch file "
+                                         + batchFileName
+                                         + " line "
+                                         + AString::number(lineNumber)
+                                         + " has an invalid image width or height");
+            }
+        }
+        sceneJobsOut.push_back(job);
+    }
+}
+
+/**
+ * Restore a scene and render each of its windows into image files.
+ *
+ * @param sceneFile
+ *     Scene file containing the scene.
+ * @param job
+ *     Scene name and output image for this render.
+ * @param useWindowSizeForImageSizeFlag
+ *     If true, use the window size from the scene when it is available.
+ * @param windowSizeSwitch
+ *     Command line switch for the window size option, for messages.
+ * @param doNotUseSceneColorsFlag
+ *     If true, do not use the background and foreground colors in the scene.
+ * @param imageWriter
+ *     Writes the rendered images.
+ */
+void
+OperationShowScene::renderScene(SceneFile* sceneFile,
+                                const ShowSceneJob& job,
+                                const bool useWindowSizeForImageSizeFlag,
+                                const AString& windowSizeSwitch,
+                                const bool doNotUseSceneColorsFlag,
+                                ShowSceneImageWriter& imageWriter)
+{
+    const AString& sceneNameOrNumber = job.m_sceneNameOrNumber;
+    const AString& imageFileName = job.m_imageFileName;
+    const int32_t userImageWidth  = job.m_imageWidth;
+    const int32_t userImageHeight = job.m_imageHeight;
+    
+    Scene* scene = sceneFile->getSceneWithName(sceneNameOrNumber);
     if (scene == NULL) {
         bool valid = false;
         const int32_t sceneIndexStartAtOne = sceneNameOrNumber.toInt(&valid);
         if (valid) {
             const int32_t sceneIndex = sceneIndexStartAtOne - 1;
             if ((sceneIndex >= 0)
-                && (sceneIndex < sceneFile.getNumberOfScenes())) {
-                scene = sceneFile.getSceneAtIndex(sceneIndex);
+                && (sceneIndex < sceneFile->getNumberOfScenes())) {
+                scene = sceneFile->getSceneAtIndex(sceneIndex);
             }
             else {
                 throw OperationException("Scene index is invalid");
@@ -213,11 +770,6 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         }
     }
 
-    /*
-     * Enable voxel coloring since it is defaulted off for commands
-     */
-    VolumeFile::setVoxelColoringEnabled(true);
-    
     SceneAttributes sceneAttributes(SceneTypeEnum::SCENE_TYPE_FULL);
     
     if (doNotUseSceneColorsFlag) {
@@ -227,7 +779,16 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     /*
      * Restore the scene
      */
-    const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    const SceneClass* guiManagerClass = NULL;
+    try {
+        guiManagerClass = scene->getClassWithName("guiManager");
+    }
+    catch (const DataFileException& dfe) {
+        throw OperationException(dfe);
+    }
+    if (guiManagerClass == NULL) {
+        throw OperationException("Scene does not contain a guiManager class");
+    }
     if (guiManagerClass->getName() != "guiManager") {
         throw OperationException("Top level scene class should be guiManager but it is: "
                                  + guiManagerClass->getName());
@@ -282,7 +843,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     if ((imageWidth <= 0)
                         || (imageHeight <= 0)) {
                         const QString msg("Option "
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + windowSizeSwitch
                                           + " is used but window size not found in scene and width="
                                           + QString::number(imageWidth)
                                           + " height="
@@ -294,7 +855,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     
                     if ( ! missingWindowMessageHasBeenDisplayed) {
                         const QString msg("Option \""
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + windowSizeSwitch
                                           + "\" is used but window size not found in scene.\n"
                                           "   Scene was created prior to implementation of this option.\n"
                                           "   Image size will be width="
@@ -345,25 +906,27 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                                accumBits,
                                                                NULL);
             if (mesaContext == 0) {
-                throw ("Creating Mesa Context failed.");
+                throw OperationException("Creating Mesa Context failed.");
             }
             
+            /*
+             * Destroys the context when leaving this scope, including when an
+             * exception is thrown, declared before any OpenGL rendering so
+             * that the rendering is destroyed first.
+             */
+            ShowSceneMesaContextDeleter mesaContextDeleter(mesaContext);
+            
             //
             // Allocate image buffer
             //
             const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
-            unsigned char* imageBuffer = new unsigned char[imageBufferSize];
-            if (imageBuffer == 0) {
-                throw OperationException("Allocating image buffer size="
-                                         + QString::number(imageBufferSize)
-                                         + " failed.");
-            }
+            std::vector<unsigned char> imageBuffer(imageBufferSize);
             
             //
             // Assign buffer to Mesa Context and make current
             //
             if (OSMesaMakeCurrent(mesaContext,
-                                  imageBuffer,
+                                  &imageBuffer[0],
                                   GL_UNSIGNED_BYTE,
                                   imageWidth,
                                   imageHeight) == 0) {
@@ -439,11 +1002,11 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                           ? i
                                                           : -1);
                         
-                        writeImage(imageFileName,
-                                   outputImageIndex,
-                                   imageBuffer,
-                                   imageWidth,
-                                   imageHeight);
+                        imageWriter.addImage(getOutputImageFileName(imageFileName,
+                                                                    outputImageIndex),
+                                              &imageBuffer[0],
+                                              imageWidth,
+                                              imageHeight);
                         
                         for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
                              vpIter != viewports.end();
@@ -495,20 +1058,14 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                       ? i
                                                       : -1);
                     
-                    writeImage(imageFileName,
-                               outputImageIndex,
-                               imageBuffer,
-                               imageWidth,
-                               imageHeight);
+                    imageWriter.addImage(getOutputImageFileName(imageFileName,
+                                                                outputImageIndex),
+                                          &imageBuffer[0],
+                                          imageWidth,
+                                          imageHeight);
                     
                 }
             }
-            
-            /*
-             * Free image memory and Mesa context
-             */
-            delete[] imageBuffer;
-            OSMesaDestroyContext(mesaContext);
         }
     }
 }
@@ -696,29 +1253,19 @@ OperationShowScene::createBrainOpenGL(const int32_t windowIndex)
 #endif // HAVE_OSMESA
 
 /**
- * Write the image data to a Image File.
+ * Get the name for an output image.
  *
  * @param imageFileName
  *     Name of image file.
  * @param imageIndex
- *     Index of image.
- * @param imageContent
- *     content of image.
- * @param imageWidth
- *     width of image.
- * @param imageHeight
- *     height of image.
+ *     Index of image, if negative, the name is not changed.
+ * @return
+ *     Name of image with the index inserted before the extension.
  */
-void
-OperationShowScene::writeImage(const AString& imageFileName,
-                               const int32_t imageIndex,
-                               const unsigned char* imageContent,
-                               const int32_t imageWidth,
-                               const int32_t imageHeight)
+AString
+OperationShowScene::getOutputImageFileName(const AString& imageFileName,
+                                           const int32_t imageIndex)
 {
-    /*
-     * Create name of image
-     */
     QString outputName(imageFileName);
     if (imageIndex >= 0) {
         const AString imageNumber = QString("_%1").arg((int)(imageIndex + 1),
@@ -736,17 +1283,7 @@ OperationShowScene::writeImage(const AString& imageFileName,
         }
     }
     
-    try {
-        //ImageFile imageFile(image);
-        ImageFile imageFile(imageContent,
-                            imageWidth,
-                            imageHeight,
-                            ImageFile::IMAGE_DATA_ORIGIN_AT_BOTTOM);
-        imageFile.writeFile(outputName);
-    }
-    catch (const DataFileException& dfe) {
-        throw OperationException(dfe);
-    }
+    return outputName;
 }
 
 /**
@@ -27,6 +27,8 @@
 namespace caret {
 
     class BrainOpenGLFixedPipeline;
+    class SceneFile;
+    class ShowSceneImageWriter;
     
     class OperationShowScene : public AbstractOperation {
 
@@ -43,13 +45,31 @@ namespace caret {
         static bool isShowSceneCommandAvailable();
         
     private:
+        /** One scene to render and where to write its images */
+        struct ShowSceneJob {
+            AString m_sceneFileName;
+            AString m_sceneNameOrNumber;
+            AString m_imageFileName;
+            int32_t m_imageWidth;
+            int32_t m_imageHeight;
+        };
+        
         static BrainOpenGLFixedPipeline* createBrainOpenGL(const int32_t windowIndex);
         
-        static void writeImage(const AString& imageFileName,
-                                  const int32_t imageIndex,
-                                  const unsigned char* imageContent,
-                                  const int32_t imageWidth,
-                                  const int32_t imageHeight);
+        static void readBatchFile(const AString& batchFileName,
+                                  const int32_t defaultImageWidth,
+                                  const int32_t defaultImageHeight,
+                                  std::vector<ShowSceneJob>& sceneJobsOut);
+        
+        static void renderScene(SceneFile* sceneFile,
+                                const ShowSceneJob& job,
+                                const bool useWindowSizeForImageSizeFlag,
+                                const AString& windowSizeSwitch,
+                                const bool doNotUseSceneColorsFlag,
+                                ShowSceneImageWriter& imageWriter);
+        
+        static AString getOutputImageFileName(const AString& imageFileName,
+                                              const int32_t imageIndex);
         
         static void estimateGraphicsSize(const SceneClass* windowSceneClass,
                                          float& estimatedWidthOut,
@@ -23,10 +23,17 @@
 #include "Scene.h"
 #undef __SCENE_DECLARE__
 
+#include <memory>
+
 #include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
 #include "SceneAttributes.h"
 #include "SceneClass.h"
 #include "SceneInfo.h"
+#include "SceneSaxReader.h"
+#include "XmlSaxParser.h"
+#include "XmlSaxParserException.h"
 
 using namespace caret;
 
@@ -236,6 +243,8 @@ Scene::Scene(const SceneTypeEnum::Enum sceneType)
     m_sceneAttributes = new SceneAttributes(sceneType);
     m_hasFilesWithRemotePaths = false;
     m_sceneInfo = new SceneInfo();
+    m_deferredSceneOffset = 0;
+    m_deferredSceneLength = 0;
 }
 
 Scene::Scene(const Scene& rhs) : CaretObject()
@@ -243,6 +252,14 @@ Scene::Scene(const Scene& rhs) : CaretObject()
     m_sceneAttributes = new SceneAttributes(*(rhs.m_sceneAttributes));
     m_hasFilesWithRemotePaths = rhs.m_hasFilesWithRemotePaths;
     m_sceneInfo = new SceneInfo(*(rhs.m_sceneInfo));
+    /*
+     * An unread scene shares the file content instead of reading it
+     */
+    m_deferredSceneFileName = rhs.m_deferredSceneFileName;
+    m_deferredFileContent = rhs.m_deferredFileContent;
+    m_deferredSceneOffset = rhs.m_deferredSceneOffset;
+    m_deferredSceneLength = rhs.m_deferredSceneLength;
+    m_deferredSceneErrorMessage = rhs.m_deferredSceneErrorMessage;
     for (std::vector<SceneClass*>::const_iterator iter = rhs.m_sceneClasses.begin(); iter != rhs.m_sceneClasses.end(); ++iter)
     {
         m_sceneClasses.push_back(new SceneClass(**iter));
@@ -256,7 +273,7 @@ Scene::~Scene()
 {
     delete m_sceneAttributes;
 
-    const int32_t numberOfSceneClasses = this->getNumberOfClasses();
+    const int32_t numberOfSceneClasses = static_cast<int32_t>(m_sceneClasses.size());
     for (int32_t i = 0; i < numberOfSceneClasses; i++) {
         delete m_sceneClasses[i];
     }
@@ -287,6 +304,7 @@ void
 Scene::addClass(SceneClass* sceneClass)
 {
     if (sceneClass != NULL) {
+        readDeferredSceneXml();
         m_sceneClasses.push_back(sceneClass);
     }
 }
@@ -294,10 +312,13 @@ Scene::addClass(SceneClass* sceneClass)
 
 /**
  * @return Number of classes contained in the scene
+ * @throw DataFileException
+ *    If the scene's deferred XML is invalid.
  */
 int32_t
 Scene::getNumberOfClasses() const
 {
+    readDeferredSceneXml();
     return m_sceneClasses.size();
 }
 
@@ -306,10 +327,13 @@ Scene::getNumberOfClasses() const
  * @param indx
  *    Index of the scene class.
  * @return Scene class at the given index.
+ * @throw DataFileException
+ *    If the scene's deferred XML is invalid.
  */
 const SceneClass* 
 Scene::getClassAtIndex(const int32_t indx) const
 {
+    readDeferredSceneXml();
     CaretAssertVectorIndex(m_sceneClasses, indx);
     return m_sceneClasses[indx];
 }
@@ -319,6 +343,8 @@ Scene::getClassAtIndex(const int32_t indx) const
  * @param sceneClassName
  *    Name of the scene class.
  * @return Scene class with the given name or NULL if not found.
+ * @throw DataFileException
+ *    If the scene's deferred XML is invalid.
  */
 const SceneClass* 
 Scene::getClassWithName(const AString& sceneClassName) const
@@ -397,10 +423,13 @@ Scene::setDescription(const AString& sceneDescription)
 
 /**
  * @return true if there are files with remote paths in the scene.
+ * @throw DataFileException
+ *    If the scene's deferred XML is invalid.
  */
 bool
 Scene::hasFilesWithRemotePaths() const
 {
+    readDeferredSceneXml();
     return m_hasFilesWithRemotePaths;
 }
 
@@ -416,6 +445,97 @@ Scene::setHasFilesWithRemotePaths(const bool hasFilesWithRemotePaths)
     m_hasFilesWithRemotePaths = hasFilesWithRemotePaths;
 }
 
+/**
+ * Defer reading of the scene's classes until they are first accessed.
+ * When a scene file is read, only the name and description of each scene
+ * are read and the XML of the scene is kept so that it can be read later.
+ *
+ * @param sceneFileName
+ *    Name of the scene file (needed to resolve relative path names).
+ * @param fileContent
+ *    Content of the scene file (implicitly shared among scenes).
+ * @param sceneOffset
+ *    Offset of the scene's XML in the file content.
+ * @param sceneLength
+ *    Length of the scene's XML in the file content.
+ */
+void
+Scene::setDeferredSceneXml(const AString& sceneFileName,
+                           const QByteArray& fileContent,
+                           const int64_t sceneOffset,
+                           const int64_t sceneLength)
+{
+    CaretAssert(m_sceneClasses.empty());
+    CaretAssert((sceneOffset >= 0)
+                && (sceneLength > 0)
+                && ((sceneOffset + sceneLength) <= fileContent.size()));
+    
+    m_deferredSceneFileName = sceneFileName;
+    m_deferredFileContent   = fileContent;
+    m_deferredSceneOffset   = sceneOffset;
+    m_deferredSceneLength   = sceneLength;
+    m_deferredSceneErrorMessage.clear();
+}
+
+/**
+ * @return True if the scene's classes have not been read from
+ * the scene file yet.
+ */
+bool
+Scene::isSceneXmlDeferred() const
+{
+    return ( ! m_deferredFileContent.isEmpty());
+}
+
+/**
+ * If reading of the scene's classes was deferred, read them now.
+ *
+ * @throw DataFileException
+ *    If the scene's XML is invalid.  The error is thrown again
+ *    on each later access of the scene's classes.
+ */
+void
+Scene::readDeferredSceneXml() const
+{
+    if ( ! m_deferredSceneErrorMessage.isEmpty()) {
+        throw DataFileException(m_deferredSceneFileName,
+                                m_deferredSceneErrorMessage);
+    }
+    if (m_deferredFileContent.isEmpty()) {
+        return;
+    }
+    
+    /*
+     * Release the file content before parsing since it is
+     * not needed after the scene has been read.
+     */
+    const QString sceneXml = QString::fromUtf8(m_deferredFileContent.constData() + m_deferredSceneOffset,
+                                               static_cast<int>(m_deferredSceneLength));
+    m_deferredFileContent = QByteArray();
+    
+    Scene scene(m_sceneAttributes->getSceneType());
+    SceneSaxReader saxReader(m_deferredSceneFileName,
+                             &scene);
+    std::auto_ptr<XmlSaxParser> parser(XmlSaxParser::createXmlParser());
+    try {
+        parser->parseString(sceneXml,
+                            &saxReader);
+    }
+    catch (const XmlSaxParserException& e) {
+        m_deferredSceneErrorMessage = ("Error reading scene \""
+                                       + getName()
+                                       + "\": "
+                                       + e.whatString());
+        throw DataFileException(m_deferredSceneFileName,
+                                m_deferredSceneErrorMessage);
+    }
+    
+    m_sceneClasses.swap(scene.m_sceneClasses);
+    if (scene.m_hasFilesWithRemotePaths) {
+        m_hasFilesWithRemotePaths = true;
+    }
+}
+
 /**
  * Set a static value for the scene that is being created.
  */
@@ -22,6 +22,10 @@
 /*LICENSE_END*/
 
 
+#include <stdint.h>
+
+#include <QByteArray>
+
 #include "CaretObject.h"
 #include "SceneTypeEnum.h"
 
@@ -78,6 +82,12 @@ namespace caret {
         
         void setHasFilesWithRemotePaths(const bool hasFilesWithRemotePaths);
 
+        void setDeferredSceneXml(const AString& sceneFileName,
+                                 const QByteArray& fileContent,
+                                 const int64_t sceneOffset,
+                                 const int64_t sceneLength);
+        
+        bool isSceneXmlDeferred() const;
         
         // ADD_NEW_METHODS_HERE
 
@@ -86,18 +96,34 @@ namespace caret {
         static void setSceneBeingCreatedHasFilesWithRemotePaths();
         
     private:
+        void readDeferredSceneXml() const;
 
         /** Attributes of the scene*/
         SceneAttributes* m_sceneAttributes;
 
-        /** Classes contained in the scene*/
-        std::vector<SceneClass*> m_sceneClasses;
+        /** Classes contained in the scene, mutable since they are read when first accessed */
+        mutable std::vector<SceneClass*> m_sceneClasses;
+
+        /** Name of file containing the scene */
+        AString m_deferredSceneFileName;
+        
+        /** Content of the scene file, empty once the scene's classes have been read */
+        mutable QByteArray m_deferredFileContent;
+        
+        /** Offset of the scene's XML in the file content */
+        int64_t m_deferredSceneOffset;
+        
+        /** Length of the scene's XML in the file content */
+        int64_t m_deferredSceneLength;
+        
+        /** Error from reading the scene's XML, reported on every access of the scene's classes */
+        mutable AString m_deferredSceneErrorMessage;
 
         /** Info about scene */
         SceneInfo* m_sceneInfo;
         
-        /** True if it found a ScenePathName with a remote file */
-        bool m_hasFilesWithRemotePaths;
+        /** True if it found a ScenePathName with a remote file, mutable since it is set when the scene's classes are read */
+        mutable bool m_hasFilesWithRemotePaths;
         
         /** When a scene is being created, this will be set */
         static Scene* s_sceneBeingCreated;
@@ -54,6 +54,7 @@ SceneInfo::SceneInfo(const SceneInfo& rhs) : CaretObject()
     m_balsaSceneID = rhs.m_balsaSceneID;
     m_imageFormat = rhs.m_imageFormat;
     m_imageBytes = rhs.m_imageBytes;
+    m_imageBase64 = rhs.m_imageBase64;
 }
 
 /**
@@ -116,6 +117,7 @@ SceneInfo::setImageBytes(const QByteArray& imageBytes,
                                   const AString& imageFormat)
 {
     m_imageBytes  = imageBytes;
+    m_imageBase64.clear();
     m_imageFormat = imageFormat;
 }
 
@@ -131,6 +133,10 @@ void
 SceneInfo::getImageBytes(QByteArray& imageBytesOut,
                                   AString& imageFormatOut) const
 {
+    if ( ! m_imageBase64.isEmpty()) {
+        m_imageBytes = QByteArray::fromBase64(m_imageBase64);
+        m_imageBase64.clear();
+    }
     imageBytesOut = m_imageBytes;
     imageFormatOut         = m_imageFormat;
 }
@@ -144,7 +150,8 @@ SceneInfo::getImageBytes(QByteArray& imageBytesOut,
 bool
 SceneInfo::hasImage() const
 {
-    if (m_imageBytes.isEmpty()) {
+    if (m_imageBytes.isEmpty()
+        && m_imageBase64.isEmpty()) {
         return false;
     }
     
@@ -200,10 +207,28 @@ SceneInfo::writeSceneInfo(XmlWriter& xmlWriter,
     xmlWriter.writeElementCData(SceneXmlElements::SCENE_INFO_DESCRIPTION_TAG,
                                        m_sceneDescription);
     
-    writeSceneInfoImage(xmlWriter,
-                        SceneXmlElements::SCENE_INFO_IMAGE_TAG,
-                        m_imageBytes,
-                        m_imageFormat);
+    if ( ! m_imageBase64.isEmpty()) {
+        /*
+         * Thumbnail was never displayed so write the text
+         * that was read without decoding and encoding it.
+         */
+        XmlAttributes imageAttributes;
+        imageAttributes.addAttribute(SceneXmlElements::SCENE_INFO_IMAGE_ENCODING_ATTRIBUTE,
+                                     SceneXmlElements::SCENE_INFO_ENCODING_BASE64_NAME);
+        imageAttributes.addAttribute(SceneXmlElements::SCENE_INFO_IMAGE_FORMAT_ATTRIBUTE,
+                                     m_imageFormat);
+        xmlWriter.writeStartElement(SceneXmlElements::SCENE_INFO_IMAGE_TAG,
+                                    imageAttributes);
+        xmlWriter.writeCharacters(QString::fromAscii(m_imageBase64.constData(),
+                                                     m_imageBase64.size()));
+        xmlWriter.writeEndElement();
+    }
+    else {
+        writeSceneInfoImage(xmlWriter,
+                            SceneXmlElements::SCENE_INFO_IMAGE_TAG,
+                            m_imageBytes,
+                            m_imageFormat);
+    }
     
     /*
      * End class element.
@@ -266,11 +291,16 @@ SceneInfo::setImageFromText(const AString& text,
                                const AString& imageFormat)
 {
     m_imageBytes.clear();
+    m_imageBase64.clear();
     m_imageFormat = "";
     
     if ( ! text.isEmpty()) {
         if (encoding == SceneXmlElements::SCENE_INFO_ENCODING_BASE64_NAME) {
-            m_imageBytes = QByteArray::fromBase64(text.toAscii());
+            /*
+             * Decoding is deferred until the image is requested since
+             * most thumbnails in a large scene file are never displayed.
+             */
+            m_imageBase64 = text.toAscii();
             m_imageFormat = imageFormat;
         }
         else {
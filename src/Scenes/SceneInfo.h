@@ -83,7 +83,10 @@ namespace caret {
         AString m_balsaSceneID;
         
         /** thumbnail image bytes */
-        QByteArray m_imageBytes;
+        mutable QByteArray m_imageBytes;
+        
+        /** base64 text of thumbnail read from file, decoded into m_imageBytes when first requested */
+        mutable QByteArray m_imageBase64;
         
         /** format of thumbnail image (eg: jpg, ppm, etc.) */
         AString m_imageFormat;
@@ -0,0 +1,115 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "PointLocatorTest.h"
+
+#include "CaretPointLocator.h"
+
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    float distSquared(const float* a, const float* b)
+    {
+        float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+}
+
+PointLocatorTest::PointLocatorTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void PointLocatorTest::execute()
+{
+    const int NUM_POINTS = 5000;
+    const int NUM_TARGETS = 500;
+    const float RANGE = 4.0f;
+    vector<float> points(NUM_POINTS * 3), targets(NUM_TARGETS * 3);
+    for (int i = 0; i < NUM_POINTS * 3; ++i)
+    {
+        points[i] = (rand() % 1000) / 10.0f;//coarse grid, so there are duplicate points and ties
+    }
+    for (int i = 0; i < 100 * 3; ++i)
+    {
+        points[i] = 50.0f;//many identical points, to test that the tree doesn't degenerate
+    }
+    for (int i = 0; i < NUM_TARGETS * 3; ++i)
+    {
+        targets[i] = (rand() % 1200) / 10.0f - 10.0f;//some outside the bounding box
+    }
+    CaretPointLocator myLocator(points.data(), NUM_POINTS);
+    vector<int64_t> batchClosest(NUM_TARGETS), batchLimited(NUM_TARGETS), rangeOffsets;
+    vector<LocatorInfo> rangeResults, singleRange;
+    myLocator.closestPoints(targets.data(), NUM_TARGETS, batchClosest.data());
+    myLocator.closestPoints(targets.data(), NUM_TARGETS, batchLimited.data(), RANGE);
+    myLocator.pointsInRange(targets.data(), NUM_TARGETS, RANGE, rangeOffsets, rangeResults);
+    for (int t = 0; t < NUM_TARGETS; ++t)
+    {
+        const float* target = targets.data() + t * 3;
+        float bestDist2 = -1.0f;
+        int inRange = 0;
+        for (int i = 0; i < NUM_POINTS; ++i)
+        {
+            float tempf = distSquared(points.data() + i * 3, target);
+            if (bestDist2 < 0.0f || tempf < bestDist2) bestDist2 = tempf;
+            if (tempf <= RANGE * RANGE) ++inRange;
+        }
+        int64_t closest = myLocator.closestPoint(target);
+        if (closest < 0 || distSquared(points.data() + closest * 3, target) != bestDist2) setFailed("closestPoint found wrong point for target " + AString::number(t));
+        if (batchClosest[t] < 0 || distSquared(points.data() + batchClosest[t] * 3, target) != bestDist2) setFailed("batch closest found wrong point for target " + AString::number(t));
+        if (bestDist2 <= RANGE * RANGE)
+        {
+            if (batchLimited[t] < 0 || distSquared(points.data() + batchLimited[t] * 3, target) != bestDist2) setFailed("batch limited closest found wrong point for target " + AString::number(t));
+        } else {
+            if (batchLimited[t] != -1) setFailed("batch limited closest found point outside range for target " + AString::number(t));
+            if (myLocator.closestPointLimited(target, RANGE) != -1) setFailed("closestPointLimited found point outside range for target " + AString::number(t));
+        }
+        if (myLocator.anyInRange(target, RANGE) != (bestDist2 < RANGE * RANGE)) setFailed("anyInRange gave wrong answer for target " + AString::number(t));
+        if (rangeOffsets[t + 1] - rangeOffsets[t] != inRange) setFailed("batch range query found wrong number of points for target " + AString::number(t));
+        myLocator.pointsInRange(target, RANGE, singleRange);
+        if ((int)singleRange.size() != inRange) setFailed("range query found wrong number of points for target " + AString::number(t));
+        if ((int)myLocator.pointsInRange(target, RANGE).size() != inRange) setFailed("set range query found wrong number of points for target " + AString::number(t));
+        for (int64_t i = rangeOffsets[t]; i < rangeOffsets[t + 1]; ++i)
+        {
+            if (distSquared(points.data() + rangeResults[i].index * 3, target) > RANGE * RANGE) setFailed("batch range query returned point outside range for target " + AString::number(t));
+        }
+    }
+    vector<float> farPoints(targets);//no ties with the first set, so the closest point's set is well defined
+    for (int i = 0; i < NUM_TARGETS * 3; ++i)
+    {
+        farPoints[i] += 1000.0f;
+    }
+    int32_t secondSet = myLocator.addPointSet(farPoints.data(), NUM_TARGETS);
+    LocatorInfo myInfo(-1, -1, Vector3D());
+    myLocator.closestPoint(farPoints.data() + 3, &myInfo);
+    if (myInfo.whichSet != secondSet || distSquared(farPoints.data() + myInfo.index * 3, farPoints.data() + 3) != 0.0f) setFailed("added point set not found");
+    myLocator.removePointSet(secondSet);
+    myLocator.closestPoint(targets.data() + 3, &myInfo);//ties are allowed, so compare distances rather than indexes
+    if (myInfo.whichSet != 0 || myInfo.index < 0 || distSquared(points.data() + myInfo.index * 3, targets.data() + 3) != distSquared(points.data() + batchClosest[1] * 3, targets.data() + 3)) setFailed("removed point set still found");
+    const float emptyBounds[3] = { 0.0f, 0.0f, 0.0f };
+    CaretPointLocator emptyLocator(emptyBounds, emptyBounds);
+    myInfo = LocatorInfo(0, 0, Vector3D());
+    if (emptyLocator.closestPoint(targets.data(), &myInfo) != -1 || myInfo.index != -1 || myInfo.whichSet != -1) setFailed("empty locator closestPoint did not return -1");
+    myInfo = LocatorInfo(0, 0, Vector3D());
+    if (emptyLocator.closestPointLimited(targets.data(), RANGE, &myInfo) != -1 || myInfo.index != -1 || myInfo.whichSet != -1) setFailed("empty locator closestPointLimited did not return -1");
+}
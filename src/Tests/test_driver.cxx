@@ -42,6 +42,7 @@
 #include "MathExpressionTest.h"
 #include "NiftiTest.h"
 #include "PointerTest.h"
+#include "PointLocatorTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
 #include "StatisticsTest.h"
@@ -79,6 +80,7 @@ int main(int argc, char** argv)
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
         mytests.push_back(new PointerTest("pointer"));
+        mytests.push_back(new PointLocatorTest("pointlocator"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
         mytests.push_back(new StatisticsTest("statistics"));
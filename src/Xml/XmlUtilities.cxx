@@ -225,8 +225,16 @@ XmlUtilities::getArrayOfNumbersFromText(const AString& elementName,
                                         const int32_t correctVectorLength,
                                         std::vector<float>& numbersOut)
 {
-    numbersOut.clear();
-    AString::toNumbers(text, numbersOut);
+    /*
+     * Text written by workbench is separated by whitespace, only
+     * use the tolerant (and much slower) conversion if that fails.
+     */
+    if ( ! AString::toNumbersSeparatedByWhitespace(text.constData(),
+                                                   text.size(),
+                                                   numbersOut)) {
+        numbersOut.clear();
+        AString::toNumbers(text, numbersOut);
+    }
     
     if (static_cast<int32_t>(numbersOut.size()) != correctVectorLength) {
         AString txt = XmlUtilities::createInvalidNumberOfElementsMessage(elementName,
@@ -259,8 +267,16 @@ XmlUtilities::getArrayOfNumbersFromText(const AString& elementName,
                                         const int32_t correctVectorLength,
                                         std::vector<int32_t>& numbersOut)
 {
-    numbersOut.clear();
-    AString::toNumbers(text, numbersOut);
+    /*
+     * Text written by workbench is separated by whitespace, only
+     * use the tolerant (and much slower) conversion if that fails.
+     */
+    if ( ! AString::toNumbersSeparatedByWhitespace(text.constData(),
+                                                   text.size(),
+                                                   numbersOut)) {
+        numbersOut.clear();
+        AString::toNumbers(text, numbersOut);
+    }
     
     if (static_cast<int32_t>(numbersOut.size()) != correctVectorLength) {
         AString txt = XmlUtilities::createInvalidNumberOfElementsMessage(elementName,